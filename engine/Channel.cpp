@@ -464,8 +464,7 @@ void Channel::connected(const char* reason)
     Message* m = message("chan.connected",false,true);
     if (reason)
 	m->setParam("reason",reason);
-    if (!Engine::enqueue(m))
-	TelEngine::destruct(m);
+    Engine::enqueue(m);
     getPeerId(m_lastPeerId);
 }
 
@@ -1511,10 +1510,13 @@ void Driver::statusParams(String& str)
 
 void Driver::statusDetail(String& str)
 {
+    StringBuilder out(str);
     ObjList* l = m_chans.skipNull();
     for (; l; l=l->skipNext()) {
 	Channel* c = static_cast<Channel*>(l->get());
-	str.append(c->id(),",") << "=" << c->status() << "|" << c->address() << "|" << c->getPeerId();
+	if (out.length())
+	    out << ",";
+	out << c->id() << "=" << c->status() << "|" << c->address() << "|" << c->getPeerId();
     }
 }
 
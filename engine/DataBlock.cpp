@@ -27,6 +27,15 @@
 
 using namespace TelEngine;
 
+// Vector kernels are built for x86 with compilers that support per function targets
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__)) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#define G711_SIMD
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 namespace { // anonymous
 
 extern "C" {
@@ -39,6 +48,269 @@ static unsigned char s2a[65536];
 static unsigned char s2u[65536];
 }
 
+// Conversion kernel, converts a number of samples
+typedef void (*ConvKernel)(const void* src, void* dst, unsigned int len);
+
+inline void encodeTable(const unsigned char* table, const void* src, void* dst, unsigned int len)
+{
+    const unsigned short* s = (const unsigned short*)src;
+    unsigned char* d = (unsigned char*)dst;
+    while (len--)
+	*d++ = table[*s++];
+}
+
+inline void decodeTable(const unsigned short* table, const void* src, void* dst, unsigned int len)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned short* d = (unsigned short*)dst;
+    while (len--)
+	*d++ = table[*s++];
+}
+
+inline void mapTable(const unsigned char* table, const void* src, void* dst, unsigned int len)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dst;
+    while (len--)
+	*d++ = table[*s++];
+}
+
+static void slinToAlaw(const void* src, void* dst, unsigned int len)
+{
+    encodeTable(s2a,src,dst,len);
+}
+
+static void slinToMulaw(const void* src, void* dst, unsigned int len)
+{
+    encodeTable(s2u,src,dst,len);
+}
+
+static void alawToSlin(const void* src, void* dst, unsigned int len)
+{
+    decodeTable(a2s,src,dst,len);
+}
+
+static void mulawToSlin(const void* src, void* dst, unsigned int len)
+{
+    decodeTable(u2s,src,dst,len);
+}
+
+// Byte to byte conversions stay table driven, no vector sequence beats
+//  a lookup in a 256 byte table
+static void alawToMulaw(const void* src, void* dst, unsigned int len)
+{
+    mapTable(a2u,src,dst,len);
+}
+
+static void mulawToAlaw(const void* src, void* dst, unsigned int len)
+{
+    mapTable(u2a,src,dst,len);
+}
+
+// Kernels in use, indexed by DataBlock::Conversion
+static ConvKernel s_kernels[DataBlock::MulawToAlaw + 1] = {
+    0, 0,
+    slinToAlaw, slinToMulaw,
+    alawToSlin, alawToMulaw,
+    mulawToSlin, mulawToAlaw
+};
+static int s_convLevel = 0;
+
+#ifdef G711_SIMD
+// Vector kernels produce exactly the same output as the tables
+
+// Multiply 8 values by 2 to the power of 8 small exponents, the powers
+//  are built in the exponent field of single precision floats
+TARGET_SSE2 inline __m128i mulPow2(__m128i t, __m128i e)
+{
+    __m128i lo = _mm_unpacklo_epi16(e,_mm_setzero_si128());
+    __m128i hi = _mm_unpackhi_epi16(e,_mm_setzero_si128());
+    lo = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(lo,_mm_set1_epi32(127)),23)));
+    hi = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(hi,_mm_set1_epi32(127)),23)));
+    return _mm_mullo_epi16(t,_mm_packs_epi32(lo,hi));
+}
+
+// Signed linear values of 8 A-law codes, one per 16 bit lane
+TARGET_SSE2 inline __m128i alawValue(__m128i a)
+{
+    a = _mm_xor_si128(a,_mm_set1_epi16(0x55));
+    __m128i seg = _mm_and_si128(_mm_srli_epi16(a,4),_mm_set1_epi16(7));
+    __m128i t = _mm_add_epi16(_mm_slli_epi16(_mm_and_si128(a,_mm_set1_epi16(15)),4),_mm_set1_epi16(8));
+    t = _mm_add_epi16(t,_mm_and_si128(_mm_cmpgt_epi16(seg,_mm_setzero_si128()),_mm_set1_epi16(0x100)));
+    t = mulPow2(t,_mm_subs_epu16(seg,_mm_set1_epi16(1)));
+    __m128i neg = _mm_cmpeq_epi16(_mm_and_si128(a,_mm_set1_epi16(0x80)),_mm_setzero_si128());
+    return _mm_sub_epi16(_mm_xor_si128(t,neg),neg);
+}
+
+// Signed linear values of 8 mu-law codes, one per 16 bit lane
+TARGET_SSE2 inline __m128i mulawValue(__m128i u)
+{
+    u = _mm_xor_si128(u,_mm_set1_epi16(0xff));
+    __m128i seg = _mm_and_si128(_mm_srli_epi16(u,4),_mm_set1_epi16(7));
+    __m128i t = _mm_add_epi16(_mm_slli_epi16(_mm_and_si128(u,_mm_set1_epi16(15)),3),_mm_set1_epi16(0x84));
+    t = _mm_sub_epi16(mulPow2(t,seg),_mm_set1_epi16(0x84));
+    __m128i neg = _mm_cmpgt_epi16(_mm_and_si128(u,_mm_set1_epi16(0x80)),_mm_setzero_si128());
+    return _mm_sub_epi16(_mm_xor_si128(t,neg),neg);
+}
+
+TARGET_SSE2 static void alawToSlinSSE2(const void* src, void* dst, unsigned int len)
+{
+    const __m128i* s = (const __m128i*)src;
+    __m128i* d = (__m128i*)dst;
+    for (; len >= 16; len -= 16, d += 2) {
+	__m128i a = _mm_loadu_si128(s++);
+	_mm_storeu_si128(d,alawValue(_mm_unpacklo_epi8(a,_mm_setzero_si128())));
+	_mm_storeu_si128(d + 1,alawValue(_mm_unpackhi_epi8(a,_mm_setzero_si128())));
+    }
+    decodeTable(a2s,s,d,len);
+}
+
+TARGET_SSE2 static void mulawToSlinSSE2(const void* src, void* dst, unsigned int len)
+{
+    const __m128i* s = (const __m128i*)src;
+    __m128i* d = (__m128i*)dst;
+    for (; len >= 16; len -= 16, d += 2) {
+	__m128i u = _mm_loadu_si128(s++);
+	_mm_storeu_si128(d,mulawValue(_mm_unpacklo_epi8(u,_mm_setzero_si128())));
+	_mm_storeu_si128(d + 1,mulawValue(_mm_unpackhi_epi8(u,_mm_setzero_si128())));
+    }
+    decodeTable(u2s,s,d,len);
+}
+
+// The encoders use the same rounding as the tables: a sample gets the next
+//  code once it reaches the value of the current one plus 8 (A-law, mu-law
+//  negative side: 12) or 4 (mu-law positive side). So for a magnitude y the
+//  code is the number of codes whose value is <= y, made of a segment and
+//  a mantissa. The segment is the bit length of y divided by the segment
+//  start, the mantissa needs a shift by a number of bits looked up for each
+//  lane. The high byte of each lookup index is 0x80 or 0 so it gets 0 or the
+//  first entry of the table which is always 0
+
+// Bit length of 8 bit values
+TARGET_AVX2 inline __m256i bitLength(__m256i q)
+{
+    const __m256i lo = _mm256_setr_epi8(0,1,2,2,3,3,3,3,4,4,4,4,4,4,4,4,
+	0,1,2,2,3,3,3,3,4,4,4,4,4,4,4,4);
+    const __m256i hi = _mm256_setr_epi8(0,5,6,6,7,7,7,7,8,8,8,8,8,8,8,8,
+	0,5,6,6,7,7,7,7,8,8,8,8,8,8,8,8);
+    return _mm256_max_epi16(_mm256_shuffle_epi8(lo,_mm256_and_si256(q,_mm256_set1_epi16(15))),
+	_mm256_shuffle_epi8(hi,_mm256_srli_epi16(q,4)));
+}
+
+// Shift right 16 lanes of values up to 32767 by up to 7 bits
+TARGET_AVX2 inline __m256i shiftRight(__m256i w, __m256i sh)
+{
+    const __m256i pow = _mm256_setr_epi8((char)128,64,32,16,8,4,2,1,0,0,0,0,0,0,0,0,
+	(char)128,64,32,16,8,4,2,1,0,0,0,0,0,0,0,0);
+    // (w * 2) * 2^(15 - sh) / 2^16, the multiplier is in the high byte
+    __m256i m = _mm256_shuffle_epi8(pow,_mm256_or_si256(_mm256_slli_epi16(sh,8),_mm256_set1_epi16(0x80)));
+    return _mm256_mulhi_epu16(_mm256_slli_epi16(w,1),m);
+}
+
+TARGET_AVX2 inline __m256i alawCode(__m256i x)
+{
+    __m256i neg = _mm256_srai_epi16(x,15);
+    __m256i y = _mm256_subs_epi16(_mm256_xor_si256(x,neg),neg);
+    y = _mm256_adds_epi16(y,_mm256_add_epi16(_mm256_set1_epi16(-8),_mm256_and_si256(neg,_mm256_set1_epi16(15))));
+    y = _mm256_max_epi16(_mm256_min_epi16(y,_mm256_set1_epi16(32256)),_mm256_setzero_si256());
+    // segment starts at 264 << (seg - 1), y / 264 computed as y * 63551 / 2^24
+    __m256i seg = bitLength(_mm256_srli_epi16(_mm256_mulhi_epu16(y,_mm256_set1_epi16((short)63551)),8));
+    __m256i w = shiftRight(y,_mm256_subs_epu16(seg,_mm256_set1_epi16(1)));
+    __m256i off = _mm256_add_epi16(_mm256_set1_epi16(8),
+	_mm256_and_si256(_mm256_cmpgt_epi16(seg,_mm256_setzero_si256()),_mm256_set1_epi16(256)));
+    __m256i r = _mm256_min_epi16(_mm256_srai_epi16(_mm256_sub_epi16(w,off),4),_mm256_set1_epi16(15));
+    r = _mm256_add_epi16(_mm256_add_epi16(r,_mm256_set1_epi16(1)),_mm256_slli_epi16(seg,4));
+    r = _mm256_max_epi16(_mm256_min_epi16(_mm256_add_epi16(r,neg),_mm256_set1_epi16(127)),_mm256_setzero_si256());
+    r = _mm256_or_si256(r,_mm256_and_si256(neg,_mm256_set1_epi16(0x80)));
+    return _mm256_xor_si256(r,_mm256_set1_epi16(0xd5));
+}
+
+TARGET_AVX2 inline __m256i mulawCode(__m256i x)
+{
+    __m256i neg = _mm256_srai_epi16(x,15);
+    __m256i y = _mm256_subs_epi16(_mm256_xor_si256(x,neg),neg);
+    y = _mm256_adds_epi16(y,_mm256_add_epi16(_mm256_set1_epi16(-4),_mm256_and_si256(neg,_mm256_set1_epi16(15))));
+    y = _mm256_min_epi16(y,_mm256_set1_epi16(32124));
+    __m256i w = _mm256_add_epi16(y,_mm256_set1_epi16(132));
+    // segment starts at 132 << seg, w / 132 computed as w * 63551 / 2^23
+    __m256i seg = bitLength(_mm256_srli_epi16(_mm256_mulhi_epu16(w,_mm256_set1_epi16((short)63551)),7));
+    seg = _mm256_subs_epu16(seg,_mm256_set1_epi16(1));
+    w = shiftRight(w,seg);
+    __m256i r = _mm256_min_epi16(_mm256_srai_epi16(_mm256_sub_epi16(w,_mm256_set1_epi16(132)),3),_mm256_set1_epi16(15));
+    r = _mm256_add_epi16(_mm256_add_epi16(r,_mm256_set1_epi16(1)),_mm256_slli_epi16(seg,4));
+    r = _mm256_min_epi16(_mm256_add_epi16(r,neg),_mm256_set1_epi16(127));
+    r = _mm256_max_epi16(r,_mm256_and_si256(neg,_mm256_set1_epi16(1)));
+    return _mm256_xor_si256(r,_mm256_xor_si256(_mm256_set1_epi16(0xff),_mm256_and_si256(neg,_mm256_set1_epi16(0x80))));
+}
+
+// Decoders look up the power of 2 of the segment
+TARGET_AVX2 inline __m256i alawValue(__m256i a)
+{
+    const __m256i pow = _mm256_setr_epi8(1,1,2,4,8,16,32,64,0,0,0,0,0,0,0,0,
+	1,1,2,4,8,16,32,64,0,0,0,0,0,0,0,0);
+    a = _mm256_xor_si256(a,_mm256_set1_epi16(0x55));
+    __m256i seg = _mm256_and_si256(_mm256_srli_epi16(a,4),_mm256_set1_epi16(7));
+    __m256i t = _mm256_add_epi16(_mm256_slli_epi16(_mm256_and_si256(a,_mm256_set1_epi16(15)),4),_mm256_set1_epi16(8));
+    t = _mm256_add_epi16(t,_mm256_and_si256(_mm256_cmpgt_epi16(seg,_mm256_setzero_si256()),_mm256_set1_epi16(0x100)));
+    // the high byte of each index is 0x80 so it becomes 0
+    t = _mm256_mullo_epi16(t,_mm256_shuffle_epi8(pow,_mm256_or_si256(seg,_mm256_set1_epi16((short)0x8000))));
+    __m256i neg = _mm256_cmpeq_epi16(_mm256_and_si256(a,_mm256_set1_epi16(0x80)),_mm256_setzero_si256());
+    return _mm256_sub_epi16(_mm256_xor_si256(t,neg),neg);
+}
+
+TARGET_AVX2 inline __m256i mulawValue(__m256i u)
+{
+    const __m256i pow = _mm256_setr_epi8(1,2,4,8,16,32,64,(char)128,0,0,0,0,0,0,0,0,
+	1,2,4,8,16,32,64,(char)128,0,0,0,0,0,0,0,0);
+    u = _mm256_xor_si256(u,_mm256_set1_epi16(0xff));
+    __m256i seg = _mm256_and_si256(_mm256_srli_epi16(u,4),_mm256_set1_epi16(7));
+    __m256i t = _mm256_add_epi16(_mm256_slli_epi16(_mm256_and_si256(u,_mm256_set1_epi16(15)),3),_mm256_set1_epi16(0x84));
+    t = _mm256_mullo_epi16(t,_mm256_shuffle_epi8(pow,_mm256_or_si256(seg,_mm256_set1_epi16((short)0x8000))));
+    t = _mm256_sub_epi16(t,_mm256_set1_epi16(0x84));
+    __m256i neg = _mm256_cmpgt_epi16(_mm256_and_si256(u,_mm256_set1_epi16(0x80)),_mm256_setzero_si256());
+    return _mm256_sub_epi16(_mm256_xor_si256(t,neg),neg);
+}
+
+TARGET_AVX2 static void slinToAlawAVX2(const void* src, void* dst, unsigned int len)
+{
+    const __m256i* s = (const __m256i*)src;
+    __m256i* d = (__m256i*)dst;
+    // packing works on 128 bit halves, put the quadwords back in order
+    for (; len >= 32; len -= 32, s += 2)
+	_mm256_storeu_si256(d++,_mm256_permute4x64_epi64(_mm256_packus_epi16(
+	    alawCode(_mm256_loadu_si256(s)),alawCode(_mm256_loadu_si256(s + 1))),0xd8));
+    encodeTable(s2a,s,d,len);
+}
+
+TARGET_AVX2 static void slinToMulawAVX2(const void* src, void* dst, unsigned int len)
+{
+    const __m256i* s = (const __m256i*)src;
+    __m256i* d = (__m256i*)dst;
+    for (; len >= 32; len -= 32, s += 2)
+	_mm256_storeu_si256(d++,_mm256_permute4x64_epi64(_mm256_packus_epi16(
+	    mulawCode(_mm256_loadu_si256(s)),mulawCode(_mm256_loadu_si256(s + 1))),0xd8));
+    encodeTable(s2u,s,d,len);
+}
+
+TARGET_AVX2 static void alawToSlinAVX2(const void* src, void* dst, unsigned int len)
+{
+    const __m128i* s = (const __m128i*)src;
+    __m256i* d = (__m256i*)dst;
+    for (; len >= 16; len -= 16)
+	_mm256_storeu_si256(d++,alawValue(_mm256_cvtepu8_epi16(_mm_loadu_si128(s++))));
+    decodeTable(a2s,s,d,len);
+}
+
+TARGET_AVX2 static void mulawToSlinAVX2(const void* src, void* dst, unsigned int len)
+{
+    const __m128i* s = (const __m128i*)src;
+    __m256i* d = (__m256i*)dst;
+    for (; len >= 16; len -= 16)
+	_mm256_storeu_si256(d++,mulawValue(_mm256_cvtepu8_epi16(_mm_loadu_si128(s++))));
+    decodeTable(u2s,s,d,len);
+}
+#endif // G711_SIMD
+
 class InitG711
 {
 public:
@@ -71,6 +343,7 @@ public:
 		val = (--v) ^ 0xd5;
 	    s2a[i] = val;
 	}
+	DataBlock::convertLevel(2);
     }
 };
 
@@ -86,19 +359,19 @@ const DataBlock& DataBlock::empty()
 }
 
 DataBlock::DataBlock()
-    : m_data(0), m_length(0)
+    : m_data(0), m_length(0), m_offset(0), m_buffer(0), m_size(0)
 {
 }
 
 DataBlock::DataBlock(const DataBlock& value)
     : GenObject(),
-      m_data(0), m_length(0)
+      m_data(0), m_length(0), m_offset(0), m_buffer(0), m_size(0)
 {
     assign(value.data(),value.length());
 }
 
 DataBlock::DataBlock(void* value, unsigned int len, bool copyData)
-    : m_data(0), m_length(0)
+    : m_data(0), m_length(0), m_offset(0), m_buffer(0), m_size(0)
 {
     assign(value,len,copyData);
 }
@@ -117,51 +390,155 @@ void* DataBlock::getObject(const String& name) const
 
 void DataBlock::clear(bool deleteData)
 {
+    void* buf = m_buffer;
+    m_data = 0;
     m_length = 0;
-    if (m_data) {
-	void *data = m_data;
-	m_data = 0;
-	if (deleteData)
-	    ::free(data);
+    m_offset = 0;
+    m_buffer = 0;
+    m_size = 0;
+    if (buf && deleteData)
+	::free(buf);
+}
+
+// Move the data in a new buffer of given size, at given offset from its start
+bool DataBlock::relocate(unsigned int head, unsigned int size)
+{
+    void* buf = 0;
+    if (!(head || m_offset))
+	buf = ::realloc(m_buffer,size);
+    else {
+	buf = ::malloc(size);
+	if (buf) {
+	    if (m_length)
+		::memcpy(head + (char*)buf,m_data,m_length);
+	    if (m_buffer)
+		::free(m_buffer);
+	}
+    }
+    if (!buf) {
+	Debug("DataBlock",DebugFail,"malloc(%u) returned NULL!",size);
+	return false;
+    }
+    m_buffer = buf;
+    m_size = size;
+    m_offset = head;
+    m_data = m_length ? (head + (char*)buf) : 0;
+    return true;
+}
+
+// Make room for len bytes after the data, grow the buffer geometrically
+bool DataBlock::growTail(unsigned int len)
+{
+    unsigned int need = m_length + len;
+    if (m_offset + need <= m_size)
+	return true;
+    if ((need <= m_size) && (m_offset >= m_length)) {
+	// more was cut from the front than we have to move
+	if (m_length) {
+	    ::memmove(m_buffer,m_data,m_length);
+	    m_data = m_buffer;
+	}
+	m_offset = 0;
+	return true;
     }
+    unsigned int size = m_size + (m_size >> 1);
+    if (size < need)
+	size = need;
+    return relocate(0,size);
+}
+
+// Make room for len bytes in front of the data, the new space goes at head
+bool DataBlock::growHead(unsigned int len)
+{
+    if (m_offset >= len)
+	return true;
+    unsigned int need = m_length + len;
+    unsigned int tail = tailroom();
+    if ((need <= m_size) && (tail >= m_length)) {
+	unsigned int head = m_size - m_length;
+	if (m_length) {
+	    ::memmove(head + (char*)m_buffer,m_data,m_length);
+	    m_data = head + (char*)m_buffer;
+	}
+	m_offset = head;
+	return true;
+    }
+    unsigned int size = m_size + (m_size >> 1);
+    if (size < need + tail)
+	size = need + tail;
+    return relocate(size - m_length - tail,size);
+}
+
+void DataBlock::reserve(unsigned int tail, unsigned int head)
+{
+    unsigned int room = tailroom();
+    if ((m_offset >= head) && (room >= tail))
+	return;
+    if (head < m_offset)
+	head = m_offset;
+    if (tail < room)
+	tail = room;
+    relocate(head,head + m_length + tail);
 }
 
 DataBlock& DataBlock::assign(void* value, unsigned int len, bool copyData)
 {
-    if ((value != m_data) || (len != m_length)) {
-	void *odata = m_data;
-	m_length = 0;
-	m_data = 0;
-	if (len) {
-	    if (copyData) {
-		void *data = ::malloc(len);
-		if (data) {
-		    if (value)
-			::memcpy(data,value,len);
-		    else
-			::memset(data,0,len);
-		    m_data = data;
-		}
-		else
-		    Debug("DataBlock",DebugFail,"malloc(%d) returned NULL!",len);
-	    }
-	    else
-		m_data = value;
-	    if (m_data)
-		m_length = len;
+    if (!len) {
+	clear();
+	return *this;
+    }
+    if (value && (value == m_data)) {
+	// shrinking or growing in place inside our own buffer
+	if (len == m_length)
+	    return *this;
+	if (m_offset + len <= m_size) {
+	    m_length = len;
+	    return *this;
 	}
-	if (odata && (odata != m_data))
-	    ::free(odata);
+    }
+    void* obuf = m_buffer;
+    if (!copyData) {
+	m_buffer = m_data = value;
+	m_length = m_size = len;
+	m_offset = 0;
+	if (obuf && (obuf != value))
+	    ::free(obuf);
+	return *this;
+    }
+    // keep the buffer if the new data fits and uses at least half of it
+    if (obuf && (len <= m_size) && (len >= (m_size >> 1))) {
+	if (value)
+	    ::memmove(obuf,value,len);
+	else
+	    ::memset(obuf,0,len);
+	m_data = obuf;
+	m_length = len;
+	m_offset = 0;
+	return *this;
+    }
+    void* data = ::malloc(len);
+    if (data) {
+	if (value)
+	    ::memcpy(data,value,len);
+	else
+	    ::memset(data,0,len);
+	m_buffer = m_data = data;
+	m_length = m_size = len;
+	m_offset = 0;
+	if (obuf)
+	    ::free(obuf);
+    }
+    else {
+	Debug("DataBlock",DebugFail,"malloc(%d) returned NULL!",len);
+	clear();
     }
     return *this;
 }
 
 void DataBlock::truncate(unsigned int len)
 {
-    if (!len)
-	clear();
-    else if (len < m_length)
-	assign(m_data,len);
+    if (len < m_length)
+	cut(m_length - len);
 }
 
 void DataBlock::cut(int len)
@@ -169,16 +546,20 @@ void DataBlock::cut(int len)
     if (!len)
 	return;
 
-    int ofs = 0;
+    unsigned int ofs = 0;
     if (len < 0)
 	ofs = len = -len;
 
     if ((unsigned)len >= m_length) {
-	clear();
+	m_data = 0;
+	m_length = 0;
+	m_offset = 0;
 	return;
     }
 
-    assign(ofs+(char *)m_data,m_length - len);
+    m_offset += ofs;
+    m_data = ofs + (char*)m_data;
+    m_length -= len;
 }
 
 DataBlock& DataBlock::operator=(const DataBlock& value)
@@ -187,106 +568,208 @@ DataBlock& DataBlock::operator=(const DataBlock& value)
     return *this;
 }
 
-void DataBlock::append(const DataBlock& value)
+void DataBlock::append(void* value, unsigned int len)
 {
-    if (m_length) {
-	if (value.length()) {
-	    unsigned int len = m_length+value.length();
-	    void *data = ::malloc(len);
-	    if (data) {
-		::memcpy(data,m_data,m_length);
-		::memcpy(m_length+(char*)data,value.data(),value.length());
-		assign(data,len,false);
-	    }
-	    else
-		Debug("DataBlock",DebugFail,"malloc(%d) returned NULL!",len);
-	}
+    if (!len)
+	return;
+    if (!(m_length || m_buffer)) {
+	assign(value,len);
+	return;
     }
-    else
-	assign(value.data(),value.length());
+    // the source may be part of our own data that is about to move
+    int ofs = -1;
+    if (m_data && (value >= m_data) && (value < (m_length + (char*)m_data)))
+	ofs = (char*)value - (char*)m_data;
+    if (!growTail(len))
+	return;
+    if (ofs >= 0)
+	value = ofs + (char*)m_data;
+    ::memcpy(m_offset + m_length + (char*)m_buffer,value,len);
+    m_data = m_offset + (char*)m_buffer;
+    m_length += len;
+}
+
+void DataBlock::append(const DataBlock& value)
+{
+    append(value.data(),value.length());
 }
 
 void DataBlock::append(const String& value)
 {
-    if (m_length) {
-	if (value.length()) {
-	    unsigned int len = m_length+value.length();
-	    void *data = ::malloc(len);
-	    if (data) {
-		::memcpy(data,m_data,m_length);
-		::memcpy(m_length+(char*)data,value.safe(),value.length());
-		assign(data,len,false);
-	    }
-	    else
-		Debug("DataBlock",DebugFail,"malloc(%d) returned NULL!",len);
-	}
+    append((void*)value.c_str(),value.length());
+}
+
+void DataBlock::insert(void* value, unsigned int len)
+{
+    if (!len)
+	return;
+    if (!(m_length || m_buffer)) {
+	assign(value,len);
+	return;
     }
-    else
-	assign((void*)value.c_str(),value.length());
+    int ofs = -1;
+    if (m_data && (value >= m_data) && (value < (m_length + (char*)m_data)))
+	ofs = (char*)value - (char*)m_data;
+    if (!growHead(len))
+	return;
+    if (ofs >= 0)
+	value = ofs + (char*)m_data;
+    m_offset -= len;
+    m_data = m_offset + (char*)m_buffer;
+    ::memcpy(m_data,value,len);
+    m_length += len;
 }
 
 void DataBlock::insert(const DataBlock& value)
 {
-    unsigned int vl = value.length();
-    if (m_length) {
-	if (vl) {
-	    unsigned int len = m_length+vl;
-	    void *data = ::malloc(len);
-	    if (data) {
-		::memcpy(data,value.data(),vl);
-		::memcpy(vl+(char*)data,m_data,m_length);
-		assign(data,len,false);
-	    }
-	    else
-		Debug("DataBlock",DebugFail,"malloc(%d) returned NULL!",len);
-	}
+    insert(value.data(),value.length());
+}
+
+
+namespace { // anonymous
+
+// Reference counted holder of the buffer shared by slices
+class SliceBuffer : public RefObject
+{
+public:
+    DataBlock m_block;
+};
+
+}; // anonymous namespace
+
+DataSlice::DataSlice()
+    : m_buffer(0), m_data(0), m_length(0)
+{
+}
+
+DataSlice::DataSlice(const DataSlice& value)
+    : GenObject(),
+      m_buffer(0), m_data(0), m_length(0)
+{
+    set(value.m_buffer,value.m_data,value.m_length);
+}
+
+DataSlice::DataSlice(const DataSlice& value, unsigned int offs, unsigned int len)
+    : GenObject(),
+      m_buffer(0), m_data(0), m_length(0)
+{
+    if (offs >= value.m_length)
+	return;
+    if (len > value.m_length - offs)
+	len = value.m_length - offs;
+    set(value.m_buffer,value.m_data + offs,len);
+}
+
+DataSlice::DataSlice(const DataBlock& value)
+    : m_buffer(0), m_data(0), m_length(0)
+{
+    if (!value.length())
+	return;
+    SliceBuffer* buf = new SliceBuffer;
+    buf->m_block = value;
+    set(buf,(const unsigned char*)buf->m_block.data(),buf->m_block.length());
+    buf->deref();
+}
+
+DataSlice::DataSlice(DataBlock& value, bool take)
+    : m_buffer(0), m_data(0), m_length(0)
+{
+    if (!value.length())
+	return;
+    SliceBuffer* buf = new SliceBuffer;
+    DataBlock& b = buf->m_block;
+    if (take) {
+	b.m_data = value.m_data;
+	b.m_length = value.m_length;
+	b.m_offset = value.m_offset;
+	b.m_buffer = value.m_buffer;
+	b.m_size = value.m_size;
+	value.clear(false);
     }
     else
-	assign(value.data(),vl);
+	b = value;
+    set(buf,(const unsigned char*)b.data(),b.length());
+    buf->deref();
 }
 
-bool DataBlock::convert(const DataBlock& src, const String& sFormat,
-    const String& dFormat, unsigned maxlen)
+DataSlice::~DataSlice()
 {
-    if (sFormat == dFormat) {
-	operator=(src);
-	return true;
-    }
-    unsigned sl = 0, dl = 0;
-    void *ctable = 0;
-    if (sFormat == YSTRING("slin")) {
-	sl = 2;
-	dl = 1;
-	if (dFormat == YSTRING("alaw"))
-	    ctable = s2a;
-	else if (dFormat == YSTRING("mulaw"))
-	    ctable = s2u;
+    clear();
+}
+
+void DataSlice::set(RefObject* buffer, const unsigned char* data, unsigned int len)
+{
+    if (!(len && buffer && buffer->ref())) {
+	clear();
+	return;
     }
-    else if (sFormat == YSTRING("alaw")) {
-	sl = 1;
-	if (dFormat == YSTRING("mulaw")) {
-	    dl = 1;
-	    ctable = a2u;
-	}
-	else if (dFormat == YSTRING("slin")) {
-	    dl = 2;
-	    ctable = a2s;
-	}
+    RefObject* old = m_buffer;
+    m_buffer = buffer;
+    m_data = data;
+    m_length = len;
+    if (old)
+	old->deref();
+}
+
+void DataSlice::clear()
+{
+    RefObject* old = m_buffer;
+    m_buffer = 0;
+    m_data = 0;
+    m_length = 0;
+    if (old)
+	old->deref();
+}
+
+void DataSlice::cut(int len)
+{
+    if (!len)
+	return;
+    unsigned int ofs = 0;
+    if (len < 0)
+	ofs = len = -len;
+    if ((unsigned int)len >= m_length) {
+	clear();
+	return;
     }
-    else if (sFormat == YSTRING("mulaw")) {
-	sl = 1;
-	if (dFormat == YSTRING("alaw")) {
-	    dl = 1;
-	    ctable = u2a;
-	}
-	else if (dFormat == YSTRING("slin")) {
+    m_data += ofs;
+    m_length -= len;
+}
+
+DataSlice& DataSlice::operator=(const DataSlice& value)
+{
+    if (&value != this)
+	set(value.m_buffer,value.m_data,value.m_length);
+    return *this;
+}
+
+bool DataBlock::convert(const DataBlock& src, const String& sFormat,
+    const String& dFormat, unsigned maxlen)
+{
+    return convert(src,conversion(sFormat,dFormat),maxlen);
+}
+
+bool DataBlock::convert(const DataBlock& src, Conversion conv, unsigned maxlen)
+{
+    unsigned sl = 1, dl = 1;
+    switch (conv) {
+	case CopyData:
+	    operator=(src);
+	    return true;
+	case SlinToAlaw:
+	case SlinToMulaw:
+	    sl = 2;
+	    break;
+	case AlawToSlin:
+	case MulawToSlin:
 	    dl = 2;
-	    ctable = u2s;
-	}
-    }
-    if (!ctable) {
-	clear();
-	return false;
+	    break;
+	case AlawToMulaw:
+	case MulawToAlaw:
+	    break;
+	default:
+	    clear();
+	    return false;
     }
     unsigned len = src.length();
     if (maxlen && (maxlen < len))
@@ -297,28 +780,62 @@ bool DataBlock::convert(const DataBlock& src, const String& sFormat,
 	return true;
     }
     resize(len * dl);
-    if ((sl == 1) && (dl == 1)) {
-	unsigned char *s = (unsigned char *) src.data();
-	unsigned char *d = (unsigned char *) data();
-	unsigned char *c = (unsigned char *) ctable;
-	while (len--)
-	    *d++ = c[*s++];
+    s_kernels[conv](src.data(),data(),len);
+    return true;
+}
+
+DataBlock::Conversion DataBlock::conversion(const String& sFormat, const String& dFormat)
+{
+    if (sFormat == dFormat)
+	return CopyData;
+    if (sFormat == YSTRING("slin")) {
+	if (dFormat == YSTRING("alaw"))
+	    return SlinToAlaw;
+	if (dFormat == YSTRING("mulaw"))
+	    return SlinToMulaw;
+    }
+    else if (sFormat == YSTRING("alaw")) {
+	if (dFormat == YSTRING("mulaw"))
+	    return AlawToMulaw;
+	if (dFormat == YSTRING("slin"))
+	    return AlawToSlin;
     }
-    else if ((sl == 1) && (dl == 2)) {
-	unsigned char *s = (unsigned char *) src.data();
-	unsigned short *d = (unsigned short *) data();
-	unsigned short *c = (unsigned short *) ctable;
-	while (len--)
-	    *d++ = c[*s++];
+    else if (sFormat == YSTRING("mulaw")) {
+	if (dFormat == YSTRING("alaw"))
+	    return MulawToAlaw;
+	if (dFormat == YSTRING("slin"))
+	    return MulawToSlin;
     }
-    else if ((sl == 2) && (dl == 1)) {
-	unsigned short *s = (unsigned short *) src.data();
-	unsigned char *d = (unsigned char *) data();
-	unsigned char *c = (unsigned char *) ctable;
-	while (len--)
-	    *d++ = c[*s++];
+    return NoConversion;
+}
+
+int DataBlock::convertLevel(int level)
+{
+    if (level < 0)
+	return s_convLevel;
+#ifdef G711_SIMD
+    __builtin_cpu_init();
+    if ((level >= 2) && __builtin_cpu_supports("avx2")) {
+	s_kernels[SlinToAlaw] = slinToAlawAVX2;
+	s_kernels[SlinToMulaw] = slinToMulawAVX2;
+	s_kernels[AlawToSlin] = alawToSlinAVX2;
+	s_kernels[MulawToSlin] = mulawToSlinAVX2;
+	return (s_convLevel = 2);
     }
-    return true;
+    if ((level >= 1) && __builtin_cpu_supports("sse2")) {
+	// without byte shuffles computing codes is slower than the tables
+	s_kernels[SlinToAlaw] = slinToAlaw;
+	s_kernels[SlinToMulaw] = slinToMulaw;
+	s_kernels[AlawToSlin] = alawToSlinSSE2;
+	s_kernels[MulawToSlin] = mulawToSlinSSE2;
+	return (s_convLevel = 1);
+    }
+#endif
+    s_kernels[SlinToAlaw] = slinToAlaw;
+    s_kernels[SlinToMulaw] = slinToMulaw;
+    s_kernels[AlawToSlin] = alawToSlin;
+    s_kernels[MulawToSlin] = mulawToSlin;
+    return (s_convLevel = 0);
 }
 
 // Decode a single nibble, return -1 on error
@@ -24,6 +24,23 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Vector kernels are built for x86 with compilers that support per function targets
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__)) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#define RESAMP_SIMD
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Resampler filter lengths are a multiple of this so vector loops have no tail
+#define RESAMP_TAPS 16
 
 namespace TelEngine {
 
@@ -42,6 +59,8 @@ static const FormatInfo s_formats[] = {
     FormatInfo("2*slin/32000", 1280, 10000, "audio", 32000, 2),
     FormatInfo("2*alaw", 160, 10000, "audio", 8000, 2),
     FormatInfo("2*mulaw", 160, 10000, "audio", 8000, 2),
+    FormatInfo("slin/44100", 882, 10000, "audio", 44100, 1, true),
+    FormatInfo("slin/48000", 960, 10000, "audio", 48000, 1, true),
     FormatInfo("gsm", 33, 20000),
     FormatInfo("ilbc20", 38, 20000),
     FormatInfo("ilbc30", 50, 30000),
@@ -89,13 +108,29 @@ static TranslatorCaps s_simpleCaps32k[] = {
     { 0, 0, 0 }
 };
 
+// Direct resampling between any two rates is always cheaper than a chain,
+//  decimating by more than 2 needs longer filters so it costs more
 static TranslatorCaps s_resampCaps[] = {
     { s_formats+0, s_formats+3, 2 },
     { s_formats+0, s_formats+6, 2 },
+    { s_formats+0, s_formats+14, 2 },
+    { s_formats+0, s_formats+15, 2 },
     { s_formats+3, s_formats+0, 2 },
     { s_formats+3, s_formats+6, 2 },
-    { s_formats+6, s_formats+0, 2 },
+    { s_formats+3, s_formats+14, 2 },
+    { s_formats+3, s_formats+15, 2 },
+    { s_formats+6, s_formats+0, 3 },
     { s_formats+6, s_formats+3, 2 },
+    { s_formats+6, s_formats+14, 2 },
+    { s_formats+6, s_formats+15, 2 },
+    { s_formats+14, s_formats+0, 3 },
+    { s_formats+14, s_formats+3, 3 },
+    { s_formats+14, s_formats+6, 2 },
+    { s_formats+14, s_formats+15, 2 },
+    { s_formats+15, s_formats+0, 3 },
+    { s_formats+15, s_formats+3, 3 },
+    { s_formats+15, s_formats+6, 2 },
+    { s_formats+15, s_formats+14, 2 },
     { 0, 0, 0 }
 };
 
@@ -144,27 +179,28 @@ class SimpleTranslator : public DataTranslator
 {
 public:
     SimpleTranslator(const DataFormat& sFormat, const DataFormat& dFormat)
-	: DataTranslator(sFormat,dFormat), m_valid(false) {
+	: DataTranslator(sFormat,dFormat), m_conv(DataBlock::NoConversion) {
 	    if (!getTransSource())
 		return;
 	    int nchan = m_format.numChannels();
 	    if (nchan != getTransSource()->getFormat().numChannels())
 		return;
-	    m_valid = true;
-	    m_sFmt = m_format;
-	    m_dFmt = getTransSource()->getFormat();
+	    String sFmt = m_format;
+	    String dFmt = getTransSource()->getFormat();
 	    if (nchan != 1) {
 		// get rid of the channel prefix
-		m_sFmt >> "*";
-		m_dFmt >> "*";
+		sFmt >> "*";
+		dFmt >> "*";
 	    }
+	    // resolve the conversion once, not for every data block
+	    m_conv = DataBlock::conversion(sFmt,dFmt);
 	}
     virtual unsigned long Consume(const DataBlock& data, unsigned long tStamp, unsigned long flags)
 	{
 	    if (!ref())
 		return 0;
 	    unsigned long len = 0;
-	    if (m_valid && getTransSource() && m_buffer.convert(data,m_sFmt,m_dFmt)) {
+	    if (m_conv && getTransSource() && m_buffer.convert(data,m_conv)) {
 		if (tStamp == invalidStamp()) {
 		    unsigned int delta = data.length();
 		    if (delta > m_buffer.length())
@@ -178,75 +214,65 @@ public:
 	    return len;
 	}
 private:
-    bool m_valid;
-    String m_sFmt;
-    String m_dFmt;
+    DataBlock::Conversion m_conv;
     DataBlock m_buffer;
 };
 
-// slin basic mono resampler
+typedef int (*ResampDot)(const short* x, const short* c, unsigned int n);
+
+// Dot product of samples and Q15 filter coefficients
+static int resampDot(const short* x, const short* c, unsigned int n)
+{
+    int sum = 0;
+    while (n--)
+	sum += (int)*x++ * *c++;
+    return sum;
+}
+
+#ifdef RESAMP_SIMD
+TARGET_SSE2 static int resampDotSSE2(const short* x, const short* c, unsigned int n)
+{
+    __m128i sum = _mm_setzero_si128();
+    for (; n; n -= 8, x += 8, c += 8)
+	sum = _mm_add_epi32(sum,_mm_madd_epi16(_mm_loadu_si128((const __m128i*)x),
+	    _mm_loadu_si128((const __m128i*)c)));
+    sum = _mm_add_epi32(sum,_mm_shuffle_epi32(sum,0x4e));
+    sum = _mm_add_epi32(sum,_mm_shuffle_epi32(sum,0xb1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+TARGET_AVX2 static int resampDotAVX2(const short* x, const short* c, unsigned int n)
+{
+    __m256i sum = _mm256_setzero_si256();
+    for (; n; n -= 16, x += 16, c += 16)
+	sum = _mm256_add_epi32(sum,_mm256_madd_epi16(_mm256_loadu_si256((const __m256i*)x),
+	    _mm256_loadu_si256((const __m256i*)c)));
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum),_mm256_extracti128_si256(sum,1));
+    s = _mm_add_epi32(s,_mm_shuffle_epi32(s,0x4e));
+    s = _mm_add_epi32(s,_mm_shuffle_epi32(s,0xb1));
+    return _mm_cvtsi128_si32(s);
+}
+#endif
+
+// slin mono polyphase FIR resampler for any rational rate ratio
 class ResampTranslator : public DataTranslator
 {
-private:
-    int m_sRate, m_dRate;
-    short m_last;
 public:
-    ResampTranslator(const DataFormat& sFormat, const DataFormat& dFormat)
-	: DataTranslator(sFormat,dFormat),
-	m_sRate(sFormat.sampleRate()), m_dRate(dFormat.sampleRate()), m_last(0)
-	{ }
-    virtual unsigned long Consume(const DataBlock& data, unsigned long tStamp, unsigned long flags)
-	{
-	    unsigned int n = data.length();
-	    if (!n || (n & 1) || !m_sRate || !m_dRate || !ref())
-		return 0;
-	    unsigned long len = 0;
-	    n /= 2;
-	    DataSource* src = getTransSource();
-	    if (src) {
-		long delta = tStamp - m_timestamp;
-		short* s = (short*) data.data();
-		DataBlock oblock;
-		if (m_dRate > m_sRate) {
-		    int mul = m_dRate / m_sRate;
-		    // linear interpolation between existing samples
-		    delta *= mul;
-		    oblock.assign(0,2*n*mul);
-		    short* d = (short*) oblock.data();
-		    while (n--) {
-			short v = *s++;
-			for (int i = 1; i <= mul; i++)
-			    *d++ = ((m_last * (mul - i)) + (v * i)) / mul;
-			m_last = v;
-		    }
-		}
-		else {
-		    int div = m_sRate / m_dRate;
-		    // average an integer number of samples
-		    delta /= div;
-		    n /= div;
-		    oblock.assign(0,2*n);
-		    short* d = (short*) oblock.data();
-		    while (n--) {
-			int v = 0;
-			for (int i = 0; i < div; i++)
-			    v += *s++;
-			v /= div;
-			// saturate average result
-			if (v > 32767)
-			    v = 32767;
-			if (v < -32767)
-			    v = -32767;
-			*d++ = v;
-		    }
-		}
-		if (src->timeStamp() != invalidStamp())
-		    delta += src->timeStamp();
-		len = src->Forward(oblock, delta, flags);
-	    }
-	    deref();
-	    return len;
-	}
+    ResampTranslator(const DataFormat& sFormat, const DataFormat& dFormat);
+    virtual ~ResampTranslator();
+    virtual unsigned long Consume(const DataBlock& data, unsigned long tStamp, unsigned long flags);
+private:
+    unsigned int m_up, m_down;
+    unsigned int m_taps;
+    short* m_coefs;
+    short* m_hist;
+    unsigned int m_histSize;
+    unsigned int m_histLen;
+    unsigned int m_pos;
+    unsigned int m_phase;
+    u_int64_t m_stamp;
+    ResampDot m_dot;
+    DataBlock m_buffer;
 };
 
 // slin simple mono-stereo converter
@@ -370,6 +396,135 @@ private:
 using namespace TelEngine;
 
 
+ResampTranslator::ResampTranslator(const DataFormat& sFormat, const DataFormat& dFormat)
+    : DataTranslator(sFormat,dFormat),
+      m_up(dFormat.sampleRate()), m_down(sFormat.sampleRate()), m_taps(0), m_coefs(0),
+      m_hist(0), m_histSize(0), m_histLen(0), m_pos(0), m_phase(0), m_stamp(0),
+      m_dot(resampDot)
+{
+    if (!(m_up && m_down))
+	return;
+    // reduce the ratio, we need one filter phase for each output position
+    unsigned int a = m_up;
+    unsigned int b = m_down;
+    while (b) {
+	unsigned int r = a % b;
+	a = b;
+	b = r;
+    }
+    m_up /= a;
+    m_down /= a;
+    // cut below the lower Nyquist frequency, a narrower band needs a longer filter
+    double ratio = (m_up < m_down) ? (double)m_up / m_down : 1.0;
+    m_taps = (unsigned int)::ceil(RESAMP_TAPS / ratio);
+    m_taps = (m_taps + RESAMP_TAPS - 1) / RESAMP_TAPS * RESAMP_TAPS;
+    double cutoff = 0.9 * ratio;
+    double width = m_taps / 2 + 1;
+    double* h = new double[m_taps];
+    m_coefs = new short[m_up * m_taps];
+    for (unsigned int p = 0; p < m_up; p++) {
+	// Blackman windowed sinc sampled at the phase offset
+	double sum = 0;
+	for (unsigned int k = 0; k < m_taps; k++) {
+	    double t = (double)p / m_up + m_taps / 2 - 1 - k;
+	    double x = M_PI * cutoff * t;
+	    h[k] = (x ? (::sin(x) / x) : 1.0) *
+		(0.42 + 0.5 * ::cos(M_PI * t / width) + 0.08 * ::cos(2 * M_PI * t / width));
+	    sum += h[k];
+	}
+	// unity gain for each phase, fold the rounding error in the largest tap
+	short* c = m_coefs + p * m_taps;
+	int total = 0;
+	unsigned int big = 0;
+	for (unsigned int k = 0; k < m_taps; k++) {
+	    c[k] = (short)::floor(h[k] * 32768 / sum + 0.5);
+	    total += c[k];
+	    if (c[k] > c[big])
+		big = k;
+	}
+	c[big] += 32768 - total;
+    }
+    delete[] h;
+    // center the first output on the first input sample
+    m_histLen = m_taps / 2 - 1;
+    m_histSize = m_histLen + 2 * m_taps;
+    m_hist = new short[m_histSize];
+    ::memset(m_hist,0,m_histSize * sizeof(short));
+#ifdef RESAMP_SIMD
+    switch (DataBlock::convertLevel()) {
+	case 2:
+	    m_dot = resampDotAVX2;
+	    break;
+	case 1:
+	    m_dot = resampDotSSE2;
+	    break;
+    }
+#endif
+    DDebug(DebugAll,"ResampTranslator %d->%d ratio %u/%u taps %u [%p]",
+	sFormat.sampleRate(),dFormat.sampleRate(),m_up,m_down,m_taps,this);
+}
+
+ResampTranslator::~ResampTranslator()
+{
+    delete[] m_coefs;
+    delete[] m_hist;
+}
+
+unsigned long ResampTranslator::Consume(const DataBlock& data, unsigned long tStamp, unsigned long flags)
+{
+    unsigned int n = data.length();
+    if (!n || (n & 1) || !m_coefs || !ref())
+	return 0;
+    unsigned long len = 0;
+    n /= 2;
+    DataSource* src = getTransSource();
+    if (src) {
+	if (m_histLen + n > m_histSize) {
+	    m_histSize = m_histLen + n;
+	    short* hist = new short[m_histSize];
+	    ::memcpy(hist,m_hist,m_histLen * sizeof(short));
+	    delete[] m_hist;
+	    m_hist = hist;
+	}
+	::memcpy(m_hist + m_histLen,data.data(),n * sizeof(short));
+	m_histLen += n;
+	// outputs whose filter taps are all available in the history
+	unsigned int count = 0;
+	if (m_pos + m_taps <= m_histLen)
+	    count = ((m_histLen - m_taps - m_pos + 1) * m_up - m_phase + m_down - 1) / m_down;
+	m_buffer.resize(count * sizeof(short));
+	short* d = (short*)m_buffer.data();
+	for (unsigned int i = 0; i < count; i++) {
+	    int v = (m_dot(m_hist + m_pos,m_coefs + m_phase * m_taps,m_taps) + 16384) >> 15;
+	    if (v > 32767)
+		v = 32767;
+	    if (v < -32767)
+		v = -32767;
+	    *d++ = v;
+	    m_phase += m_down;
+	    m_pos += m_phase / m_up;
+	    m_phase %= m_up;
+	}
+	// keep only the samples the next outputs still need
+	m_histLen -= m_pos;
+	::memmove(m_hist,m_hist + m_pos,m_histLen * sizeof(short));
+	m_pos = 0;
+	// scale the timestamp advance to the output rate without losing the remainder
+	long delta = tStamp - m_timestamp;
+	if (delta > 0)
+	    m_stamp += (u_int64_t)delta * m_up;
+	if (count) {
+	    delta = (long)(m_stamp / m_down);
+	    m_stamp %= m_down;
+	    if (src->timeStamp() != invalidStamp())
+		delta += src->timeStamp();
+	    len = src->Forward(m_buffer,delta,flags);
+	}
+    }
+    deref();
+    return len;
+}
+
 int FormatInfo::guessSamples(int len) const
 {
     if (!(frameTime && frameSize))
@@ -91,13 +91,20 @@ namespace TelEngine {
 class EnginePrivate : public Thread
 {
 public:
-    EnginePrivate()
-	: Thread("Engine Worker")
-	{ count++; }
+    EnginePrivate(unsigned int cls = 0, const char* name = "Engine Worker",
+	Priority prio = Normal)
+	: Thread(name,prio), m_class(cls)
+	{ if (cls) classCount++; else count++; }
     ~EnginePrivate()
-	{ count--; }
+	{ if (m_class) classCount--; else count--; }
     virtual void run();
+    static void initClasses(const Configuration& cfg);
+    static void startClasses();
+    static void classStatus(String& str);
     static int count;
+    static int classCount;
+private:
+    unsigned int m_class;
 };
 
 class EngineCommand : public MessageHandler
@@ -140,6 +147,11 @@ using namespace TelEngine;
 #define MAX_STOP 5
 #endif
 
+// Maximum time a worker waits for enqueued messages before reporting idle
+#ifndef WORKER_WAIT_USEC
+#define WORKER_WAIT_USEC 100000
+#endif
+
 // Supervisor control constants
 
 // Maximum the child's sanity pool can grow
@@ -223,6 +235,7 @@ Engine::CallAccept Engine::s_accept = Engine::Accept;
 Engine* Engine::s_self = 0;
 int Engine::s_haltcode = -1;
 int EnginePrivate::count = 0;
+int EnginePrivate::classCount = 0;
 static String s_cfgpath(CFG_PATH);
 static String s_usrpath;
 static bool s_createusr = true;
@@ -230,6 +243,7 @@ static bool s_init = false;
 static bool s_dynplugin = false;
 static Engine::PluginMode s_loadMode = Engine::LoadFail;
 static int s_maxworkers = 10;
+static ObjList s_classes;
 static bool s_debug = true;
 static bool s_capture = CAPTURE_EVENTS;
 static int s_maxevents = 25;
@@ -420,6 +434,8 @@ bool EngineStatusHandler::received(Message &msg)
 #endif
     msg.retValue() << ",threads=" << Thread::count();
     msg.retValue() << ",workers=" << EnginePrivate::count;
+    if (EnginePrivate::classCount)
+	msg.retValue() << ",classworkers=" << EnginePrivate::classCount;
     msg.retValue() << ",mutexes=" << Mutex::count();
     msg.retValue() << ",locks=" << Mutex::locks();
     msg.retValue() << ",semaphores=" << Semaphore::count();
@@ -434,6 +450,10 @@ bool EngineStatusHandler::received(Message &msg)
 	    msg.retValue() << sep << p->name() << "=" << *p;
 	    sep = ',';
 	}
+	String classes;
+	EnginePrivate::classStatus(classes);
+	if (classes)
+	    msg.retValue() << sep << classes;
     }
     msg.retValue() << "\r\n";
     return false;
@@ -744,13 +764,76 @@ bool EngineHelp::received(Message &msg)
 
 void EnginePrivate::run()
 {
+    MessageDispatcher& disp = Engine::self()->m_dispatcher;
     for (;;) {
-	s_makeworker = false;
-	Engine::self()->m_dispatcher.dequeue();
-	Thread::idle(true);
+	if (!m_class)
+	    s_makeworker = false;
+	while (disp.dequeueOne(m_class))
+	    Thread::check();
+	// sleep until a message is enqueued, wake periodically to report idle
+	disp.waitMessage(WORKER_WAIT_USEC,m_class);
+	Thread::check();
+    }
+}
+
+
+// Set up message classes from [msgclass NAME] sections, only once at startup
+void EnginePrivate::initClasses(const Configuration& cfg)
+{
+    MessageDispatcher& disp = Engine::self()->m_dispatcher;
+    unsigned int n = cfg.sections();
+    for (unsigned int i = 0; i < n; i++) {
+	const NamedList* sect = cfg.getSection(i);
+	if (!(sect && sect->startsWith("msgclass ")))
+	    continue;
+	String name = sect->substr(9);
+	name.trimBlanks();
+	const String& match = (*sect)[YSTRING("match")];
+	if (name.null() || match.null()) {
+	    Debug(DebugWarn,"Ignoring incomplete message class section [%s]",sect->c_str());
+	    continue;
+	}
+	unsigned int cls = disp.addClass(name,match,
+	    sect->getIntValue(YSTRING("maxdepth"),0,0),
+	    (*sect)[YSTRING("drop")] == YSTRING("old"));
+	if (!cls) {
+	    Debug(DebugWarn,"Could not create message class '%s'",name.c_str());
+	    continue;
+	}
+	// the list name is kept as the name of the worker threads
+	NamedList* c = new NamedList("Worker " + name);
+	c->addParam("class",String(cls));
+	c->addParam("workers",String(sect->getIntValue(YSTRING("workers"),1,1,100)));
+	c->addParam("priority",sect->getValue(YSTRING("priority"),"normal"));
+	s_classes.append(c);
+    }
+}
+
+// Start the workers of the configured message classes
+void EnginePrivate::startClasses()
+{
+    for (ObjList* l = s_classes.skipNull(); l; l = l->skipNext()) {
+	const NamedList* c = static_cast<const NamedList*>(l->get());
+	unsigned int cls = c->getIntValue(YSTRING("class"));
+	Thread::Priority prio = Thread::priority(c->getValue(YSTRING("priority")));
+	int workers = c->getIntValue(YSTRING("workers"));
+	for (int i = 0; i < workers; i++) {
+	    EnginePrivate* prv = new EnginePrivate(cls,c->c_str(),prio);
+	    if (!prv->startup()) {
+		Debug(DebugWarn,"Failed to start worker for message class '%s'",c->c_str());
+		delete prv;
+	    }
+	}
     }
 }
 
+void EnginePrivate::classStatus(String& str)
+{
+    MessageDispatcher& disp = Engine::self()->m_dispatcher;
+    if (disp.classCount() > 1)
+	disp.classStatus(str);
+}
+
 
 static bool logFileOpen()
 {
@@ -1317,6 +1400,7 @@ int Engine::engineInit()
     if (modPath)
 	s_modpath = modPath;
     s_maxworkers = s_cfg.getIntValue("general","maxworkers",s_maxworkers);
+    EnginePrivate::initClasses(s_cfg);
     s_maxevents = s_cfg.getIntValue("general","maxevents",s_maxevents);
     s_restarts = s_cfg.getIntValue("general","restarts");
     m_dispatcher.warnTime(1000*(u_int64_t)s_cfg.getIntValue("general","warntime"));
@@ -1407,6 +1491,7 @@ int Engine::engineInit()
 	    m->addParam("nodename",nodeName());
 	enqueue(m);
     }
+    EnginePrivate::startClasses();
     Output("Yate%s engine is initialized and starting up%s%s",
 	clientMode() ? " client" : "",s_node.null() ? "" : " on " ,s_node.safe());
 
@@ -1841,7 +1926,12 @@ bool Engine::uninstall(MessageHandler* handler)
 
 bool Engine::enqueue(Message* msg)
 {
-    return (msg && s_self) ? s_self->m_dispatcher.enqueue(msg) : false;
+    if (!msg)
+	return false;
+    if (s_self)
+	return s_self->m_dispatcher.enqueue(msg);
+    msg->destruct();
+    return false;
 }
 
 bool Engine::dispatch(Message* msg)
@@ -25,9 +25,33 @@
 
 using namespace TelEngine;
 
+#ifndef ATOMIC_OPS
+static Mutex s_atomic(false,"MessageDispatcher::atomic");
+#endif
+
+// Maximum number of pending wakeups of threads waiting for messages
+#define MAX_WAKEUPS 64
+
+// Atomically add a value to a counter and return the new value
+// This is also a full memory barrier for the snapshot publishing code
+static inline int atomicAdd(int& counter, int value)
+{
+#ifdef ATOMIC_OPS
+#ifdef _WINDOWS
+    return InterlockedExchangeAdd((LONG*)&counter,value) + value;
+#else
+    return __sync_add_and_fetch(&counter,value);
+#endif
+#else
+    Lock lock(s_atomic);
+    return (counter += value);
+#endif
+}
+
 Message::Message(const char* name, const char* retval, bool broadcast)
     : NamedList(name),
-      m_return(retval), m_data(0), m_notify(false), m_broadcast(broadcast)
+      m_return(retval), m_data(0), m_notify(false), m_broadcast(broadcast),
+      m_queued(false)
 {
     XDebug(DebugAll,"Message::Message(\"%s\",\"%s\",%s) [%p]",
 	name,retval,String::boolText(broadcast),this);
@@ -36,7 +60,8 @@ Message::Message(const char* name, const char* retval, bool broadcast)
 Message::Message(const Message& original)
     : NamedList(original),
       m_return(original.retValue()), m_time(original.msgTime()),
-      m_data(0), m_notify(false), m_broadcast(original.broadcast())
+      m_data(0), m_notify(false), m_broadcast(original.broadcast()),
+      m_queued(false)
 {
     XDebug(DebugAll,"Message::Message(&%p) [%p]",&original,this);
 }
@@ -44,7 +69,8 @@ Message::Message(const Message& original)
 Message::Message(const Message& original, bool broadcast)
     : NamedList(original),
       m_return(original.retValue()), m_time(original.msgTime()),
-      m_data(0), m_notify(false), m_broadcast(broadcast)
+      m_data(0), m_notify(false), m_broadcast(broadcast),
+      m_queued(false)
 {
     XDebug(DebugAll,"Message::Message(&%p,%s) [%p]",
 	&original,String::boolText(broadcast),this);
@@ -247,9 +273,8 @@ void MessageHandler::destruct()
 
 void MessageHandler::safeNow()
 {
-    Lock lock(m_dispatcher);
     // when the unsafe counter reaches zero we're again safe to destroy
-    m_unsafe--;
+    atomicAdd(m_unsafe,-1);
 }
 
 bool MessageHandler::receivedInternal(Message& msg)
@@ -284,11 +309,291 @@ bool MessageRelay::receivedInternal(Message& msg)
 }
 
 
+namespace { // anonymous
+
+// Installed handler as seen by dispatching threads
+// The handler pointer is cleared on uninstall, the slot itself lives as
+//  long as any handler snapshot refers to it
+class HandlerSlot : public RefObject
+{
+public:
+    inline HandlerSlot(MessageHandler* handler)
+	: m_handler(handler), m_address(handler),
+	  m_priority(handler->priority()), m_busy(0)
+	{ }
+    inline unsigned int priority() const
+	{ return m_priority; }
+    // Address of the handler, valid for ordering even after uninstall
+    inline const void* address() const
+	{ return m_address; }
+    // Check if this slot is called after priority p and handler address a
+    inline bool after(unsigned int p, const void* a) const
+	{ return (m_priority > p) || ((m_priority == p) && (m_address > a)); }
+    // Prevent the handler from being uninstalled, returns NULL if already gone
+    inline MessageHandler* acquire()
+	{
+	    atomicAdd(m_busy,1);
+	    MessageHandler* h = m_handler;
+	    if (!h)
+		atomicAdd(m_busy,-1);
+	    return h;
+	}
+    inline void release()
+	{ atomicAdd(m_busy,-1); }
+    // Detach the handler and wait until no dispatcher is looking at it
+    inline void detach()
+	{
+	    m_handler = 0;
+	    while (atomicAdd(m_busy,0) > 0)
+		Thread::yield();
+	}
+private:
+    MessageHandler* volatile m_handler;
+    const void* m_address;
+    unsigned int m_priority;
+    int m_busy;
+};
+
+// Immutable priority ordered array of the handlers for one message name
+class HandlerArray : public RefObject
+{
+public:
+    HandlerArray(const String& name, const HandlerArray* old, HandlerSlot* add, const HandlerSlot* del);
+    virtual ~HandlerArray();
+    virtual const String& toString() const
+	{ return m_name; }
+    inline unsigned int count() const
+	{ return m_count; }
+    inline HandlerSlot* at(unsigned int index) const
+	{ return (index < m_count) ? m_slots[index] : 0; }
+    HandlerSlot* find(const MessageHandler* handler) const;
+    unsigned int after(unsigned int p, const void* a) const;
+private:
+    String m_name;
+    HandlerSlot** m_slots;
+    unsigned int m_count;
+};
+
+// Immutable set of handler arrays indexed by message name
+// Dispatching threads hold a reference to it while walking the handlers
+class HandlerSnapshot : public RefObject
+{
+public:
+    HandlerSnapshot(const HandlerSnapshot* old = 0, HandlerArray* changed = 0);
+    virtual ~HandlerSnapshot();
+    inline const HandlerArray* named(const String& name) const
+	{ return static_cast<const HandlerArray*>(m_named[name]); }
+    inline const HandlerArray* unnamed() const
+	{ return m_unnamed; }
+    inline const HandlerArray* array(const String& name) const
+	{ return name.null() ? unnamed() : named(name); }
+    void detachAll() const;
+private:
+    HashList m_named;
+    HandlerArray* m_unnamed;
+};
+
+// Waiting queue for a class of enqueued messages
+class MessageClass : public String
+{
+public:
+    MessageClass(const char* name, const char* match = 0,
+	unsigned int maxDepth = 0, bool dropOld = false);
+    inline bool matches(const String& name) const
+	{ return !m_match.null() && m_match.matches(name); }
+    inline unsigned int count() const
+	{ return m_count; }
+    inline Semaphore& semaphore()
+	{ return m_semaphore; }
+    bool push(Message* msg, Message*& dropped);
+    Message* pop();
+    void status(String& str) const;
+private:
+    Regexp m_match;
+    ObjList m_messages;
+    ObjList* m_append;
+    unsigned int m_count;
+    unsigned int m_maxDepth;
+    unsigned int m_highest;
+    bool m_dropOld;
+    unsigned int m_enqueued;
+    unsigned int m_dropped;
+    Semaphore m_semaphore;
+};
+
+// Cached association of a message name to its message class
+class ClassMapping : public String
+{
+public:
+    inline ClassMapping(const String& name, MessageClass* cls)
+	: String(name), m_class(cls)
+	{ }
+    inline MessageClass* cls() const
+	{ return m_class; }
+private:
+    MessageClass* m_class;
+};
+
+}; // anonymous namespace
+
+
+MessageClass::MessageClass(const char* name, const char* match,
+    unsigned int maxDepth, bool dropOld)
+    : String(name),
+      m_match(match), m_append(&m_messages), m_count(0),
+      m_maxDepth(maxDepth), m_highest(0), m_dropOld(dropOld),
+      m_enqueued(0), m_dropped(0),
+      m_semaphore(MAX_WAKEUPS,"MessageClass")
+{
+}
+
+// Append a message to the queue, return false if the queue is full
+// When dropping old messages return the one that must be destroyed
+bool MessageClass::push(Message* msg, Message*& dropped)
+{
+    if (m_maxDepth && (m_count >= m_maxDepth)) {
+	m_dropped++;
+	if (!m_dropOld)
+	    return false;
+	dropped = pop();
+    }
+    m_append = m_append->append(msg);
+    m_enqueued++;
+    if (++m_count > m_highest)
+	m_highest = m_count;
+    return true;
+}
+
+Message* MessageClass::pop()
+{
+    // the second list item is about to be deleted by remove()
+    if (m_messages.next() == m_append)
+	m_append = &m_messages;
+    Message* msg = static_cast<Message*>(m_messages.remove(false));
+    if (msg)
+	m_count--;
+    return msg;
+}
+
+void MessageClass::status(String& str) const
+{
+    str.append(c_str(),",") << "=" << m_count << "|" << m_highest << "|" <<
+	m_maxDepth << "|" << m_enqueued << "|" << m_dropped;
+}
+
+
+HandlerArray::HandlerArray(const String& name, const HandlerArray* old,
+    HandlerSlot* add, const HandlerSlot* del)
+    : m_name(name), m_slots(0), m_count(0)
+{
+    unsigned int n = old ? old->count() : 0;
+    if (add)
+	n++;
+    if (n)
+	m_slots = new HandlerSlot*[n];
+    unsigned int i = 0;
+    for (unsigned int o = 0; old && (o < old->count()); o++) {
+	HandlerSlot* s = old->at(o);
+	if (s == del)
+	    continue;
+	if (add && s->after(add->priority(),add->address())) {
+	    m_slots[i++] = add;
+	    add = 0;
+	}
+	m_slots[i++] = s;
+    }
+    if (add)
+	m_slots[i++] = add;
+    m_count = i;
+    for (i = 0; i < m_count; i++)
+	m_slots[i]->ref();
+}
+
+HandlerArray::~HandlerArray()
+{
+    for (unsigned int i = 0; i < m_count; i++)
+	m_slots[i]->deref();
+    delete[] m_slots;
+}
+
+HandlerSlot* HandlerArray::find(const MessageHandler* handler) const
+{
+    for (unsigned int i = 0; i < m_count; i++)
+	if (m_slots[i]->address() == handler)
+	    return m_slots[i];
+    return 0;
+}
+
+// Binary search the index of the first slot called after priority p and address a
+unsigned int HandlerArray::after(unsigned int p, const void* a) const
+{
+    unsigned int lo = 0;
+    unsigned int hi = m_count;
+    while (lo < hi) {
+	unsigned int mid = (lo + hi) / 2;
+	if (m_slots[mid]->after(p,a))
+	    hi = mid;
+	else
+	    lo = mid + 1;
+    }
+    return lo;
+}
+
+
+HandlerSnapshot::HandlerSnapshot(const HandlerSnapshot* old, HandlerArray* changed)
+    : m_named(251), m_unnamed(0)
+{
+    if (old) {
+	// share all the unchanged arrays with the old snapshot
+	for (unsigned int i = 0; i < old->m_named.length(); i++) {
+	    ObjList* l = old->m_named.getList(i);
+	    for (l = l ? l->skipNull() : 0; l; l = l->skipNext()) {
+		HandlerArray* a = static_cast<HandlerArray*>(l->get());
+		if (!(changed && (a->toString() == changed->toString())) && a->ref())
+		    m_named.append(a);
+	    }
+	}
+	if (old->m_unnamed && !(changed && changed->toString().null()) && old->m_unnamed->ref())
+	    m_unnamed = old->m_unnamed;
+    }
+    if (!(changed && changed->count() && changed->ref()))
+	return;
+    if (changed->toString().null())
+	m_unnamed = changed;
+    else
+	m_named.append(changed);
+}
+
+HandlerSnapshot::~HandlerSnapshot()
+{
+    TelEngine::destruct(m_unnamed);
+}
+
+// Detach the handlers from all the slots, used when clearing the dispatcher
+void HandlerSnapshot::detachAll() const
+{
+    for (unsigned int i = 0; i < m_named.length(); i++) {
+	ObjList* l = m_named.getList(i);
+	for (l = l ? l->skipNull() : 0; l; l = l->skipNext()) {
+	    HandlerArray* a = static_cast<HandlerArray*>(l->get());
+	    for (unsigned int j = 0; j < a->count(); j++)
+		a->at(j)->detach();
+	}
+    }
+    for (unsigned int j = 0; m_unnamed && (j < m_unnamed->count()); j++)
+	m_unnamed->at(j)->detach();
+}
+
+
 MessageDispatcher::MessageDispatcher(const char* trackParam)
     : Mutex(false,"MessageDispatcher"),
-      m_trackParam(trackParam), m_changes(0), m_warnTime(0)
+      m_classMap(67), m_msgCount(0), m_retiredCount(0),
+      m_snapshot(new HandlerSnapshot), m_grabbing(0),
+      m_trackParam(trackParam), m_warnTime(0)
 {
     XDebug(DebugInfo,"MessageDispatcher::MessageDispatcher('%s') [%p]",trackParam,this);
+    // the default queue holds messages not matching any other class
+    m_classes.append(new MessageClass("default"));
 }
 
 MessageDispatcher::~MessageDispatcher()
@@ -297,6 +602,85 @@ MessageDispatcher::~MessageDispatcher()
     lock();
     clear();
     unlock();
+    m_snapshot->deref();
+}
+
+void MessageDispatcher::clear()
+{
+    static_cast<HandlerSnapshot*>(m_snapshot)->detachAll();
+    publish(new HandlerSnapshot);
+    m_handlers.clear();
+    m_hooks.clear();
+}
+
+// Get a reference to the current handler snapshot without locking
+RefObject* MessageDispatcher::grab()
+{
+#ifdef ATOMIC_OPS
+    // retired snapshots are not destroyed while anybody is grabbing
+    atomicAdd(m_grabbing,1);
+    RefObject* snap = m_snapshot;
+    snap->ref();
+    // the last one out frees the snapshots publish() had to keep
+    // never wait for the lock, a later grab or publish will do it
+    if (!atomicAdd(m_grabbing,-1) && m_retiredCount && lock(0)) {
+	purge();
+	unlock();
+    }
+#else
+    lock();
+    RefObject* snap = m_snapshot;
+    snap->ref();
+    unlock();
+#endif
+    return snap;
+}
+
+// Make a new handler snapshot current, must be called locked
+void MessageDispatcher::publish(RefObject* snapshot)
+{
+    // keep the old snapshot alive until no dispatcher can grab it anymore
+    m_retired.append(m_snapshot);
+    m_retiredCount++;
+    m_snapshot = snapshot;
+    purge();
+}
+
+// Destroy retired snapshots nobody holds anymore, must be called locked
+void MessageDispatcher::purge()
+{
+    if (atomicAdd(m_grabbing,0) > 0)
+	return;
+    ObjList* l = m_retired.skipNull();
+    while (l) {
+	if (static_cast<RefObject*>(l->get())->refcount() > 1)
+	    l = l->skipNext();
+	else {
+	    l->remove();
+	    m_retiredCount--;
+	    l = l->skipNull();
+	}
+    }
+}
+
+// Rebuild the handler array holding a handler, must be called locked
+void MessageDispatcher::update(MessageHandler* handler, bool install)
+{
+    HandlerSnapshot* snap = static_cast<HandlerSnapshot*>(m_snapshot);
+    const HandlerArray* old = snap->array(*handler);
+    HandlerSlot* add = 0;
+    HandlerSlot* del = 0;
+    if (install)
+	add = new HandlerSlot(handler);
+    else if (old)
+	del = old->find(handler);
+    HandlerArray* changed = new HandlerArray(*handler,old,add,del);
+    TelEngine::destruct(add);
+    // the slot may go away with the old snapshot so detach it first
+    if (del)
+	del->detach();
+    publish(new HandlerSnapshot(snap,changed));
+    TelEngine::destruct(changed);
 }
 
 bool MessageDispatcher::install(MessageHandler* handler)
@@ -305,33 +689,11 @@ bool MessageDispatcher::install(MessageHandler* handler)
     if (!handler)
 	return false;
     Lock lock(this);
-    ObjList *l = m_handlers.find(handler);
-    if (l)
+    if (m_handlers.find(handler))
 	return false;
-    unsigned p = handler->priority();
-    int pos = 0;
-    for (l=&m_handlers; l; l=l->next(),pos++) {
-	MessageHandler *h = static_cast<MessageHandler *>(l->get());
-	if (!h)
-	    continue;
-	if (h->priority() < p)
-	    continue;
-	if (h->priority() > p)
-	    break;
-	// at the same priority we sort them in pointer address order
-	if (h > handler)
-	    break;
-    }
-    m_changes++;
-    if (l) {
-	XDebug(DebugAll,"Inserting handler [%p] on place #%d",handler,pos);
-	l->insert(handler);
-    }
-    else {
-	XDebug(DebugAll,"Appending handler [%p] on place #%d",handler,pos);
-	m_handlers.append(handler);
-    }
+    m_handlers.append(handler);
     handler->m_dispatcher = this;
+    update(handler,true);
     if (handler->null())
 	Debug(DebugInfo,"Registered broadcast message handler %p",handler);
     return true;
@@ -343,8 +705,9 @@ bool MessageDispatcher::uninstall(MessageHandler* handler)
     lock();
     handler = static_cast<MessageHandler *>(m_handlers.remove(handler,false));
     if (handler) {
-	m_changes++;
-	if (handler->m_unsafe > 0) {
+	// after this no dispatcher can start calling the handler
+	update(handler,false);
+	if (atomicAdd(handler->m_unsafe,0) > 0) {
 	    DDebug(DebugNote,"Waiting for unsafe MessageHandler %p '%s'",
 		handler,handler->c_str());
 	    // wait until handler is again safe to destroy
@@ -352,7 +715,7 @@ bool MessageDispatcher::uninstall(MessageHandler* handler)
 		unlock();
 		Thread::yield();
 		lock();
-	    } while (handler->m_unsafe > 0);
+	    } while (atomicAdd(handler->m_unsafe,0) > 0);
 	}
 	if (handler->m_unsafe != 0)
 	    Debug(DebugFail,"MessageHandler %p has unsafe=%d",handler,handler->m_unsafe);
@@ -371,73 +734,82 @@ bool MessageDispatcher::dispatch(Message& msg)
     u_int64_t t = m_warnTime ? Time::now() : 0;
 
     bool retv = false;
-    ObjList *l = &m_handlers;
-    Lock mylock(this);
-    for (; l; l=l->next()) {
-	MessageHandler *h = static_cast<MessageHandler*>(l->get());
-	if (h && (h->null() || *h == msg)) {
-	    if (h->filter() && (*(h->filter()) != msg.getValue(h->filter()->name())))
-		continue;
-	    unsigned int c = m_changes;
-	    unsigned int p = h->priority();
-	    if (trackParam() && h->trackName()) {
-		NamedString* tracked = msg.getParam(trackParam());
-		if (tracked)
-		    tracked->append(h->trackName(),",");
-		else
-		    msg.addParam(trackParam(),h->trackName());
-	    }
-	    // mark handler as unsafe to destroy / uninstall
-	    h->m_unsafe++;
-	    mylock.drop();
-
-	    u_int64_t tm = m_warnTime ? Time::now() : 0;
-
-	    retv = h->receivedInternal(msg) || retv;
-
-	    if (tm) {
-		tm = Time::now() - tm;
-		if (tm > m_warnTime) {
-		    mylock.acquire(this);
-		    const char* name = (c == m_changes) ? h->trackName().c_str() : 0;
-		    Debug(DebugInfo,"Message '%s' [%p] passed through %p%s%s%s in " FMT64U " usec",
-			msg.c_str(),&msg,h,
-			(name ? " '" : ""),(name ? name : ""),(name ? "'" : ""),tm);
-		}
+    // handlers may rename the message so remember what we looked up
+    unsigned int hash = msg.hash();
+    HandlerSnapshot* snap = static_cast<HandlerSnapshot*>(grab());
+    // merge the handlers of this message name with the unnamed ones
+    const HandlerArray* an = snap->named(msg);
+    const HandlerArray* au = snap->unnamed();
+    unsigned int in = 0;
+    unsigned int iu = 0;
+    for (;;) {
+	HandlerSlot* s = an ? an->at(in) : 0;
+	HandlerSlot* su = au ? au->at(iu) : 0;
+	if (s && !(su && s->after(su->priority(),su->address())))
+	    in++;
+	else if (su) {
+	    s = su;
+	    iu++;
+	}
+	else
+	    break;
+	// skip handlers uninstalled since we took the snapshot
+	MessageHandler* h = s->acquire();
+	if (!h)
+	    continue;
+	if (h->filter() && (*(h->filter()) != msg.getValue(h->filter()->name()))) {
+	    s->release();
+	    continue;
+	}
+	unsigned int p = s->priority();
+	const void* a = s->address();
+	if (trackParam() && h->trackName()) {
+	    NamedString* tracked = msg.getParam(trackParam());
+	    if (tracked)
+		tracked->append(h->trackName(),",");
+	    else
+		msg.addParam(trackParam(),h->trackName());
+	}
+	// mark handler as unsafe to destroy / uninstall
+	atomicAdd(h->m_unsafe,1);
+	s->release();
+
+	u_int64_t tm = m_warnTime ? Time::now() : 0;
+
+	retv = h->receivedInternal(msg) || retv;
+
+	if (tm) {
+	    tm = Time::now() - tm;
+	    if (tm > m_warnTime) {
+		bool alive = (s->acquire() != 0);
+		const char* name = alive ? h->trackName().c_str() : 0;
+		Debug(DebugInfo,"Message '%s' [%p] passed through %p%s%s%s in " FMT64U " usec",
+		    msg.c_str(),&msg,a,
+		    (name ? " '" : ""),(name ? name : ""),(name ? "'" : ""),tm);
+		if (alive)
+		    s->release();
 	    }
+	}
 
-	    if (retv && !msg.broadcast())
-		break;
-	    mylock.acquire(this);
-	    if (c == m_changes)
-		continue;
-	    // the handler list has changed - find again
-	    NDebug(DebugAll,"Rescanning handler list for '%s' [%p] at priority %u",
-		msg.c_str(),&msg,p);
-	    ObjList* l2 = &m_handlers;
-	    for (l = l2; l; l=l->next()) {
-		MessageHandler *mh = static_cast<MessageHandler*>(l->get());
-		if (!mh)
-		    continue;
-		if (mh == h)
-		    // exact match - silently continue where we left
-		    break;
-
-		// gone past last handler priority - exit with last handler
-		if ((mh->priority() > p) || ((mh->priority() == p) && (mh > h))) {
-		    Debug(DebugAll,"Handler list for '%s' [%p] changed, skipping from %p (%u) to %p (%u)",
-			msg.c_str(),&msg,h,p,mh,mh->priority());
-		    // l will advance in the outer for loop so use previous
-		    l = l2;
-		    break;
-		}
-		l2 = l;
-	    }
-	    if (!l)
-		break;
+	if (retv && !msg.broadcast())
+	    break;
+	if ((snap == m_snapshot) && (an ? (an->toString() == msg) : (hash == msg.hash())))
+	    continue;
+	// the handlers or message name have changed - find again where we left
+	NDebug(DebugAll,"Rescanning handler list for '%s' [%p] at priority %u",
+	    msg.c_str(),&msg,p);
+	if (snap != m_snapshot) {
+	    HandlerSnapshot* tmp = static_cast<HandlerSnapshot*>(grab());
+	    snap->deref();
+	    snap = tmp;
 	}
+	hash = msg.hash();
+	an = snap->named(msg);
+	au = snap->unnamed();
+	in = an ? an->after(p,a) : 0;
+	iu = au ? au->after(p,a) : 0;
     }
-    mylock.drop();
+    snap->deref();
     msg.dispatched(retv);
 
     if (t) {
@@ -456,7 +828,7 @@ bool MessageDispatcher::dispatch(Message& msg)
 	}
     }
 
-    l = &m_hooks;
+    ObjList* l = &m_hooks;
     for (; l; l=l->next()) {
 	MessagePostHook *h = static_cast<MessagePostHook*>(l->get());
 	if (h)
@@ -465,19 +837,76 @@ bool MessageDispatcher::dispatch(Message& msg)
     return retv;
 }
 
+unsigned int MessageDispatcher::addClass(const char* name, const char* match,
+    unsigned int maxDepth, bool dropOld)
+{
+    if (TelEngine::null(name) || TelEngine::null(match))
+	return 0;
+    MessageClass* cls = new MessageClass(name,match,maxDepth,dropOld);
+    Lock lock(this);
+    unsigned int idx = m_classes.count();
+    m_classes.append(cls);
+    // message names may now belong to the new class
+    m_classMap.clear();
+    Debug(DebugInfo,"Added message class '%s' #%u matching '%s'",name,idx,match);
+    return idx;
+}
+
 bool MessageDispatcher::enqueue(Message* msg)
 {
     Lock lock(this);
-    if (!msg || m_messages.find(msg))
+    if (!msg || msg->m_queued)
+	return false;
+    MessageClass* cls = static_cast<MessageClass*>(m_classes.get());
+    if (m_classes.next()) {
+	ClassMapping* map = static_cast<ClassMapping*>(m_classMap[*msg]);
+	if (!map) {
+	    // first time we see this name, find its class and remember it
+	    for (ObjList* l = m_classes.skipNext(); l; l = l->skipNext()) {
+		MessageClass* c = static_cast<MessageClass*>(l->get());
+		if (c->matches(*msg)) {
+		    cls = c;
+		    break;
+		}
+	    }
+	    map = new ClassMapping(*msg,cls);
+	    m_classMap.append(map);
+	}
+	cls = map->cls();
+    }
+    Message* dropped = 0;
+    if (!cls->push(msg,dropped)) {
+	// nobody else owns the message now, don't leak it
+	lock.drop();
+	Debug(DebugMild,"Message class '%s' full, refused '%s' [%p]",
+	    cls->c_str(),msg->c_str(),msg);
+	msg->destruct();
 	return false;
-    m_messages.append(msg);
+    }
+    msg->m_queued = true;
+    if (dropped)
+	dropped->m_queued = false;
+    else
+	m_msgCount++;
+    lock.drop();
+    cls->semaphore().unlock();
+    if (dropped) {
+	Debug(DebugMild,"Message class '%s' full, dropped '%s' [%p]",
+	    cls->c_str(),dropped->c_str(),dropped);
+	dropped->destruct();
+    }
     return true;
 }
 
-bool MessageDispatcher::dequeueOne()
+bool MessageDispatcher::dequeueOne(unsigned int cls)
 {
     lock();
-    Message* msg = static_cast<Message *>(m_messages.remove(false));
+    MessageClass* c = static_cast<MessageClass*>(m_classes[cls]);
+    Message* msg = c ? c->pop() : 0;
+    if (msg) {
+	msg->m_queued = false;
+	m_msgCount--;
+    }
     unlock();
     if (!msg)
 	return false;
@@ -488,14 +917,36 @@ bool MessageDispatcher::dequeueOne()
 
 void MessageDispatcher::dequeue()
 {
-    while (dequeueOne())
-	;
+    for (unsigned int i = 0; i < classCount(); i++)
+	while (dequeueOne(i))
+	    ;
+}
+
+bool MessageDispatcher::waitMessage(long maxwait, unsigned int cls)
+{
+    lock();
+    MessageClass* c = static_cast<MessageClass*>(m_classes[cls]);
+    unlock();
+    // classes are never removed so it's safe to wait unlocked
+    return c && c->semaphore().lock(maxwait);
 }
 
 unsigned int MessageDispatcher::messageCount()
+{
+    return m_msgCount;
+}
+
+unsigned int MessageDispatcher::classCount()
+{
+    Lock lock(this);
+    return m_classes.count();
+}
+
+void MessageDispatcher::classStatus(String& str)
 {
     Lock lock(this);
-    return m_messages.count();
+    for (ObjList* l = m_classes.skipNull(); l; l = l->skipNext())
+	static_cast<MessageClass*>(l->get())->status(str);
 }
 
 unsigned int MessageDispatcher::handlerCount()
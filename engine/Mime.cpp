@@ -31,6 +31,17 @@ static bool isContinuationBlank(char c)
     return ((c == ' ') || (c == '\t'));
 }
 
+// Utility function, skips the blanks at both ends of a buffer
+static void trimRange(const char*& buf, int& len)
+{
+    while ((len > 0) && ((*buf == ' ') || (*buf == '\t'))) {
+	buf++;
+	len--;
+    }
+    while ((len > 0) && ((buf[len-1] == ' ') || (buf[len-1] == '\t')))
+	len--;
+}
+
 /**
  * MimeHeaderLine
  */
@@ -47,28 +58,29 @@ MimeHeaderLine::MimeHeaderLine(const char* name, const String& value, char sep)
     }
     assign(value,sp);
     trimBlanks();
+    // build parameters straight from the value, keep a tail to append fast
+    const char* v = value.c_str();
+    ObjList* tail = &m_params;
     while (sp < (int)value.length()) {
 	int ep = findSep(value,m_separator,sp+1);
 	if (ep <= sp)
 	    ep = value.length();
 	int eq = value.find('=',sp+1);
-	if ((eq > 0) && (eq < ep)) {
-	    String pname(value.substr(sp+1,eq-sp-1));
-	    String pvalue(value.substr(eq+1,ep-eq-1));
-	    pname.trimBlanks();
-	    pvalue.trimBlanks();
-	    if (!pname.null()) {
-		XDebug(DebugAll,"hdr param name='%s' value='%s'",pname.c_str(),pvalue.c_str());
-		m_params.append(new NamedString(pname,pvalue));
-	    }
-	}
-	else {
-	    String pname(value.substr(sp+1,ep-sp-1));
-	    pname.trimBlanks();
-	    if (!pname.null()) {
-		XDebug(DebugAll,"hdr param name='%s' (no value)",pname.c_str());
-		m_params.append(new NamedString(pname));
+	const char* n = v+sp+1;
+	int nl = (((eq > 0) && (eq < ep)) ? eq : ep) - sp - 1;
+	trimRange(n,nl);
+	if (nl) {
+	    NamedString* p = new NamedString(String(n,nl));
+	    if ((eq > 0) && (eq < ep)) {
+		const char* pv = v+eq+1;
+		int pvl = ep-eq-1;
+		trimRange(pv,pvl);
+		p->assign(pv,pvl);
+		XDebug(DebugAll,"hdr param name='%s' value='%s'",p->name().c_str(),p->c_str());
 	    }
+	    else
+		XDebug(DebugAll,"hdr param name='%s' (no value)",p->name().c_str());
+	    tail = tail->append(p);
 	}
 	sp = ep;
     }
@@ -80,10 +92,11 @@ MimeHeaderLine::MimeHeaderLine(const MimeHeaderLine& original, const char* newNa
 {
     XDebug(DebugAll,"MimeHeaderLine::MimeHeaderLine(%p '%s') [%p]",&original,name().c_str(),this);
     const ObjList* l = &original.params();
+    ObjList* tail = &m_params;
     for (; l; l = l->next()) {
 	const NamedString* t = static_cast<const NamedString*>(l->get());
 	if (t)
-	    m_params.append(new NamedString(t->name(),*t));
+	    tail = tail->append(new NamedString(t->name(),*t));
     }
 }
 
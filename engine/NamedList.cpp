@@ -24,6 +24,16 @@
 
 using namespace TelEngine;
 
+// Number of parameters from which lookups by name use a hash index
+#ifndef NAMEDLIST_INDEX_MIN
+#define NAMEDLIST_INDEX_MIN 16
+#endif
+
+// Number of buckets in the hash index
+#ifndef NAMEDLIST_INDEX_SIZE
+#define NAMEDLIST_INDEX_SIZE 61
+#endif
+
 static const NamedList s_empty("");
 
 const NamedList& NamedList::empty()
@@ -32,26 +42,36 @@ const NamedList& NamedList::empty()
 }
 
 NamedList::NamedList(const char* name)
-    : String(name)
+    : String(name),
+      m_index(0), m_unindexed(0)
 {
 }
 
 NamedList::NamedList(const NamedList& original)
-    : String(original)
+    : String(original),
+      m_index(0), m_unindexed(0)
 {
     ObjList* dest = &m_params;
     for (const ObjList* l = original.m_params.skipNull(); l; l = l->skipNext()) {
 	const NamedString* p = static_cast<const NamedString*>(l->get());
-	dest = dest->append(new NamedString(p->name(),*p));
+	NamedString* s = new NamedString(p->name(),*p);
+	dest = dest->append(s);
+	indexParam(s);
     }
 }
 
 NamedList::NamedList(const char* name, const NamedList& original, const String& prefix)
-    : String(name)
+    : String(name),
+      m_index(0), m_unindexed(0)
 {
     copySubParams(original,prefix);
 }
 
+NamedList::~NamedList()
+{
+    delete m_index;
+}
+
 NamedList& NamedList::operator=(const NamedList& value)
 {
     String::operator=(value);
@@ -66,20 +86,63 @@ void* NamedList::getObject(const String& name) const
     return String::getObject(name);
 }
 
+void NamedList::clearParams()
+{
+    m_params.clear();
+    // a list that is refilled is likely to be a different one
+    delete m_index;
+    m_index = 0;
+    m_unindexed = 0;
+}
+
+// Keep the hash index in sync with a parameter just appended to the list
+void NamedList::indexParam(NamedString* param)
+{
+    if (m_index) {
+	m_index->append(param)->setDelete(false);
+	return;
+    }
+    if (++m_unindexed < NAMEDLIST_INDEX_MIN)
+	return;
+    // parameters are indexed in list order so that the first one found
+    //  by name in a bucket is also the first one in the list
+    m_index = new HashList(NAMEDLIST_INDEX_SIZE);
+    for (ObjList* l = m_params.skipNull(); l; l = l->skipNext())
+	m_index->append(l->get())->setDelete(false);
+}
+
+// Remove a parameter from the hash index before it is removed from the list
+void NamedList::unindexParam(NamedString* param)
+{
+    if (!m_index) {
+	if (m_unindexed)
+	    m_unindexed--;
+	return;
+    }
+    ObjList* l = m_index->getHashList(param->name());
+    if (l)
+	l->remove(param,false);
+}
+
 NamedList& NamedList::addParam(NamedString* param)
 {
     XDebug(DebugInfo,"NamedList::addParam(%p) [\"%s\",\"%s\"]",
         param,(param ? param->name().c_str() : ""),TelEngine::c_safe(param));
-    if (param)
+    if (param) {
 	m_params.append(param);
+	indexParam(param);
+    }
     return *this;
 }
 
 NamedList& NamedList::addParam(const char* name, const char* value, bool emptyOK)
 {
     XDebug(DebugInfo,"NamedList::addParam(\"%s\",\"%s\",%s)",name,value,String::boolText(emptyOK));
-    if (emptyOK || !TelEngine::null(value))
-	m_params.append(new NamedString(name, value));
+    if (emptyOK || !TelEngine::null(value)) {
+	NamedString* s = new NamedString(name, value);
+	m_params.append(s);
+	indexParam(s);
+    }
     return *this;
 }
 
@@ -89,11 +152,21 @@ NamedList& NamedList::setParam(NamedString* param)
         param,(param ? param->name().c_str() : ""),TelEngine::c_safe(param));
     if (!param)
 	return *this;
-    ObjList* p = m_params.find(param->name());
+    NamedString* s = getParam(param->name());
+    if (!s) {
+	m_params.append(param);
+	indexParam(param);
+	return *this;
+    }
+    if (m_index) {
+	ObjList* l = m_index->getHashList(param->name());
+	l = l ? l->find(s) : 0;
+	if (l)
+	    l->set(param,false);
+    }
+    ObjList* p = m_params.find(s);
     if (p)
 	p->set(param);
-    else
-	m_params.append(param);
     return *this;
 }
 
@@ -103,8 +176,11 @@ NamedList& NamedList::setParam(const char* name, const char* value)
     NamedString *s = getParam(name);
     if (s)
 	*s = value;
-    else
-	m_params.append(new NamedString(name, value));
+    else {
+	s = new NamedString(name, value);
+	m_params.append(s);
+	indexParam(s);
+    }
     return *this;
 }
 
@@ -115,11 +191,15 @@ NamedList& NamedList::clearParam(const String& name, char childSep)
     String tmp;
     if (childSep)
 	tmp << name << childSep;
+    else if (m_index && !m_index->find(name))
+	return *this;
     ObjList *p = &m_params;
     while (p) {
         NamedString *s = static_cast<NamedString *>(p->get());
-        if (s && ((s->name() == name) || s->name().startsWith(tmp)))
+        if (s && ((s->name() == name) || s->name().startsWith(tmp))) {
+	    unindexParam(s);
             p->remove();
+	}
 	else
 	    p = p->next();
     }
@@ -132,8 +212,10 @@ NamedList& NamedList::clearParam(NamedString* param, bool delParam)
     if (!param)
 	return *this;
     ObjList* o = m_params.find(param);
-    if (o)
+    if (o) {
+	unindexParam(param);
 	o->remove(delParam);
+    }
     XDebug(DebugInfo,"NamedList::clearParam(%p) found=%p",param,o);
     return *this;
 }
@@ -153,8 +235,11 @@ NamedList& NamedList::copyParam(const NamedList& original, const String& name, c
     ObjList* dest = &m_params;
     for (const ObjList* l = original.m_params.skipNull(); l; l = l->skipNext()) {
 	const NamedString* s = static_cast<const NamedString*>(l->get());
-        if ((s->name() == name) || s->name().startsWith(tmp))
-	    dest = dest->append(new NamedString(s->name(),*s));
+        if ((s->name() == name) || s->name().startsWith(tmp)) {
+	    NamedString* n = new NamedString(s->name(),*s);
+	    dest = dest->append(n);
+	    indexParam(n);
+	}
     }
     return *this;
 }
@@ -208,8 +293,11 @@ NamedList& NamedList::copySubParams(const NamedList& original, const String& pre
 	    const NamedString* s = static_cast<const NamedString*>(l->get());
 	    if (s->name().startsWith(prefix)) {
 		const char* name = s->name().c_str() + offs;
-		if (*name)
-		    dest = dest->append(new NamedString(name,*s));
+		if (*name) {
+		    NamedString* n = new NamedString(name,*s);
+		    dest = dest->append(n);
+		    indexParam(n);
+		}
 	    }
 	}
     }
@@ -257,6 +345,10 @@ int NamedList::getIndex(const NamedString* param) const
 
 int NamedList::getIndex(const String& name) const
 {
+    if (m_index) {
+	ObjList* l = m_index->find(name);
+	return l ? getIndex(static_cast<const NamedString*>(l->get())) : -1;
+    }
     const ObjList *p = &m_params;
     for (int i=0; p; p=p->next(),i++) {
         NamedString *s = static_cast<NamedString *>(p->get());
@@ -269,6 +361,10 @@ int NamedList::getIndex(const String& name) const
 NamedString* NamedList::getParam(const String& name) const
 {
     XDebug(DebugInfo,"NamedList::getParam(\"%s\")",name.c_str());
+    if (m_index) {
+	ObjList* l = m_index->find(name);
+	return l ? static_cast<NamedString*>(l->get()) : 0;
+    }
     const ObjList *p = m_params.skipNull();
     for (; p; p=p->skipNext()) {
         NamedString *s = static_cast<NamedString *>(p->get());
@@ -324,48 +420,56 @@ bool NamedList::getBoolValue(const String& name, bool defvalue) const
 
 int NamedList::replaceParams(String& str, bool sqlEsc, char extraEsc) const
 {
-    int p1 = 0;
+    int p1 = str.find("${");
+    if (p1 < 0)
+	return 0;
+    // build the result in a single pass, replaced text is never searched again
+    String res;
+    StringBuilder out(res,str.length());
+    int p0 = 0;
     int cnt = 0;
-    while ((p1 = str.find("${",p1)) >= 0) {
+    for (; p1 >= 0; p1 = str.find("${",p0)) {
 	int p2 = str.find('}',p1+2);
-	if (p2 > 0) {
-	    String def;
-	    String tmp = str.substr(p1+2,p2-p1-2);
-	    tmp.trimBlanks();
-	    int pq = tmp.find('$');
-	    if (pq >= 0) {
-		// param is in ${<name>$<default>} format
-		def = tmp.substr(pq+1).trimBlanks();
-		tmp = tmp.substr(0,pq).trimBlanks();
-	    }
-	    DDebug(DebugAll,"NamedList replacing parameter '%s' [%p]",tmp.c_str(),this);
-	    const String* ns = getParam(tmp);
-	    if (ns) {
-		if (sqlEsc) {
-		    const DataBlock* data = 0;
-		    if (ns->null()) {
-			NamedPointer* np = YOBJECT(NamedPointer,ns);
-			if (np)
-			    data = YOBJECT(DataBlock,np->userData());
-		    }
-		    if (data)
-			tmp = data->sqlEscape(extraEsc);
-		    else
-			tmp = ns->sqlEscape(extraEsc);
+	if (p2 <= 0) {
+	    cnt = -1;
+	    break;
+	}
+	String def;
+	String tmp = str.substr(p1+2,p2-p1-2);
+	tmp.trimBlanks();
+	int pq = tmp.find('$');
+	if (pq >= 0) {
+	    // param is in ${<name>$<default>} format
+	    def = tmp.substr(pq+1).trimBlanks();
+	    tmp = tmp.substr(0,pq).trimBlanks();
+	}
+	DDebug(DebugAll,"NamedList replacing parameter '%s' [%p]",tmp.c_str(),this);
+	const String* ns = getParam(tmp);
+	if (ns) {
+	    if (sqlEsc) {
+		const DataBlock* data = 0;
+		if (ns->null()) {
+		    NamedPointer* np = YOBJECT(NamedPointer,ns);
+		    if (np)
+			data = YOBJECT(DataBlock,np->userData());
 		}
+		if (data)
+		    tmp = data->sqlEscape(extraEsc);
 		else
-		    tmp = *ns;
+		    tmp = ns->sqlEscape(extraEsc);
 	    }
 	    else
-		tmp = def;
-	    str = str.substr(0,p1) + tmp + str.substr(p2+1);
-	    // advance search offset past the string we just replaced
-	    p1 += tmp.length();
-	    cnt++;
+		tmp = *ns;
 	}
 	else
-	    return -1;
+	    tmp = def;
+	out.append(str.c_str() + p0,p1 - p0) << tmp;
+	p0 = p2 + 1;
+	cnt++;
     }
+    out << str.c_str() + p0;
+    out.flush();
+    str = res;
     return cnt;
 }
 
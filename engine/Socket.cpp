@@ -1184,6 +1184,105 @@ bool File::listDirectory(const char* path, ObjList* dirs, ObjList* files, int* e
 }
 
 
+namespace { // anonymous
+
+// A packet in a socket batch
+struct BatchPacket
+{
+    unsigned char* data;
+    int length;
+    socklen_t adrlen;
+    struct sockaddr_storage addr;
+};
+
+// Packets of a batch, the system descriptors must be in contiguous arrays
+struct BatchData
+{
+    BatchPacket* packets;
+#ifdef HAVE_MMSG
+    struct mmsghdr* hdrs;
+    struct iovec* iovs;
+#endif
+};
+
+}; // anonymous namespace
+
+SocketBatch::SocketBatch(unsigned int capacity, unsigned int size)
+    : m_capacity(capacity ? capacity : 1), m_size(size ? size : 1), m_count(0),
+      m_buffer(0), m_packets(0)
+{
+    m_buffer = new unsigned char[m_capacity * m_size];
+    BatchData* d = new BatchData;
+    d->packets = new BatchPacket[m_capacity];
+    ::memset(d->packets,0,m_capacity * sizeof(BatchPacket));
+#ifdef HAVE_MMSG
+    d->hdrs = new struct mmsghdr[m_capacity];
+    d->iovs = new struct iovec[m_capacity];
+    ::memset(d->hdrs,0,m_capacity * sizeof(struct mmsghdr));
+    ::memset(d->iovs,0,m_capacity * sizeof(struct iovec));
+#endif
+    for (unsigned int i = 0; i < m_capacity; i++) {
+	d->packets[i].data = m_buffer + i * m_size;
+#ifdef HAVE_MMSG
+	d->hdrs[i].msg_hdr.msg_iov = d->iovs + i;
+	d->hdrs[i].msg_hdr.msg_iovlen = 1;
+	d->hdrs[i].msg_hdr.msg_name = &d->packets[i].addr;
+#endif
+    }
+    m_packets = d;
+}
+
+SocketBatch::~SocketBatch()
+{
+    BatchData* d = static_cast<BatchData*>(m_packets);
+#ifdef HAVE_MMSG
+    delete[] d->iovs;
+    delete[] d->hdrs;
+#endif
+    delete[] d->packets;
+    delete d;
+    delete[] m_buffer;
+}
+
+unsigned char* SocketBatch::data(unsigned int index) const
+{
+    return (index < m_count) ? static_cast<BatchData*>(m_packets)->packets[index].data : 0;
+}
+
+int SocketBatch::length(unsigned int index) const
+{
+    return (index < m_count) ? static_cast<BatchData*>(m_packets)->packets[index].length : 0;
+}
+
+const struct sockaddr* SocketBatch::address(unsigned int index, socklen_t* adrlen) const
+{
+    if (index >= m_count) {
+	if (adrlen)
+	    *adrlen = 0;
+	return 0;
+    }
+    BatchPacket& p = static_cast<BatchData*>(m_packets)->packets[index];
+    if (adrlen)
+	*adrlen = p.adrlen;
+    return (const struct sockaddr*)&p.addr;
+}
+
+bool SocketBatch::add(const void* data, int length, const SocketAddr& addr)
+{
+    if (full() || (length < 0) || ((unsigned int)length > m_size) || (length && !data))
+	return false;
+    if (!addr.address() || (addr.length() > (socklen_t)sizeof(struct sockaddr_storage)))
+	return false;
+    BatchPacket& p = static_cast<BatchData*>(m_packets)->packets[m_count++];
+    if (length)
+	::memcpy(p.data,data,length);
+    p.length = length;
+    p.adrlen = addr.length();
+    ::memcpy(&p.addr,addr.address(),p.adrlen);
+    return true;
+}
+
+
 Socket::Socket()
     : m_handle(invalidHandle())
 {
@@ -1515,6 +1614,103 @@ int Socket::recvFrom(void* buffer, int length, SocketAddr& addr, int flags)
     return res;
 }
 
+int Socket::recvBatch(SocketBatch& batch, int flags)
+{
+    batch.clear();
+    BatchData* d = static_cast<BatchData*>(batch.m_packets);
+    BatchPacket* p = d->packets;
+    int res = 0;
+#ifdef HAVE_MMSG
+    for (unsigned int i = 0; i < batch.capacity(); i++) {
+	d->iovs[i].iov_base = p[i].data;
+	d->iovs[i].iov_len = batch.size();
+	d->hdrs[i].msg_hdr.msg_name = &p[i].addr;
+	d->hdrs[i].msg_hdr.msg_namelen = sizeof(p[i].addr);
+	d->hdrs[i].msg_hdr.msg_control = 0;
+	d->hdrs[i].msg_hdr.msg_controllen = 0;
+	d->hdrs[i].msg_hdr.msg_flags = 0;
+    }
+    res = ::recvmmsg(m_handle,d->hdrs,batch.capacity(),flags,0);
+    if (!checkError(res,true))
+	return socketError();
+    for (int i = 0; i < res; i++) {
+	p[i].length = d->hdrs[i].msg_len;
+	p[i].adrlen = d->hdrs[i].msg_hdr.msg_namelen;
+    }
+#else
+    while ((unsigned int)res < batch.capacity()) {
+	p[res].adrlen = sizeof(p[res].addr);
+	int len = ::recvfrom(m_handle,(char*)p[res].data,batch.size(),flags,
+	    (struct sockaddr*)&p[res].addr,&p[res].adrlen);
+	if (!checkError(len,true)) {
+	    if (!res)
+		return socketError();
+	    // return what we got so far, usually there is nothing left
+	    clearError();
+	    break;
+	}
+	p[res++].length = len;
+    }
+#endif
+    // drop the packets claimed by filters, keep the others in order
+    unsigned int n = 0;
+    for (int i = 0; i < res; i++) {
+	if (applyFilters(p[i].data,p[i].length,flags,(struct sockaddr*)&p[i].addr,p[i].adrlen))
+	    continue;
+	if (n != (unsigned int)i) {
+	    unsigned char* tmp = p[n].data;
+	    p[n].data = p[i].data;
+	    p[i].data = tmp;
+	    p[n].length = p[i].length;
+	    p[n].adrlen = p[i].adrlen;
+	    ::memcpy(&p[n].addr,&p[i].addr,p[i].adrlen);
+	}
+	n++;
+    }
+    batch.m_count = n;
+    if (res && !n) {
+	m_error = EAGAIN;
+	return socketError();
+    }
+    return n;
+}
+
+int Socket::sendBatch(SocketBatch& batch, int flags)
+{
+    BatchData* d = static_cast<BatchData*>(batch.m_packets);
+    BatchPacket* p = d->packets;
+    unsigned int count = batch.count();
+    batch.clear();
+    unsigned int sent = 0;
+#ifdef HAVE_MMSG
+    for (unsigned int i = 0; i < count; i++) {
+	d->iovs[i].iov_base = p[i].data;
+	d->iovs[i].iov_len = p[i].length;
+	d->hdrs[i].msg_hdr.msg_name = &p[i].addr;
+	d->hdrs[i].msg_hdr.msg_namelen = p[i].adrlen;
+	d->hdrs[i].msg_hdr.msg_control = 0;
+	d->hdrs[i].msg_hdr.msg_controllen = 0;
+	d->hdrs[i].msg_hdr.msg_flags = 0;
+    }
+    while (sent < count) {
+	int res = ::sendmmsg(m_handle,d->hdrs + sent,count - sent,flags);
+	if (!checkError(res,true))
+	    return sent ? (int)sent : socketError();
+	if (!res)
+	    break;
+	sent += res;
+    }
+#else
+    for (; sent < count; sent++) {
+	int res = ::sendto(m_handle,(const char*)p[sent].data,p[sent].length,flags,
+	    (const struct sockaddr*)&p[sent].addr,p[sent].adrlen);
+	if (!checkError(res,true))
+	    return sent ? (int)sent : socketError();
+    }
+#endif
+    return sent;
+}
+
 int Socket::recv(void* buffer, int length, int flags)
 {
     if (!buffer)
@@ -188,13 +188,15 @@ const String& String::empty()
 }
 
 String::String()
-    : m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+    : m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String() [%p]",this);
 }
 
 String::String(const char* value, int len)
-    : m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+    : m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String(\"%s\",%d) [%p]",value,len,this);
     assign(value,len);
@@ -202,7 +204,8 @@ String::String(const char* value, int len)
 
 String::String(const String& value)
     : GenObject(),
-      m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+      m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String(%p) [%p]",&value,this);
     if (!value.null()) {
@@ -214,7 +217,8 @@ String::String(const String& value)
 }
 
 String::String(char value, unsigned int repeat)
-    : m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+    : m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String('%c',%d) [%p]",value,repeat,this);
     if (value && repeat) {
@@ -230,7 +234,8 @@ String::String(char value, unsigned int repeat)
 }
 
 String::String(int value)
-    : m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+    : m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String(%d) [%p]",value,this);
     char buf[64];
@@ -242,7 +247,8 @@ String::String(int value)
 }
 
 String::String(unsigned int value)
-    : m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+    : m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String(%u) [%p]",value,this);
     char buf[64];
@@ -254,7 +260,8 @@ String::String(unsigned int value)
 }
 
 String::String(bool value)
-    : m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+    : m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String(%u) [%p]",value,this);
     m_string = ::strdup(boolText(value));
@@ -264,7 +271,8 @@ String::String(bool value)
 }
 
 String::String(const String* value)
-    : m_string(0), m_length(0), m_hash(YSTRING_INIT_HASH), m_matches(0)
+    : m_string(0), m_length(0), m_capacity(0), m_lengthSet(false),
+      m_hash(YSTRING_INIT_HASH), m_matches(0)
 {
     XDebug(DebugAll,"String::String(%p) [%p]",&value,this);
     if (value && !value->null()) {
@@ -304,18 +312,23 @@ String& String::assign(const char* value, int len)
 	    len = l;
 	}
 	if (value != m_string || len != (int)m_length) {
-	    char* data = (char*) ::malloc(len+1);
+	    unsigned int size = len;
+	    // a NULL string may have room reserved for its first value
+	    if (!m_string && (m_capacity > size))
+		size = m_capacity;
+	    char* data = (char*) ::malloc(size+1);
 	    if (data) {
 		::memcpy(data,value,len);
 		data[len] = 0;
 		char* odata = m_string;
 		m_string = data;
-		changed();
+		m_capacity = size;
+		lengthChanged(len);
 		if (odata)
 		    ::free(odata);
 	    }
 	    else
-		Debug("String",DebugFail,"malloc(%d) returned NULL!",len+1);
+		Debug("String",DebugFail,"malloc(%d) returned NULL!",size+1);
 	}
     }
     else
@@ -332,7 +345,8 @@ String& String::assign(char value, unsigned int repeat)
 	    data[repeat] = 0;
 	    char* odata = m_string;
 	    m_string = data;
-	    changed();
+	    m_capacity = repeat;
+	    lengthChanged(repeat);
 	    if (odata)
 		::free(odata);
 	}
@@ -367,6 +381,7 @@ String& String::hexify(void* data, unsigned int len, char sep, bool upCase)
 	    *d = '\0';
 	    char* odata = m_string;
 	    m_string = data;
+	    m_capacity = repeat;
 	    changed();
 	    if (odata)
 		::free(odata);
@@ -383,7 +398,18 @@ void String::changed()
 {
     clearMatches();
     m_hash = YSTRING_INIT_HASH;
-    m_length = m_string ? ::strlen(m_string) : 0;
+    // appending already knows the new length, no need to count it again
+    if (!m_lengthSet)
+	m_length = m_string ? ::strlen(m_string) : 0;
+}
+
+// Set the length of the string and notify the change
+void String::lengthChanged(unsigned int len)
+{
+    m_length = len;
+    m_lengthSet = true;
+    changed();
+    m_lengthSet = false;
 }
 
 void String::clear()
@@ -391,11 +417,70 @@ void String::clear()
     if (m_string) {
 	char *odata = m_string;
 	m_string = 0;
+	m_capacity = 0;
 	changed();
 	::free(odata);
     }
 }
 
+void String::reserve(unsigned int len)
+{
+    if (!m_string) {
+	if (len > m_capacity)
+	    m_capacity = len;
+	return;
+    }
+    if (len <= capacity())
+	return;
+    char* data = (char*) ::realloc(m_string,len+1);
+    if (data) {
+	m_string = data;
+	m_capacity = len;
+    }
+    else
+	Debug("String",DebugFail,"realloc(%u) returned NULL!",len+1);
+}
+
+// Make room for a string of the given length, growing the buffer geometrically
+//  so repeated appending copies each character only a few times
+bool String::grow(unsigned int len)
+{
+    unsigned int cap = capacity();
+    if (m_string && (len <= cap))
+	return true;
+    unsigned int size = cap + (cap >> 1);
+    if (size < len)
+	size = len;
+    if (!m_string && (m_capacity > size))
+	size = m_capacity;
+    char* data = (char*) ::realloc(m_string,size+1);
+    if (!data) {
+	Debug("String",DebugFail,"realloc(%u) returned NULL!",size+1);
+	return false;
+    }
+    m_string = data;
+    m_capacity = size;
+    return true;
+}
+
+// Append characters without notifying the change
+bool String::appendRaw(const char* value, unsigned int len)
+{
+    unsigned int olen = m_length;
+    // the value may be part of this string and move when growing
+    int offs = -1;
+    if (m_string && (value >= m_string) && (value <= m_string + olen))
+	offs = value - m_string;
+    if (!grow(olen + len))
+	return false;
+    if (offs >= 0)
+	value = m_string + offs;
+    ::memcpy(m_string + olen,value,len);
+    m_string[olen + len] = 0;
+    m_length = olen + len;
+    return true;
+}
+
 char String::at(int index) const
 {
     if ((index < 0) || ((unsigned)index >= m_length) || !m_string)
@@ -565,8 +650,12 @@ String& String::operator=(const char* value)
     if (value && !*value)
 	value = 0;
     if (value != c_str()) {
+	// keep the room reserved by a NULL string
+	if (value && !m_string && m_capacity)
+	    return assign(value);
 	char *tmp = m_string;
 	m_string = value ? ::strdup(value) : 0;
+	m_capacity = 0;
 	if (value && !m_string)
 	    Debug("String",DebugFail,"strdup() returned NULL!");
 	changed();
@@ -698,31 +787,17 @@ String& String::operator>>(bool& store)
 String& String::append(const char* value, int len)
 {
     if (len && value && *value) {
-	if (len < 0) {
-	    if (!m_string) {
-		m_string = ::strdup(value);
-		if (!m_string)
-		    Debug("String",DebugFail,"strdup() returned NULL!");
-		changed();
-		return *this;
-	    }
+	if (len < 0)
 	    len = ::strlen(value);
+	else {
+	    int l = 0;
+	    for (const char* p = value; l < len; l++)
+		if (!*p++)
+		    break;
+	    len = l;
 	}
-	int olen = length();
-	len += olen;
-	char *tmp1 = m_string;
-	char *tmp2 = (char *) ::malloc(len+1);
-	if (tmp2) {
-	    if (m_string)
-		::strncpy(tmp2,m_string,olen);
-	    ::strncpy(tmp2+olen,value,len-olen);
-	    tmp2[len] = 0;
-	    m_string = tmp2;
-	    ::free(tmp1);
-	}
-	else
-	    Debug("String",DebugFail,"malloc(%d) returned NULL!",len+1);
-	changed();
+	if (appendRaw(value,len))
+	    lengthChanged(m_length);
     }
     return *this;
 }
@@ -754,14 +829,9 @@ String& String::append(const ObjList* list, const char* separator, bool force)
     }
     if (!len)
 	return *this;
-    char* oldStr = m_string;
-    char* newStr = (char*)::malloc(olen + len + 1);
-    if (!newStr) {
-	Debug("String",DebugFail,"malloc(%d) returned NULL!",olen + len + 1);
+    if (!grow(olen + len))
 	return *this;
-    }
-    if (m_string)
-	::memcpy(newStr,m_string,olen);
+    char* newStr = m_string;
     for (list = list->skipNull(); list; list = list->skipNext()) {
 	const String& src = list->get()->toString();
 	if (sepLen && olen && (src.length() || force)) {
@@ -772,9 +842,7 @@ String& String::append(const ObjList* list, const char* separator, bool force)
 	olen += src.length();
     }
     newStr[olen] = 0;
-    m_string = newStr;
-    ::free(oldStr);
-    changed();
+    lengthChanged(olen);
     return *this;
 }
 
@@ -1356,6 +1424,78 @@ const String& String::toString() const
 }
 
 
+// Write the decimal digits of a number before the end of a buffer
+static char* decimalDigits(char* end, u_int64_t value)
+{
+    do {
+	*--end = '0' + (char)(value % 10);
+	value /= 10;
+    } while (value);
+    return end;
+}
+
+StringBuilder::StringBuilder(String& str, unsigned int reserve)
+    : m_str(str), m_changed(false)
+{
+    if (reserve)
+	str.reserve(str.length() + reserve);
+}
+
+String& StringBuilder::flush()
+{
+    if (m_changed) {
+	m_changed = false;
+	m_str.lengthChanged(m_str.length());
+    }
+    return m_str;
+}
+
+StringBuilder& StringBuilder::append(const char* value, unsigned int len)
+{
+    if (value && len && m_str.appendRaw(value,len))
+	m_changed = true;
+    return *this;
+}
+
+StringBuilder& StringBuilder::operator<<(const char* value)
+{
+    return value ? append(value,::strlen(value)) : *this;
+}
+
+StringBuilder& StringBuilder::operator<<(char value)
+{
+    return value ? append(&value,1) : *this;
+}
+
+StringBuilder& StringBuilder::operator<<(int value)
+{
+    return operator<<((int64_t)value);
+}
+
+StringBuilder& StringBuilder::operator<<(unsigned int value)
+{
+    return operator<<((u_int64_t)value);
+}
+
+StringBuilder& StringBuilder::operator<<(int64_t value)
+{
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = decimalDigits(end,(value < 0) ? (u_int64_t)0 - (u_int64_t)value : (u_int64_t)value);
+    if (value < 0)
+	*--p = '-';
+    return append(p,end - p);
+}
+
+StringBuilder& StringBuilder::operator<<(u_int64_t value)
+{
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = decimalDigits(end,value);
+    return append(p,end - p);
+}
+
+
 Regexp::Regexp()
     : m_regexp(0), m_flags(0)
 {
@@ -34,7 +34,8 @@ ASNLib::ASNLib()
 ASNLib::~ASNLib()
 {}
 
-int ASNLib::decodeLength(DataBlock& data) {
+int ASNLib::decodeLength(AsnCursor& data)
+{
 
     XDebug(s_libName.c_str(),DebugAll,"::decodeLength() - from data='%p'",&data);
     int length = 0;
@@ -90,7 +91,7 @@ DataBlock ASNLib::buildLength(DataBlock& data)
    return lenDb;
 }
 
-int ASNLib::matchEOC(DataBlock& data)
+int ASNLib::matchEOC(AsnCursor& data)
 {
     /**
      * EoC = 00 00
@@ -106,7 +107,7 @@ int ASNLib::matchEOC(DataBlock& data)
 }
 
 
-int ASNLib::parseUntilEoC(DataBlock& data, int length)
+int ASNLib::parseUntilEoC(AsnCursor& data, int length)
 {
     if (length >= (int)data.length() || ASNLib::matchEOC(data) > 0)
 	return length;
@@ -138,7 +139,7 @@ int ASNLib::parseUntilEoC(DataBlock& data, int length)
     return length;
 }
 
-int ASNLib::decodeBoolean(DataBlock& data, bool* val, bool tagCheck)
+int ASNLib::decodeBoolean(AsnCursor& data, bool* val, bool tagCheck)
 {
     /**
      * boolean = 0x01 length byte (byte == 0 => false, byte != 0 => true)
@@ -183,7 +184,7 @@ int ASNLib::decodeBoolean(DataBlock& data, bool* val, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeInteger(DataBlock& data, u_int64_t& intVal, unsigned int bytes, bool tagCheck)
+int ASNLib::decodeInteger(AsnCursor& data, u_int64_t& intVal, unsigned int bytes, bool tagCheck)
 {
     /**
      * integer = 0x02 length byte {byte}*
@@ -236,7 +237,7 @@ int ASNLib::decodeInteger(DataBlock& data, u_int64_t& intVal, unsigned int bytes
     return length;
 }
 
-int ASNLib::decodeUINT8(DataBlock& data, u_int8_t* intVal, bool tagCheck)
+int ASNLib::decodeUINT8(AsnCursor& data, u_int8_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeUINT8()");
     u_int64_t val;
@@ -249,7 +250,7 @@ int ASNLib::decodeUINT8(DataBlock& data, u_int8_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeUINT16(DataBlock& data, u_int16_t* intVal, bool tagCheck)
+int ASNLib::decodeUINT16(AsnCursor& data, u_int16_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeUINT16() from data='%p'",&data);
     u_int64_t val;
@@ -262,7 +263,7 @@ int ASNLib::decodeUINT16(DataBlock& data, u_int16_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeUINT32(DataBlock& data, u_int32_t* intVal, bool tagCheck)
+int ASNLib::decodeUINT32(AsnCursor& data, u_int32_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeUINT32() from data='%p'",&data);
     u_int64_t val;
@@ -275,7 +276,7 @@ int ASNLib::decodeUINT32(DataBlock& data, u_int32_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeUINT64(DataBlock& data, u_int64_t* intVal, bool tagCheck)
+int ASNLib::decodeUINT64(AsnCursor& data, u_int64_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeUINT64() from data='%p'",&data);
     u_int64_t val;
@@ -288,7 +289,7 @@ int ASNLib::decodeUINT64(DataBlock& data, u_int64_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeINT8(DataBlock& data, int8_t* intVal, bool tagCheck)
+int ASNLib::decodeINT8(AsnCursor& data, int8_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeINT8() from data='%p'",&data);
     u_int64_t val;
@@ -301,7 +302,7 @@ int ASNLib::decodeINT8(DataBlock& data, int8_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeINT16(DataBlock& data, int16_t* intVal, bool tagCheck)
+int ASNLib::decodeINT16(AsnCursor& data, int16_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeINT16() from data='%p'",&data);
     u_int64_t val;
@@ -314,7 +315,7 @@ int ASNLib::decodeINT16(DataBlock& data, int16_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeINT32(DataBlock& data, int32_t* intVal, bool tagCheck)
+int ASNLib::decodeINT32(AsnCursor& data, int32_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeINT32() from data='%p'",&data);
     u_int64_t val;
@@ -327,7 +328,7 @@ int ASNLib::decodeINT32(DataBlock& data, int32_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeINT64(DataBlock& data, int64_t* intVal, bool tagCheck)
+int ASNLib::decodeINT64(AsnCursor& data, int64_t* intVal, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeINT64() from data='%p'",&data);
     u_int64_t val;
@@ -340,7 +341,7 @@ int ASNLib::decodeINT64(DataBlock& data, int64_t* intVal, bool tagCheck)
     return l;
 }
 
-int ASNLib::decodeBitString(DataBlock& data, String* val, bool tagCheck)
+int ASNLib::decodeBitString(AsnCursor& data, String* val, bool tagCheck)
 {
     /**
      * bitstring ::= 0x03 asnlength unusedBytes {byte}*
@@ -401,7 +402,7 @@ int ASNLib::decodeBitString(DataBlock& data, String* val, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeOctetString(DataBlock& db, OctetString* strVal, bool tagCheck)
+int ASNLib::decodeOctetString(AsnCursor& db, OctetString* strVal, bool tagCheck)
 {
     /**
      *  octet string ::= 0x04 asnlength {byte}*
@@ -442,7 +443,7 @@ int ASNLib::decodeOctetString(DataBlock& db, OctetString* strVal, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeNull(DataBlock& data, bool tagCheck)
+int ASNLib::decodeNull(AsnCursor& data, bool tagCheck)
 {
     /**
      * ASN.1 null := 0x05 00
@@ -468,7 +469,7 @@ int ASNLib::decodeNull(DataBlock& data, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeOID(DataBlock& data, ASNObjId* obj, bool tagCheck)
+int ASNLib::decodeOID(AsnCursor& data, ASNObjId* obj, bool tagCheck)
 {
    /**
     * ASN.1 objid ::= 0x06 asnlength subidentifier {subidentifier}*
@@ -549,7 +550,7 @@ int ASNLib::decodeOID(DataBlock& data, ASNObjId* obj, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeReal(DataBlock& db, float* realVal, bool tagCheck)
+int ASNLib::decodeReal(AsnCursor& db, float* realVal, bool tagCheck)
 {
     if (db.length() < 2)
 	return InvalidLengthOrTag;
@@ -576,7 +577,7 @@ int ASNLib::decodeReal(DataBlock& db, float* realVal, bool tagCheck)
     return 0;
 }
 
-int ASNLib::decodeString(DataBlock& data, String* str, int* type, bool tagCheck)
+int ASNLib::decodeString(AsnCursor& data, String* str, int* type, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeString() from data='%p'",&data);
     if (data.length() < 2)
@@ -625,7 +626,7 @@ int ASNLib::decodeString(DataBlock& data, String* str, int* type, bool tagCheck)
 }
 
 
-int ASNLib::decodeUtf8(DataBlock& data, String* str, bool tagCheck)
+int ASNLib::decodeUtf8(AsnCursor& data, String* str, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeUtf8() from data='%p'",&data);
     if (data.length() < 2)
@@ -668,7 +669,7 @@ int ASNLib::decodeUtf8(DataBlock& data, String* str, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeGenTime(DataBlock& data, unsigned int* time, unsigned int* fractions, bool* utc, bool tagCheck)
+int ASNLib::decodeGenTime(AsnCursor& data, unsigned int* time, unsigned int* fractions, bool* utc, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeGenTime() from data='%p'",&data);
     if (data.length() < 2)
@@ -764,7 +765,7 @@ int ASNLib::decodeGenTime(DataBlock& data, unsigned int* time, unsigned int* fra
     return length;
 }
 
-int ASNLib::decodeUTCTime(DataBlock& data, unsigned int* time, bool tagCheck)
+int ASNLib::decodeUTCTime(AsnCursor& data, unsigned int* time, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeUTCTime() from data='%p'",&data);
     if (data.length() < 2)
@@ -847,18 +848,18 @@ int ASNLib::decodeUTCTime(DataBlock& data, unsigned int* time, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeAny(DataBlock data, DataBlock* val, bool tagCheck)
+int ASNLib::decodeAny(const AsnCursor& data, DataBlock* val, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeAny() from data='%p'",&data);
     if (!val) {
         DDebug(s_libName.c_str(),DebugAll,"::decodeAny() - Invalid buffer for return data");
         return InvalidContentsError;
     }
-    val->append(data);
+    val->append((void*)data.data(),data.length());
     return data.length();
 }
 
-int ASNLib::decodeSequence(DataBlock& data, bool tagCheck)
+int ASNLib::decodeSequence(AsnCursor& data, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeSequence() from data='%p'",&data);
     if (data.length() < 2)
@@ -882,7 +883,7 @@ int ASNLib::decodeSequence(DataBlock& data, bool tagCheck)
     return length;
 }
 
-int ASNLib::decodeSet(DataBlock& data, bool tagCheck)
+int ASNLib::decodeSet(AsnCursor& data, bool tagCheck)
 {
     XDebug(s_libName.c_str(),DebugAll,"::decodeSet() from data='%p",&data);
     if (data.length() < 2)
@@ -907,6 +908,207 @@ int ASNLib::decodeSet(DataBlock& data, bool tagCheck)
     return length;
 }
 
+/**
+  * DataBlock decoders, they consume the data block as the cursor advances
+  */
+int ASNLib::decodeLength(DataBlock& data)
+{
+    AsnCursor cursor(data);
+    int ret = decodeLength(cursor);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::matchEOC(DataBlock& data)
+{
+    AsnCursor cursor(data);
+    int ret = matchEOC(cursor);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::parseUntilEoC(DataBlock& data, int length)
+{
+    AsnCursor cursor(data);
+    int ret = parseUntilEoC(cursor,length);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeBoolean(DataBlock& data, bool* val, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeBoolean(cursor,val,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeInteger(DataBlock& data, u_int64_t& intVal, unsigned int bytes, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeInteger(cursor,intVal,bytes,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeUINT8(DataBlock& data, u_int8_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeUINT8(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeUINT16(DataBlock& data, u_int16_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeUINT16(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeUINT32(DataBlock& data, u_int32_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeUINT32(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeUINT64(DataBlock& data, u_int64_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeUINT64(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeINT8(DataBlock& data, int8_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeINT8(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeINT16(DataBlock& data, int16_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeINT16(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeINT32(DataBlock& data, int32_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeINT32(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeINT64(DataBlock& data, int64_t* intVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeINT64(cursor,intVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeBitString(DataBlock& data, String* val, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeBitString(cursor,val,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeOctetString(DataBlock& data, OctetString* strVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeOctetString(cursor,strVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeNull(DataBlock& data, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeNull(cursor,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeOID(DataBlock& data, ASNObjId* obj, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeOID(cursor,obj,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeReal(DataBlock& data, float* realVal, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeReal(cursor,realVal,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeString(DataBlock& data, String* str, int* type, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeString(cursor,str,type,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeUtf8(DataBlock& data, String* str, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeUtf8(cursor,str,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeGenTime(DataBlock& data, unsigned int* time, unsigned int* fractions, bool* utc, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeGenTime(cursor,time,fractions,utc,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeUTCTime(DataBlock& data, unsigned int* time, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeUTCTime(cursor,time,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeSequence(DataBlock& data, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeSequence(cursor,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeSet(DataBlock& data, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    int ret = decodeSet(cursor,tagCheck);
+    cursor.apply(data);
+    return ret;
+}
+
+int ASNLib::decodeAny(DataBlock data, DataBlock* val, bool tagCheck)
+{
+    AsnCursor cursor(data);
+    return decodeAny(cursor,val,tagCheck);
+}
+
 DataBlock ASNLib::encodeBoolean(bool val, bool tagCheck)
 {
     /**
@@ -1239,7 +1441,7 @@ int ASNLib::encodeSet(DataBlock& data, bool tagCheck)
 /**
   * AsnTag
   */
-void AsnTag::decode(AsnTag& tag, DataBlock& data)
+void AsnTag::decode(AsnTag& tag, AsnCursor& data)
 {
     XDebug(s_libName.c_str(),DebugAll,"AsnTag::decode()");
     tag.classType((Class)(data[0] & 0xc0));
@@ -1261,6 +1463,12 @@ void AsnTag::decode(AsnTag& tag, DataBlock& data)
     tag.encode();
 }
 
+void AsnTag::decode(AsnTag& tag, DataBlock& data)
+{
+    AsnCursor cursor(data);
+    decode(tag,cursor);
+}
+
 void AsnTag::encode(Class clas, Type type, unsigned int code, DataBlock& data)
 {
     XDebug(s_libName.c_str(),DebugAll,"AsnTag::encode(clas=0x%x, type=0x%x, code=%u)",clas,type,code);
@@ -1302,6 +1510,118 @@ void AsnTag::encode(Class clas, Type type, unsigned int code, DataBlock& data)
 #endif
 }
 
+/**
+  * AsnWriter
+  */
+static inline int hexDigit(char c)
+{
+    if (('0' <= c) && (c <= '9'))
+	return c - '0';
+    if (('a' <= c) && (c <= 'f'))
+	return c - 'a' + 10;
+    if (('A' <= c) && (c <= 'F'))
+	return c - 'A' + 10;
+    return -1;
+}
+
+AsnWriter::AsnWriter(DataBlock& data, unsigned int room)
+    : m_data(data)
+{
+    if (room)
+	m_data.reserve(0,room);
+}
+
+void AsnWriter::putLength(unsigned int len)
+{
+    if (len < ASN_LONG_LENGTH) {
+	putByte(len);
+	return;
+    }
+    u_int8_t buf[sizeof(len) + 1];
+    unsigned int i = sizeof(buf);
+    while (len) {
+	buf[--i] = len & 0xff;
+	len >>= 8;
+    }
+    buf[i - 1] = ASN_LONG_LENGTH | (sizeof(buf) - i);
+    i--;
+    put(buf + i,sizeof(buf) - i);
+}
+
+void AsnWriter::putInteger(u_int64_t val)
+{
+    // 9 consecutive ones or zeros are not allowed at the beginning of an integer
+    int size = sizeof(u_int64_t);
+    uint16_t msb = (uint16_t)(val >> ((size - 1) * 8 - 1));
+    while (((msb & 0x1FF) == 0 || (msb & 0x1FF) == 0x1FF) && (size - 1 >= 1)) {
+	size--;
+	msb = (uint16_t)(val >> ((size - 1) * 8 - 1));
+    }
+    u_int8_t buf[sizeof(u_int64_t)];
+    for (int i = size - 1; i >= 0; i--) {
+	buf[i] = (u_int8_t)val;
+	val >>= 8;
+    }
+    put(buf,size);
+}
+
+bool AsnWriter::putHex(const String& hex, char sep)
+{
+    const char* str = hex.c_str();
+    unsigned int len = hex.length();
+    unsigned int step = 2;
+    if (sep) {
+	// Remove leading and trailing separators
+	if (len && str[0] == sep) {
+	    str++;
+	    len--;
+	}
+	if (len && str[len - 1] == sep)
+	    len--;
+	if (2 != (len % 3))
+	    return (len == 0);
+	step = 3;
+    }
+    else if (len % 2)
+	return false;
+    unsigned int n = (len + 1) / step;
+    unsigned int mark = length();
+    // Decode from the last octet in chunks so nothing is allocated
+    u_int8_t buf[64];
+    while (n) {
+	unsigned int chunk = (n < sizeof(buf)) ? n : sizeof(buf);
+	n -= chunk;
+	for (unsigned int i = 0; i < chunk; i++) {
+	    const char* s = str + (n + i) * step;
+	    int c1 = hexDigit(s[0]);
+	    int c2 = hexDigit(s[1]);
+	    if (c1 < 0 || c2 < 0 || (sep && (n + i) && (s[-1] != sep))) {
+		rollback(mark);
+		return false;
+	    }
+	    buf[i] = (c1 << 4) | c2;
+	}
+	put(buf,chunk);
+    }
+    return true;
+}
+
+unsigned int AsnWriter::close(unsigned int mark, u_int8_t tag)
+{
+    unsigned int len = length() - mark;
+    putLength(len);
+    putByte(tag);
+    return len;
+}
+
+unsigned int AsnWriter::close(unsigned int mark, const AsnTag& tag)
+{
+    unsigned int len = length() - mark;
+    putLength(len);
+    putTag(tag);
+    return len;
+}
+
 /**
   * ASNObjId
   */
@@ -57,6 +57,131 @@ class ASNObjId;
 class ASNLib;
 class ASNError;
 
+/**
+ * A read cursor over constant BER encoded data. Decoding advances the start
+ *  of the cursor instead of cutting the data so the buffer is never changed.
+ * The cursor does not own the data, which must outlive it
+ * @short Read position and bounds inside encoded data
+ */
+class YASN_API AsnCursor
+{
+public:
+    /**
+     * Constructs an empty cursor
+     */
+    inline AsnCursor()
+	: m_data(0), m_length(0)
+	{ }
+
+    /**
+     * Constructs a cursor over all the data in a block
+     * @param data Data block to read, must not be changed while the cursor is used
+     */
+    explicit inline AsnCursor(const DataBlock& data)
+	: m_data(static_cast<const unsigned char*>(data.data())), m_length(data.length())
+	{ }
+
+    /**
+     * Constructs a cursor over a buffer
+     * @param data Pointer to the data to read
+     * @param len Length of the data
+     */
+    inline AsnCursor(const void* data, unsigned int len)
+	: m_data(static_cast<const unsigned char*>(data)), m_length(data ? len : 0)
+	{ }
+
+    /**
+     * Get a pointer to the data at the cursor position
+     * @return Pointer to the unread data, may be NULL if the cursor was always empty
+     */
+    inline const unsigned char* data() const
+	{ return m_data; }
+
+    /**
+     * Get a pointer to a byte range after the cursor position
+     * @param offs Byte offset from the cursor position
+     * @param len Number of bytes that must be valid starting at offset
+     * @return A pointer to the data or NULL if the range is not available
+     */
+    inline const unsigned char* data(unsigned int offs, unsigned int len = 1) const
+	{ return (offs + len <= m_length) ? (m_data + offs) : 0; }
+
+    /**
+     * Get the number of bytes left to read
+     * @return Length of the unread data
+     */
+    inline unsigned int length() const
+	{ return m_length; }
+
+    /**
+     * Get the value of a byte after the cursor position
+     * @param offs Byte offset from the cursor position
+     * @param defvalue Default value to return if offset is outside data
+     * @return Byte value at offset (0-255) or defvalue if offset outside data
+     */
+    inline int at(unsigned int offs, int defvalue = -1) const
+	{ return (offs < m_length) ? m_data[offs] : defvalue; }
+
+    /**
+     * Byte indexing operator with signed parameter
+     * @param index Offset of the byte from the cursor position
+     * @return Byte value at offset (0-255) or -1 if index outside data
+     */
+    inline int operator[](signed int index) const
+	{ return at(index); }
+
+    /**
+     * Byte indexing operator with unsigned parameter
+     * @param index Offset of the byte from the cursor position
+     * @return Byte value at offset (0-255) or -1 if index outside data
+     */
+    inline int operator[](unsigned int index) const
+	{ return at(index); }
+
+    /**
+     * Skip data at the cursor position or drop it from the end, same as DataBlock::cut()
+     * @param len Amount to cut, positive to cut from end, negative to advance the position
+     */
+    inline void cut(int len)
+	{
+	    if (len < 0) {
+		unsigned int n = -len;
+		if (n > m_length)
+		    n = m_length;
+		m_data += n;
+		m_length -= n;
+	    }
+	    else if ((unsigned int)len < m_length)
+		m_length -= len;
+	    else
+		m_length = 0;
+	}
+
+    /**
+     * Get a cursor limited to the data following the position
+     * @param len Maximum length of the new cursor
+     * @return Cursor over at most len bytes starting at this cursor position
+     */
+    inline AsnCursor sub(unsigned int len) const
+	{ return AsnCursor(m_data,(len < m_length) ? len : m_length); }
+
+    /**
+     * Cut from a data block what was consumed by this cursor.
+     * The cursor must have been built on the same unchanged data block
+     * @param data Data block the cursor was built on
+     */
+    inline void apply(DataBlock& data) const
+	{
+	    if (m_data && data.data())
+		data.cut(-(int)(m_data - static_cast<const unsigned char*>(data.data())));
+	    data.truncate(m_length);
+	}
+
+private:
+    const unsigned char* m_data;
+    unsigned int m_length;
+};
+
 /**
  * Helper class for operations with octet strings. Helps with conversions from String to/from DataBlock
  * @short Helper class for operations with octet strings
@@ -595,6 +720,13 @@ public:
      */
     static void decode(AsnTag& tag, DataBlock& data);
 
+    /**
+     * Decode an ASN.1 tag from the given data using a read cursor
+     * @param tag Tag to fill
+     * @param data Cursor over the input, advanced past the decoded data
+     */
+    static void decode(AsnTag& tag, AsnCursor& data);
+
     /**
      * Encode an ASN.1 tag and put the encoded form into the given data
      * @param clas Class of the tag
@@ -694,6 +826,117 @@ private:
     DataBlock m_coding;
 };
 
+/**
+ * A BER encoder writing from the end of a PDU towards its start.
+ * Contents are put before anything already written so the length of a
+ *  constructed element is known when its tag and length are put in front of it.
+ * Everything is written in the head room of a single data block which is the
+ *  finished PDU, reserving enough room up front avoids any reallocation
+ * @short Back to front ASN.1 BER encoder
+ */
+class YASN_API AsnWriter
+{
+public:
+    /**
+     * Constructor
+     * @param data Data block to write into, its current content ends the PDU
+     * @param room Number of bytes to reserve in front of the data
+     */
+    explicit AsnWriter(DataBlock& data, unsigned int room = 0);
+
+    /**
+     * Get the data block holding the encoded data
+     * @return Data block written into
+     */
+    inline DataBlock& data() const
+	{ return m_data; }
+
+    /**
+     * Get the number of bytes written so far, used as a mark to close elements
+     * @return Length of the encoded data
+     */
+    inline unsigned int length() const
+	{ return m_data.length(); }
+
+    /**
+     * Put raw bytes in front of the encoded data
+     * @param buf Pointer to the bytes to put
+     * @param len Number of bytes to put
+     */
+    inline void put(const void* buf, unsigned int len)
+	{ m_data.insert(const_cast<void*>(buf),len); }
+
+    /**
+     * Put the content of a data block in front of the encoded data
+     * @param buf Data block to put
+     */
+    inline void put(const DataBlock& buf)
+	{ m_data.insert(buf); }
+
+    /**
+     * Put a single byte in front of the encoded data
+     * @param val Byte to put
+     */
+    inline void putByte(u_int8_t val)
+	{ m_data.insert(&val,1); }
+
+    /**
+     * Put an encoded tag in front of the encoded data
+     * @param tag Tag to put
+     */
+    inline void putTag(const AsnTag& tag)
+	{ put(tag.coding()); }
+
+    /**
+     * Put the BER encoding of a length in front of the encoded data
+     * @param len Length to encode
+     */
+    void putLength(unsigned int len);
+
+    /**
+     * Put the contents of an integer in front of the encoded data, same as ASNLib::encodeInteger(val,false)
+     * @param val Integer value to encode
+     */
+    void putInteger(u_int64_t val);
+
+    /**
+     * Put hexified data in front of the encoded data
+     * @param hex String holding the hexified bytes
+     * @param sep Separator character used between octets
+     * @return True if the string was valid and its bytes were put
+     */
+    bool putHex(const String& hex, char sep = ' ');
+
+    /**
+     * Close an element by putting its length and tag in front of its contents
+     * @param mark Length of the encoded data before the contents were put
+     * @param tag Tag byte of the element
+     * @return Length of the contents of the element
+     */
+    unsigned int close(unsigned int mark, u_int8_t tag);
+
+    /**
+     * Close an element by putting its length and tag in front of its contents
+     * @param mark Length of the encoded data before the contents were put
+     * @param tag Tag of the element
+     * @return Length of the contents of the element
+     */
+    unsigned int close(unsigned int mark, const AsnTag& tag);
+
+    /**
+     * Drop what was written after a mark, used to abandon a failed element
+     * @param mark Length of the encoded data to return to
+     */
+    inline void rollback(unsigned int mark)
+	{
+	    if (length() > mark)
+		m_data.cut(-(int)(length() - mark));
+	}
+
+private:
+    DataBlock& m_data;
+};
+
 /**
  * Class ASNLib
  * @short Class containing functions for decoding/encoding ASN.1 basic data types
@@ -767,6 +1010,13 @@ public:
      */
     static int decodeLength(DataBlock& data);
 
+    /**
+     * Decode the length of the block data containing the ASN.1 type data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @return The length of the data block containing data, -1 if it couldn't be decoded
+     */
+    static int decodeLength(AsnCursor& data);
+
     /**
      * Decode a boolean value from the encoded data
      * @param data Input block from which the boolean value should be extracted
@@ -776,6 +1026,15 @@ public:
      */
     static int decodeBoolean(DataBlock& data, bool* val, bool tagCheck);
 
+    /**
+     * Decode a boolean value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param val Pointer to a boolean to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for boolean (0x01) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the boolean value could not be decoded
+     */
+    static int decodeBoolean(AsnCursor& data, bool* val, bool tagCheck);
+
     /**
      * Decode an integer value from the encoded data
      * @param data Input block from which the integer value should be extracted
@@ -786,6 +1045,16 @@ public:
      */
     static int decodeInteger(DataBlock& data, u_int64_t& intVal, unsigned int bytes, bool tagCheck);
 
+    /**
+     * Decode an integer value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param bytes Width of the decoded integer field
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeInteger(AsnCursor& data, u_int64_t& intVal, unsigned int bytes, bool tagCheck);
+
     /**
      * Decode an unsigned integer value from the encoded data - helper function for casting from u_int64_t to u_int8_t in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -795,6 +1064,15 @@ public:
      */
     static int decodeUINT8(DataBlock& data, u_int8_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an unsigned integer value from the encoded data - helper function for casting from u_int64_t to u_int8_t in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeUINT8(AsnCursor& data, u_int8_t* intVal, bool tagCheck);
+
     /**
      * Decode an unsigned integer value from the encoded data - helper function for casting from u_int64_t to u_int16_t in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -804,6 +1082,15 @@ public:
      */
     static int decodeUINT16(DataBlock& data, u_int16_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an unsigned integer value from the encoded data - helper function for casting from u_int64_t to u_int16_t in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeUINT16(AsnCursor& data, u_int16_t* intVal, bool tagCheck);
+
     /**
      * Decode an unsigned integer value from the encoded data - helper function for casting from u_int64_t to u_int32_t in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -813,6 +1100,15 @@ public:
      */
     static int decodeUINT32(DataBlock& data, u_int32_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an unsigned integer value from the encoded data - helper function for casting from u_int64_t to u_int32_t in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeUINT32(AsnCursor& data, u_int32_t* intVal, bool tagCheck);
+
     /**
      * Decode an unsigned integer value from the encoded data - helper function for casting in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -822,6 +1118,15 @@ public:
      */
     static int decodeUINT64(DataBlock& data, u_int64_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an unsigned integer value from the encoded data - helper function for casting in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeUINT64(AsnCursor& data, u_int64_t* intVal, bool tagCheck);
+
     /**
      * Decode an integer value from the encoded data - helper function for casting from u_int64_t to int8_t in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -831,6 +1136,15 @@ public:
      */
     static int decodeINT8(DataBlock& data, int8_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an integer value from the encoded data - helper function for casting from u_int64_t to int8_t in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeINT8(AsnCursor& data, int8_t* intVal, bool tagCheck);
+
     /**
      * Decode an integer value from the encoded data - helper function for casting from u_int64_t to int16_t in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -840,6 +1154,15 @@ public:
      */
     static int decodeINT16(DataBlock& data, int16_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an integer value from the encoded data - helper function for casting from u_int64_t to int16_t in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeINT16(AsnCursor& data, int16_t* intVal, bool tagCheck);
+
     /**
      * Decode an integer value from the encoded data - helper function for casting from u_int64_t to int32_t in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -849,6 +1172,15 @@ public:
      */
     static int decodeINT32(DataBlock& data, int32_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an integer value from the encoded data - helper function for casting from u_int64_t to int32_t in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeINT32(AsnCursor& data, int32_t* intVal, bool tagCheck);
+
     /**
      * Decode an integer value from the encoded data - helper function for casting in case of size constraints
      * @param data Input block from which the integer value should be extracted
@@ -858,6 +1190,15 @@ public:
      */
     static int decodeINT64(DataBlock& data, int64_t* intVal, bool tagCheck);
 
+    /**
+     * Decode an integer value from the encoded data - helper function for casting in case of size constraints using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param intVal Integer to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x02) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeINT64(AsnCursor& data, int64_t* intVal, bool tagCheck);
+
     /**
      * Decode a bitstring value from the encoded data
      * @param data Input block from which the bitstring value should be extracted
@@ -867,6 +1208,15 @@ public:
      */
     static int decodeBitString(DataBlock& data, String* val, bool tagCheck);
 
+    /**
+     * Decode a bitstring value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param val String to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x03) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeBitString(AsnCursor& data, String* val, bool tagCheck);
+
     /**
      * Decode a string value from the encoded data
      * @param data Input block from which the octet string value should be extracted
@@ -876,6 +1226,15 @@ public:
      */
     static int decodeOctetString(DataBlock& data, OctetString* strVal, bool tagCheck);
 
+    /**
+     * Decode a string value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param strVal String to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x04) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeOctetString(AsnCursor& data, OctetString* strVal, bool tagCheck);
+
     /**
      * Decode a null value from the encoded data
      * @param data Input block from which the null value should be extracted
@@ -884,6 +1243,14 @@ public:
      */
     static int decodeNull(DataBlock& data, bool tagCheck);
 
+    /**
+     * Decode a null value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x05) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeNull(AsnCursor& data, bool tagCheck);
+
     /**
      * Decode an object id value from the encoded data
      * @param data Input block from which the OID value should be extracted
@@ -893,6 +1260,15 @@ public:
      */
     static int decodeOID(DataBlock& data, ASNObjId* obj, bool tagCheck);
 
+    /**
+     * Decode an object id value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param obj ASNObjId to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x06) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeOID(AsnCursor& data, ASNObjId* obj, bool tagCheck);
+
     /**
      * Decode a real value from the encoded data - not implemented
      * @param data Input block from which the real value should be extracted
@@ -902,6 +1278,15 @@ public:
      */
     static int decodeReal(DataBlock& data, float* realVal, bool tagCheck);
 
+    /**
+     * Decode a real value from the encoded data - not implemented using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param realVal Float to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag for integer (0x09) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeReal(AsnCursor& data, float* realVal, bool tagCheck);
+
     /**
      * Decode other types of ASN.1 strings from the encoded data (NumericString, PrintableString, VisibleString, IA5String)
      * @param data Input block from which the string value should be extracted
@@ -912,6 +1297,16 @@ public:
      */
     static int decodeString(DataBlock& data, String* str, int* type, bool tagCheck);
 
+    /**
+     * Decode other types of ASN.1 strings from the encoded data (NumericString, PrintableString, VisibleString, IA5String) using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param str String to be filled with the decoded value
+     * @param type Integer to be filled with the value indicating which type of string has been decoded
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeString(AsnCursor& data, String* str, int* type, bool tagCheck);
+
     /**
      * Decode an UTF8 string from the encoded data
      * @param data Input block from which the string value should be extracted
@@ -921,6 +1316,15 @@ public:
      */
     static int decodeUtf8(DataBlock& data, String* str, bool tagCheck);
 
+    /**
+     * Decode an UTF8 string from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param str String to be filled with the decoded value
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag (0x0c) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeUtf8(AsnCursor& data, String* str, bool tagCheck);
+
     /**
      * Decode a GeneralizedTime value from the encoded data
      * @param data Input block from which the value should be extracted
@@ -932,6 +1336,17 @@ public:
      */
     static int decodeGenTime(DataBlock& data, unsigned int* time, unsigned int* fractions, bool* utc, bool tagCheck);
 
+    /**
+     * Decode a GeneralizedTime value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param time Integer to be filled with time in seconds since epoch
+     * @param fractions Integer to be filled with fractions of a second
+     * @param utc Flag indicating if the decode time value represent local time or UTC time
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag (0x18) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeGenTime(AsnCursor& data, unsigned int* time, unsigned int* fractions, bool* utc, bool tagCheck);
+
     /**
      * Decode a UTC time value from the encoded data
      * @param data Input block from which the value should be extracted
@@ -941,6 +1356,15 @@ public:
      */
     static int decodeUTCTime(DataBlock& data, unsigned int* time, bool tagCheck);
 
+    /**
+     * Decode a UTC time value from the encoded data using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param time Integer to be filled with time in seconds since epoch
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 tag (0x17) should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeUTCTime(AsnCursor& data, unsigned int* time, bool tagCheck);
+
     /**
      * Decode a block of arbitrary data
      * @param data Input block from which the value should be extracted
@@ -950,6 +1374,15 @@ public:
      */
     static int decodeAny(DataBlock data, DataBlock* val, bool tagCheck);
 
+    /**
+     * Decode a block of arbitrary data using a read cursor
+     * @param data Cursor over the input, it is not changed
+     * @param val DataBlock in which the data shoulb be copied
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 should be verified
+     * @return Length of data consumed from the input data it the decoding was successful, -1 if the integer value could not be decoded
+     */
+    static int decodeAny(const AsnCursor& data, DataBlock* val, bool tagCheck);
+
     /**
      * Decode the header of an ASN.1 sequence ( decodes the tag and the length of the sequence)
      * @param data Input block from which the header should be extracted
@@ -958,6 +1391,14 @@ public:
      */
     static int decodeSequence(DataBlock& data, bool tagCheck);
 
+    /**
+     * Decode the header of an ASN.1 sequence ( decodes the tag and the length of the sequence) using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 (0x30) should be verified
+     * @return Length of data consumed from the input data it the decoding was succesful, -1 if the integer value could not be decoded
+     */
+    static int decodeSequence(AsnCursor& data, bool tagCheck);
+
     /**
      * Decode the header of an ASN.1 set ( decodes the tag and the length of the sequence)
      * @param data Input block from which the header should be extracted
@@ -966,6 +1407,14 @@ public:
      */
     static int decodeSet(DataBlock& data, bool tagCheck);
 
+    /**
+     * Decode the header of an ASN.1 set ( decodes the tag and the length of the sequence) using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param tagCheck Flag for indicating if in the process of decoding the value the presence of the ASN.1 (0x31) should be verified
+     * @return Length of data consumed from the input data it the decoding was succesful, -1 if the integer value could not be decoded
+     */
+    static int decodeSet(AsnCursor& data, bool tagCheck);
+
     /**
      * Encode the length of the given data
      * @param data The data for which the length should be encoded
@@ -1093,6 +1542,13 @@ public:
      */
     static int matchEOC(DataBlock& data);
 
+    /**
+     * Verify the data for End Of Contents presence using a read cursor
+     * @param  data Input block to verify
+     * @return Length of data consumed from the input data it the decoding was succesful, it should be 2 in case of success, -1 if the data doesn't match EoC
+     */
+    static int matchEOC(AsnCursor& data);
+
     /**
      * Extract length until a End Of Contents is found. 
      * @param data Input block for which to determine the length to End Of Contents
@@ -1100,6 +1556,14 @@ public:
      * @return Length until End Of Contents
      */
     static int parseUntilEoC(DataBlock& data, int length = 0);
+
+    /**
+     * Extract length until a End Of Contents is found.  using a read cursor
+     * @param data Cursor over the input, advanced past the decoded data
+     * @param length Length to which to add determined length
+     * @return Length until End Of Contents
+     */
+    static int parseUntilEoC(AsnCursor& data, int length = 0);
 };
 
 }
@@ -80,6 +80,9 @@ static const String s_googleAndroidNode2 = "http://www.android.com/gtalk/client/
 // Stream read buffer
 #define JB_STREAMBUF                8192
 #define JB_STREAMBUF_MIN            1024
+// Stream parser arena block
+#define JB_XMLARENA                 4096
+#define JB_XMLARENA_MAX            65536
 // Stream restart counter
 #define JB_RESTART_COUNT               2
 #define JB_RESTART_COUNT_MIN           1
@@ -926,7 +929,7 @@ JBEngine::JBEngine(const char* name)
     m_pingInterval(JB_PING_INTERVAL), m_pingTimeout(JB_PING_TIMEOUT),
     m_idleTimeout(0), m_pptTimeoutC2s(0), m_pptTimeout(0),
     m_streamReadBuffer(JB_STREAMBUF), m_maxIncompleteXml(XMPP_MAX_INCOMPLETEXML),
-    m_redirectMax(JB_REDIRECT_COUNT),
+    m_xmlArena(JB_XMLARENA), m_redirectMax(JB_REDIRECT_COUNT),
     m_hasClientTls(true), m_printXml(0), m_initialized(false)
 {
     debugName(name);
@@ -961,6 +964,7 @@ void JBEngine::initialize(const NamedList& params)
 	JB_STREAMBUF,JB_STREAMBUF_MIN,(unsigned int)-1);
     m_maxIncompleteXml = fixValue(params,"stream_parsermaxbuffer",
 	XMPP_MAX_INCOMPLETEXML,1024,(unsigned int)-1);
+    m_xmlArena = params.getIntValue("stream_xmlarena",JB_XMLARENA,0,JB_XMLARENA_MAX);
     m_restartMax = fixValue(params,"stream_restartcount",
 	JB_RESTART_COUNT,JB_RESTART_COUNT_MIN,JB_RESTART_COUNT_MAX);
     m_restartUpdInterval = fixValue(params,"stream_restartupdateinterval",
@@ -1230,6 +1230,7 @@ void JBStream::resetConnection(Socket* sock)
 	}
 	m_xmlDom = new XmlDomParser(debugName());
 	m_xmlDom->debugChain(this);
+	m_xmlDom->setArena(m_engine->m_xmlArena);
 	m_socket = sock;
 	if (debugAt(DebugAll)) {
 	    SocketAddr l, r;
@@ -2247,6 +2247,7 @@ protected:
     unsigned int m_pptTimeout;           // Non client streams postpone stream termination intervals
     unsigned int m_streamReadBuffer;     // Stream read buffer length
     unsigned int m_maxIncompleteXml;     // Maximum length of an incomplete xml
+    unsigned int m_xmlArena;             // Block size of the stream parsers arena, 0 to use the heap
     unsigned int m_redirectMax;          // Max redirect counter for outgoing streams
     bool m_hasClientTls;                 // True if TLS is available for outgoing streams
     int m_printXml;                      // Print XML data to output
@@ -0,0 +1,333 @@
+/**
+ * reactor.cpp
+ * Yet Another RTP Stack
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2004-2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <yatertp.h>
+
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#include <errno.h>
+#include <fcntl.h>
+#endif
+
+// maximum number of socket events handled in one run
+#define MAX_EVENTS 64
+
+// number and size of the buffers used to receive packets in batches
+#define RECV_BATCH 16
+#define BUF_SIZE 1500
+
+// tag set in the event data of RTCP sockets, entries are at least 2 aligned
+#define RTCP_TAG 1
+
+using namespace TelEngine;
+
+namespace TelEngine {
+
+// A processor that joined a reactor, its place in the timer wheel
+class ReactorEntry : public GenObject
+{
+public:
+    inline ReactorEntry(RTPProcessor* proc)
+	: m_proc(proc), m_trans(YOBJECT(RTPTransport,proc)),
+	  m_rtp(Socket::invalidHandle()), m_rtcp(Socket::invalidHandle()),
+	  m_dead(false)
+	{ }
+    RTPProcessor* m_proc;
+    RTPTransport* m_trans;
+    SOCKET m_rtp;
+    SOCKET m_rtcp;
+    bool m_dead;
+};
+
+}; // namespace TelEngine
+
+static ObjList s_pool;
+static Mutex s_poolMutex(false,"RTPReactors");
+
+
+RTPReactor::RTPReactor(int msec, Priority prio)
+    : RTPGroup(msec,prio),
+      m_epoll(-1), m_load(0), m_slots(RTPGroup::msec()), m_index(0), m_wheel(0), m_batch(0)
+{
+    DDebug(DebugInfo,"RTPReactor::RTPReactor(%d) [%p]",msec,this);
+    m_wheel = new ObjList[m_slots];
+    m_batch = new SocketBatch(RECV_BATCH,BUF_SIZE);
+#ifdef HAVE_EPOLL
+    m_epoll = ::epoll_create(256);
+    if (m_epoll >= 0)
+	::fcntl(m_epoll,F_SETFD,FD_CLOEXEC);
+    else
+	Debug(DebugWarn,"RTPReactor failed to create epoll: %d [%p]",errno,this);
+#endif
+}
+
+RTPReactor::~RTPReactor()
+{
+    DDebug(DebugInfo,"RTPReactor::~RTPReactor() [%p]",this);
+    delete[] m_wheel;
+    delete m_batch;
+#ifdef HAVE_EPOLL
+    if (m_epoll >= 0)
+	::close(m_epoll);
+#endif
+}
+
+void RTPReactor::cleanup()
+{
+    DDebug(DebugInfo,"RTPReactor::cleanup() load=%u [%p]",m_load,this);
+    s_poolMutex.lock();
+    s_pool.remove(this,false);
+    s_poolMutex.unlock();
+    lock();
+    // parting only marks the entries as dead, the wheel is not changed
+    for (unsigned int i = 0; i < m_slots; i++) {
+	for (ObjList* l = m_wheel[i].skipNull(); l; l = l->skipNext()) {
+	    ReactorEntry* e = static_cast<ReactorEntry*>(l->get());
+	    if (!e->m_dead)
+		e->m_proc->group(0);
+	}
+	m_wheel[i].clear();
+    }
+    unlock();
+}
+
+void RTPReactor::run()
+{
+    DDebug(DebugInfo,"RTPReactor::run() slots=%u [%p]",m_slots,this);
+#ifdef HAVE_EPOLL
+    struct epoll_event events[MAX_EVENTS];
+    unsigned int slot = 0;
+    u_int64_t next = Time::now();
+    while (!Thread::check(false)) {
+	u_int64_t now = Time::now();
+	int timeout = (next > now) ? (int)((next - now + 999) / 1000) : 0;
+	// an idle reactor only needs to wake up to check for cancellation
+	if (!m_load)
+	    timeout = Thread::idleMsec();
+	int n = ::epoll_wait(m_epoll,events,MAX_EVENTS,timeout);
+	if (n < 0) {
+	    if (errno != EINTR) {
+		Debug(DebugWarn,"RTPReactor epoll wait failed: %d [%p]",errno,this);
+		Thread::msleep(1);
+	    }
+	    n = 0;
+	}
+	lock();
+	for (int i = 0; i < n; i++) {
+	    ReactorEntry* e = (ReactorEntry*)(unsigned long)(events[i].data.u64 & ~(u_int64_t)RTCP_TAG);
+	    // entries are deleted only by the timer wheel so this one is safe
+	    if (e->m_dead)
+		continue;
+	    if (events[i].data.u64 & RTCP_TAG)
+		e->m_trans->readRTCP();
+	    else
+		e->m_trans->readRTP(m_batch);
+	}
+	Time t;
+	// run the slots that are due, if late by a whole turn skip ahead
+	for (unsigned int i = 0; (next <= t.usec()) && (i < m_slots); i++) {
+	    tick(slot,t);
+	    if (++slot >= m_slots)
+		slot = 0;
+	    next += 1000;
+	}
+	if (next <= t.usec())
+	    next = t.usec() + 1000;
+	flush();
+	unlock();
+    }
+#endif
+    DDebug(DebugInfo,"RTPReactor::run() terminated [%p]",this);
+}
+
+void RTPReactor::join(RTPProcessor* proc)
+{
+    DDebug(DebugAll,"RTPReactor::join(%p) [%p]",proc,this);
+    lock();
+    ReactorEntry* e = new ReactorEntry(proc);
+    m_wheel[m_index].append(e);
+    if (++m_index >= m_slots)
+	m_index = 0;
+    m_load++;
+    if (e->m_trans)
+	watch(e);
+    unlock();
+}
+
+void RTPReactor::part(RTPProcessor* proc)
+{
+    DDebug(DebugAll,"RTPReactor::part(%p) [%p]",proc,this);
+    lock();
+    for (unsigned int i = 0; i < m_slots; i++) {
+	for (ObjList* l = m_wheel[i].skipNull(); l; l = l->skipNext()) {
+	    ReactorEntry* e = static_cast<ReactorEntry*>(l->get());
+	    if (e->m_dead || (e->m_proc != proc))
+		continue;
+	    // the entry may still be in use up the stack, let the wheel delete it
+	    e->m_dead = true;
+	    if (e->m_trans) {
+		if (m_pending.remove(e->m_trans,false))
+		    e->m_trans->flushRTP();
+		unwatch(e);
+		e->m_trans->m_watched = false;
+	    }
+	    m_load--;
+	    unlock();
+	    return;
+	}
+    }
+    unlock();
+}
+
+// Run the timers of the processors in a slot, delete the dead ones
+void RTPReactor::tick(unsigned int slot, const Time& when)
+{
+    ObjList* l = m_wheel + slot;
+    while (l) {
+	ReactorEntry* e = static_cast<ReactorEntry*>(l->get());
+	if (!e) {
+	    l = l->next();
+	    continue;
+	}
+	if (e->m_dead) {
+	    l->remove();
+	    continue;
+	}
+	// sockets may be created or swapped after joining
+	if (e->m_trans)
+	    watch(e);
+	e->m_proc->timerTick(when);
+	l = l->next();
+    }
+}
+
+// Remember a transport that queued packets for sending
+void RTPReactor::pending(RTPTransport* trans)
+{
+    m_pending.append(trans)->setDelete(false);
+}
+
+// Send the packets queued by transports during this run
+void RTPReactor::flush()
+{
+    while (RTPTransport* trans = static_cast<RTPTransport*>(m_pending.remove(false)))
+	trans->flushRTP();
+}
+
+// Register the current sockets of a transport with epoll
+void RTPReactor::watch(ReactorEntry* entry)
+{
+#ifdef HAVE_EPOLL
+    SOCKET rtp = entry->m_trans->m_rtpSock.handle();
+    SOCKET rtcp = entry->m_trans->m_rtcpSock.handle();
+    if ((rtp == entry->m_rtp) && (rtcp == entry->m_rtcp))
+	return;
+    unwatch(entry);
+    bool ok = true;
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    if (rtp != Socket::invalidHandle()) {
+	ev.data.u64 = (unsigned long)entry;
+	if (::epoll_ctl(m_epoll,EPOLL_CTL_ADD,rtp,&ev))
+	    ok = false;
+    }
+    if (rtcp != Socket::invalidHandle()) {
+	ev.data.u64 = (unsigned long)entry | RTCP_TAG;
+	if (::epoll_ctl(m_epoll,EPOLL_CTL_ADD,rtcp,&ev))
+	    ok = false;
+    }
+    if (!ok)
+	Debug(DebugMild,"RTPReactor failed to watch sockets of %p: %d [%p]",
+	    entry->m_trans,errno,this);
+    entry->m_rtp = rtp;
+    entry->m_rtcp = rtcp;
+    // if anything failed leave the transport polling its sockets
+    entry->m_trans->m_watched = ok && (rtp != Socket::invalidHandle());
+#endif
+}
+
+// Unregister the sockets of a transport from epoll
+void RTPReactor::unwatch(ReactorEntry* entry)
+{
+#ifdef HAVE_EPOLL
+    // closed sockets are removed automatically and their handle may be
+    //  reused by another transport so only remove the ones we still own
+    SOCKET rtp = entry->m_trans->m_rtpSock.handle();
+    SOCKET rtcp = entry->m_trans->m_rtcpSock.handle();
+    struct epoll_event ev;
+    if ((entry->m_rtp != Socket::invalidHandle()) &&
+	((entry->m_rtp == rtp) || (entry->m_rtp == rtcp)))
+	::epoll_ctl(m_epoll,EPOLL_CTL_DEL,entry->m_rtp,&ev);
+    if ((entry->m_rtcp != Socket::invalidHandle()) &&
+	((entry->m_rtcp == rtp) || (entry->m_rtcp == rtcp)))
+	::epoll_ctl(m_epoll,EPOLL_CTL_DEL,entry->m_rtcp,&ev);
+#endif
+    entry->m_rtp = Socket::invalidHandle();
+    entry->m_rtcp = Socket::invalidHandle();
+}
+
+bool RTPReactor::supported()
+{
+#ifdef HAVE_EPOLL
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool RTPReactor::start(unsigned int count, int msec, Priority prio)
+{
+    if (!supported())
+	return false;
+    Lock lock(s_poolMutex);
+    while (s_pool.count() < count) {
+	RTPReactor* r = new RTPReactor(msec,prio);
+	if (r->m_epoll < 0 || !r->startup()) {
+	    Debug(DebugWarn,"Failed to start RTP reactor");
+	    delete r;
+	    break;
+	}
+	s_pool.append(r)->setDelete(false);
+    }
+    return s_pool.skipNull() != 0;
+}
+
+RTPReactor* RTPReactor::pick()
+{
+    Lock lock(s_poolMutex);
+    RTPReactor* best = 0;
+    for (ObjList* l = s_pool.skipNull(); l; l = l->skipNext()) {
+	RTPReactor* r = static_cast<RTPReactor*>(l->get());
+	if (!best || (r->load() < best->load()))
+	    best = r;
+    }
+    return best;
+}
+
+unsigned int RTPReactor::pool()
+{
+    Lock lock(s_poolMutex);
+    return s_pool.count();
+}
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -631,6 +631,21 @@ bool UDPSession::initGroup(int msec, Thread::Priority prio)
     return true;
 }
 
+bool UDPSession::initGroup(RTPGroup* group)
+{
+    if (m_group)
+	return true;
+    if (m_transport)
+	this->group(m_transport->group());
+    if (!m_group)
+	this->group(group);
+    if (!m_group)
+	return false;
+    if (m_transport)
+	m_transport->group(m_group);
+    return true;
+}
+
 bool UDPSession::initTransport()
 {
     if (m_transport)
@@ -25,6 +25,9 @@
 
 #define BUF_SIZE 1500
 
+// maximum number of RTP packets queued for a batched send
+#define SEND_BATCH 8
+
 using namespace TelEngine;
 
 static unsigned long s_sleep = 5;
@@ -164,7 +167,7 @@ void RTPProcessor::getStats(String& stats) const
 
 RTPTransport::RTPTransport(RTPTransport::Type type)
     : RTPProcessor(),
-      m_type(type), m_processor(0), m_monitor(0), m_autoRemote(false)
+      m_type(type), m_watched(false), m_sendBatch(0), m_processor(0), m_monitor(0), m_autoRemote(false)
 {
     DDebug(DebugAll,"RTPTransport::RTPTransport(%d) [%p]",type,this);
 }
@@ -178,6 +181,7 @@ RTPTransport::~RTPTransport()
     group(0);
     setProcessor();
     setMonitor();
+    delete m_sendBatch;
 }
 
 void RTPTransport::destruct()
@@ -191,67 +195,104 @@ void RTPTransport::destruct()
 void RTPTransport::timerTick(const Time& when)
 {
     XDebug(DebugAll,"RTPTransport::timerTick() group=%p [%p]",group(),this);
+    // a reactor reads the sockets as soon as they become readable
     if (m_rtpSock.valid()) {
-	char buf[BUF_SIZE];
-	int len;
-	while ((len = m_rtpSock.recvFrom(buf,sizeof(buf),m_rxAddrRTP)) > 0) {
-	    XDebug(DebugAll,"RTP/UDPTL from '%s:%d' length %d [%p]",
-		m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port(),len,this);
-	    switch (m_type) {
-		case RTP:
-		    if (len < 12)
-			continue;
-		    if (((unsigned char)buf[0] & 0xc0) != 0x80)
-			continue;
-		    break;
-		case UDPTL:
-		    if (len < 6)
-			continue;
-		    break;
-		default:
-		    break;
-	    }
-	    if (!m_remoteAddr.valid())
-		continue;
-	    // looks like it's RTP or UDPTL, at least by length and version
-	    bool preferred = false;
-	    if ((m_autoRemote || (preferred = (m_rxAddrRTP == m_remotePref))) && (m_rxAddrRTP != m_remoteAddr)) {
-		Debug(DebugInfo,"Auto changing RTP address from %s:%d to%s %s:%d",
-		    m_remoteAddr.host().c_str(),m_remoteAddr.port(),
-		    (preferred ? " preferred" : ""),
-		    m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port());
-		// if we received from the preferred address don't auto change any more
-		if (preferred)
-		    m_remotePref.clear();
-		remoteAddr(m_rxAddrRTP);
-	    }
-	    m_autoRemote = false;
-	    if (m_rxAddrRTP == m_remoteAddr) {
-		if (m_processor)
-		    m_processor->rtpData(buf,len);
-		if (m_monitor)
-		    m_monitor->rtpData(buf,len);
-	    }
-	    else if (m_processor)
-		m_processor->incWrongSrc();
-	}
+	if (!m_watched)
+	    readRTP();
 	m_rtpSock.timerTick(when);
     }
     if (m_rtcpSock.valid()) {
-	char buf[BUF_SIZE];
-	int len;
-	while (((len = m_rtcpSock.recvFrom(buf,sizeof(buf),m_rxAddrRTCP)) >= 8) && (m_rxAddrRTCP == m_remoteRTCP)) {
-	    XDebug(DebugAll,"RTCP from '%s:%d' length %d [%p]",
-		m_rxAddrRTCP.host().c_str(),m_rxAddrRTCP.port(),len,this);
-	    if (m_processor)
-		m_processor->rtcpData(buf,len);
-	    if (m_monitor)
-		m_monitor->rtcpData(buf,len);
-	}
+	if (!m_watched)
+	    readRTCP();
 	m_rtcpSock.timerTick(when);
     }
 }
 
+void RTPTransport::readRTP(SocketBatch* batch)
+{
+    if (batch) {
+	int n;
+	while ((n = m_rtpSock.recvBatch(*batch)) > 0) {
+	    for (int i = 0; i < n; i++) {
+		socklen_t alen = 0;
+		const struct sockaddr* addr = batch->address(i,&alen);
+		m_rxAddrRTP.assign(addr,alen);
+		rxRTP(batch->data(i),batch->length(i));
+	    }
+	    // a short batch means the socket was drained
+	    if ((unsigned int)n < batch->capacity())
+		break;
+	}
+	return;
+    }
+    char buf[BUF_SIZE];
+    int len;
+    while ((len = m_rtpSock.recvFrom(buf,sizeof(buf),m_rxAddrRTP)) > 0)
+	rxRTP(buf,len);
+}
+
+// Process one received RTP or UDPTL packet, source is in m_rxAddrRTP
+void RTPTransport::rxRTP(const void* data, int len)
+{
+    const unsigned char* buf = (const unsigned char*)data;
+    XDebug(DebugAll,"RTP/UDPTL from '%s:%d' length %d [%p]",
+	m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port(),len,this);
+    switch (m_type) {
+	case RTP:
+	    if (len < 12)
+		return;
+	    if ((buf[0] & 0xc0) != 0x80)
+		return;
+	    break;
+	case UDPTL:
+	    if (len < 6)
+		return;
+	    break;
+	default:
+	    break;
+    }
+    if (!m_remoteAddr.valid())
+	return;
+    // looks like it's RTP or UDPTL, at least by length and version
+    bool preferred = false;
+    if ((m_autoRemote || (preferred = (m_rxAddrRTP == m_remotePref))) && (m_rxAddrRTP != m_remoteAddr)) {
+	Debug(DebugInfo,"Auto changing RTP address from %s:%d to%s %s:%d",
+	    m_remoteAddr.host().c_str(),m_remoteAddr.port(),
+	    (preferred ? " preferred" : ""),
+	    m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port());
+	// if we received from the preferred address don't auto change any more
+	if (preferred)
+	    m_remotePref.clear();
+	remoteAddr(m_rxAddrRTP);
+    }
+    m_autoRemote = false;
+    if (m_rxAddrRTP == m_remoteAddr) {
+	if (m_processor)
+	    m_processor->rtpData(buf,len);
+	if (m_monitor)
+	    m_monitor->rtpData(buf,len);
+    }
+    else if (m_processor)
+	m_processor->incWrongSrc();
+}
+
+void RTPTransport::readRTCP()
+{
+    char buf[BUF_SIZE];
+    int len;
+    // drain the socket, packets that are too short or from a wrong source are dropped
+    while ((len = m_rtcpSock.recvFrom(buf,sizeof(buf),m_rxAddrRTCP)) > 0) {
+	if ((len < 8) || (m_rxAddrRTCP != m_remoteRTCP))
+	    continue;
+	XDebug(DebugAll,"RTCP from '%s:%d' length %d [%p]",
+	    m_rxAddrRTCP.host().c_str(),m_rxAddrRTCP.port(),len,this);
+	if (m_processor)
+	    m_processor->rtcpData(buf,len);
+	if (m_monitor)
+	    m_monitor->rtcpData(buf,len);
+    }
+}
+
 void RTPTransport::rtpData(const void* data, int len)
 {
     if (!data)
@@ -268,8 +309,36 @@ void RTPTransport::rtpData(const void* data, int len)
 	default:
 	    break;
     }
-    if (m_rtpSock.valid() && m_remoteAddr.valid())
+    if (m_rtpSock.valid() && m_remoteAddr.valid()) {
+	if (m_watched && queueRTP(data,len))
+	    return;
 	m_rtpSock.sendTo(data,len,m_remoteAddr);
+    }
+}
+
+// Queue a packet sent from the reactor's thread, it will be flushed
+//  together with any others at the end of the current run
+bool RTPTransport::queueRTP(const void* data, int len)
+{
+    RTPGroup* g = group();
+    if (!g || (Thread::current() != g))
+	return false;
+    if (!m_sendBatch)
+	m_sendBatch = new SocketBatch(SEND_BATCH,BUF_SIZE);
+    else if (m_sendBatch->full())
+	flushRTP();
+    bool first = !m_sendBatch->count();
+    if (!m_sendBatch->add(data,len,m_remoteAddr))
+	return false;
+    if (first)
+	static_cast<RTPReactor*>(g)->pending(this);
+    return true;
+}
+
+void RTPTransport::flushRTP()
+{
+    if (m_sendBatch && m_sendBatch->count())
+	m_rtpSock.sendBatch(*m_sendBatch);
 }
 
 void RTPTransport::rtcpData(const void* data, int len)
@@ -61,6 +61,7 @@ class RTPSecure;
 class YRTP_API RTPProcessor : public GenObject
 {
     friend class UDPSession;
+    friend class RTPReactor;
     friend class UDPTLSession;
     friend class RTPGroup;
     friend class RTPTransport;
@@ -179,13 +180,21 @@ public:
      * Add a RTP processor to this group
      * @param proc Pointer to the RTP processor to add
      */
-    void join(RTPProcessor* proc);
+    virtual void join(RTPProcessor* proc);
 
     /**
      * Remove a RTP processor from this group
      * @param proc Pointer to the RTP processor to remove
      */
-    void part(RTPProcessor* proc);
+    virtual void part(RTPProcessor* proc);
+
+protected:
+    /**
+     * Get the time to sleep between two processor runs
+     * @return Sleep interval in milliseconds
+     */
+    inline unsigned long msec() const
+	{ return m_sleep; }
 
 private:
     ObjList m_processors;
@@ -193,12 +202,113 @@ private:
     unsigned long m_sleep;
 };
 
+class ReactorEntry;
+
+/**
+ * A reactor is a long lived RTP group shared by many sessions. Instead of
+ *  polling each transport it waits for the sockets of the transports to
+ *  become readable and runs the processors' timers from a timer wheel
+ *  with one millisecond slots.
+ * Packets are received in batches and RTP packets sent from the reactor's
+ *  own thread are queued and sent in batches at the end of each run.
+ * Reactors are kept in a pool, new sessions should join the least loaded.
+ * @short A shared event driven RTP group
+ */
+class YRTP_API RTPReactor : public RTPGroup
+{
+    friend class RTPTransport;
+public:
+    /**
+     * Constructor
+     * @param msec Interval between two timer ticks of each processor in milliseconds
+     * @param prio Thread priority to run this reactor
+     */
+    RTPReactor(int msec = 0, Priority prio = Normal);
+
+    /**
+     * Destructor
+     */
+    virtual ~RTPReactor();
+
+    /**
+     * Group's cleanup function, removes the reactor from the pool
+     */
+    virtual void cleanup();
+
+    /**
+     * Reactor's main event and timer loop
+     */
+    virtual void run();
+
+    /**
+     * Add a RTP processor to this reactor, watch the sockets of transports
+     * @param proc Pointer to the RTP processor to add
+     */
+    virtual void join(RTPProcessor* proc);
+
+    /**
+     * Remove a RTP processor from this reactor
+     * @param proc Pointer to the RTP processor to remove
+     */
+    virtual void part(RTPProcessor* proc);
+
+    /**
+     * Get the number of processors handled by this reactor
+     * @return Count of RTP processors that joined the reactor
+     */
+    inline unsigned int load() const
+	{ return m_load; }
+
+    /**
+     * Check if reactors are supported on this platform
+     * @return True if reactors can be started
+     */
+    static bool supported();
+
+    /**
+     * Start reactors until the pool holds the requested number of them
+     * @param count Number of reactors the pool should hold
+     * @param msec Interval between two timer ticks of each processor in milliseconds
+     * @param prio Thread priority to run the new reactors
+     * @return True if the pool holds at least one reactor
+     */
+    static bool start(unsigned int count, int msec = 0, Priority prio = Normal);
+
+    /**
+     * Pick the least loaded reactor from the pool
+     * @return Pointer to a running reactor, NULL if the pool is empty
+     */
+    static RTPReactor* pick();
+
+    /**
+     * Get the number of reactors in the pool
+     * @return Count of running reactors
+     */
+    static unsigned int pool();
+
+private:
+    void watch(ReactorEntry* entry);
+    void tick(unsigned int slot, const Time& when);
+    void unwatch(ReactorEntry* entry);
+    void pending(RTPTransport* trans);
+    void flush();
+    int m_epoll;
+    unsigned int m_load;
+    unsigned int m_slots;
+    unsigned int m_index;
+    ObjList* m_wheel;
+    SocketBatch* m_batch;
+    ObjList m_pending;
+};
+
 /**
  * Class that holds sockets and addresses for transporting RTP and RTCP packets.
  * @short Low level transport for RTP and RTCP
  */
 class YRTP_API RTPTransport : public RTPProcessor
 {
+    friend class RTPReactor;
+    YCLASS(RTPTransport,RTPProcessor)
 public:
     /**
      * Activation status of the transport
@@ -332,8 +442,24 @@ protected:
      */
     virtual void rtcpData(const void* data, int len);
 
+    /**
+     * Read and process all the packets waiting in the RTP socket
+     * @param batch Optional batch of buffers to receive many packets per system call
+     */
+    void readRTP(SocketBatch* batch = 0);
+
+    /**
+     * Read and process all the packets waiting in the RTCP socket
+     */
+    void readRTCP();
+
 private:
+    void rxRTP(const void* data, int len);
+    bool queueRTP(const void* data, int len);
+    void flushRTP();
     Type m_type;
+    bool m_watched;
+    SocketBatch* m_sendBatch;
     RTPProcessor* m_processor;
     RTPProcessor* m_monitor;
     Socket m_rtpSock;
@@ -902,6 +1028,13 @@ public:
      */
     bool initGroup(int msec = 0, Thread::Priority prio = Thread::Normal);
 
+    /**
+     * Initialize the RTP session, join an existing group if none is present
+     * @param group Pointer to the group to join, usually a shared reactor
+     * @return True if initialized, false on some failure
+     */
+    bool initGroup(RTPGroup* group);
+
     /**
      * Set the remote network address of the RTP transport of this session
      * @param addr New remote RTP transport address
@@ -37,6 +37,10 @@ using namespace TelEngine;
 // Maximum number of mandatory parameters including two terminators
 #define MAX_MANDATORY_PARAMS 16
 
+// Calls on circuit codes below this are found in a direct indexed table
+// Larger codes (BICC) are searched in the call list
+#define ISUP_MAX_CIC_INDEX 0x10000
+
 // Timer limits and default values
 #define ISUP_T7_MINVAL  20000
 #define ISUP_T7_DEFVAL  20000
@@ -2269,6 +2273,8 @@ SS7ISUPCall::SS7ISUPCall(SS7ISUP* controller, SignallingCircuit* cic,
 
 SS7ISUPCall::~SS7ISUPCall()
 {
+    if (isup())
+	isup()->unindexCall(this,id());
     TelEngine::destruct(m_iamMsg);
     TelEngine::destruct(m_sgmMsg);
     const char* timeout = 0;
@@ -3298,6 +3304,7 @@ SS7ISUP::SS7ISUP(const NamedList& params, unsigned char sio)
       m_inn(false),
       m_defaultSls(SlsLatest),
       m_maxCalledDigits(16),
+      m_callIndex(false),
       m_confirmCCR(true),
       m_dropOnUnknown(true),
       m_ignoreGRSSingle(false),
@@ -3709,6 +3716,7 @@ SignallingCall* SS7ISUP::call(SignallingMessage* msg, String& reason)
 	call = new SS7ISUPCall(this,cic,*m_defPoint,dest,true,sls,range);
 	call->ref();
 	m_calls.append(call);
+	indexCall(call);
 	SignallingEvent* event = new SignallingEvent(SignallingEvent::NewCall,msg,call);
 	// (re)start RSC timer if not currently reseting
 	if (!m_rscCic && m_rscTimer.interval())
@@ -3800,6 +3808,9 @@ void SS7ISUP::cleanup(const char* reason)
     m_rscTimer.stop();
     unlock();
     clearCalls();
+    lock();
+    m_callIndex.clear();
+    unlock();
 }
 
 // Remove all links with other layers. Disposes the memory
@@ -3807,6 +3818,7 @@ void SS7ISUP::destroyed()
 {
     lock();
     clearCalls();
+    m_callIndex.clear();
     unlock();
     SignallingCallControl::attach(0);
     SS7Layer4::destroyed();
@@ -5027,7 +5039,7 @@ void SS7ISUP::processCallMsg(SS7MsgISUP* msg, const SS7Label& label, int sls)
 		DROP_MSG("collision - we control the CIC")
 	    // Accept the incoming request. Change the call's circuit
 	    reserveCircuit(circuit,call->cicRange(),SignallingCircuit::LockLockedBusy);
-	    call->replaceCircuit(circuit);
+	    replaceCallCircuit(call,circuit);
 	    circuit = 0;
 	    call = 0;
 	}
@@ -5054,6 +5066,7 @@ void SS7ISUP::processCallMsg(SS7MsgISUP* msg, const SS7Label& label, int sls)
 	    call = new SS7ISUPCall(this,circuit,label.dpc(),label.opc(),false,label.sls(),
 		0,msg->type() == SS7MsgISUP::CCR);
 	    m_calls.append(call);
+	    indexCall(call);
 	    break;
 	}
 	// Congestion: send REL
@@ -5507,7 +5520,7 @@ bool SS7ISUP::resetCircuit(unsigned int cic, bool remote, bool checkCall)
 	    if (call->outgoing() && call->state() == SS7ISUPCall::Setup) {
 	        SignallingCircuit* newCircuit = 0;
 		reserveCircuit(newCircuit,call->cicRange(),SignallingCircuit::LockLockedBusy);
-		call->replaceCircuit(newCircuit);
+		replaceCallCircuit(call,newCircuit);
 	    }
 	    else
 		call->setTerminate(false,"normal");
@@ -5567,6 +5580,11 @@ bool SS7ISUP::blockCircuit(unsigned int cic, bool block, bool remote, bool hwFai
 
 SS7ISUPCall* SS7ISUP::findCall(unsigned int cic)
 {
+    if (cic < ISUP_MAX_CIC_INDEX) {
+	// A circuit is reserved by a single call so the index holds all of them
+	SS7ISUPCall* call = static_cast<SS7ISUPCall*>(m_callIndex.at(cic));
+	return (call && call->id() == cic) ? call : 0;
+    }
     for (ObjList* o = m_calls.skipNull(); o; o = o->skipNext()) {
 	SS7ISUPCall* call = static_cast<SS7ISUPCall*>(o->get());
 	if (call->id() == cic)
@@ -5575,6 +5593,52 @@ SS7ISUPCall* SS7ISUP::findCall(unsigned int cic)
     return 0;
 }
 
+// Add a call to the circuit code index
+// Rebuild the index from the call list when the code doesn't fit in it
+void SS7ISUP::indexCall(SS7ISUPCall* call)
+{
+    unsigned int cic = call->id();
+    if (cic >= ISUP_MAX_CIC_INDEX)
+	return;
+    Lock mylock(this);
+    if (cic >= m_callIndex.length()) {
+	unsigned int len = m_callIndex.length() ? m_callIndex.length() : 64;
+	while (len <= cic)
+	    len *= 2;
+	ObjList empty;
+	m_callIndex.assign(empty,false,len);
+	for (ObjList* o = m_calls.skipNull(); o; o = o->skipNext()) {
+	    SS7ISUPCall* c = static_cast<SS7ISUPCall*>(o->get());
+	    // Skip calls being destroyed, they already left the index
+	    if (c != call && c->alive() && !m_callIndex.at(c->id()))
+		m_callIndex.set(c,c->id());
+	}
+    }
+    // Don't hide a call still using the circuit
+    SS7ISUPCall* old = static_cast<SS7ISUPCall*>(m_callIndex.at(cic));
+    if (!old || old->id() != cic)
+	m_callIndex.set(call,cic);
+}
+
+// Remove a call from the index if it's still set for the given code
+void SS7ISUP::unindexCall(SS7ISUPCall* call, unsigned int cic)
+{
+    Lock mylock(this);
+    if (m_callIndex.at(cic) == call)
+	m_callIndex.set(0,cic);
+}
+
+// Replace the circuit of a call, it may change its code or release it
+bool SS7ISUP::replaceCallCircuit(SS7ISUPCall* call, SignallingCircuit* circuit, SS7MsgISUP* msg)
+{
+    unsigned int cic = call->id();
+    bool ok = call->replaceCircuit(circuit,msg);
+    Lock mylock(this);
+    unindexCall(call,cic);
+    indexCall(call);
+    return ok;
+}
+
 // Utility used in sendLocalLock()
 // Check if a circuit has lock change flag set and can be locked (not busy)
 static inline bool canLock(SignallingCircuit* cic, bool hw)
@@ -6179,7 +6243,7 @@ void SS7ISUP::replaceCircuit(unsigned int cic, const String& map, bool rel)
 	    m->ref();
 	}
 	unlock();
-	call->replaceCircuit(newCircuit,m);
+	replaceCallCircuit(call,newCircuit,m);
 	if (m) {
 	    SignallingMessageTimer* t = 0;
 	    if (rel)
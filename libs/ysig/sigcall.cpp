@@ -30,6 +30,9 @@
 
 using namespace TelEngine;
 
+// Circuits with codes below this are found in a direct indexed table
+#define CIC_MAX_INDEX 0x10000
+
 const TokenDict SignallingCircuit::s_lockNames[] = {
     {"localhw",            LockLocalHWFail},
     {"localmaint",         LockLocalMaint},
@@ -743,6 +746,7 @@ const TokenDict SignallingCircuitGroup::s_strategy[] = {
 SignallingCircuitGroup::SignallingCircuitGroup(unsigned int base, int strategy, const char* name)
     : SignallingComponent(name),
       Mutex(true,"SignallingCircuitGroup"),
+      m_index(false),
       m_range(String::empty(),name,strategy),
       m_base(base)
 {
@@ -769,6 +773,8 @@ SignallingCircuit* SignallingCircuitGroup::find(unsigned int cic, bool local)
     Lock mylock(this);
     if (cic >= m_range.m_last)
 	return 0;
+    if (cic < CIC_MAX_INDEX)
+	return static_cast<SignallingCircuit*>(m_index.at(cic));
     ObjList* l = m_circuits.skipNull();
     for (; l; l = l->skipNext()) {
 	SignallingCircuit* c = static_cast<SignallingCircuit*>(l->get());
@@ -807,6 +813,7 @@ bool SignallingCircuitGroup::insert(SignallingCircuit* circuit)
     circuit->m_group = this;
     m_circuits.append(circuit);
     m_range.add(circuit->code());
+    indexCircuit(circuit,true);
     return true;
 }
 
@@ -820,9 +827,37 @@ void SignallingCircuitGroup::remove(SignallingCircuit* circuit)
 	return;
     circuit->m_group = 0;
     m_range.remove(circuit->code());
+    indexCircuit(circuit,false);
     // TODO: remove from all ranges
 }
 
+// Add or remove a circuit in the code index
+// Rebuild the index from the circuit list when the code doesn't fit in it
+void SignallingCircuitGroup::indexCircuit(SignallingCircuit* circuit, bool add)
+{
+    unsigned int code = circuit->code();
+    if (code >= CIC_MAX_INDEX)
+	return;
+    if (!add) {
+	if (m_index.at(code) == circuit)
+	    m_index.set(0,code);
+	return;
+    }
+    if (code >= m_index.length()) {
+	unsigned int len = m_index.length() ? m_index.length() : 64;
+	while (len <= code)
+	    len *= 2;
+	ObjList empty;
+	m_index.assign(empty,false,len);
+	for (ObjList* l = m_circuits.skipNull(); l; l = l->skipNext()) {
+	    SignallingCircuit* c = static_cast<SignallingCircuit*>(l->get());
+	    if (c->code() < len)
+		m_index.set(c,c->code());
+	}
+    }
+    m_index.set(circuit,code);
+}
+
 // Append a span to the list if not already there
 bool SignallingCircuitGroup::insertSpan(SignallingCircuitSpan* span)
 {
@@ -1114,6 +1149,7 @@ void SignallingCircuitGroup::clearAll()
 	c->m_group = 0;
     }
     m_circuits.clear();
+    m_index.clear();
     m_ranges.clear();
 }
 
@@ -910,7 +910,9 @@ void SS7TCAP::buildSCCPData(NamedList& params, SS7TCAPTransaction* tr)
     }
 
     if (sendOk) {
+	// message is encoded back to front, room for a full UDT avoids reallocating
 	DataBlock data;
+	data.reserve(0,256);
 	tr->requestContent(params,data);
 	tr->addSCCPAddressing(params,false);
 	encodeTransactionPart(params,data);
@@ -1979,15 +1981,11 @@ void SS7TCAPANSI::encodeTransactionPart(NamedList& params, DataBlock& data)
 	    break;
     };
 
-    DataBlock db;
-    db.unHexify(ids.c_str(),ids.length(),' ');
-    db.insert(ASNLib::buildLength(db));
-    int tag = TransactionIDTag;
-    db.insert(DataBlock(&tag,1));
-
-    data.insert(db);
-    data.insert(ASNLib::buildLength(data));
-    data.insert(DataBlock(&msgType,1));
+    AsnWriter writer(data);
+    unsigned int mark = writer.length();
+    writer.putHex(ids);
+    writer.close(mark,TransactionIDTag);
+    writer.close(0,msgType);
 }
 
 /**
@@ -2349,7 +2347,9 @@ void SS7TCAPTransactionANSI::encodeDialogPortion(NamedList& params, DataBlock& d
 {
     XDebug(tcap(),DebugAll,"SS7TCAPTransactionANSI::encodeDialogPortion() for transaction with localID=%s [%p]",m_localID.c_str(),this);
 
-    DataBlock dialogData;
+    AsnWriter writer(data);
+    unsigned int dialogMark = writer.length();
+    unsigned int mark = 0;
     int tag;
 
     // encode confidentiality information
@@ -2363,29 +2363,19 @@ void SS7TCAPTransactionANSI::encodeDialogPortion(NamedList& params, DataBlock& d
 	      " both IntegerConfidentialityAlgorithmID=%s and ObjectIDConfidentialityID=%s specified, can't pick one",
 	      val->c_str(),oidStr->c_str());
     }
-    else {
+    else if (!TelEngine::null(val) || !TelEngine::null(oidStr)) {
+	unsigned int confMark = writer.length();
+	mark = writer.length();
 	if (!TelEngine::null(val)) {
-	    DataBlock db = ASNLib::encodeInteger(val->toInteger(),false);
-	    db.insert(ASNLib::buildLength(db));
-	    tag = SS7TCAPANSI::IntSecurityContextTag;
-	    db.insert(DataBlock(&tag,1));
-
-	    dialogData.insert(db);
+	    writer.putInteger(val->toInteger());
+	    writer.close(mark,SS7TCAPANSI::IntSecurityContextTag);
 	}
-	else if (!TelEngine::null(oidStr)) {
+	else {
 	    oid = *oidStr;
-	    DataBlock db = ASNLib::encodeOID(oid,false);
-	    db.insert(ASNLib::buildLength(db));
-	    tag = SS7TCAPANSI::OIDSecurityContextTag;
-	    db.insert(DataBlock(&tag,1));
-
-	    dialogData.insert(db);
-	}
-	if (dialogData.length()) {
-	    dialogData.insert(ASNLib::buildLength(dialogData));
-	    tag = SS7TCAPANSI::ConfidentialityTag;
-	    dialogData.insert(DataBlock(&tag,1));
+	    writer.put(ASNLib::encodeOID(oid,false));
+	    writer.close(mark,SS7TCAPANSI::OIDSecurityContextTag);
 	}
+	writer.close(confMark,SS7TCAPANSI::ConfidentialityTag);
     }
     // encode security information
     val = params.getParam(s_tcapIntSecID);
@@ -2398,25 +2388,19 @@ void SS7TCAPTransactionANSI::encodeDialogPortion(NamedList& params, DataBlock& d
 	      val->c_str(),oid.toString().c_str());
     }
     else if (!TelEngine::null(val)) {
-	DataBlock db = ASNLib::encodeInteger(val->toInteger(),false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPANSI::IntSecurityContextTag;
-	db.insert(DataBlock(&tag,1));
-
-	dialogData.insert(db);
+	mark = writer.length();
+	writer.putInteger(val->toInteger());
+	writer.close(mark,SS7TCAPANSI::IntSecurityContextTag);
     }
     else if (!TelEngine::null(oidStr)) {
 	oid = *oidStr;
-	DataBlock db = ASNLib::encodeOID(oid,false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPANSI::OIDSecurityContextTag;
-	db.insert(DataBlock(&tag,1));
-
-	dialogData.insert(db);
+	mark = writer.length();
+	writer.put(ASNLib::encodeOID(oid,false));
+	writer.close(mark,SS7TCAPANSI::OIDSecurityContextTag);
     }
 
     // encode user information
-    DataBlock userInfo;
+    unsigned int userMark = writer.length();
     val = params.getParam(s_tcapEncodingType);
     if (!TelEngine::null(val)) {
 	if (*val == "single-ASN1-type-primitive")
@@ -2430,43 +2414,28 @@ void SS7TCAPTransactionANSI::encodeDialogPortion(NamedList& params, DataBlock& d
 
 	val = params.getParam(s_tcapEncodingContent);
 	if (val) {
-	    DataBlock db;
-	    db.unHexify(val->c_str(),val->length(),' ');
-	    db.insert(ASNLib::buildLength(db));
-	    db.insert(DataBlock(&tag,1));
-
-	    userInfo.insert(db);
+	    mark = writer.length();
+	    writer.putHex(*val);
+	    writer.close(mark,tag);
 	}
     }
     val = params.getParam(s_tcapDataDesc);
     if (!TelEngine::null(val)) {
-	DataBlock db = ASNLib::encodeString(*val,ASNLib::PRINTABLE_STR,false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPANSI::DataDescriptorTag;
-	db.insert(DataBlock(&tag,1));
-
-	userInfo.insert(db);
+	mark = writer.length();
+	writer.put(ASNLib::encodeString(*val,ASNLib::PRINTABLE_STR,false));
+	writer.close(mark,SS7TCAPANSI::DataDescriptorTag);
     }
     val = params.getParam(s_tcapReference);
     if (!TelEngine::null(val)) {
 	oid = *val;
-	DataBlock db = ASNLib::encodeOID(oid,false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPANSI::DirectReferenceTag;
-	db.insert(DataBlock(&tag,1));
-
-	userInfo.insert(db);
+	mark = writer.length();
+	writer.put(ASNLib::encodeOID(oid,false));
+	writer.close(mark,SS7TCAPANSI::DirectReferenceTag);
     }
 
-    if (userInfo.length()) {
-	userInfo.insert(ASNLib::buildLength(userInfo));
-	tag = SS7TCAPANSI::ExternalTag;
-	userInfo.insert(DataBlock(&tag,1));
-	userInfo.insert(ASNLib::buildLength(userInfo));
-	tag = SS7TCAPANSI::UserInformationTag;
-	userInfo.insert(DataBlock(&tag,1));
-
-	dialogData.insert(userInfo);
+    if (writer.length() > userMark) {
+	writer.close(userMark,SS7TCAPANSI::ExternalTag);
+	writer.close(userMark,SS7TCAPANSI::UserInformationTag);
     }
 
     // Aplication context
@@ -2478,40 +2447,28 @@ void SS7TCAPTransactionANSI::encodeDialogPortion(NamedList& params, DataBlock& d
 	    " both IntegerApplicationID=%s and ObjectApplicationID=%s specified, can't pick one",val->c_str(),oid.toString().c_str());
     }
     else if (!TelEngine::null(val)) {
-	DataBlock db = ASNLib::encodeInteger(val->toInteger(),false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPANSI::IntApplicationContextTag;
-	db.insert(DataBlock(&tag,1));
-
-	dialogData.insert(db);
+	mark = writer.length();
+	writer.putInteger(val->toInteger());
+	writer.close(mark,SS7TCAPANSI::IntApplicationContextTag);
     }
     else if (!TelEngine::null(oidStr)) {
 	oid = *oidStr;
-	DataBlock db = ASNLib::encodeOID(oid,false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPANSI::OIDApplicationContextTag;
-	db.insert(DataBlock(&tag,1));
-
-	dialogData.insert(db);
+	mark = writer.length();
+	writer.put(ASNLib::encodeOID(oid,false));
+	writer.close(mark,SS7TCAPANSI::OIDApplicationContextTag);
     }
 
     val = params.getParam(s_tcapProtoVers);
     if (!TelEngine::null(val)) {
 	u_int8_t proto = val->toInteger();
-	DataBlock db  = ASNLib::encodeInteger(proto,false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPANSI::ProtocolVersionTag;
-	db.insert(DataBlock(&tag,1));
-	dialogData.insert(db);
+	mark = writer.length();
+	writer.putInteger(proto);
+	writer.close(mark,SS7TCAPANSI::ProtocolVersionTag);
     }
 
-    if (dialogData.length()) {
-	dialogData.insert(ASNLib::buildLength(dialogData));
-	tag = SS7TCAPANSI::DialogPortionTag;
-	dialogData.insert(DataBlock(&tag,1));
-    }
+    if (writer.length() > dialogMark)
+	writer.close(dialogMark,SS7TCAPANSI::DialogPortionTag);
 
-    data.insert(dialogData);
     params.clearParam(s_tcapDialogPrefix,'.');
 #ifdef DEBUG
      if (s_printMsgs && s_extendedDbg && debugAt(DebugAll))
@@ -2561,32 +2518,27 @@ SS7TCAPError SS7TCAPTransactionANSI::decodePAbort(SS7TCAPTransaction* tr, NamedL
 void SS7TCAPTransactionANSI::encodePAbort(SS7TCAPTransaction* tr, NamedList& params, DataBlock& data)
 {
     NamedString* pAbortCause = params.getParam(s_tcapAbortCause);
-    DataBlock db;
+    AsnWriter writer(data);
+    unsigned int mark = writer.length();
     if (!TelEngine::null(pAbortCause)) {
-	int tag = 0;
 	if (*pAbortCause == "pAbort") {
-	    tag = SS7TCAPANSI::PCauseTag;
 	    u_int16_t pCode = SS7TCAPError::codeFromError(SS7TCAP::ANSITCAP,params.getIntValue(s_tcapAbortInfo));
 	    if (pCode) {
-		db.append(ASNLib::encodeInteger(pCode,false));
-		db.insert(ASNLib::buildLength(db));
+		writer.putInteger(pCode);
+		writer.close(mark,SS7TCAPANSI::PCauseTag);
 	    }
 	}
 	else if (*pAbortCause == "userAbortP" || *pAbortCause == "userAbortC") {
 	    NamedString* info = params.getParam(s_tcapAbortInfo);
 	    if (!TelEngine::null(info))
-		db.unHexify(info->c_str(),info->length(),' ');
-	    db.insert(ASNLib::buildLength(db));
+		writer.putHex(*info);
 	    if (*pAbortCause == "userAbortP")
-		tag = SS7TCAPANSI::UserAbortPTag;
+		writer.close(mark,SS7TCAPANSI::UserAbortPTag);
 	    else
-		tag = SS7TCAPANSI::UserAbortCTag;
+		writer.close(mark,SS7TCAPANSI::UserAbortCTag);
 	}
-	if (db.length())
-	    db.insert(DataBlock(&tag,1));
     }
-    if (db.length()) {
-	data.insert(db);
+    if (writer.length() > mark) {
 	params.clearParam(s_tcapAbortCause);
 	params.clearParam(s_tcapAbortInfo);
     }
@@ -2796,12 +2748,12 @@ void SS7TCAPTransactionANSI::encodeComponents(NamedList& params, DataBlock& data
     XDebug(tcap(),DebugAll,"SS7TCAPTransactionANSI::encodeComponents() for transaction with localID=%s [%p]",m_localID.c_str(),this);
 
     int componentCount = params.getIntValue(s_tcapCompCount,0);
-    DataBlock compData;
+    AsnWriter writer(data);
+    unsigned int portionMark = writer.length();
     if (componentCount) {
 	int index = componentCount + 1;
 
 	while (--index) {
-	    DataBlock codedComp;
 	    // encode parameters
 	    String compParam;
 	    compPrefix(compParam,index,false);
@@ -2814,29 +2766,23 @@ void SS7TCAPTransactionANSI::encodeComponents(NamedList& params, DataBlock& data
 	    if (!map)
 		continue;
 	    int compType = map->mappedTo;
+	    unsigned int compMark = writer.length();
+	    unsigned int mark = 0;
 	    String payloadHex = params.getValue(compParam,"");
-	    if (!payloadHex.null()) {
-		DataBlock payload;
-		payload.unHexify(payloadHex.c_str(),payloadHex.length(),' ');
-		//payload.insert(ASNLib::buildLength(payload));
-		codedComp.insert(payload);
-	    }
+	    if (!payloadHex.null())
+		writer.putHex(payloadHex);
 
 	    // encode Problem only if Reject
 	    if (compType == Reject) {
 		value = params.getParam(compParam + "." + s_tcapProblemCode);
 		if (!TelEngine::null(value)) {
 		    u_int16_t code = SS7TCAPError::codeFromError(tcap()->tcapType(),value->toInteger());
-		    DataBlock db = ASNLib::encodeInteger(code,false);
+		    mark = writer.length();
+		    writer.putInteger(code);
 		    // should check that encoded length is 2
-		    if (db.length() < 2) {
-			code = 0;
-			db.insert(DataBlock(&code,1));
-		    }
-		    db.insert(ASNLib::buildLength(db));
-		    int tag = SS7TCAPANSI::ProblemCodeTag;
-		    db.insert(DataBlock(&tag,1));
-		    codedComp.insert(db);
+		    if (writer.length() - mark < 2)
+			writer.putByte(0);
+		    writer.close(mark,SS7TCAPANSI::ProblemCodeTag);
 		}
 	    }
 
@@ -2845,16 +2791,14 @@ void SS7TCAPTransactionANSI::encodeComponents(NamedList& params, DataBlock& data
 		value = params.getParam(compParam + "." + s_tcapErrCodeType);
 		if (!TelEngine::null(value)) {
 		    int errCode = params.getIntValue(compParam + "." + s_tcapErrCode,0);
-		    DataBlock db = ASNLib::encodeInteger(errCode,false);
-		    db.insert(ASNLib::buildLength(db));
-
 		    int tag = 0;
 		    if (*value == "national")
 			tag = SS7TCAPANSI::ErrorNationalTag;
 		    else if (*value == "private")
 			tag = SS7TCAPANSI::ErrorPrivateTag;
-		    db.insert(DataBlock(&tag,1));
-		    codedComp.insert(db);
+		    mark = writer.length();
+		    writer.putInteger(errCode);
+		    writer.close(mark,tag);
 		}
 	    }
 
@@ -2864,72 +2808,48 @@ void SS7TCAPTransactionANSI::encodeComponents(NamedList& params, DataBlock& data
 		value = params.getParam(compParam + "." + s_tcapOpCodeType);
 		if (!TelEngine::null(value)) {
 		    int opCode = params.getIntValue(compParam + "." + s_tcapOpCode,0);
-		    DataBlock db = ASNLib::encodeInteger(opCode,false);
+		    mark = writer.length();
+		    writer.putInteger(opCode);
 		    int tag = 0;
 		    if (*value == "national") {
 			tag = SS7TCAPANSI::OperationNationalTag;
-			if (db.length() < 2) {
-			    opCode = 0;
-			    db.insert(DataBlock(&opCode,1));
-			}
+			if (writer.length() - mark < 2)
+			    writer.putByte(0);
 		    }
 		    else if (*value == "private")
 			tag = SS7TCAPANSI::OperationPrivateTag;
-		    db.insert(ASNLib::buildLength(db));
-		    db.insert(DataBlock(&tag,1));
-		    codedComp.insert(db);
+		    writer.close(mark,tag);
 		}
 	    }
 	    NamedString* invID = params.getParam(compParam + "." + s_tcapLocalCID);
 	    NamedString* corrID = params.getParam(compParam + "." + s_tcapRemoteCID);
-	    DataBlock db;
-	    u_int8_t val = 0;
+	    mark = writer.length();
 	    switch (compType) {
 		case InvokeLast:
 		case InvokeNotLast:
-		    if (!TelEngine::null(invID)) {
-			val = invID->toInteger();
-			db.append(&val,sizeof(u_int8_t));
-			if (!TelEngine::null(corrID)) {
-			    val = corrID->toInteger();
-			    db.append(&val,sizeof(u_int8_t));
-			}
-		    }
-		    else {
-			if (!TelEngine::null(corrID)) {
-			    val = corrID->toInteger();
-			    db.append(&val,sizeof(u_int8_t));
-			}
-		    }
+		    // the correlation ID follows the invoke ID
+		    if (!TelEngine::null(corrID))
+			writer.putByte(corrID->toInteger());
+		    if (!TelEngine::null(invID))
+			writer.putByte(invID->toInteger());
 		    break;
 		case ReturnResultLast:
 		case ReturnError:
 		case Reject:
 		case ReturnResultNotLast:
-		    val = corrID->toInteger();
-		    db.append(&val,sizeof(u_int8_t));
+		    writer.putByte(corrID->toInteger());
 		    break;
 		default:
 		    break;
 	    }
-
-	    db.insert(ASNLib::buildLength(db));
-	    int tag = SS7TCAPANSI::ComponentsIDsTag;
-	    db.insert(DataBlock(&tag,1));
-	    codedComp.insert(db);
-	    codedComp.insert(ASNLib::buildLength(codedComp));
-	    codedComp.insert(DataBlock(&compType,1));
+	    writer.close(mark,SS7TCAPANSI::ComponentsIDsTag);
+	    writer.close(compMark,compType);
 
 	    params.clearParam(compParam,'.'); // clear all params for this component
-	    compData.insert(codedComp);
 	}
     }
 
-    compData.insert(ASNLib::buildLength(compData));
-    int tag = SS7TCAPANSI::ComponentPortionTag;
-    compData.insert(DataBlock(&tag,1));
-
-    data.insert(compData);
+    writer.close(portionMark,SS7TCAPANSI::ComponentPortionTag);
     params.clearParam(s_tcapCompPrefix,'.');
 }
 
@@ -3213,7 +3133,6 @@ void SS7TCAPITU::encodeTransactionPart(NamedList& params, DataBlock& data)
 
     u_int8_t msgType = map->mappedTo;
     NamedString* val = 0;
-    u_int8_t tag;
     bool encDTID = false;
     bool encOTID = false;
 
@@ -3235,33 +3154,28 @@ void SS7TCAPITU::encodeTransactionPart(NamedList& params, DataBlock& data)
 	    break;
     }
 
+    AsnWriter writer(data);
+    unsigned int mark = 0;
     if (encDTID) {
 	val = params.getParam(s_tcapRemoteTID);
 	if (!TelEngine::null(val)) {
 	    // destination TID
-	    DataBlock db;
-	    db.unHexify(val->c_str(),val->length(),' ');
-	    db.insert(ASNLib::buildLength(db));
-	    tag = DestinationIDTag;
-	    db.insert(DataBlock(&tag,1));
-	    data.insert(db);
+	    mark = writer.length();
+	    writer.putHex(*val);
+	    writer.close(mark,DestinationIDTag);
 	}
     }
     if (encOTID) {
 	val = params.getParam(s_tcapLocalTID);
 	if (!TelEngine::null(val)) {
 	    // origination id
-	    DataBlock db;
-	    db.unHexify(val->c_str(),val->length(),' ');
-	    db.insert(ASNLib::buildLength(db));
-	    tag = OriginatingIDTag;
-	    db.insert(DataBlock(&tag,1));
-	    data.insert(db);
+	    mark = writer.length();
+	    writer.putHex(*val);
+	    writer.close(mark,OriginatingIDTag);
 	}
     }
 
-    data.insert(ASNLib::buildLength(data));
-    data.insert(DataBlock(&msgType,1));
+    writer.close(0,msgType);
 }
 
 /**
@@ -3725,16 +3639,14 @@ void SS7TCAPTransactionITU::abnormalDialogInfo(NamedList& params)
 void SS7TCAPTransactionITU::encodePAbort(SS7TCAPTransaction* tr, NamedList& params, DataBlock& data)
 {
     NamedString* pAbortCause = params.getParam(s_tcapAbortCause);
-    DataBlock db;
     if (!TelEngine::null(pAbortCause)) {
-	int tag = 0;
 	if (*pAbortCause == "pAbort") {
-	    tag = SS7TCAPITU::PCauseTag;
 	    u_int8_t pCode = SS7TCAPError::codeFromError(SS7TCAP::ITUTCAP,params.getIntValue(s_tcapAbortInfo));
 	    if (pCode) {
-		db.append(ASNLib::encodeInteger(pCode,false));
-		db.insert(ASNLib::buildLength(db));
-		db.insert(DataBlock(&tag,1));
+		AsnWriter writer(data);
+		unsigned int mark = writer.length();
+		writer.putInteger(pCode);
+		writer.close(mark,SS7TCAPITU::PCauseTag);
 	    }
 	}
 	else if (*pAbortCause == "uAbort") {
@@ -3742,8 +3654,6 @@ void SS7TCAPTransactionITU::encodePAbort(SS7TCAPTransaction* tr, NamedList& para
 		tr->encodeDialogPortion(params,data);
 	}
     }
-    if (db.length())
-	data.insert(db);
 
 #ifdef DEBUG
      if (tr && tr->tcap() && s_printMsgs && s_extendedDbg && debugAt(DebugAll))
@@ -4031,7 +3941,6 @@ void SS7TCAPTransactionITU::encodeDialogPortion(NamedList& params, DataBlock& da
     DDebug(tcap(),DebugAll,"SS7TCAPTransactionITU::encodeDialogPortion() for transaction with localID=%s [%p]",
 		m_localID.c_str(),this);
 
-    DataBlock dialogData;
     int tag;
 
     NamedString* typeStr = params.getParam(s_tcapDialoguePduType);
@@ -4039,8 +3948,11 @@ void SS7TCAPTransactionITU::encodeDialogPortion(NamedList& params, DataBlock& da
 	return;
     u_int8_t pduType = typeStr->toInteger(s_dialogPDUs);
 
+    AsnWriter writer(data);
+    unsigned int dialogMark = writer.length();
+    unsigned int mark = 0;
+
     // encode user information
-    DataBlock userInfo;
     NamedString* val = params.getParam(s_tcapEncodingType);
     if (!TelEngine::null(val)) {
 	if (*val == "single-ASN1-type-primitive")
@@ -4054,39 +3966,28 @@ void SS7TCAPTransactionITU::encodeDialogPortion(NamedList& params, DataBlock& da
 
 	val = params.getParam(s_tcapEncodingContent);
 	if (val) {
-	    DataBlock db;
-	    db.unHexify(val->c_str(),val->length(),' ');
-	    db.insert(ASNLib::buildLength(db));
-	    db.insert(DataBlock(&tag,1));
-	    userInfo.insert(db);
+	    mark = writer.length();
+	    writer.putHex(*val);
+	    writer.close(mark,tag);
 	}
     }
     val = params.getParam(s_tcapDataDesc);
     if (!TelEngine::null(val)) {
-	DataBlock db = ASNLib::encodeString(*val,ASNLib::PRINTABLE_STR,false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPITU::DataDescriptorTag;
-	db.insert(DataBlock(&tag,1));
-	userInfo.insert(db);
+	mark = writer.length();
+	writer.put(ASNLib::encodeString(*val,ASNLib::PRINTABLE_STR,false));
+	writer.close(mark,SS7TCAPITU::DataDescriptorTag);
     }
     val = params.getParam(s_tcapReference);
     if (!TelEngine::null(val)) {
 	ASNObjId oid = *val;
-	DataBlock db = ASNLib::encodeOID(oid,false);
-	db.insert(ASNLib::buildLength(db));
-	tag = SS7TCAPITU::DirectReferenceTag;
-	db.insert(DataBlock(&tag,1));
-	userInfo.insert(db);
+	mark = writer.length();
+	writer.put(ASNLib::encodeOID(oid,false));
+	writer.close(mark,SS7TCAPITU::DirectReferenceTag);
     }
 
-    if (userInfo.length()) {
-	userInfo.insert(ASNLib::buildLength(userInfo));
-	tag = SS7TCAPITU::ExternalTag;
-	userInfo.insert(DataBlock(&tag,1));
-	userInfo.insert(ASNLib::buildLength(userInfo));
-	tag = SS7TCAPITU::UserInformationTag;
-	userInfo.insert(DataBlock(&tag,1));
-	dialogData.insert(userInfo);
+    if (writer.length() > dialogMark) {
+	writer.close(dialogMark,SS7TCAPITU::ExternalTag);
+	writer.close(dialogMark,SS7TCAPITU::UserInformationTag);
     }
 
     switch (pduType) {
@@ -4094,83 +3995,66 @@ void SS7TCAPTransactionITU::encodeDialogPortion(NamedList& params, DataBlock& da
 	    val = params.getParam(s_tcapDialogueDiag);
 	    if (!TelEngine::null(val)) {
 		u_int16_t code = val->toInteger(s_resultPDUValues);
-		DataBlock db = ASNLib::encodeInteger(code % 0x10,true);
-		db.insert(ASNLib::buildLength(db));
+		mark = writer.length();
+		writer.put(ASNLib::encodeInteger(code % 0x10,true));
 		if ((code & 0x10) == 0x10)
-		    tag = ResultDiagnosticUserTag;
+		    writer.close(mark,ResultDiagnosticUserTag);
 		else
-		    tag = ResultDiagnosticProviderTag;
-		db.insert(DataBlock(&tag,1));
-		db.insert(ASNLib::buildLength(db));
-		tag = ResultDiagnosticTag;
-		db.insert(DataBlock(&tag,1));
-		dialogData.insert(db);
+		    writer.close(mark,ResultDiagnosticProviderTag);
+		writer.close(mark,ResultDiagnosticTag);
 	    }
 
 	    val = params.getParam(s_tcapDialogueResult);
 	    if (!TelEngine::null(val)) {
 		u_int8_t res = val->toInteger(s_resultPDUValues);
-		DataBlock db = ASNLib::encodeInteger(res,true);
-		db.insert(ASNLib::buildLength(db));
-		tag = ResultTag;
-		db.insert(DataBlock(&tag,1));
-		dialogData.insert(db);
+		mark = writer.length();
+		writer.put(ASNLib::encodeInteger(res,true));
+		writer.close(mark,ResultTag);
 	    }
 	case AARQDialogTag:
 	    // Application context
 	    val = params.getParam(s_tcapDialogueAppCtxt);
 	    if (!TelEngine::null(val)) {
 		ASNObjId oid = *val;
-		DataBlock db = ASNLib::encodeOID(oid,true);
-		db.insert(ASNLib::buildLength(db));
-		tag = SS7TCAPITU::ApplicationContextTag;
-		db.insert(DataBlock(&tag,1));
-		dialogData.insert(db);
+		mark = writer.length();
+		writer.put(ASNLib::encodeOID(oid,true));
+		writer.close(mark,SS7TCAPITU::ApplicationContextTag);
 	    }
 	    val = params.getParam(s_tcapProtoVers);
 	    if (!TelEngine::null(val) && (val->toInteger() > 0)) {
-		DataBlock db = ASNLib::encodeBitString(*val,false);
-		db.insert(ASNLib::buildLength(db));
-		tag = SS7TCAPITU::ProtocolVersionTag;
-		db.insert(DataBlock(&tag,1));
-		dialogData.insert(db);
+		mark = writer.length();
+		writer.put(ASNLib::encodeBitString(*val,false));
+		writer.close(mark,SS7TCAPITU::ProtocolVersionTag);
 	    }
 	    break;
 	case ABRTDialogTag:
 	    val = params.getParam(s_tcapDialogueAbrtSrc);
 	    if (!TelEngine::null(val)) {
 		u_int8_t code = val->toInteger(s_resultPDUValues) % 0x30;
-		DataBlock db = ASNLib::encodeInteger(code,false);
-		db.insert(ASNLib::buildLength(db));
-		tag = SS7TCAPITU::ProtocolVersionTag;
-		db.insert(DataBlock(&tag,1));
-		dialogData.insert(db);
+		mark = writer.length();
+		writer.putInteger(code);
+		writer.close(mark,SS7TCAPITU::ProtocolVersionTag);
 	    }
 	    break;
 	default:
+	    writer.rollback(dialogMark);
 	    return;
     }
 
-    dialogData.insert(ASNLib::buildLength(dialogData));
-    dialogData.insert(DataBlock(&pduType,1));
-    dialogData.insert(ASNLib::buildLength(dialogData));
-    tag = SS7TCAPITU::SingleASNTypeCEncTag;
-    dialogData.insert(DataBlock(&tag,1));
+    writer.close(dialogMark,pduType);
+    writer.close(dialogMark,SS7TCAPITU::SingleASNTypeCEncTag);
 
     val = params.getParam(s_tcapDialogueID);
-    if (TelEngine::null(val))
+    if (TelEngine::null(val)) {
+	writer.rollback(dialogMark);
 	return;
+    }
 
     ASNObjId oid = *val;
-    dialogData.insert(ASNLib::encodeOID(oid,true));
-    dialogData.insert(ASNLib::buildLength(dialogData));
-    tag = SS7TCAPITU::ExternalTag;
-    dialogData.insert(DataBlock(&tag,1));
-    dialogData.insert(ASNLib::buildLength(dialogData));
-    tag = SS7TCAPITU::DialogPortionTag;
-    dialogData.insert(DataBlock(&tag,1));
-
-    data.insert(dialogData);
+    writer.put(ASNLib::encodeOID(oid,true));
+    writer.close(dialogMark,SS7TCAPITU::ExternalTag);
+    writer.close(dialogMark,SS7TCAPITU::DialogPortionTag);
+
     params.clearParam(s_tcapDialogPrefix,'.');
 #ifdef DEBUG
      if (s_printMsgs && s_extendedDbg && debugAt(DebugAll))
@@ -4377,12 +4261,12 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
     XDebug(tcap(),DebugAll,"SS7TCAPTransactionITU::encodeComponents() for transaction with localID=%s [%p]",m_localID.c_str(),this);
 
     int componentCount = params.getIntValue(s_tcapCompCount,0);
-    DataBlock compData;
+    AsnWriter writer(data);
+    unsigned int portionMark = writer.length();
     if (componentCount) {
 	int index = componentCount + 1;
 
 	while (--index) {
-	    DataBlock codedComp;
 	    // encode parameters
 	    String compParam;
 	    compPrefix(compParam,index,false);
@@ -4392,6 +4276,8 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 	    if (!map)
 		continue;
 	    int compType = map->mappedTo;
+	    unsigned int compMark = writer.length();
+	    unsigned int mark = 0;
 
 	    NamedString* value = 0;
 	    bool hasPayload = false;
@@ -4401,10 +4287,8 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 		    u_int16_t codeErr = SS7TCAPError::codeFromError(tcap()->tcapType(),(SS7TCAPError::ErrorType)value->toInteger());
 		    u_int8_t problemTag = (codeErr & 0xff00) >> 8;
 		    u_int8_t code = codeErr & 0x000f;
-		    DataBlock db(DataBlock(&code,1));
-		    db.insert(ASNLib::buildLength(db));
-		    db.insert(DataBlock(&problemTag,1));
-		    codedComp.insert(db);
+		    writer.putByte(code);
+		    writer.close(compMark,problemTag);
 		}
 		else {
 		    Debug(tcap(),DebugWarn,"Missing mandatory 'problemCode' information for component with index='%d' from transaction "
@@ -4415,9 +4299,7 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 	    else {
 		NamedString* payloadHex = params.getParam(compParam);
 		if (!TelEngine::null(payloadHex)) {
-		    DataBlock payload;
-		    payload.unHexify(payloadHex->c_str(),payloadHex->length(),' ');
-		    codedComp.insert(payload);
+		    writer.putHex(*payloadHex);
 		    hasPayload = true;
 		}
 	    }
@@ -4426,25 +4308,25 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 		value = params.getParam(compParam + "." + s_tcapErrCodeType);
 		if (!TelEngine::null(value)) {
 		    int tag = 0;
-		    DataBlock db;
+		    mark = writer.length();
 		    if (*value == "local") {
 			tag = SS7TCAPITU::LocalTag;
 			int errCode = params.getIntValue(compParam + "." + s_tcapErrCode,0);
-			db = ASNLib::encodeInteger(errCode,false);
-			db.insert(ASNLib::buildLength(db));
+			writer.putInteger(errCode);
+			writer.putLength(writer.length() - mark);
 		    }
 		    else if (*value == "global") {
 			tag = SS7TCAPITU::GlobalTag;
 			ASNObjId oid = String(params.getValue(compParam + "." + s_tcapErrCode));
-			db = ASNLib::encodeOID(oid,false);
-			db.insert(ASNLib::buildLength(db));
+			writer.put(ASNLib::encodeOID(oid,false));
+			writer.putLength(writer.length() - mark);
 		    }
-		    db.insert(DataBlock(&tag,1));
-		    codedComp.insert(db);
+		    writer.putByte(tag);
 		}
 		else {
 		    Debug(tcap(),DebugWarn,"Missing mandatory 'errorCodeType' information for component with index='%d' from transaction "
 			    "with localID=%s [%p]",index,m_localID.c_str(),this);
+		    writer.rollback(compMark);
 		    continue;
 		}
 	    }
@@ -4455,28 +4337,22 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 		compType == ReturnResultLast) {
 		value = params.getParam(compParam + "." + s_tcapOpCodeType);
 		if (!TelEngine::null(value)) {
-		    int tag = 0;
-		    DataBlock db;
 		    if (*value == "local") {
 			int opCode = params.getIntValue(compParam + "." + s_tcapOpCode,0);
-			db = ASNLib::encodeInteger(opCode,true);
+			writer.put(ASNLib::encodeInteger(opCode,true));
 		    }
 		    else if (*value == "global") {
 			ASNObjId oid(params.getValue(compParam + "." + s_tcapOpCode));
-			db = ASNLib::encodeOID(oid,true);
-			//db.insert(ASNLib::buildLength(db));
-		    }
-		    codedComp.insert(db);
-		    if (compType != Invoke) {
-			tag = SS7TCAPITU::ParameterSeqTag;
-			codedComp.insert(ASNLib::buildLength(codedComp));
-			codedComp.insert(DataBlock(&tag,1));
+			writer.put(ASNLib::encodeOID(oid,true));
 		    }
+		    if (compType != Invoke)
+			writer.close(compMark,SS7TCAPITU::ParameterSeqTag);
 		}
 		else {
 		    if (compType == Invoke || hasPayload) {
 			Debug(tcap(),DebugWarn,"Missing mandatory 'operationCodeType' information for component with index='%d' from transaction "
 			    "with localID=%s [%p]",index,m_localID.c_str(),this);
+			writer.rollback(compMark);
 			continue;
 		    }
 		}
@@ -4484,29 +4360,22 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 
 	    NamedString* invID = params.getParam(compParam + "." + s_tcapLocalCID);
 	    NamedString* linkID = params.getParam(compParam + "." + s_tcapRemoteCID);
-	    DataBlock db;
-	    u_int8_t val = 0;
 	    switch (compType) {
 		case Invoke:
 		    if (!TelEngine::null(linkID)) {
-			val = linkID->toInteger();
-			DataBlock db1;
-			db1.append(&val,sizeof(u_int8_t));
-			db1.insert(ASNLib::buildLength(db1));
-			val = SS7TCAPITU::LinkedIDTag;
-			db1.insert(DataBlock(&val,1));
-			codedComp.insert(db1);
+			mark = writer.length();
+			writer.putByte(linkID->toInteger());
+			writer.close(mark,SS7TCAPITU::LinkedIDTag);
 		    }
 		    if (!TelEngine::null(invID)) {
-			val = invID->toInteger();
-			db.append(&val,sizeof(u_int8_t));
-			db.insert(ASNLib::buildLength(db));
-			val = SS7TCAPITU::LocalTag;
-			db.insert(DataBlock(&val,1));
+			mark = writer.length();
+			writer.putByte(invID->toInteger());
+			writer.close(mark,SS7TCAPITU::LocalTag);
 		    }
 		    else {
 			Debug(tcap(),DebugWarn,"Missing mandatory 'localCID' information for component with index='%d' from transaction "
 			    "with localID=%s [%p]",index,m_localID.c_str(),this);
+			writer.rollback(compMark);
 			continue;
 		    }
 		    break;
@@ -4514,15 +4383,14 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 		case ReturnError:
 		case ReturnResultNotLast:
 		    if (!TelEngine::null(linkID)) {
-			val = linkID->toInteger();
-			db.append(&val,sizeof(u_int8_t));
-			db.insert(ASNLib::buildLength(db));
-			val = SS7TCAPITU::LocalTag;
-			db.insert(DataBlock(&val,1));
+			mark = writer.length();
+			writer.putByte(linkID->toInteger());
+			writer.close(mark,SS7TCAPITU::LocalTag);
 		    }
 		    else {
 			Debug(tcap(),DebugWarn,"Missing mandatory 'remoteCID' information for component with index='%d' from transaction "
 			    "with localID=%s [%p]",index,m_localID.c_str(),this);
+			writer.rollback(compMark);
 			continue;
 		    }
 		    break;
@@ -4530,36 +4398,25 @@ void SS7TCAPTransactionITU::encodeComponents(NamedList& params, DataBlock& data)
 		    if (TelEngine::null(linkID))
 			linkID = invID;
 		    if (!TelEngine::null(linkID)) {
-			val = linkID->toInteger();
-			db.append(&val,sizeof(u_int8_t));
-			db.insert(ASNLib::buildLength(db));
-			val = SS7TCAPITU::LocalTag;
-			db.insert(DataBlock(&val,1));
+			mark = writer.length();
+			writer.putByte(linkID->toInteger());
+			writer.close(mark,SS7TCAPITU::LocalTag);
 		    }
 		    else
-			db.insert(ASNLib::encodeNull(true));
+			writer.put(ASNLib::encodeNull(true));
 		    break;
 		default:
 		    break;
 	    }
-	    codedComp.insert(db);
 
-	    if(codedComp.length()) {
-		codedComp.insert(ASNLib::buildLength(codedComp));
-		codedComp.insert(DataBlock(&compType,1));
-	    }
+	    if (writer.length() > compMark)
+		writer.close(compMark,compType);
 
 	    params.clearParam(compParam,'.'); // clear all params for this component
-	    compData.insert(codedComp);
 	}
 
-	if (compData.length()) {
-	    compData.insert(ASNLib::buildLength(compData));
-	    int tag = SS7TCAPITU::ComponentPortionTag;
-	    compData.insert(DataBlock(&tag,1));
-
-	    data.insert(compData);
-	}
+	if (writer.length() > portionMark)
+	    writer.close(portionMark,SS7TCAPITU::ComponentPortionTag);
     }
 
     params.clearParam(s_tcapCompPrefix,'.');
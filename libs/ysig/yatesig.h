@@ -2357,8 +2357,11 @@ protected:
 private:
     unsigned int advance(unsigned int n, int strategy, SignallingCircuitRange& range);
     void clearAll();
+    // Add or remove a circuit in the code index, grow the index if needed
+    void indexCircuit(SignallingCircuit* circuit, bool add);
 
     ObjList m_circuits;                  // The circuits belonging to this group
+    ObjVector m_index;                   // Circuits indexed by their code, not owned
     ObjList m_spans;                     // The spans belonging to this group
     ObjList m_ranges;                    // Additional circuit ranges
     SignallingCircuitRange m_range;      // Range containing all circuits belonging to this group
@@ -9151,6 +9154,14 @@ private:
     // Find a call by its circuit identification code
     // This method is not thread safe
     SS7ISUPCall* findCall(unsigned int cic);
+    // Add a call to the circuit code index, grow the index if needed
+    // This method is thread safe
+    void indexCall(SS7ISUPCall* call);
+    // Remove a call from the index slot of a circuit code
+    // This method is thread safe
+    void unindexCall(SS7ISUPCall* call, unsigned int cic);
+    // Replace the circuit of a call and move it in the circuit code index
+    bool replaceCallCircuit(SS7ISUPCall* call, SignallingCircuit* circuit, SS7MsgISUP* msg = 0);
     // Find a call by its circuit identification code
     // This method is thread safe
     inline void findCall(unsigned int cic, RefPointer<SS7ISUPCall>& call) {
@@ -9203,6 +9214,7 @@ private:
     bool m_inn;                          // Routing to internal network number flag
     int m_defaultSls;                    // Default SLS to use in outbound calls
     unsigned int m_maxCalledDigits;      // Maximum digits allowed in Called Number in IAM
+    ObjVector m_callIndex;               // Calls indexed by circuit code, not owned
     String m_numPlan;                    // Numbering plan
     String m_numType;                    // Number type
     String m_numPresentation;            // Number presentation
@@ -29,6 +29,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+// number of hash buckets in the transaction indexes
+#define TRANS_INDEX_SIZE 1021
 
 using namespace TelEngine;
 
@@ -110,6 +112,12 @@ static TokenDict sip_responses[] = {
 
 TokenDict* TelEngine::SIPResponses = sip_responses;
 
+// Retrieve the bucket of a transaction index that holds a key
+static inline ObjList* indexBucket(ObjList* index, const String& key)
+{
+    return index + (key.hash() % TRANS_INDEX_SIZE);
+}
+
 SIPParty::SIPParty(Mutex* mutex)
     : m_mutex(mutex), m_reliable(false), m_localPort(0), m_partyPort(0)
 {
@@ -169,6 +177,8 @@ SIPEvent::~SIPEvent()
 
 SIPEngine::SIPEngine(const char* userAgent)
     : Mutex(true,"SIPEngine"),
+      m_branchIndex(0), m_callidIndex(0), m_transCount(0),
+      m_readyTail(&m_ready), m_timers(0),
       m_t1(500000), m_t4(5000000), m_reqTransCount(5), m_rspTransCount(6),
       m_maxForwards(70),
       m_cseq(0), m_flags(0), m_lazyTrying(false),
@@ -177,6 +187,9 @@ SIPEngine::SIPEngine(const char* userAgent)
       m_autoChangeParty(false)
 {
     debugName("sipengine");
+    m_branchIndex = new ObjList[TRANS_INDEX_SIZE];
+    m_callidIndex = new ObjList[TRANS_INDEX_SIZE];
+    m_timers = new SIPTimerWheel(Time::now());
     DDebug(this,DebugInfo,"SIPEngine::SIPEngine() [%p]",this);
     if (m_userAgent.null())
 	m_userAgent << "YATE/" << YATE_VERSION;
@@ -189,6 +202,15 @@ SIPEngine::SIPEngine(const char* userAgent)
 SIPEngine::~SIPEngine()
 {
     DDebug(this,DebugInfo,"SIPEngine::~SIPEngine() [%p]",this);
+    lock();
+    clearTransactions();
+    delete m_timers;
+    m_timers = 0;
+    delete[] m_branchIndex;
+    m_branchIndex = 0;
+    delete[] m_callidIndex;
+    m_callidIndex = 0;
+    unlock();
 }
 
 SIPTransaction* SIPEngine::addMessage(SIPParty* ep, const char* buf, int len)
@@ -227,20 +249,42 @@ SIPTransaction* SIPEngine::addMessage(SIPMessage* message)
 	branch = *br;
     Lock lock(this);
     SIPTransaction* forked = 0;
-    ObjList* l = &m_transList;
-    for (; l; l = l->next()) {
-	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
-	if (!t)
-	    continue;
-	switch (t->processMessage(message,branch)) {
-	    case SIPTransaction::Matched:
-		return t;
-	    case SIPTransaction::NoDialog:
-		forked = t;
-		break;
-	    case SIPTransaction::NoMatch:
-	    default:
-		break;
+    // RFC 3261 transactions are found by branch alone, their entries are
+    //  kept in list order so the first transaction to match still wins
+    if (branch) {
+	for (ObjList* l = indexBucket(m_branchIndex,branch)->skipNull(); l; l = l->skipNext()) {
+	    SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
+	    if (t->getBranch() != branch)
+		continue;
+	    switch (t->processMessage(message,branch)) {
+		case SIPTransaction::Matched:
+		    return t;
+		case SIPTransaction::NoDialog:
+		    forked = t;
+		    break;
+		case SIPTransaction::NoMatch:
+		default:
+		    break;
+	    }
+	}
+    }
+    // RFC 2543 peers and ACKs to 2xx (new branch) can match only by Call-ID
+    if (branch.null() || message->isACK()) {
+	const String& callid = message->getHeaderValue("Call-ID");
+	for (ObjList* l = indexBucket(m_callidIndex,callid)->skipNull(); l; l = l->skipNext()) {
+	    SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
+	    if ((t->getCallID() != callid) || (branch && (t->getBranch() == branch)))
+		continue;
+	    switch (t->processMessage(message,branch)) {
+		case SIPTransaction::Matched:
+		    return t;
+		case SIPTransaction::NoDialog:
+		    forked = t;
+		    break;
+		case SIPTransaction::NoMatch:
+		default:
+		    break;
+	    }
 	}
     }
     if (forked)
@@ -278,36 +322,167 @@ bool SIPEngine::process()
 SIPEvent* SIPEngine::getEvent()
 {
     Lock lock(this);
-    ObjList* l = m_transList.skipNull();
-    if (!l)
-	return 0;
     u_int64_t time = Time::now();
-    for (; l; l = l->skipNext()) {
-	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
-	SIPEvent* e = t->getEvent(true,time);
-	if (e) {
-	    DDebug(this,DebugInfo,"Got pending event %p (state %s) from transaction %p [%p]",
-		e,SIPTransaction::stateName(e->getState()),t,this);
-	    if (t->getState() == SIPTransaction::Invalid)
-		m_transList.remove(t);
-	    return e;
-	}
-    }
-    time = Time::now();
-    for (l = m_transList.skipNull(); l; l = l->skipNext()) {
-	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
+    ObjList expired;
+    m_timers->advance(time,expired);
+    while (SIPTransaction* t = static_cast<SIPTransaction*>(expired.remove(false)))
+	wakeup(t);
+    // transactions leave the queue when they have nothing more to report
+    while (SIPTransaction* t = static_cast<SIPTransaction*>(m_ready.get())) {
+	if (m_ready.next() == m_readyTail)
+	    m_readyTail = &m_ready;
+	m_ready.remove(false);
+	t->m_queued = false;
+	if (t->getState() == SIPTransaction::Invalid)
+	    continue;
 	SIPEvent* e = t->getEvent(false,time);
-	if (e) {
-	    DDebug(this,DebugInfo,"Got event %p (state %s) from transaction %p [%p]",
-		e,SIPTransaction::stateName(e->getState()),t,this);
-	    if (t->getState() == SIPTransaction::Invalid)
-		m_transList.remove(t);
-	    return e;
-	}
+	if (!e)
+	    continue;
+	DDebug(this,DebugInfo,"Got event %p (state %s) from transaction %p [%p]",
+	    e,SIPTransaction::stateName(e->getState()),t,this);
+	if (t->getState() == SIPTransaction::Invalid)
+	    drop(t);
+	else
+	    // it may have more events, keep it first in line
+	    wakeup(t,true);
+	return e;
     }
     return 0;
 }
 
+void SIPEngine::getTransactions(ObjList& list) const
+{
+    ObjList* tail = list.last();
+    // the Call-ID index holds every transaction exactly once
+    for (unsigned int i = 0; i < TRANS_INDEX_SIZE; i++) {
+	for (ObjList* l = m_callidIndex[i].skipNull(); l; l = l->skipNext()) {
+	    tail = tail->append(l->get());
+	    tail->setDelete(false);
+	}
+    }
+}
+
+void SIPEngine::clearTransactions()
+{
+    Lock lock(this);
+    for (unsigned int i = 0; i < TRANS_INDEX_SIZE; i++) {
+	while (ObjList* l = m_callidIndex[i].skipNull())
+	    drop(static_cast<SIPTransaction*>(l->get()));
+    }
+}
+
+void SIPEngine::remove(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    if (transaction->m_listed)
+	unlist(transaction);
+}
+
+void SIPEngine::append(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    indexAdd(transaction,false);
+    transaction->m_listed = true;
+    m_transCount++;
+    wakeup(transaction);
+    schedule(transaction);
+}
+
+void SIPEngine::insert(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    indexAdd(transaction,true);
+    transaction->m_listed = true;
+    m_transCount++;
+    wakeup(transaction,true);
+    schedule(transaction);
+}
+
+void SIPEngine::rebranch(SIPTransaction* transaction, const String& oldBranch)
+{
+    if (!transaction || (transaction->getBranch() == oldBranch))
+	return;
+    Lock lock(this);
+    if (!transaction->m_listed)
+	return;
+    if (oldBranch)
+	indexBucket(m_branchIndex,oldBranch)->remove(transaction,false);
+    if (transaction->getBranch())
+	indexBucket(m_branchIndex,transaction->getBranch())->append(transaction)->setDelete(false);
+}
+
+void SIPEngine::indexAdd(SIPTransaction* transaction, bool first)
+{
+    if (!transaction)
+	return;
+    // index buckets never own the transactions, only the list does
+    if (transaction->getBranch()) {
+	ObjList* l = indexBucket(m_branchIndex,transaction->getBranch());
+	(first ? l->insert(transaction) : l->append(transaction))->setDelete(false);
+    }
+    ObjList* l = indexBucket(m_callidIndex,transaction->getCallID());
+    (first ? l->insert(transaction) : l->append(transaction))->setDelete(false);
+}
+
+void SIPEngine::indexRemove(SIPTransaction* transaction)
+{
+    if (!transaction)
+	return;
+    if (transaction->getBranch())
+	indexBucket(m_branchIndex,transaction->getBranch())->remove(transaction,false);
+    indexBucket(m_callidIndex,transaction->getCallID())->remove(transaction,false);
+}
+
+void SIPEngine::drop(SIPTransaction* transaction)
+{
+    if (!transaction->m_listed)
+	return;
+    unlist(transaction);
+    transaction->deref();
+}
+
+void SIPEngine::unlist(SIPTransaction* transaction)
+{
+    indexRemove(transaction);
+    m_timers->cancel(transaction);
+    if (transaction->m_queued) {
+	m_ready.remove(transaction,false);
+	m_readyTail = m_ready.last();
+	transaction->m_queued = false;
+    }
+    transaction->m_listed = false;
+    m_transCount--;
+}
+
+void SIPEngine::wakeup(SIPTransaction* transaction, bool first)
+{
+    Lock lock(this);
+    if (transaction->m_queued || !transaction->m_listed)
+	return;
+    transaction->m_queued = true;
+    if (first && m_ready.get()) {
+	m_ready.insert(transaction)->setDelete(false);
+	// the previous first transaction was moved to a new node
+	if (m_readyTail == &m_ready)
+	    m_readyTail = m_ready.next();
+    }
+    else {
+	m_readyTail = m_readyTail->append(transaction);
+	m_readyTail->setDelete(false);
+    }
+}
+
+void SIPEngine::schedule(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    if (!(transaction->m_listed && m_timers))
+	return;
+    if (transaction->getState() == SIPTransaction::Invalid)
+	m_timers->cancel(transaction);
+    else
+	m_timers->schedule(transaction);
+}
+
 void SIPEngine::processEvent(SIPEvent *event)
 {
     if (!event)
@@ -32,6 +32,90 @@ using namespace TelEngine;
 
 static Regexp s_angled("<\\([^>]\\+\\)>");
 
+// number of buckets used to map indexed header names, must be a power of 2
+#define INDEX_BUCKETS 64
+
+namespace { // anonymous
+
+// Maps the names of the most frequently used headers to a small number
+class HeaderNames
+{
+public:
+    HeaderNames();
+    int find(const char* name) const;
+private:
+    static unsigned int hash(const char* name);
+    signed char m_buckets[INDEX_BUCKETS];
+};
+
+}; // anonymous namespace
+
+// Headers kept in the message index, others are searched in the list
+static const char* s_indexedNames[] = {
+    "Via",
+    "From",
+    "To",
+    "Call-ID",
+    "CSeq",
+    "Contact",
+    "Max-Forwards",
+    "Content-Length",
+    "Content-Type",
+    "Route",
+    "Record-Route",
+    "Expires",
+    "Allow",
+    "Supported",
+    "Require",
+    "User-Agent",
+    "WWW-Authenticate",
+    "Proxy-Authenticate",
+    "Authorization",
+    "Proxy-Authorization",
+    0
+};
+
+// Index of some of the names above, used while parsing
+enum {
+    HdrCSeq = 4,
+    HdrContentLength = 7,
+    HdrFirstAuth = 16,
+    HdrLastAuth = 19,
+};
+
+static const HeaderNames s_indexed;
+
+HeaderNames::HeaderNames()
+{
+    ::memset(m_buckets,-1,sizeof(m_buckets));
+    for (int i = 0; s_indexedNames[i]; i++) {
+	unsigned int b = hash(s_indexedNames[i]);
+	while (m_buckets[b & (INDEX_BUCKETS - 1)] >= 0)
+	    b++;
+	m_buckets[b & (INDEX_BUCKETS - 1)] = i;
+    }
+}
+
+// Case insensitive hash of a header name
+unsigned int HeaderNames::hash(const char* name)
+{
+    unsigned int h = 0;
+    while (char c = *name++)
+	h = (h << 5) + h + (c | 0x20);
+    return h;
+}
+
+int HeaderNames::find(const char* name) const
+{
+    for (unsigned int b = hash(name); ; b++) {
+	int i = m_buckets[b & (INDEX_BUCKETS - 1)];
+	if (i < 0)
+	    return -1;
+	if (!::strcasecmp(name,s_indexedNames[i]))
+	    return i;
+    }
+}
+
 SIPMessage::SIPMessage(const SIPMessage& original)
     : RefObject(),
       version(original.version), method(original.method), uri(original.uri),
@@ -143,7 +227,7 @@ SIPMessage::SIPMessage(const SIPMessage* original, const SIPMessage* answer)
 	    tmp << " " << getParty()->getLocalAddr() << ":" << getParty()->getLocalPort();
 	}
 	hl = new MimeHeaderLine("Via",tmp);
-	header.append(hl);
+	addHeader(hl);
     }
     if (answer && (answer->code == 200) && (original->method &= "INVITE")) {
 	String tmp("z9hG4bK");
@@ -238,7 +322,7 @@ void SIPMessage::complete(SIPEngine* engine, const char* user, const char* domai
 	    hl->setParam("alias");
 	if (!((flags & (NotReqRport|RportAfterBranch)) || isAnswer() || isACK()))
 	    hl->setParam("rport");
-	header.append(hl);
+	addHeader(hl);
     }
     if (!(isAnswer() || hl->getParam("branch"))) {
 	String tmp("z9hG4bK");
@@ -265,7 +349,7 @@ void SIPMessage::complete(SIPEngine* engine, const char* user, const char* domai
 		tmp << String::uriEscape(user,'@',"+?&") << "@";
 	    tmp << domain << ">";
 	    hl = new MimeHeaderLine("From",tmp);
-	    header.append(hl);
+	    addHeader(hl);
 	}
 	if (!hl->getParam("tag"))
 	    hl->setParam("tag",String((unsigned int)Random::random()));
@@ -276,7 +360,7 @@ void SIPMessage::complete(SIPEngine* engine, const char* user, const char* domai
 	String tmp;
 	tmp << "<" << uri << ">";
 	hl = new MimeHeaderLine("To",tmp);
-	header.append(hl);
+	addHeader(hl);
     }
     if (hl && dlgTag && !hl->getParam("tag"))
 	hl->setParam("tag",dlgTag);
@@ -332,7 +416,7 @@ bool SIPMessage::copyHeader(const SIPMessage* message, const char* name, const c
 {
     const MimeHeaderLine* hl = message ? message->getHeader(name) : 0;
     if (hl) {
-	header.append(hl->clone(newName));
+	addHeader(hl->clone(newName));
 	return true;
     }
     return false;
@@ -348,109 +432,206 @@ int SIPMessage::copyAllHeaders(const SIPMessage* message, const char* name, cons
 	const MimeHeaderLine* hl = static_cast<const MimeHeaderLine*>(l->get());
 	if (hl && (hl->name() &= name)) {
 	    ++c;
-	    header.append(hl->clone(newName));
+	    addHeader(hl->clone(newName));
 	}
     }
     return c;
 }
 
+// Check if a character is a space as matched by [[:space:]]
+static inline bool isSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '\v') || (c == '\f');
+}
+
+static inline bool isDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+// Match a SIP/x.y version, return its length or 0 if not matched
+static unsigned int matchVersion(const char* s, unsigned int len)
+{
+    if ((len < 6) || ::strncasecmp(s,"SIP/",4) || !isDigit(s[4]) || (s[5] != '.'))
+	return 0;
+    unsigned int i = 6;
+    while ((i < len) && isDigit(s[i]))
+	i++;
+    return (i > 6) ? i : 0;
+}
+
+// Skip spaces, return the number of characters skipped
+static unsigned int skipSpaces(const char* s, unsigned int len)
+{
+    unsigned int i = 0;
+    while ((i < len) && isSpace(s[i]))
+	i++;
+    return i;
+}
+
+// Find the next line in a buffer without copying it, trim its blanks
+// Return false if the line must be unfolded or holds NUL characters
+static bool getLine(const char*& buf, int& len, const char*& line, int& lineLen)
+{
+    const char* b = buf;
+    int l = len;
+    int e = 0;
+    for (; (l > 0) && (*b != '\r') && (*b != '\n'); b++, l--, e++) {
+	if (!*b)
+	    return false;
+    }
+    if (l > 0) {
+	// CR is optional but skip over it if exists
+	if ((*b == '\r') && (l > 1) && (b[1] == '\n')) {
+	    b++;
+	    l--;
+	}
+	b++;
+	l--;
+	// continuation lines are unfolded by the MIME code
+	if (e && (l > 0) && ((*b == ' ') || (*b == '\t')))
+	    return false;
+    }
+    line = buf;
+    while (e && ((*line == ' ') || (*line == '\t'))) {
+	line++;
+	e--;
+    }
+    while (e && ((line[e - 1] == ' ') || (line[e - 1] == '\t')))
+	e--;
+    lineLen = e;
+    buf = b;
+    len = l;
+    return true;
+}
+
 bool SIPMessage::parseFirst(String& line)
 {
     XDebug(DebugAll,"SIPMessage::parse firstline= '%s'",line.c_str());
     if (line.null())
 	return false;
-    static Regexp r("^\\([Ss][Ii][Pp]/[0-9]\\.[0-9]\\+\\)[[:space:]]\\+\\([0-9][0-9][0-9]\\)[[:space:]]\\+\\(.*\\)$");
-    if (line.matches(r)) {
+    const char* s = line.c_str();
+    unsigned int len = line.length();
+    unsigned int v = matchVersion(s,len);
+    unsigned int sp = v ? skipSpaces(s + v,len - v) : 0;
+    if (sp && (len >= v + sp + 4) && isDigit(s[v + sp]) && isDigit(s[v + sp + 1]) &&
+	isDigit(s[v + sp + 2]) && isSpace(s[v + sp + 3])) {
 	// Answer: <version> <code> <reason-phrase>
 	m_answer = true;
-	version = line.matchString(1).toUpper();
-	code = line.matchString(2).toInteger();
-	reason = line.matchString(3);
+	version.assign(s,v).toUpper();
+	code = (s[v + sp] - '0') * 100 + (s[v + sp + 1] - '0') * 10 + (s[v + sp + 2] - '0');
+	unsigned int r = v + sp + 3;
+	r += skipSpaces(s + r,len - r);
+	reason.assign(s + r,len - r);
 	DDebug(DebugAll,"got answer version='%s' code=%d reason='%s'",
 	    version.c_str(),code,reason.c_str());
+	return true;
     }
-    else {
-	static Regexp r2("^\\([[:alpha:]]\\+\\)[[:space:]]\\+\\([^[:space:]]\\+\\)[[:space:]]\\+\\([Ss][Ii][Pp]/[0-9]\\.[0-9]\\+\\)$");
-	if (line.matches(r2)) {
-	    // Request: <method> <uri> <version>
-	    m_answer = false;
-	    method = line.matchString(1).toUpper();
-	    uri = line.matchString(2);
-	    version = line.matchString(3).toUpper();
-	    DDebug(DebugAll,"got request method='%s' uri='%s' version='%s'",
-		method.c_str(),uri.c_str(),version.c_str());
-	    if (method == YSTRING("ACK"))
-		m_ack = true;
-	}
-	else {
-	    Debug(DebugAll,"Invalid SIP line '%s'",line.c_str());
-	    return false;
-	}
+    // Request: <method> <uri> <version>
+    unsigned int m = 0;
+    while ((m < len) && (((s[m] | 0x20) >= 'a') && ((s[m] | 0x20) <= 'z')))
+	m++;
+    unsigned int u = m ? (m + skipSpaces(s + m,len - m)) : 0;
+    unsigned int ue = u;
+    while ((ue < len) && !isSpace(s[ue]))
+	ue++;
+    unsigned int vs = ue + skipSpaces(s + ue,len - ue);
+    if ((u > m) && (ue > u) && (vs > ue) && (matchVersion(s + vs,len - vs) == len - vs)) {
+	m_answer = false;
+	method.assign(s,m).toUpper();
+	uri.assign(s + u,ue - u);
+	version.assign(s + vs,len - vs).toUpper();
+	DDebug(DebugAll,"got request method='%s' uri='%s' version='%s'",
+	    method.c_str(),uri.c_str(),version.c_str());
+	if (method == YSTRING("ACK"))
+	    m_ack = true;
+	return true;
     }
-    return true;
+    Debug(DebugAll,"Invalid SIP line '%s'",line.c_str());
+    return false;
 }
 
+// Parse the buffer in a single pass, header lines are sliced in place and
+//  copied only once into the objects that hold them
 bool SIPMessage::parse(const char* buf, int len, unsigned int* bodyLen)
 {
     DDebug(DebugAll,"SIPMessage::parse(%p,%d) [%p]",buf,len,this);
-    String* line = 0;
+    const char* s = 0;
+    int l = 0;
+    String first;
     while (len > 0) {
-	line = MimeBody::getUnfoldedLine(buf,len);
-	if (!line->null())
-	    break;
+	if (getLine(buf,len,s,l))
+	    first.assign(s,l);
+	else {
+	    String* line = MimeBody::getUnfoldedLine(buf,len);
+	    first = *line;
+	    line->destruct();
+	}
 	// Skip any initial empty lines
-	TelEngine::destruct(line);
+	if (!first.null())
+	    break;
     }
-    if (!line)
+    if (!parseFirst(first))
 	return false;
-    if (!parseFirst(*line)) {
-	line->destruct();
-	return false;
-    }
-    line->destruct();
     int clen = -1;
+    String value;
+    ObjList* tail = header.last();
     while (len > 0) {
-	line = MimeBody::getUnfoldedLine(buf,len);
-	if (line->null()) {
-	    // Found end of headers
-	    line->destruct();
+	String* unfolded = 0;
+	if (!getLine(buf,len,s,l)) {
+	    unfolded = MimeBody::getUnfoldedLine(buf,len);
+	    s = unfolded->c_str();
+	    l = unfolded->length();
+	}
+	// Found end of headers
+	if (!l) {
+	    TelEngine::destruct(unfolded);
 	    break;
 	}
-	int col = line->find(':');
-	if (col <= 0) {
-	    line->destruct();
+	const char* col = (const char*)::memchr(s,':',l);
+	int n = col ? (col - s) : 0;
+	while (n && ((s[n - 1] == ' ') || (s[n - 1] == '\t')))
+	    n--;
+	if (n <= 0) {
+	    TelEngine::destruct(unfolded);
 	    return false;
 	}
-	String name = line->substr(0,col);
-	name.trimBlanks();
-	if (name.null()) {
-	    line->destruct();
-	    return false;
+	const char* v = col + 1;
+	int vl = l - (v - s);
+	while (vl && ((*v == ' ') || (*v == '\t'))) {
+	    v++;
+	    vl--;
+	}
+	String name;
+	if (n == 1) {
+	    char c[2] = { *s, 0 };
+	    name = uncompactForm(c);
 	}
-	name = uncompactForm(name);
-	*line >> ":";
-	line->trimBlanks();
-	XDebug(DebugAll,"SIPMessage::parse header='%s' value='%s'",name.c_str(),line->c_str());
-
-	if ((name &= "WWW-Authenticate") ||
-	    (name &= "Proxy-Authenticate") ||
-	    (name &= "Authorization") ||
-	    (name &= "Proxy-Authorization"))
-	    header.append(new MimeAuthLine(name,*line));
 	else
-	    header.append(new MimeHeaderLine(name,*line));
+	    name.assign(s,n);
+	value.assign(v,vl);
+	TelEngine::destruct(unfolded);
+	XDebug(DebugAll,"SIPMessage::parse header='%s' value='%s'",name.c_str(),value.c_str());
 
-	if ((clen < 0) && (name &= "Content-Length"))
-	    clen = line->toInteger(-1,10);
-	else if ((m_cseq < 0) && (name &= "CSeq")) {
-	    String seq = *line;
+	int id = indexOf(name);
+	MimeHeaderLine* hl = 0;
+	if ((id >= HdrFirstAuth) && (id <= HdrLastAuth))
+	    hl = new MimeAuthLine(name,value);
+	else
+	    hl = new MimeHeaderLine(name,value);
+	tail = tail->append(hl);
+	indexHeader(hl,id);
+
+	if ((clen < 0) && (id == HdrContentLength))
+	    clen = value.toInteger(-1,10);
+	else if ((m_cseq < 0) && (id == HdrCSeq)) {
+	    String seq = value;
 	    seq >> m_cseq;
 	    if (m_answer) {
 		seq.trimBlanks().toUpper();
 		method = seq;
 	    }
 	}
-	line->destruct();
     }
     if (!bodyLen) {
 	if (clen >= 0) {
@@ -504,6 +685,7 @@ void SIPMessage::buildBody(const char* buf, int len)
 	    if (!delobj)
 		body->appendHdr(line);
 	}
+	reindexHeaders();
     }
     DDebug(DebugAll,"SIPMessage::buildBody %d header lines, body %p",
 	header.count(),body);
@@ -513,6 +695,9 @@ const MimeHeaderLine* SIPMessage::getHeader(const char* name) const
 {
     if (!(name && *name))
 	return 0;
+    int id = indexOf(name);
+    if (id >= 0)
+	return m_index.m_slots[id].first;
     const ObjList* l = &header;
     for (; l; l = l->next()) {
 	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
@@ -526,6 +711,9 @@ const MimeHeaderLine* SIPMessage::getLastHeader(const char* name) const
 {
     if (!(name && *name))
 	return 0;
+    int id = indexOf(name);
+    if (id >= 0)
+	return m_index.m_slots[id].last;
     const MimeHeaderLine* res = 0;
     const ObjList* l = &header;
     for (; l; l = l->next()) {
@@ -540,6 +728,10 @@ void SIPMessage::clearHeaders(const char* name)
 {
     if (!(name && *name))
 	return;
+    int id = indexOf(name);
+    // an indexed header that is not present needs no list walk
+    if ((id >= 0) && !m_index.m_slots[id].count)
+	return;
     ObjList* l = &header;
     while (l) {
 	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
@@ -548,12 +740,17 @@ void SIPMessage::clearHeaders(const char* name)
 	else
 	    l = l->next();
     }
+    if (id >= 0)
+	::memset(&m_index.m_slots[id],0,sizeof(HeaderSlot));
 }
 
 int SIPMessage::countHeaders(const char* name) const
 {
     if (!(name && *name))
 	return 0;
+    int id = indexOf(name);
+    if (id >= 0)
+	return m_index.m_slots[id].count;
     int res = 0;
     const ObjList* l = &header;
     for (; l; l = l->next()) {
@@ -564,6 +761,49 @@ int SIPMessage::countHeaders(const char* name) const
     return res;
 }
 
+void SIPMessage::reindexHeaders()
+{
+    m_index.clear();
+    for (const ObjList* l = header.skipNull(); l; l = l->skipNext())
+	indexHeader(static_cast<const MimeHeaderLine*>(l->get()));
+}
+
+// Remember an added header line if it has one of the indexed names
+void SIPMessage::indexHeader(const MimeHeaderLine* line)
+{
+    if (line)
+	indexHeader(line,indexOf(line->name()));
+}
+
+// Remember an added header line in the index slot of its name
+void SIPMessage::indexHeader(const MimeHeaderLine* line, int id)
+{
+    if (id < 0)
+	return;
+    HeaderSlot& slot = m_index.m_slots[id];
+    if (!slot.first)
+	slot.first = line;
+    slot.last = line;
+    slot.count++;
+}
+
+// Get the index slot of a header name, -1 if the header is not indexed
+int SIPMessage::indexOf(const char* name)
+{
+    int id = s_indexed.find(name);
+    return (id < HeaderIndex::Size) ? id : -1;
+}
+
+SIPMessage::HeaderIndex::HeaderIndex()
+{
+    clear();
+}
+
+void SIPMessage::HeaderIndex::clear()
+{
+    ::memset(m_slots,0,sizeof(m_slots));
+}
+
 const NamedString* SIPMessage::getParam(const char* name, const char* param, bool last) const
 {
     const MimeHeaderLine* hl = last ? getLastHeader(name) : getHeader(name);
@@ -585,6 +825,8 @@ const String& SIPMessage::getParamValue(const char* name, const char* param, boo
 const String& SIPMessage::getHeaders() const
 {
     if (isValid() && m_string.null()) {
+	// most messages fit, avoid growing the buffer several times
+	m_string.reserve(512);
 	if (isAnswer())
 	    m_string << version << " " << code << " " << reason << "\r\n";
 	else
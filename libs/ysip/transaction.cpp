@@ -32,7 +32,8 @@ using namespace TelEngine;
 // Constructor from new message
 SIPTransaction::SIPTransaction(SIPMessage* message, SIPEngine* engine, bool outgoing)
     : m_outgoing(outgoing), m_invite(false), m_transmit(false), m_state(Invalid), m_response(0), m_timeout(0),
-      m_firstMessage(message), m_lastMessage(0), m_pending(0), m_engine(engine), m_private(0)
+      m_firstMessage(message), m_lastMessage(0), m_pending(0), m_engine(engine), m_private(0),
+      m_timerNode(0), m_queued(false), m_listed(false)
 {
     DDebug(getEngine(),DebugAll,"SIPTransaction::SIPTransaction(%p,%p,%d) [%p]",
 	message,engine,outgoing,this);
@@ -77,7 +78,8 @@ SIPTransaction::SIPTransaction(SIPTransaction& original, SIPMessage* answer)
       m_firstMessage(original.m_firstMessage), m_lastMessage(original.m_lastMessage),
       m_pending(0), m_engine(original.m_engine),
       m_branch(original.m_branch), m_callid(original.m_callid), m_tag(original.m_tag),
-      m_private(0)
+      m_private(0),
+      m_timerNode(0), m_queued(false), m_listed(false)
 {
     DDebug(getEngine(),DebugAll,"SIPTransaction::SIPTransaction(&%p,%p) [%p]",
 	&original,answer,this);
@@ -92,6 +94,7 @@ SIPTransaction::SIPTransaction(SIPTransaction& original, SIPMessage* answer)
 	original.m_branch = *ns;
     else
 	original.m_branch.clear();
+    m_engine->rebranch(&original,m_branch);
     ns = msg->getParam("To","tag");
     if (ns)
 	original.m_tag = *ns;
@@ -121,7 +124,8 @@ SIPTransaction::SIPTransaction(const SIPTransaction& original, const String& tag
       m_firstMessage(original.m_firstMessage), m_lastMessage(0),
       m_pending(0), m_engine(original.m_engine),
       m_branch(original.m_branch), m_callid(original.m_callid), m_tag(tag),
-      m_private(0)
+      m_private(0),
+      m_timerNode(0), m_queued(false), m_listed(false)
 {
     if (m_firstMessage)
 	m_firstMessage->ref();
@@ -186,6 +190,7 @@ bool SIPTransaction::changeState(int newstate)
     DDebug(getEngine(),DebugAll,"SIPTransaction state changed from %s to %s [%p]",
 	stateName(m_state),stateName(newstate),this);
     m_state = newstate;
+    m_engine->wakeup(this);
     return true;
 }
 
@@ -231,6 +236,14 @@ void SIPTransaction::setPendingEvent(SIPEvent* event, bool replace)
 	    delete event;
     else
 	m_pending = event;
+    if (m_pending)
+	m_engine->wakeup(this);
+}
+
+void SIPTransaction::setTransmit()
+{
+    m_transmit = true;
+    m_engine->wakeup(this);
 }
 
 void SIPTransaction::setTimeout(u_int64_t delay, unsigned int count)
@@ -238,6 +251,7 @@ void SIPTransaction::setTimeout(u_int64_t delay, unsigned int count)
     m_timeouts = count;
     m_delay = delay;
     m_timeout = (count && delay) ? Time::now() + delay : 0;
+    m_engine->schedule(this);
 #ifdef DEBUG
     if (m_timeout)
 	Debug(getEngine(),DebugAll,"SIPTransaction new %d timeouts initially " FMT64U " usec apart [%p]",
@@ -271,6 +285,7 @@ SIPEvent* SIPTransaction::getEvent(bool pendingOnly, u_int64_t time)
 	    timeout = --m_timeouts;
 	    m_delay *= 2; // exponential back-off
 	    m_timeout = (m_timeouts) ? time + m_delay : 0;
+	    m_engine->schedule(this);
 	    DDebug(getEngine(),DebugAll,"SIPTransaction fired timer #%d [%p]",timeout,this);
 	}
     }
@@ -21,10 +21,14 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <yatesip.h>
 #include "util.h"
 
 #include <string.h>
 
+// duration of a timer wheel tick in microseconds
+#define WHEEL_TICK 1000
+
 namespace TelEngine {
 
 static const char* compactForms[] = {
@@ -77,4 +81,111 @@ const char* compactForm(const char* header)
 
 }
 
+using namespace TelEngine;
+
+SIPTimerWheel::SIPTimerWheel(u_int64_t now)
+    : m_tick(now / WHEEL_TICK), m_count(0)
+{
+}
+
+void SIPTimerWheel::schedule(SIPTransaction* trans)
+{
+    cancel(trans);
+    if (trans->m_timeout) {
+	place(trans);
+	m_count++;
+    }
+}
+
+void SIPTimerWheel::cancel(SIPTransaction* trans)
+{
+    ObjList* node = trans->m_timerNode;
+    if (!node)
+	return;
+    trans->m_timerNode = 0;
+    m_count--;
+    // removing pulls the next transaction into this node
+    node->remove(false);
+    SIPTransaction* next = static_cast<SIPTransaction*>(node->get());
+    if (next)
+	next->m_timerNode = node;
+}
+
+// Put a transaction in the slot of the lowest level that covers its timeout
+void SIPTimerWheel::place(SIPTransaction* trans)
+{
+    u_int64_t base = m_tick + 1;
+    u_int64_t tick = (trans->m_timeout + WHEEL_TICK - 1) / WHEEL_TICK;
+    if (tick < base)
+	tick = base;
+    u_int64_t delta = tick - base;
+    unsigned int level = 0;
+    for (; level < Levels; level++) {
+	if (delta < ((u_int64_t)1 << (Bits * (level + 1))))
+	    break;
+    }
+    if (level >= Levels) {
+	// too far in the future, park it in the last slot and look again later
+	level = Levels - 1;
+	tick = base + ((u_int64_t)1 << (Bits * Levels)) - 1;
+    }
+    ObjList* slot = &m_slots[level][(tick >> (Bits * level)) & (Slots - 1)];
+    // inserting pushes the previous first transaction into a new node
+    SIPTransaction* next = static_cast<SIPTransaction*>(slot->get());
+    slot->insert(trans)->setDelete(false);
+    if (next) {
+	slot->next()->setDelete(false);
+	next->m_timerNode = slot->next();
+    }
+    trans->m_timerNode = slot;
+}
+
+// Spread the transactions of the current slot of a level to the lower levels
+void SIPTimerWheel::cascade(unsigned int level)
+{
+    ObjList* slot = &m_slots[level][((m_tick + 1) >> (Bits * level)) & (Slots - 1)];
+    ObjList moved;
+    while (SIPTransaction* t = static_cast<SIPTransaction*>(slot->remove(false))) {
+	t->m_timerNode = 0;
+	moved.insert(t)->setDelete(false);
+    }
+    while (SIPTransaction* t = static_cast<SIPTransaction*>(moved.remove(false)))
+	place(t);
+}
+
+void SIPTimerWheel::advance(u_int64_t now, ObjList& expired)
+{
+    ObjList* tail = expired.last();
+    ObjList later;
+    u_int64_t target = now / WHEEL_TICK;
+    while (m_tick < target) {
+	if (!m_count) {
+	    m_tick = target;
+	    break;
+	}
+	u_int64_t tick = m_tick + 1;
+	// at the start of a slot of an upper level move its timers down
+	unsigned int level = 0;
+	while ((level < Levels - 1) && !((tick >> (Bits * level)) & (Slots - 1)))
+	    level++;
+	for (; level > 0; level--)
+	    cascade(level);
+	m_tick = tick;
+	ObjList* slot = &m_slots[0][tick & (Slots - 1)];
+	while (SIPTransaction* t = static_cast<SIPTransaction*>(slot->remove(false))) {
+	    t->m_timerNode = 0;
+	    if (t->m_timeout > now) {
+		// parked far in the future, not due yet
+		later.insert(t)->setDelete(false);
+		continue;
+	    }
+	    m_count--;
+	    tail = tail->append(t);
+	    tail->setDelete(false);
+	}
+	while (SIPTransaction* t = static_cast<SIPTransaction*>(later.remove(false)))
+	    place(t);
+    }
+}
+
 /* vi: set ts=8 sw=4 sts=4 noet: */
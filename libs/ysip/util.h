@@ -31,6 +31,35 @@ const char* uncompactForm(const char* header);
 // Utility function, returns a compacted header name
 const char* compactForm(const char* header);
 
+class SIPTransaction;
+
+// Hierarchical timer wheel of transactions keyed by their timeout
+// Each level holds 64 slots, a slot spans 64 slots of the level below
+class SIPTimerWheel
+{
+public:
+    enum {
+	Levels = 4,
+	Slots = 64,
+	Bits = 6,
+    };
+    SIPTimerWheel(u_int64_t now);
+    // Place or move a transaction according to its timeout
+    void schedule(SIPTransaction* trans);
+    // Remove a transaction from the wheel
+    void cancel(SIPTransaction* trans);
+    // Move forward up to a time, append transactions whose timeout passed
+    void advance(u_int64_t now, ObjList& expired);
+    inline unsigned int count() const
+	{ return m_count; }
+private:
+    void place(SIPTransaction* trans);
+    void cascade(unsigned int level);
+    ObjList m_slots[Levels][Slots];
+    u_int64_t m_tick;
+    unsigned int m_count;
+};
+
 }
 
 /* vi: set ts=8 sw=4 sts=4 noet: */
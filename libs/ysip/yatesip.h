@@ -55,6 +55,7 @@ extern YSIP_API TokenDict* SIPResponses;
 
 class SIPEngine;
 class SIPEvent;
+class SIPTimerWheel;
 
 class YSIP_API SIPParty : public RefObject
 {
@@ -310,14 +311,14 @@ public:
      * @param value Content of the new header line
      */
     inline void addHeader(const char* name, const char* value = 0)
-	{ header.append(new MimeHeaderLine(name,value)); }
+	{ addHeader(new MimeHeaderLine(name,value)); }
 
     /**
      * Append an already constructed header line
      * @param line Header line to add
      */
     inline void addHeader(MimeHeaderLine* line)
-	{ header.append(line); }
+	{ header.append(line); indexHeader(line); }
 
     /**
      * Clear all header lines that match a name
@@ -331,6 +332,12 @@ public:
     inline void setHeader(const char* name, const char* value = 0)
 	{ clearHeaders(name); addHeader(name,value); }
 
+    /**
+     * Rebuild the index of frequently used header lines.
+     * This method must be called after changing the header list directly
+     */
+    void reindexHeaders();
+
     /**
      * Construct a new authorization line based on credentials and challenge
      * @param username User account name
@@ -428,6 +435,8 @@ public:
 
     /**
      * All the headers should be in this list.
+     * Use the addHeader() and clearHeaders() methods to change it or call
+     *  reindexHeaders() after modifying it directly
      */
     ObjList header;
 
@@ -453,6 +462,24 @@ protected:
     String m_authPass;
 private:
     SIPMessage(); // no, thanks
+    // First and last line and number of lines of an indexed header
+    struct HeaderSlot {
+	const MimeHeaderLine* first;
+	const MimeHeaderLine* last;
+	int count;
+    };
+    // Index of the frequently used headers, cleared at construction
+    class HeaderIndex {
+    public:
+	enum { Size = 20 };
+	HeaderIndex();
+	void clear();
+	HeaderSlot m_slots[Size];
+    };
+    static int indexOf(const char* name);
+    void indexHeader(const MimeHeaderLine* line);
+    void indexHeader(const MimeHeaderLine* line, int id);
+    HeaderIndex m_index;
 };
 
 /**
@@ -607,6 +634,8 @@ public:
  */
 class YSIP_API SIPTransaction : public RefObject
 {
+    friend class SIPEngine;
+    friend class SIPTimerWheel;
 public:
     /**
      * Current state of the transaction
@@ -783,8 +812,7 @@ public:
      * Set the (re)transmission flag that allows the latest outgoing message
      *  to be send over the wire
      */
-    inline void setTransmit()
-	{ m_transmit = true; }
+    void setTransmit();
 
     /**
      * Change transaction status to Cleared
@@ -982,6 +1010,11 @@ protected:
     String m_callid;
     String m_tag;
     void *m_private;
+
+private:
+    ObjList* m_timerNode;
+    bool m_queued;
+    bool m_listed;
 };
 
 /**
@@ -1073,6 +1106,7 @@ protected:
  */
 class YSIP_API SIPEngine : public DebugEnabler, public Mutex
 {
+    friend class SIPTransaction;
 public:
     /**
      * Create the SIP Engine
@@ -1151,9 +1185,10 @@ public:
 
     /**
      * Get a SIPEvent from the queue. 
-     * This method mainly looks into the transaction list and get all kind of 
-     * events, like an incoming request (INVITE, REGISTRATION), a timer, an
-     * outgoing message.
+     * This method polls only the transactions that were woken up by a state
+     *  change, a message to send or an expired timer and gets all kind of
+     *  events, like an incoming request (INVITE, REGISTRATION), a timer, an
+     *  outgoing message.
      * This method is thread safe
      */
     SIPEvent *getEvent();
@@ -1325,31 +1360,120 @@ public:
 	{ return m_allowed; }
 
     /**
-     * Remove a transaction from the list without dereferencing it
+     * Get the number of transactions held by the engine
+     * @return Count of transactions in the engine
+     */
+    inline unsigned int transactions() const
+	{ return m_transCount; }
+
+    /**
+     * Fill a list with all the transactions held by the engine.
+     * The engine must be kept locked while the list is used
+     * @param list List to append to, the transactions are not owned by it
+     */
+    void getTransactions(ObjList& list) const;
+
+    /**
+     * Remove and dereference all the transactions held by the engine
+     */
+    void clearTransactions();
+
+    /**
+     * Remove a transaction from the engine without dereferencing it
      * @param transaction Pointer to transaction to remove
      */
-    inline void remove(SIPTransaction* transaction)
-	{ lock(); m_transList.remove(transaction,false); unlock(); }
+    void remove(SIPTransaction* transaction);
 
     /**
-     * Append a transaction to the end of the list
+     * Add a transaction to the engine, it will be matched and polled after
+     *  the transactions already held
      * @param transaction Pointer to transaction to append
      */
-    inline void append(SIPTransaction* transaction)
-	{ lock(); m_transList.append(transaction); unlock(); }
+    void append(SIPTransaction* transaction);
 
     /**
-     * Insert a transaction at the start of the list
+     * Add a transaction to the engine, it will be matched and polled before
+     *  the transactions already held
      * @param transaction Pointer to transaction to insert
      */
-    inline void insert(SIPTransaction* transaction)
-	{ lock(); m_transList.insert(transaction); unlock(); }
+    void insert(SIPTransaction* transaction);
+
+    /**
+     * Update the branch index after the branch of a transaction changed
+     * @param transaction Pointer to transaction whose branch changed
+     * @param oldBranch Branch the transaction was previously indexed by
+     */
+    void rebranch(SIPTransaction* transaction, const String& oldBranch);
 
 protected:
     /**
-     * The list that holds all the SIP transactions.
+     * Add a transaction to the branch and Call-ID indexes
+     * @param transaction Pointer to transaction to index
+     * @param first True to index it ahead of other transactions with same keys
+     */
+    void indexAdd(SIPTransaction* transaction, bool first);
+
+    /**
+     * Remove a transaction from the branch and Call-ID indexes
+     * @param transaction Pointer to transaction to remove from indexes
+     */
+    void indexRemove(SIPTransaction* transaction);
+
+    /**
+     * Remove a transaction from the engine and dereference it
+     * @param transaction Pointer to transaction to drop
+     */
+    void drop(SIPTransaction* transaction);
+
+    /**
+     * Remove a held transaction from indexes, timers and ready queue
+     * @param transaction Pointer to transaction to forget
+     */
+    void unlist(SIPTransaction* transaction);
+
+    /**
+     * Queue a transaction to be polled for events at next @ref getEvent()
+     * @param transaction Pointer to transaction that may have an event
+     * @param first True to poll it ahead of the already queued transactions
+     */
+    void wakeup(SIPTransaction* transaction, bool first = false);
+
+    /**
+     * Update the timer of a transaction after its timeout changed
+     * @param transaction Pointer to transaction whose timeout changed
+     */
+    void schedule(SIPTransaction* transaction);
+
+    /**
+     * Transactions hashed by their Via branch, in the order they were added
+     */
+    ObjList* m_branchIndex;
+
+    /**
+     * Transactions hashed by their Call-ID, in the order they were added.
+     * Each transaction held by the engine is found here exactly once
+     */
+    ObjList* m_callidIndex;
+
+    /**
+     * Number of transactions held by the engine, each holds one reference
+     */
+    unsigned int m_transCount;
+
+    /**
+     * Transactions that need to be polled for events, not owned
+     */
+    ObjList m_ready;
+
+    /**
+     * Last node of the ready queue
+     */
+    ObjList* m_readyTail;
+
+    /**
+     * Timer wheel holding the transactions by their next timeout
      */
-    ObjList m_transList;
+    SIPTimerWheel* m_timers;
 
     u_int64_t m_t1;
     u_int64_t m_t4;
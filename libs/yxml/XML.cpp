@@ -31,6 +31,88 @@ const String XmlElement::s_nsPrefix = "xmlns:";
 static const String s_type("type");
 static const String s_name("name");
 
+namespace { // anonymous
+
+// A memory block of an arena, kept alive by the objects allocated from it
+class ArenaBlock : public RefObject
+{
+public:
+    inline ArenaBlock(unsigned int size)
+	: m_data(new char[size])
+	{ }
+    virtual ~ArenaBlock()
+	{ delete[] m_data; }
+    char* m_data;
+};
+
+// Header placed in front of each object allocated by an arena, keeps objects aligned
+union ArenaHeader {
+    ArenaBlock* block;
+    double align1;
+    u_int64_t align2;
+    void* align3[2];
+};
+
+// Allocation operators of the objects a parser builds in its arena.
+// Only these classes carry the arena header, the base classes use the heap
+class ArenaObject
+{
+public:
+    static void* operator new(size_t size, XmlArena* arena)
+	{ return arena->alloc(size); }
+    static void operator delete(void* ptr)
+	{ XmlArena::release(ptr); }
+    static void operator delete(void* ptr, XmlArena* arena)
+	{ XmlArena::release(ptr); }
+};
+
+// An attribute allocated by a parser from its arena
+class ArenaString : public NamedString, public ArenaObject
+{
+public:
+    inline ArenaString(const char* name, const char* value)
+	: NamedString(name,value)
+	{ }
+};
+
+// An element allocated by a parser from its arena
+class ArenaElement : public XmlElement, public ArenaObject
+{
+public:
+    inline ArenaElement(const char* name, bool complete)
+	: XmlElement(name,complete)
+	{ }
+};
+
+// A comment allocated by a parser from its arena
+class ArenaComment : public XmlComment, public ArenaObject
+{
+public:
+    inline ArenaComment(const String& comm)
+	: XmlComment(comm)
+	{ }
+};
+
+// A CDATA section allocated by a parser from its arena
+class ArenaCData : public XmlCData, public ArenaObject
+{
+public:
+    inline ArenaCData(const String& data)
+	: XmlCData(data)
+	{ }
+};
+
+// A text allocated by a parser from its arena
+class ArenaText : public XmlText, public ArenaObject
+{
+public:
+    inline ArenaText(const String& text)
+	: XmlText(text)
+	{ }
+};
+
+}; // anonymous namespace
+
 
 // Return a replacement char for the given string
 char replace(const char* str, const XmlEscape* esc)
@@ -108,15 +190,79 @@ const XmlEscape XmlSaxParser::s_escape[] = {
 };
 
 
+XmlArena::XmlArena(unsigned int blockSize)
+    : m_block(0), m_blockSize(blockSize), m_used(0),
+    m_objects(0), m_blocks(0), m_large(0)
+{
+}
+
+XmlArena::~XmlArena()
+{
+    // objects still alive keep their block
+    if (m_block)
+	m_block->deref();
+}
+
+// Allocate from the current block, objects reference the block they are in
+void* XmlArena::alloc(size_t size)
+{
+    unsigned int len = (size + 2 * sizeof(ArenaHeader) - 1) & ~(sizeof(ArenaHeader) - 1);
+    if (len > m_blockSize / 4) {
+	// too large, allocate it from the heap with an empty header
+	m_large++;
+	ArenaHeader* hdr = (ArenaHeader*)new char[size + sizeof(ArenaHeader)];
+	hdr->block = 0;
+	return hdr + 1;
+    }
+    ArenaBlock* block = static_cast<ArenaBlock*>(m_block);
+    if (!block || (m_used + len > m_blockSize)) {
+	if (block)
+	    block->deref();
+	block = new ArenaBlock(m_blockSize);
+	m_block = block;
+	m_used = 0;
+	m_blocks++;
+    }
+    ArenaHeader* hdr = (ArenaHeader*)(block->m_data + m_used);
+    m_used += len;
+    block->ref();
+    hdr->block = block;
+    m_objects++;
+    return hdr + 1;
+}
+
+// Release a block reference or free heap memory
+void XmlArena::release(void* ptr)
+{
+    if (!ptr)
+	return;
+    ArenaHeader* hdr = static_cast<ArenaHeader*>(ptr) - 1;
+    if (hdr->block)
+	hdr->block->deref();
+    else
+	delete[] (char*)hdr;
+}
+
+
 XmlSaxParser::XmlSaxParser(const char* name)
     : m_offset(0), m_row(1), m_column(1), m_error(NoError),
-    m_parsed(""), m_unparsed(None)
+    m_pos(0), m_unchecked(0), m_parsed(""), m_unparsed(None), m_arena(0)
 {
     debugName(name);
 }
 
 XmlSaxParser::~XmlSaxParser()
 {
+    delete m_arena;
+}
+
+// Replace the arena, objects already allocated keep their blocks
+void XmlSaxParser::setArena(unsigned int blockSize)
+{
+    if (m_arena && (m_arena->blockSize() == blockSize))
+	return;
+    delete m_arena;
+    m_arena = blockSize ? new XmlArena(blockSize) : 0;
 }
 
 // Parse a given string
@@ -132,15 +278,32 @@ bool XmlSaxParser::parse(const char* text)
     XDebug(this,DebugAll,"XmlSaxParser::parse(%s) unparsed=%u%s buf=%s [%p]",
 	text,unparsed(),tmp.safe(),m_buf.safe(),this);
 #endif
-    char car;
     setError(NoError);
-    String auxData;
+    unsigned int len = m_buf.length();
     m_buf << text;
-    if (m_buf.lenUtf8() == -1) {
-	//FIXME this should not be here in case we have a different encoding
+    m_unchecked += m_buf.length() - len;
+    // Data checked by previous calls ends on a character boundary so only
+    //  the new bytes and an incomplete character before them need checking
+    //FIXME this should not be here in case we have a different encoding
+    if (String::lenUtf8(m_buf.c_str() + m_buf.length() - m_unchecked) == -1) {
 	DDebug(this,DebugNote,"Request to parse invalid utf-8 data [%p]",this);
 	return setError(Incomplete);
     }
+    m_unchecked = 0;
+    bool ok = parseBuffer();
+    // Drop the parsed data once, the buffer keeps only what is left
+    if (m_pos) {
+	m_buf = m_buf.substr(m_pos);
+	m_pos = 0;
+    }
+    return ok;
+}
+
+// Parse the data in the main buffer starting from current position
+bool XmlSaxParser::parseBuffer()
+{
+    char car;
+    String auxData;
     if (unparsed()) {
 	if (unparsed() != Text) {
 	    if (!auxParse())
@@ -152,8 +315,8 @@ bool XmlSaxParser::parse(const char* text)
 	setUnparsed(None);
     }
     unsigned int len = 0;
-    while (m_buf.at(len) && !error()) {
-	car = m_buf.at(len);
+    while (bufAt(len) && !error()) {
+	car = bufAt(len);
 	if (car != '<' ) { // We have a new child check what it is
 	    if (car == '>' || !checkDataChar(car)) {
 		Debug(this,DebugNote,"XML text contains unescaped '%c' character [%p]",
@@ -164,51 +327,51 @@ bool XmlSaxParser::parse(const char* text)
 	    continue;
 	}
 	if (len > 0) {
-	    auxData << m_buf.substr(0,len);
+	    auxData << bufSub(0,len);
 	}
 	if (auxData.c_str()) {  // We have an end of tag or another child is riseing
 	    if (!processText(auxData))
 		return false;
-	    m_buf = m_buf.substr(len);
+	    bufSkip(len);
 	    len = 0;
 	    auxData = "";
 	}
-	char auxCar = m_buf.at(1);
+	char auxCar = bufAt(1);
 	if (!auxCar)
 	    return setError(Incomplete);
 	if (auxCar == '?') {
-	    m_buf = m_buf.substr(2);
+	    bufSkip(2);
 	    if (!parseInstruction())
 		return false;
 	    continue;
 	}
 	if (auxCar == '!') {
-	    m_buf = m_buf.substr(2);
+	    bufSkip(2);
 	    if (!parseSpecial())
 		return false;
 	    continue;
 	}
 	if (auxCar == '/') {
-	    m_buf = m_buf.substr(2);
+	    bufSkip(2);
 	    if (!parseEndTag())
 		return false;
 	    continue;
 	}
 	// If we are here mens that we have a element
 	// process an xml element
-	m_buf = m_buf.substr(1);
+	bufSkip(1);
 	if (!parseElement())
 	    return false;
     }
     // Incomplete text
-    if ((unparsed() == None || unparsed() == Text) && (auxData || m_buf)) {
+    if ((unparsed() == None || unparsed() == Text) && (auxData || bufLen())) {
 	if (!auxData)
-	    m_parsed.assign(m_buf);
+	    m_parsed.assign(bufStr(),bufLen());
 	else {
-	    auxData << m_buf;
+	    auxData.append(bufStr(),bufLen());
 	    m_parsed.assign(auxData);
 	}
-	m_buf = "";
+	bufSet(String::empty());
 	setUnparsed(Text);
 	return setError(Incomplete);
     }
@@ -216,7 +379,7 @@ bool XmlSaxParser::parse(const char* text)
 	DDebug(this,DebugNote,"Got error while parsing %s [%p]",getError(),this);
 	return false;
     }
-    m_buf = "";
+    bufSet(String::empty());
     resetParsed();
     setUnparsed(None);
     return true;
@@ -274,22 +437,22 @@ bool XmlSaxParser::parseEndTag()
 	    setUnparsed(EndTag);
 	return false;
     }
-    if (!aux || m_buf.at(0) == '/') { // The end tag has attributes or contains / char at the end of name
+    if (!aux || bufAt(0) == '/') { // The end tag has attributes or contains / char at the end of name
 	setError(ReadingEndTag);
 	Debug(this,DebugNote,"Got bad end tag </%s/> [%p]",name->c_str(),this);
 	setUnparsed(EndTag);
-	m_buf = *name + m_buf;
+	bufSet(*name + bufSub(0));
 	return false;
     }
     resetError();
     endElement(*name);
     if (error()) {
 	setUnparsed(EndTag);
-	m_buf = *name + ">";
+	bufSet(*name + ">");
 	TelEngine::destruct(name);
 	return false;
     }
-    m_buf = m_buf.substr(1);
+    bufSkip(1);
     TelEngine::destruct(name);
     return true;
 }
@@ -297,9 +460,9 @@ bool XmlSaxParser::parseEndTag()
 // Parse an instruction form the main buffer
 bool XmlSaxParser::parseInstruction()
 {
-    XDebug(this,DebugAll,"XmlSaxParser::parseInstruction() buf len=%u [%p]",m_buf.length(),this);
+    XDebug(this,DebugAll,"XmlSaxParser::parseInstruction() buf len=%u [%p]",bufLen(),this);
     setUnparsed(Instruction);
-    if (!m_buf.c_str())
+    if (!bufLen())
 	return setError(Incomplete);
     // extract the name
     String name;
@@ -308,12 +471,12 @@ bool XmlSaxParser::parseInstruction()
     if (!m_parsed) {
 	bool nameComplete = false;
 	bool endDecl = false;
-	while (0 != (c = m_buf.at(len))) {
+	while (0 != (c = bufAt(len))) {
 	    nameComplete = blank(c);
 	    if (!nameComplete) {
 		// Check for instruction end: '?>'
 		if (c == '?') {
-		    char next = m_buf.at(len + 1);
+		    char next = bufAt(len + 1);
 		    if (!next)
 			return setError(Incomplete);
 		    if (next == '>') {
@@ -338,14 +501,14 @@ bool XmlSaxParser::parseInstruction()
 	    if (!endDecl)
 		return setError(Incomplete);
 	    // Remove instruction end from buffer
-	    m_buf = m_buf.substr(2);
+	    bufSkip(2);
 	    Debug(this,DebugNote,"Instruction with empty name [%p]",this);
 	    return setError(InvalidElementName);
 	}
 	if (!nameComplete)
 	    return setError(Incomplete);
-	name = m_buf.substr(0,len);
-	m_buf = m_buf.substr(!endDecl ? len : len + 2);
+	name = bufSub(0,len);
+	bufSkip(!endDecl ? len : len + 2);
 	if (name == YSTRING("xml")) {
 	    if (!endDecl)
 		return parseDeclaration();
@@ -368,7 +531,7 @@ bool XmlSaxParser::parseInstruction()
     // Retrieve instruction content
     skipBlanks();
     len = 0;
-    while (0 != (c = m_buf.at(len))) {
+    while (0 != (c = bufAt(len))) {
 	if (c != '?') {
 	    if (c == 0x0c) {
 		setError(Unknown);
@@ -379,13 +542,13 @@ bool XmlSaxParser::parseInstruction()
 	    len++;
 	    continue;
 	}
-	char ch = m_buf.at(len + 1);
+	char ch = bufAt(len + 1);
 	if (!ch)
 	    break;
 	if (ch == '>') { // end of instruction
-	    NamedString inst(name,m_buf.substr(0,len));
+	    NamedString inst(name,bufSub(0,len));
 	    // Parsed instruction: remove instruction end from buffer and reset parsed
-	    m_buf = m_buf.substr(len + 2);
+	    bufSkip(len + 2);
 	    resetParsed();
 	    resetError();
 	    setUnparsed(None);
@@ -402,9 +565,9 @@ bool XmlSaxParser::parseInstruction()
 // Parse a declaration form the main buffer
 bool XmlSaxParser::parseDeclaration()
 {
-    XDebug(this,DebugAll,"XmlSaxParser::parseDeclaration() buf len=%u [%p]",m_buf.length(),this);
+    XDebug(this,DebugAll,"XmlSaxParser::parseDeclaration() buf len=%u [%p]",bufLen(),this);
     setUnparsed(Declaration);
-    if (!m_buf.c_str())
+    if (!bufLen())
 	return setError(Incomplete);
     NamedList dc("xml");
     if (m_parsed.count()) {
@@ -414,8 +577,8 @@ bool XmlSaxParser::parseDeclaration()
     char c;
     skipBlanks();
     int len = 0;
-    while (m_buf.at(len)) {
-	c = m_buf.at(len);
+    while (bufAt(len)) {
+	c = bufAt(len);
 	if (c != '?') {
 	    skipBlanks();
 	    NamedString* s = getAttribute();
@@ -432,7 +595,7 @@ bool XmlSaxParser::parseDeclaration()
 		return setError(DeclarationParse);
 	    }
 	    dc.addParam(s);
-	    char ch = m_buf.at(len);
+	    char ch = bufAt(len);
 	    if (ch && !blank(ch) && ch != '?') {
 		Debug(this,DebugNote,"No blanks between attributes in declaration [%p]",this);
 		return setError(DeclarationParse);
@@ -440,15 +603,15 @@ bool XmlSaxParser::parseDeclaration()
 	    skipBlanks();
 	    continue;
 	}
-	if (!m_buf.at(++len))
+	if (!bufAt(++len))
 	    break;
-	char ch = m_buf.at(len);
+	char ch = bufAt(len);
 	if (ch == '>') { // end of declaration
 	    // Parsed declaration: remove declaration end from buffer and reset parsed
 	    resetError();
 	    resetParsed();
 	    setUnparsed(None);
-	    m_buf = m_buf.substr(len + 1);
+	    bufSkip(len + 1);
 	    gotDeclaration(dc);
 	    return error() == NoError;
 	}
@@ -463,7 +626,7 @@ bool XmlSaxParser::parseDeclaration()
 // Parse a CData section form the main buffer
 bool XmlSaxParser::parseCData()
 {
-    if (!m_buf.c_str()) {
+    if (!bufLen()) {
 	setUnparsed(CData);
 	setError(Incomplete);
 	return false;
@@ -475,28 +638,27 @@ bool XmlSaxParser::parseCData()
     }
     char c;
     int len = 0;
-    while (m_buf.at(len)) {
-	c = m_buf.at(len);
+    while (bufAt(len)) {
+	c = bufAt(len);
 	if (c != ']') {
 	    len ++;
 	    continue;
 	}
-	if (m_buf.substr(++len,2) == "]>") { // End of CData section
-	    cdata += m_buf.substr(0,len - 1);
+	if (bufSub(++len,2) == "]>") { // End of CData section
+	    cdata += bufSub(0,len - 1);
 	    resetError();
 	    gotCdata(cdata);
 	    resetParsed();
 	    if (error())
 		return false;
-	    m_buf = m_buf.substr(len + 2);
+	    bufSkip(len + 2);
 	    return true;
 	}
     }
-    cdata += m_buf;
-    m_buf = "";
+    cdata.append(bufStr(),bufLen());
     setUnparsed(CData);
     int length = cdata.length();
-    m_buf << cdata.substr(length - 2);
+    bufSet(cdata.substr(length - 2));
     if (length > 1)
 	m_parsed.assign(cdata.substr(0,length - 2));
     setError(Incomplete);
@@ -506,34 +668,34 @@ bool XmlSaxParser::parseCData()
 // Helper method to classify the Xml objects starting with "<!" sequence
 bool XmlSaxParser::parseSpecial()
 {
-    if (m_buf.length() < 2) {
+    if (bufLen() < 2) {
 	setUnparsed(Special);
 	return setError(Incomplete);
     }
-    if (m_buf.startsWith("--")) {
-	m_buf = m_buf.substr(2);
+    if (bufStarts("--",2)) {
+	bufSkip(2);
 	if (!parseComment())
 	    return false;
 	return true;
     }
-    if (m_buf.length() < 7) {
+    if (bufLen() < 7) {
 	setUnparsed(Special);
 	return setError(Incomplete);
     }
-    if (m_buf.startsWith("[CDATA[")) {
-	m_buf = m_buf.substr(7);
+    if (bufStarts("[CDATA[",7)) {
+	bufSkip(7);
 	if (!parseCData())
 	    return false;
 	return true;
     }
-    if (m_buf.startsWith("DOCTYPE")) {
-	m_buf = m_buf.substr(7);
+    if (bufStarts("DOCTYPE",7)) {
+	bufSkip(7);
 	if (!parseDoctype())
 	    return false;
 	return true;
     }
     Debug(this,DebugNote,"Can't parse unknown special starting with '%s' [%p]",
-	m_buf.c_str(),this);
+	bufStr(),this);
     setError(Unknown);
     return false;
 }
@@ -549,8 +711,8 @@ bool XmlSaxParser::parseComment()
     }
     char c;
     int len = 0;
-    while (m_buf.at(len)) {
-	c = m_buf.at(len);
+    while (bufAt(len)) {
+	c = bufAt(len);
 	if (c != '-') {
 	    if (c == 0x0c) {
 		Debug(this,DebugNote,"Xml comment with unaccepted character '%c' [%p]",c,this);
@@ -559,9 +721,9 @@ bool XmlSaxParser::parseComment()
 	    len++;
 	    continue;
 	}
-	if (m_buf.at(len + 1) == '-' && m_buf.at(len + 2) == '>') { // End of comment
-	    comment << m_buf.substr(0,len);
-	    m_buf = m_buf.substr(len + 3);
+	if (bufAt(len + 1) == '-' && bufAt(len + 2) == '>') { // End of comment
+	    comment << bufSub(0,len);
+	    bufSkip(len + 3);
 #ifdef DEBUG
 	    if (comment.at(0) == '-' || comment.at(comment.length() - 1) == '-')
 		DDebug(this,DebugInfo,"Comment starts or ends with '-' character [%p]",this);
@@ -577,11 +739,11 @@ bool XmlSaxParser::parseComment()
 	len++;
     }
     // If we are here we haven't detect the end of comment
-    comment << m_buf;
+    comment.append(bufStr(),bufLen());
     int length = comment.length();
     // Keep the last 2 charaters in buffer because if the input buffer ends
     // between "--" and ">" 
-    m_buf = comment.substr(length - 2);
+    bufSet(comment.substr(length - 2));
     setUnparsed(Comment);
     if (length > 1)
 	m_parsed.assign(comment.substr(0,length - 2));
@@ -591,8 +753,8 @@ bool XmlSaxParser::parseComment()
 // Parse an element form the main buffer
 bool XmlSaxParser::parseElement()
 {
-    XDebug(this,DebugAll,"XmlSaxParser::parseElement() buf len=%u [%p]",m_buf.length(),this);
-    if (!m_buf.c_str()) {
+    XDebug(this,DebugAll,"XmlSaxParser::parseElement() buf len=%u [%p]",bufLen(),this);
+    if (!bufLen()) {
 	setUnparsed(Element);
 	return setError(Incomplete);
     }
@@ -618,37 +780,37 @@ bool XmlSaxParser::parseElement()
     }
     if (empty) { // empty flag means that the element does not have attributes
 	// check if the element is empty
-	bool aux = m_buf.at(0) == '/';
+	bool aux = bufAt(0) == '/';
 	if (!processElement(m_parsed,aux))
 	    return false;
 	if (aux)
-	    m_buf = m_buf.substr(2); // go back where we were
+	    bufSkip(2); // go back where we were
 	else
-	    m_buf = m_buf.substr(1); // go back where we were
+	    bufSkip(1); // go back where we were
 	return true;
     }
     char c;
     skipBlanks();
     int len = 0;
-    while (m_buf.at(len)) {
-	c = m_buf.at(len);
+    while (bufAt(len)) {
+	c = bufAt(len);
 	if (c == '/' || c == '>') { // end of element declaration
 	    if (c == '>') {
 		if (!processElement(m_parsed,false))
 		    return false;
-		m_buf = m_buf.substr(1);
+		bufSkip(1);
 		return true;
 	    }
-	    if (!m_buf.at(++len))
+	    if (!bufAt(++len))
 		break;
-	    char ch = m_buf.at(len);
+	    char ch = bufAt(len);
 	    if (ch != '>') {
 		Debug(this,DebugNote,"Element attribute name contains '/' character [%p]",this);
 		return setError(ReadingAttributes);
 	    }
 	    if (!processElement(m_parsed,true))
 		return false;
-	    m_buf = m_buf.substr(len + 1);
+	    bufSkip(len + 1);
 	    return true;
 	}
 	NamedString* ns = getAttribute();
@@ -665,7 +827,7 @@ bool XmlSaxParser::parseElement()
 	XDebug(this,DebugAll,"Parser adding attribute %s='%s' to '%s' [%p]",
 	    ns->name().c_str(),ns->c_str(),m_parsed.c_str(),this);
 	m_parsed.setParam(ns);
-	char ch = m_buf.at(len);
+	char ch = bufAt(len);
 	if (ch && !blank(ch) && (ch != '/' && ch != '>')) {
 	    Debug(this,DebugNote,"Element without blanks between attributes [%p]",this);
 	    return setError(NotWellFormed);
@@ -679,44 +841,44 @@ bool XmlSaxParser::parseElement()
 // Parse a doctype form the main buffer
 bool XmlSaxParser::parseDoctype()
 {
-    if (!m_buf.c_str()) {
+    if (!bufLen()) {
 	setUnparsed(Doctype);
 	setError(Incomplete);
 	return false;
     }
     unsigned int len = 0;
     skipBlanks();
-    while (m_buf.at(len) && !blank(m_buf.at(len)))
+    while (bufAt(len) && !blank(bufAt(len)))
 	len++;
     // Use a while() to break to the end
-    while (m_buf.at(len)) {
-	while (m_buf.at(len) && blank(m_buf.at(len)))
+    while (bufAt(len)) {
+	while (bufAt(len) && blank(bufAt(len)))
 	    len++;
-	if (len >= m_buf.length())
+	if (len >= bufLen())
 	   break;
-	if (m_buf[len++] == '[') {
-	    while (len < m_buf.length()) {
-		if (m_buf[len] != ']') {
+	if (bufAt(len++) == '[') {
+	    while (len < bufLen()) {
+		if (bufAt(len) != ']') {
 		    len ++;
 		    continue;
 		}
-		if (m_buf.at(++len) != '>')
+		if (bufAt(++len) != '>')
 		    continue;
-		gotDoctype(m_buf.substr(0,len));
+		gotDoctype(bufSub(0,len));
 		resetParsed();
-		m_buf = m_buf.substr(len + 1);
+		bufSkip(len + 1);
 		return true;
 	    }
 	    break;
 	}
-	while (len < m_buf.length()) {
-	    if (m_buf[len] != '>') {
+	while (len < bufLen()) {
+	    if (bufAt(len) != '>') {
 		len++;
 		continue;
 	    }
-	    gotDoctype(m_buf.substr(0,len));
+	    gotDoctype(bufSub(0,len));
 	    resetParsed();
-	    m_buf = m_buf.substr(len + 1);
+	    bufSkip(len + 1);
 	    return true;
 	}
 	break;
@@ -732,31 +894,31 @@ String* XmlSaxParser::extractName(bool& empty)
     unsigned int len = 0;
     bool ok = false;
     empty = false;
-    while (len < m_buf.length()) {
-	char c = m_buf[len];
+    while (len < bufLen()) {
+	char c = bufAt(len);
 	if (blank(c)) {
-	    if (checkFirstNameCharacter(m_buf[0])) {
+	    if (checkFirstNameCharacter(bufAt(0))) {
 		ok = true;
 		break;
 	    }
 	    Debug(this,DebugNote,"Element tag starting with invalid char %c [%p]",
-		m_buf[0],this);
+		bufAt(0),this);
 	    setError(ReadElementName);
 	    return 0;
 	}
 	if (c == '/' || c == '>') { // end of element declaration
 	    if (c == '>') {
-		if (checkFirstNameCharacter(m_buf[0])) {
+		if (checkFirstNameCharacter(bufAt(0))) {
 		    empty = true;
 		    ok = true;
 		    break;
 		}
 		Debug(this,DebugNote,"Element tag starting with invalid char %c [%p]",
-		    m_buf[0],this);
+		    bufAt(0),this);
 		setError(ReadElementName);
 		return 0;
 	    }
-	    char ch = m_buf.at(len + 1);
+	    char ch = bufAt(len + 1);
 	    if (!ch)
 		break;
 	    if (ch != '>') {
@@ -764,13 +926,13 @@ String* XmlSaxParser::extractName(bool& empty)
 		setError(ReadElementName);
 		return 0;
 	    }
-	    if (checkFirstNameCharacter(m_buf[0])) {
+	    if (checkFirstNameCharacter(bufAt(0))) {
 		empty = true;
 		ok = true;
 		break;
 	    }
 	    Debug(this,DebugNote,"Element tag starting with invalid char %c [%p]",
-		m_buf[0],this);
+		bufAt(0),this);
 	    setError(ReadElementName);
 	    return 0;
 	}
@@ -783,12 +945,12 @@ String* XmlSaxParser::extractName(bool& empty)
 	}
     }
     if (ok) {
-	String* name = new String(m_buf.substr(0,len));
-	m_buf = m_buf.substr(len);
+	String* name = new String(bufSub(0,len));
+	bufSkip(len);
 	if (!empty) {
 	    skipBlanks();
-	    empty = (m_buf && m_buf[0] == '>') ||
-		(m_buf.length() > 1 && m_buf[0] == '/' && m_buf[1] == '>');
+	    empty = (bufAt(0) == '>') ||
+		(bufLen() > 1 && bufAt(0) == '/' && bufAt(1) == '>');
 	}
 	return name;
     }
@@ -804,11 +966,11 @@ NamedString* XmlSaxParser::getAttribute()
     char c,sep = 0;
     unsigned int len = 0;
 
-    while (len < m_buf.length()) { // Circle until we find attribute value startup character (["]|['])
-	c = m_buf[len];
+    while (len < bufLen()) { // Circle until we find attribute value startup character (["]|['])
+	c = bufAt(len);
 	if (blank(c) || c == '=') {
 	    if (!name.c_str())
-		name = m_buf.substr(0,len);
+		name = bufSub(0,len);
 	    len++;
 	    continue;
 	}
@@ -842,8 +1004,8 @@ NamedString* XmlSaxParser::getAttribute()
     }
     int pos = ++len;
 
-    while (len < m_buf.length()) {
-	c = m_buf[len];
+    while (len < bufLen()) {
+	c = bufAt(len);
 	if (c != sep && !badCharacter(c)) {
 	    len ++;
 	    continue;
@@ -854,8 +1016,12 @@ NamedString* XmlSaxParser::getAttribute()
 	    setError(ReadingAttributes);
 	    return 0;
 	}
-	NamedString* ns = new NamedString(name,m_buf.substr(pos,len - pos));
-	m_buf = m_buf.substr(len + 1);
+	NamedString* ns = 0;
+	if (m_arena)
+	    ns = new (m_arena) ArenaString(name,bufSub(pos,len - pos));
+	else
+	    ns = new NamedString(name,bufSub(pos,len - pos));
+	bufSkip(len + 1);
 	// End of attribute value
 	unEscape(*ns);
 	if (error()) {
@@ -877,6 +1043,8 @@ void XmlSaxParser::reset()
     m_column = 1;
     m_error = NoError;
     m_buf.clear();
+    m_pos = 0;
+    m_unchecked = 0;
     resetParsed();
     m_unparsed = None;
 }
@@ -905,10 +1073,31 @@ bool XmlSaxParser::checkNameCharacter(unsigned char ch)
 void XmlSaxParser::skipBlanks()
 {
     unsigned int len = 0;
-    while (len < m_buf.length() && blank(m_buf[len]))
+    while (len < bufLen() && blank(bufAt(len)))
 	len++;
     if (len != 0)
-	m_buf = m_buf.substr(len);
+	bufSkip(len);
+}
+
+// Consume data from the main buffer
+void XmlSaxParser::bufSkip(unsigned int len)
+{
+    m_pos += len;
+    if (m_pos > m_buf.length())
+	m_pos = m_buf.length();
+}
+
+// Replace the data not parsed yet
+void XmlSaxParser::bufSet(const String& data)
+{
+    m_buf = data;
+    m_pos = 0;
+}
+
+// Check if the data not parsed yet starts with a given sequence
+bool XmlSaxParser::bufStarts(const char* what, unsigned int len) const
+{
+    return (bufLen() >= len) && !::strncmp(bufStr(),what,len);
 }
 
 // Obtain a char from an ascii decimal char declaration
@@ -1121,7 +1310,7 @@ XmlDomParser::~XmlDomParser()
 // Create a new xml comment and append it in the xml three
 void XmlDomParser::gotComment(const String& text)
 {
-    XmlComment* com = new XmlComment(text);
+    XmlComment* com = m_arena ? new (m_arena) ArenaComment(text) : new XmlComment(text);
     if (m_current)
 	setError(m_current->addChild(com),com);
     else
@@ -1183,7 +1372,7 @@ void XmlDomParser::gotDeclaration(const NamedList& decl)
 // Create a new xml text and append it in the xml tree
 void XmlDomParser::gotText(const String& text)
 {
-    XmlText* tet = new XmlText(text);
+    XmlText* tet = m_arena ? new (m_arena) ArenaText(text) : new XmlText(text);
     if (m_current)
 	m_current->addChild(tet);
     else
@@ -1193,7 +1382,7 @@ void XmlDomParser::gotText(const String& text)
 // Create a new xml Cdata and append it in the xml tree
 void XmlDomParser::gotCdata(const String& data)
 {
-    XmlCData* cdata = new XmlCData(data);
+    XmlCData* cdata = m_arena ? new (m_arena) ArenaCData(data) : new XmlCData(data);
     if (!m_current) {
 	if (m_data->document()) {
 	    Debug(this,DebugNote,"Document got CDATA outside element [%p]",this);
@@ -1214,18 +1403,18 @@ void XmlDomParser::gotElement(const NamedList& elem, bool empty)
     if (!m_current) {
 	// If we don't have curent element menns that the main fragment
 	// should hold it
-	element = new XmlElement(elem,empty);
+	element = createElement(elem,empty);
 	setError(m_data->addChild(element),element);
 	if (!empty && error() == XmlSaxParser::NoError)
 	    m_current = element;
     }
     else {
 	if (empty) {
-	    element = new XmlElement(elem,empty);
+	    element = createElement(elem,empty);
 	    setError(m_current->addChild(element),element);
 	}
 	else {
-	    element = new XmlElement(elem,empty,m_current);
+	    element = createElement(elem,empty,m_current);
 	    setError(m_current->addChild(element),element);
 	    if (error() == XmlSaxParser::NoError)
 		m_current = element;
@@ -1233,6 +1422,21 @@ void XmlDomParser::gotElement(const NamedList& elem, bool empty)
     }
 }
 
+// Build a new element. When using an arena move the parsed attributes to it
+XmlElement* XmlDomParser::createElement(const NamedList& elem, bool empty, XmlParent* parent)
+{
+    if (!m_arena || (&elem != &m_parsed))
+	return new XmlElement(elem,empty,parent);
+    XmlElement* element = new (m_arena) ArenaElement(elem.c_str(),empty);
+    element->m_empty = empty;
+    while (NamedString* ns = m_parsed.getParam(0u)) {
+	m_parsed.clearParam(ns,false);
+	element->m_element.addParam(ns);
+    }
+    element->setParent(parent);
+    return element;
+}
+
 // Verify if is the closeing tag for the current element
 // Complete th current element and make current the current parent
 void XmlDomParser::endElement(const String& name)
@@ -48,6 +48,7 @@
  */
 namespace TelEngine {
 
+class XmlArena;
 class XmlSaxParser;
 class XmlDomParser;
 class XmlDeclaration;
@@ -74,6 +75,84 @@ struct YXML_API XmlEscape {
     char replace;
 };
 
+/**
+ * This class hands out memory for the objects built by a parser from large
+ *  blocks so all the objects of a stanza need only a few heap allocations.
+ * Each object allocated from a block holds a reference to it. A block is
+ *  released when the arena and all objects allocated from it are gone so
+ *  objects may outlive the arena and may be destroyed by any thread.
+ * A single object kept alive pins its whole block. Objects meant to be kept
+ *  for long should be copied out of the arena (e.g. new XmlElement(*elem)),
+ *  copies are always allocated from the heap.
+ * The arena itself must be used by a single thread at a time.
+ * @short Block allocator for parsed XML objects
+ */
+class YXML_API XmlArena
+{
+    YNOCOPY(XmlArena); // no automatic copies please
+public:
+    /**
+     * Constructor
+     * @param blockSize Size of the memory blocks to allocate
+     */
+    XmlArena(unsigned int blockSize = 4096);
+
+    /**
+     * Destructor. Releases the current block
+     */
+    ~XmlArena();
+
+    /**
+     * Allocate memory from the current block, get a new block if it's full.
+     * Objects larger than a quarter of the block are allocated from the heap
+     * @param size Number of bytes to allocate
+     * @return Pointer to memory that must be returned by calling release()
+     */
+    void* alloc(size_t size);
+
+    /**
+     * Release memory obtained from alloc()
+     * @param ptr Pointer to the memory to release, may be 0
+     */
+    static void release(void* ptr);
+
+    /**
+     * Retrieve the size of the memory blocks
+     * @return Size in bytes of the blocks allocated by this arena
+     */
+    inline unsigned int blockSize() const
+	{ return m_blockSize; }
+
+    /**
+     * Retrieve the number of objects allocated from blocks
+     * @return Number of objects allocated from this arena's blocks
+     */
+    inline unsigned int objects() const
+	{ return m_objects; }
+
+    /**
+     * Retrieve the number of blocks obtained from the heap
+     * @return Number of blocks allocated by this arena
+     */
+    inline unsigned int blocks() const
+	{ return m_blocks; }
+
+    /**
+     * Retrieve the number of objects too large to fit in a block
+     * @return Number of objects this arena allocated from the heap
+     */
+    inline unsigned int large() const
+	{ return m_large; }
+
+private:
+    RefObject* m_block;
+    unsigned int m_blockSize;
+    unsigned int m_used;
+    unsigned int m_objects;
+    unsigned int m_blocks;
+    unsigned int m_large;
+};
+
 /**
  * A Serial Access Parser (SAX) for arbitrary XML data
  * @short Serial Access XML Parser
@@ -197,6 +276,20 @@ public:
     inline void setUnparsed(Type id)
 	{ m_unparsed = id;}
 
+    /**
+     * Retrieve the arena the parsed objects are allocated from
+     * @return Pointer to the arena, 0 if objects are allocated from the heap
+     */
+    inline XmlArena* arena() const
+	{ return m_arena; }
+
+    /**
+     * Allocate the objects built by this parser from the blocks of an arena.
+     * Objects already allocated are not affected
+     * @param blockSize Size of the arena blocks, 0 to allocate objects from the heap
+     */
+    void setArena(unsigned int blockSize);
+
     /**
      * Reset error flag
      */
@@ -500,6 +593,16 @@ protected:
      */
     String m_buf;
 
+    /**
+     * Offset in the main buffer of the first byte not yet parsed
+     */
+    unsigned int m_pos;
+
+    /**
+     * Number of bytes at the end of the main buffer not yet checked for valid UTF-8
+     */
+    unsigned int m_unchecked;
+
     /**
      * The parser data holder.
      * Keeps the parsed data when an incomplete xml object is found
@@ -510,6 +613,28 @@ protected:
      * The last parsed xml object code
      */
     Type m_unparsed;
+
+    /**
+     * The arena used to allocate parsed objects, 0 to use the heap
+     */
+    XmlArena* m_arena;
+
+private:
+    bool parseBuffer();
+    // Character at an offset from the parse position, 0 past the end of data
+    inline char bufAt(unsigned int offs) const
+	{ return (m_pos + offs < m_buf.length()) ? m_buf.c_str()[m_pos + offs] : 0; }
+    // Length of data not parsed yet
+    inline unsigned int bufLen() const
+	{ return m_buf.length() - m_pos; }
+    // Start of data not parsed yet, never NULL
+    inline const char* bufStr() const
+	{ return m_buf.safe() + m_pos; }
+    inline String bufSub(unsigned int offs, int len = -1) const
+	{ return m_buf.substr(m_pos + offs,len); }
+    bool bufStarts(const char* what, unsigned int len) const;
+    void bufSkip(unsigned int len);
+    void bufSet(const String& data);
 };
 
 /**
@@ -725,6 +850,7 @@ protected:
 	{ return m_current == 0; }
 
 private:
+    XmlElement* createElement(const NamedList& elem, bool empty, XmlParent* parent = 0);
     XmlElement* m_current;                   // The current xml element
     XmlParent* m_data;                       // Main xml fragment
     bool m_ownData;                          // The DOM owns data
@@ -1097,6 +1223,7 @@ private:
 class YXML_API XmlElement : public XmlChild, public XmlParent
 {
     YCLASS(XmlElement,XmlChild)
+    friend class XmlDomParser;
 public:
     /**
      * Constructor
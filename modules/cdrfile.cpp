@@ -29,13 +29,18 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <stdio.h>
 
 #ifdef _WINDOWS
 #define EOLN "\r\n"
 #else
+#include <sys/uio.h>
 #define EOLN "\n"
 #endif
 
+// maximum number of records written with a single system call
+#define WRITE_CHUNK 256
+
 using namespace TelEngine;
 namespace { // anonymous
 
@@ -53,39 +58,151 @@ private:
 
 INIT_PLUGIN(CdrFilePlugin);
 
-class CdrFileHandler : public MessageHandler, public Mutex
+class CdrFileWriter : public Thread
 {
 public:
-    CdrFileHandler(const char *name)
-	: MessageHandler(name,100,__plugin.name()),
-	  Mutex(false,"CdrFileHandler"),
-	  m_file(-1), m_combined(false)
+    inline CdrFileWriter(CdrFileHandler* handler)
+	: Thread("CDR File Writer"),
+	  m_handler(handler)
 	{ }
+    virtual void run();
+    virtual void cleanup();
+private:
+    CdrFileHandler* m_handler;
+};
+
+class CdrFileHandler : public MessageHandler, public Mutex
+{
+    friend class CdrFileWriter;
+public:
+    enum Sync {
+	SyncNone,
+	SyncWrite,
+	SyncRotate,
+    };
+    CdrFileHandler(const char *name, unsigned int queue);
     virtual ~CdrFileHandler();
     virtual bool received(Message &msg);
-    void init(const char *fname, bool tabsep, bool combined, const char* format);
+    void init(const char *fname, bool tabsep, bool combined, const char* format,
+	const NamedList& params);
+    void status(String& str);
 private:
+    void writeQueued();
+    void writeRecords(String** recs, unsigned int count);
+    void openFile();
+    void closeFile();
+    void rotate();
     int m_file;
     bool m_combined;
     String m_format;
+    // records waiting for the writer thread
+    String** m_ring;
+    unsigned int m_size;
+    unsigned int m_head;
+    unsigned int m_count;
+    unsigned int m_peak;
+    unsigned int m_written;
+    unsigned int m_dropped;
+    unsigned int m_errors;
+    bool m_dropping;
+    Semaphore m_wake;
+    CdrFileWriter* m_writer;
+    // file and write policy, protected by the file mutex
+    Mutex m_fileMutex;
+    String m_fileName;
+    int m_sync;
+    unsigned int m_flush;
+    unsigned int m_rotateTime;
+    u_int64_t m_rotateSize;
+    unsigned int m_opened;
+    u_int64_t m_fileSize;
 };
 
-CdrFileHandler::~CdrFileHandler()
+class StatusHandler : public MessageHandler
 {
-    Lock lock(this);
-    if (m_file >= 0) {
-	::close(m_file);
-	m_file = -1;
+public:
+    StatusHandler(CdrFileHandler* handler)
+	: MessageHandler("engine.status",100,__plugin.name()),
+	  m_handler(handler)
+	{ }
+    virtual bool received(Message &msg);
+private:
+    CdrFileHandler* m_handler;
+};
+
+static const TokenDict s_sync[] = {
+    { "none",   CdrFileHandler::SyncNone },
+    { "write",  CdrFileHandler::SyncWrite },
+    { "rotate", CdrFileHandler::SyncRotate },
+    { 0, 0 }
+};
+
+
+void CdrFileWriter::run()
+{
+    u_int64_t next = 0;
+    while (!Thread::check(false)) {
+	// wake up often enough to notice a cancel request
+	if (!m_handler->m_wake.lock(Thread::idleUsec()) && (Time::now() < next))
+	    continue;
+	m_handler->writeQueued();
+	next = Time::now() + 1000 * (u_int64_t)m_handler->m_flush;
     }
+    // write everything still queued before exiting
+    m_handler->writeQueued();
 }
 
-void CdrFileHandler::init(const char *fname, bool tabsep, bool combined, const char* format)
+void CdrFileWriter::cleanup()
 {
-    Lock lock(this);
-    if (m_file >= 0) {
-	::close(m_file);
-	m_file = -1;
+    Lock lock(m_handler);
+    if (m_handler->m_writer == this)
+	m_handler->m_writer = 0;
+}
+
+
+CdrFileHandler::CdrFileHandler(const char *name, unsigned int queue)
+    : MessageHandler(name,100,__plugin.name()),
+      Mutex(false,"CdrFileHandler"),
+      m_file(-1), m_combined(false),
+      m_ring(0), m_size(queue), m_head(0), m_count(0), m_peak(0),
+      m_written(0), m_dropped(0), m_errors(0), m_dropping(false),
+      m_wake(1,"CdrFileWriter"), m_writer(0),
+      m_fileMutex(false,"CdrFile"),
+      m_sync(SyncNone), m_flush(500), m_rotateTime(0), m_rotateSize(0),
+      m_opened(0), m_fileSize(0)
+{
+    if (!m_size)
+	return;
+    m_ring = new String*[m_size];
+    m_writer = new CdrFileWriter(this);
+    if (!m_writer->startup()) {
+	Debug(DebugWarn,"Failed to start CDR writer thread, writing synchronously");
+	delete m_writer;
+	m_writer = 0;
+	delete[] m_ring;
+	m_ring = 0;
+	m_size = 0;
     }
+}
+
+CdrFileHandler::~CdrFileHandler()
+{
+    lock();
+    if (m_writer)
+	m_writer->cancel();
+    unlock();
+    while (m_writer)
+	Thread::idle();
+    writeQueued();
+    delete[] m_ring;
+    Lock lock(m_fileMutex);
+    closeFile();
+}
+
+void CdrFileHandler::init(const char *fname, bool tabsep, bool combined, const char* format,
+    const NamedList& params)
+{
+    Lock lock(this);
     m_format = format;
     m_combined = combined;
     if (m_format.null()) {
@@ -107,12 +224,16 @@ void CdrFileHandler::init(const char *fname, bool tabsep, bool combined, const c
 		    ",${billtime},${ringtime},${duration},\"${direction}\",\"${status}\",\"${reason}\""
 	      );
     }
-    if (fname) {
-	m_file = ::open(fname,O_WRONLY|O_CREAT|O_APPEND|O_LARGEFILE,0640);
-	if (m_file < 0)
-	    Debug(DebugWarn,"Failed to open or create '%s': %s (%d)",
-		fname,::strerror(errno),errno);
-    }
+    // never hold both locks, the writer takes the file mutex first
+    lock.drop();
+    Lock flock(m_fileMutex);
+    closeFile();
+    m_fileName = fname;
+    m_sync = params.getIntValue(YSTRING("fsync"),s_sync,SyncNone);
+    m_flush = params.getIntValue(YSTRING("flush"),500,10,60000);
+    m_rotateTime = params.getIntValue(YSTRING("rotate_interval"),0,0);
+    m_rotateSize = params.getIntValue(YSTRING("rotate_size"),0,0);
+    openFile();
 }
 
 bool CdrFileHandler::received(Message &msg)
@@ -125,16 +246,223 @@ bool CdrFileHandler::received(Message &msg)
     if (!msg.getBoolValue("cdrwrite",true))
         return false;
 
-    Lock lock(this);
-    if ((m_file >= 0) && m_format) {
-	String str = m_format;
-	str += EOLN;
-	msg.replaceParams(str);
-	::write(m_file,str.c_str(),str.length());
+    lock();
+    String* str = m_format ? new String(m_format) : 0;
+    unlock();
+    if (!str)
+	return false;
+    *str += EOLN;
+    msg.replaceParams(*str);
+    lock();
+    if (m_writer) {
+	if (m_count < m_size) {
+	    m_ring[(m_head + m_count) % m_size] = str;
+	    if (++m_count > m_peak)
+		m_peak = m_count;
+	    // wake up the writer early if the queue fills up
+	    if (m_count == m_size / 2)
+		m_wake.unlock();
+	    m_dropping = false;
+	    unlock();
+	    return false;
+	}
+	m_dropped++;
+	if (!m_dropping)
+	    Debug(DebugWarn,"CDR queue is full, dropping records");
+	m_dropping = true;
+	unlock();
+	TelEngine::destruct(str);
+	return false;
     }
+    unlock();
+    // no writer thread, write synchronously
+    Lock flock(m_fileMutex);
+    writeRecords(&str,1);
     return false;
 };
 
+// Write all the queued records, rotate the file if it's time
+void CdrFileHandler::writeQueued()
+{
+    String* recs[WRITE_CHUNK];
+    for (;;) {
+	lock();
+	unsigned int n = 0;
+	while (m_count && (n < WRITE_CHUNK)) {
+	    recs[n++] = m_ring[m_head];
+	    if (++m_head >= m_size)
+		m_head = 0;
+	    m_count--;
+	}
+	unlock();
+	Lock flock(m_fileMutex);
+	if (!n) {
+	    if (m_rotateTime && m_opened && (Time::secNow() >= m_opened + m_rotateTime))
+		rotate();
+	    break;
+	}
+	writeRecords(recs,n);
+    }
+}
+
+// Write a group of records with as few calls as possible, consume them
+// The file mutex must be locked
+void CdrFileHandler::writeRecords(String** recs, unsigned int count)
+{
+    if ((m_rotateTime && m_opened && (Time::secNow() >= m_opened + m_rotateTime)) ||
+	(m_rotateSize && (m_fileSize >= m_rotateSize)))
+	rotate();
+    // bytes and records that made it to the file
+    u_int64_t len = 0;
+    unsigned int done = 0;
+    if (m_file >= 0) {
+#ifdef _WINDOWS
+	String buf;
+	for (unsigned int i = 0; i < count; i++)
+	    buf += *recs[i];
+	unsigned int ofs = 0;
+	while (ofs < buf.length()) {
+	    int res = ::write(m_file,buf.c_str() + ofs,buf.length() - ofs);
+	    if (res <= 0) {
+		if ((res < 0) && (errno == EINTR))
+		    continue;
+		break;
+	    }
+	    ofs += res;
+	}
+	len = ofs;
+	// count records by how much of their text was written
+	for (unsigned int pos = 0; done < count; done++) {
+	    pos += recs[done]->length();
+	    if (pos > ofs)
+		break;
+	}
+#else
+	struct iovec iov[WRITE_CHUNK];
+	bool ok = true;
+	while (ok && (done < count)) {
+	    unsigned int n = 0;
+	    for (; (n < WRITE_CHUNK) && (done + n < count); n++) {
+		iov[n].iov_base = (void*)recs[done + n]->c_str();
+		iov[n].iov_len = recs[done + n]->length();
+	    }
+	    // writev may write less than requested, go on with what is left
+	    struct iovec* v = iov;
+	    while (n) {
+		int res = ::writev(m_file,v,n);
+		if (res < 0) {
+		    if (errno == EINTR)
+			continue;
+		    ok = false;
+		    break;
+		}
+		len += res;
+		size_t w = res;
+		unsigned int left = n;
+		while (n && (w >= v->iov_len)) {
+		    w -= v->iov_len;
+		    v++;
+		    n--;
+		    done++;
+		}
+		if (n) {
+		    v->iov_base = (char*)v->iov_base + w;
+		    v->iov_len -= w;
+		}
+		// nothing written and nothing consumed, don't spin
+		if (!res && (left == n)) {
+		    ok = false;
+		    break;
+		}
+	    }
+	}
+#endif
+	if (len && (m_sync == SyncWrite))
+	    ::fsync(m_file);
+    }
+    for (unsigned int i = 0; i < count; i++)
+	TelEngine::destruct(recs[i]);
+    Lock lock(this);
+    m_written += done;
+    m_fileSize += len;
+    m_errors += count - done;
+}
+
+// Open or create the file, the file mutex must be locked
+void CdrFileHandler::openFile()
+{
+    if ((m_file >= 0) || m_fileName.null())
+	return;
+    m_file = ::open(m_fileName,O_WRONLY|O_CREAT|O_APPEND|O_LARGEFILE,0640);
+    if (m_file < 0) {
+	Debug(DebugWarn,"Failed to open or create '%s': %s (%d)",
+	    m_fileName.c_str(),::strerror(errno),errno);
+	return;
+    }
+    m_opened = Time::secNow();
+    struct stat st;
+    m_fileSize = ::fstat(m_file,&st) ? 0 : st.st_size;
+}
+
+// Close the file, the file mutex must be locked
+void CdrFileHandler::closeFile()
+{
+    if (m_file < 0)
+	return;
+    if (m_sync != SyncNone)
+	::fsync(m_file);
+    ::close(m_file);
+    m_file = -1;
+    m_opened = 0;
+}
+
+// Rename the file to a timestamped name and start a new one
+// The file mutex must be locked
+void CdrFileHandler::rotate()
+{
+    if (m_file < 0)
+	return;
+    closeFile();
+    int year;
+    unsigned int month, day, hour, minute, sec;
+    char buf[32];
+    if (Time::toDateTime(Time::secNow(),year,month,day,hour,minute,sec))
+	::sprintf(buf,".%04d%02u%02u-%02u%02u%02u",year,month,day,hour,minute,sec);
+    else
+	::sprintf(buf,".%u",Time::secNow());
+    String name = m_fileName + buf;
+    // never overwrite a file rotated in the same second
+    for (unsigned int i = 1; File::exists(name); i++)
+	(name = m_fileName) << buf << "." << i;
+    int error = 0;
+    if (File::rename(m_fileName,name,&error))
+	Debug(DebugInfo,"Rotated CDR file to '%s'",name.c_str());
+    else
+	Debug(DebugWarn,"Failed to rotate CDR file to '%s': %s (%d)",
+	    name.c_str(),::strerror(error),error);
+    openFile();
+}
+
+void CdrFileHandler::status(String& str)
+{
+    Lock lock(this);
+    str << ";queued=" << m_count << ",maxqueued=" << m_peak << ",queue=" << m_size;
+    str << ",written=" << m_written << ",dropped=" << m_dropped << ",errors=" << m_errors;
+}
+
+
+bool StatusHandler::received(Message &msg)
+{
+    const String* sel = msg.getParam(YSTRING("module"));
+    if (!(TelEngine::null(sel) || (*sel == YSTRING("cdrfile"))))
+	return false;
+    String st("name=cdrfile,type=cdr");
+    m_handler->status(st);
+    msg.retValue() << st << "\r\n";
+    return false;
+}
+
+
 CdrFilePlugin::CdrFilePlugin()
     : Plugin("cdrfile",true),
       m_handler(0)
@@ -154,12 +482,17 @@ void CdrFilePlugin::initialize()
     String file = cfg.getValue("general","file");
     Engine::self()->runParams().replaceParams(file);
     if (file && !m_handler) {
-	m_handler = new CdrFileHandler("call.cdr");
+	// the queue size can be set only at first initialization
+	m_handler = new CdrFileHandler("call.cdr",cfg.getIntValue("general","queue",4096,0,1000000));
 	Engine::install(m_handler);
+	Engine::install(new StatusHandler(m_handler));
     }
-    if (m_handler)
+    if (m_handler) {
+	const NamedList* gen = cfg.getSection("general");
 	m_handler->init(file,cfg.getBoolValue("general","tabs",true),
-	    cfg.getBoolValue("general","combined",false),cfg.getValue("general","format"));
+	    cfg.getBoolValue("general","combined",false),cfg.getValue("general","format"),
+	    gen ? *gen : NamedList::empty());
+    }
 }
 
 }; // anonymous namespace
@@ -32,6 +32,8 @@ namespace { // anonymous
 
 #define DEFAULT_RULE "^\\(false\\|no\\|off\\|disable\\|f\\|0*\\)$^"
 #define BLOCK_STACK 10
+// Minimum number of consecutive literal prefix rules indexed in a trie
+#define PREFIX_RUN_MIN 8
 
 static Configuration s_cfg;
 static const char* s_trackName = 0;
@@ -41,6 +43,7 @@ static bool s_prerouteall;
 static int s_maxDepth = 5;
 static String s_defRule;
 static Mutex s_mutex(true,"RegexRoute");
+static Mutex s_varsMutex(true,"RegexRoute::vars");
 static ObjList s_extra;
 static NamedList s_vars("");
 static int s_dispatching = 0;
@@ -144,8 +147,10 @@ static void mathOper(String& str, String& par, int sep, int oper)
     }
 }
 
+// evaluate a function, variables are shared by all routing threads
 static void evalFunc(String& str, Message& msg)
 {
+    Lock lock(s_varsMutex);
     if (str.null())
 	str = ";";
     else if (str == "$")
@@ -383,6 +388,8 @@ static void setMessage(const String& match, Message& msg, String& line, Message*
 {
     if (!target)
 	target = &msg;
+    // evaluate and assign variables as a whole, like $x=$(++$x)
+    Lock lock(s_varsMutex);
     ObjList *strs = line.split(';');
     bool first = true;
     for (ObjList *p = strs; p; p=p->next()) {
@@ -438,69 +445,510 @@ static void setDefault(Regexp& reg)
     }
 }
 
-// helper function to process one match attempt
-static bool oneMatch(Message& msg, Regexp& reg, String& match, const String& context, unsigned int rule)
+// One match condition of a rule, parsed and compiled once at load time
+class RouteMatch : public GenObject
 {
+public:
+    enum Link {
+	Primary,
+	If,
+	And,
+	Or
+    };
+    RouteMatch(Link link, const String& rule, const String& context, unsigned int line);
+    bool matches(Message& msg, String& match) const;
+    inline Link link() const
+	{ return m_link; }
+    inline const String& regexp() const
+	{ return m_regexp; }
+    inline const String& param() const
+	{ return m_param; }
+    inline const String& defValue() const
+	{ return m_default; }
+    inline bool function() const
+	{ return m_function; }
+    bool literalPrefix(String& prefix) const;
+    const String& subject(const Message& msg, const String& str) const;
+private:
+    Link m_link;
+    bool m_valid;
+    bool m_negate;
+    bool m_function;
+    String m_param;
+    String m_default;
+    Regexp m_regexp;
+};
+
+// One line of a context: block markers, match conditions and the action
+class RouteRule : public GenObject
+{
+public:
+    RouteRule(const NamedString& line, unsigned int index, const String& context);
+    bool matches(Message& msg, const String& str, String& match, const String& context) const;
+    inline const String& name() const
+	{ return m_name; }
+    inline const String& action() const
+	{ return m_action; }
+    inline unsigned int line() const
+	{ return m_line; }
+    inline bool blockEnd() const
+	{ return m_blockEnd; }
+    inline bool blockStart() const
+	{ return m_blockStart; }
+    inline const RouteMatch* primary() const
+	{ return static_cast<const RouteMatch*>(m_conds.get()); }
+    inline const String& prefix() const
+	{ return m_prefix; }
+    bool sameSubject(const RouteRule* other) const;
+private:
+    String m_name;
+    String m_action;
+    String m_prefix;
+    unsigned int m_line;
+    bool m_blockEnd;
+    bool m_blockStart;
+    bool m_broken;
+    ObjList m_conds;
+};
+
+// Node of a literal prefix trie, holds the rules whose prefix ends here
+class PrefixNode
+{
+public:
+    inline PrefixNode(char c, PrefixNode* next)
+	: m_char(c), m_child(0), m_next(next), m_rules(0), m_count(0)
+	{ }
+    ~PrefixNode();
+    PrefixNode* child(char c) const;
+    PrefixNode* addChild(char c);
+    void addRule(unsigned int index);
+    unsigned int first(unsigned int from) const;
+private:
+    char m_char;
+    PrefixNode* m_child;
+    PrefixNode* m_next;
+    unsigned int* m_rules;
+    unsigned int m_count;
+};
+
+// A run of consecutive rules matching literal prefixes of the same subject
+//  indexed in a trie so only the rules that can possibly match are tried
+class PrefixRun : public GenObject
+{
+public:
+    PrefixRun(const RouteMatch* subject, unsigned int start);
+    inline ~PrefixRun()
+	{ delete m_root; }
+    inline unsigned int end() const
+	{ return m_end; }
+    void append(const RouteRule* rule);
+    unsigned int next(const Message& msg, const String& str, unsigned int from) const;
+private:
+    const RouteMatch* m_subject;
+    PrefixNode* m_root;
+    unsigned int m_end;
+};
+
+// The rules of one context in configuration order
+class RouteContext : public String
+{
+public:
+    RouteContext(const NamedList& sect);
+    ~RouteContext();
+    inline unsigned int count() const
+	{ return m_count; }
+    inline const RouteRule* rule(unsigned int index) const
+	{ return m_rules[index]; }
+    inline const PrefixRun* prefixRun(unsigned int index) const
+	{ return m_prefixes[index]; }
+private:
+    void buildPrefixes();
+    RouteRule** m_rules;
+    PrefixRun** m_prefixes;
+    unsigned int m_count;
+    ObjList m_runs;
+};
+
+// All the contexts of a loaded configuration, never modified once built
+class RouteProgram : public RefObject
+{
+public:
+    RouteProgram(const Configuration& cfg);
+    inline const RouteContext* context(const String& name) const
+	{ return static_cast<const RouteContext*>(m_contexts[name]); }
+    inline unsigned int rules() const
+	{ return m_rules; }
+private:
+    HashList m_contexts;
+    unsigned int m_rules;
+};
+
+static RefPointer<RouteProgram> s_program;
+
+// Get the current program, routing uses it without holding the module lock
+static RefPointer<RouteProgram> program()
+{
+    Lock lock(s_mutex);
+    return s_program;
+}
+
+RouteMatch::RouteMatch(Link link, const String& rule, const String& context, unsigned int line)
+    : m_link(link), m_valid(false), m_negate(false), m_function(false),
+      m_regexp(rule,s_extended,s_insensitive)
+{
+    Regexp& reg = m_regexp;
     if (reg.startsWith("${")) {
 	// handle special matching by param ${paramname}regexp
 	int p = reg.find('}');
 	if (p < 3) {
 	    Debug("RegexRoute",DebugWarn,"Invalid parameter match '%s' in rule #%u in context '%s'",
-		reg.c_str(),rule,context.c_str());
-	    return false;
+		reg.c_str(),line,context.c_str());
+	    return;
 	}
-	match = reg.substr(2,p-2);
+	m_param = reg.substr(2,p-2);
 	reg = reg.substr(p+1);
-	match.trimBlanks();
+	m_param.trimBlanks();
 	reg.trimBlanks();
-	String def;
-	p = match.find('$');
+	p = m_param.find('$');
 	if (p >= 0) {
 	    // param is in ${<name>$<default>} format
-	    def = match.substr(p+1);
-	    match = match.substr(0,p);
-	    match.trimBlanks();
+	    m_default = m_param.substr(p+1);
+	    m_param = m_param.substr(0,p);
+	    m_param.trimBlanks();
 	}
 	setDefault(reg);
-	if (match.null() || reg.null()) {
+	if (m_param.null() || reg.null()) {
 	    Debug("RegexRoute",DebugWarn,"Missing parameter or rule in rule #%u in context '%s'",
-		rule,context.c_str());
-	    return false;
+		line,context.c_str());
+	    return;
 	}
-	DDebug("RegexRoute",DebugAll,"Using message parameter '%s' default '%s'",
-	    match.c_str(),def.c_str());
-	match = msg.getValue(match,def);
     }
     else if (reg.startsWith("$(")) {
 	// handle special matching by param $(function)regexp
 	int p = reg.find(')');
 	if (p < 3) {
 	    Debug("RegexRoute",DebugWarn,"Invalid function match '%s' in rule #%u in context '%s'",
-		reg.c_str(),rule,context.c_str());
-	    return false;
+		reg.c_str(),line,context.c_str());
+	    return;
 	}
-	match = reg.substr(0,p+1);
+	m_function = true;
+	m_param = reg.substr(0,p+1);
 	reg = reg.substr(p+1);
 	reg.trimBlanks();
 	setDefault(reg);
 	if (reg.null()) {
 	    Debug("RegexRoute",DebugWarn,"Missing rule in rule #%u in context '%s'",
-		rule,context.c_str());
-	    return false;
+		line,context.c_str());
+	    return;
 	}
-	DDebug("RegexRoute",DebugAll,"Using function '%s'",match.c_str());
+    }
+    if (reg.endsWith("^")) {
+	// reverse match on final ^ (makes no sense in a regexp)
+	m_negate = true;
+	reg = reg.substr(0,reg.length()-1);
+    }
+    m_valid = true;
+    if (!reg.compile())
+	Debug("RegexRoute",DebugWarn,"Invalid regexp '%s' in rule #%u in context '%s'",
+	    reg.c_str(),line,context.c_str());
+}
+
+// process one match attempt, on input match holds the called number
+bool RouteMatch::matches(Message& msg, String& match) const
+{
+    if (!m_valid)
+	return false;
+    if (m_function) {
+	DDebug("RegexRoute",DebugAll,"Using function '%s'",m_param.c_str());
+	match = m_param;
 	msg.replaceParams(match);
 	replaceFuncs(match,msg);
     }
+    else if (m_param) {
+	DDebug("RegexRoute",DebugAll,"Using message parameter '%s' default '%s'",
+	    m_param.c_str(),m_default.c_str());
+	match = msg.getValue(m_param,m_default);
+    }
     match.trimBlanks();
+    return (match.matches(m_regexp) != m_negate);
+}
 
-    bool doMatch = true;
-    if (reg.endsWith("^")) {
-	// reverse match on final ^ (makes no sense in a regexp)
-	doMatch = false;
-	reg = reg.substr(0,reg.length()-1);
+// Get the literal string any match of the regexp must start with
+bool RouteMatch::literalPrefix(String& prefix) const
+{
+    prefix.clear();
+    if (!m_valid || m_negate || m_function || !m_regexp.startsWith("^"))
+	return false;
+    bool ext = m_regexp.isExtended();
+    // alternatives would need a prefix for each branch
+    if (m_regexp.find(ext ? "|" : "\\|") >= 0)
+	return false;
+    const char* r = m_regexp.c_str() + 1;
+    const char* extra = ext ? "#-_@:/%,;=!~<>'\"" : "#-_@:/%,;=!~<>'\"+?(){}|";
+    unsigned int len = 0;
+    for (; r[len]; len++) {
+	char c = r[len];
+	if ((c >= '0' && c <= '9') || ::strchr(extra,c))
+	    continue;
+	if (((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) && !m_regexp.isCaseInsensitive())
+	    continue;
+	break;
+    }
+    // a quantifier makes the last literal character optional
+    const char* q = r + len;
+    if (len && ((*q == '*') || (ext ? (*q && ::strchr("+?{",*q)) : ((q[0] == '\\') && q[1] && ::strchr("+?{",q[1])))))
+	len--;
+    prefix.assign(r,len);
+    return !prefix.null();
+}
+
+// Get the string the regexp is matched against, functions are not supported
+const String& RouteMatch::subject(const Message& msg, const String& str) const
+{
+    if (m_param) {
+	const String* s = msg.getParam(m_param);
+	return s ? *s : m_default;
+    }
+    return str;
+}
+
+RouteRule::RouteRule(const NamedString& line, unsigned int index, const String& context)
+    : m_name(line.name()), m_line(index + 1),
+      m_blockEnd(false), m_blockStart(false), m_broken(false)
+{
+    static const Regexp s_blockStart("\\(=[[:space:]]*\\)\\?{$");
+    String reg(m_name);
+    if (reg.startSkip("}")) {
+	m_blockEnd = true;
+	if (reg.trimBlanks().null())
+	    reg = ".*";
+    }
+    m_blockStart = s_blockStart.matches(line);
+    m_conds.append(new RouteMatch(RouteMatch::Primary,reg,context,m_line));
+    // split the secondary 'if', 'and', 'or' conditions from the action
+    String val(line);
+    for (;;) {
+	RouteMatch::Link link;
+	if (val.startSkip("or"))
+	    link = RouteMatch::Or;
+	else if (val.startSkip("if"))
+	    link = RouteMatch::If;
+	else if (val.startSkip("and"))
+	    link = RouteMatch::And;
+	else
+	    break;
+	int p = val.find('=');
+	if (p >= 1) {
+	    reg = val.substr(0,p);
+	    val = val.substr(p+1);
+	    reg.trimBlanks();
+	    val.trimBlanks();
+	    if (reg) {
+		m_conds.append(new RouteMatch(link,reg,context,m_line));
+		continue;
+	    }
+	}
+	Debug("RegexRoute",DebugWarn,"Malformed '%s' in rule #%u in context '%s'",
+	    (RouteMatch::Or == link) ? "or" : "if",m_line,context.c_str());
+	m_broken = true;
+	break;
+    }
+    m_action = val;
+    // rules that must match a literal prefix can be looked up in a trie
+    //  unless a failed match can be followed by an alternative
+    // Rules inside blocks are indexed too, only the lines opening or closing
+    //  a block are not. These lines end a run so a run never crosses a block
+    //  marker and is only searched while its whole block is being processed
+    if (m_blockEnd || m_blockStart)
+	return;
+    ObjList* l = m_conds.skipNull()->skipNext();
+    if (l && (RouteMatch::Or == static_cast<const RouteMatch*>(l->get())->link()))
+	return;
+    primary()->literalPrefix(m_prefix);
+}
+
+// Check if two prefix rules are matched against the same string
+bool RouteRule::sameSubject(const RouteRule* other) const
+{
+    const RouteMatch* m1 = primary();
+    const RouteMatch* m2 = other->primary();
+    return (m1->param() == m2->param()) && (m1->defValue() == m2->defValue());
+}
+
+// Evaluate the chain of conditions, a failed one can be followed by 'or'
+//  while a matched one followed by 'or' completes the match
+bool RouteRule::matches(Message& msg, const String& str, String& match, const String& context) const
+{
+    for (ObjList* l = m_conds.skipNull(); l; ) {
+	const RouteMatch* c = static_cast<const RouteMatch*>(l->get());
+	match = str;
+	bool ok = c->matches(msg,match);
+	l = l->skipNext();
+	const RouteMatch* next = l ? static_cast<const RouteMatch*>(l->get()) : 0;
+	if (ok) {
+	    if (!next || (RouteMatch::Or == next->link()))
+		return !m_broken;
+	}
+	else if (!(next && (RouteMatch::Or == next->link())))
+	    return false;
+	NDebug("RegexRoute",DebugAll,"Secondary match rule '%s' by rule #%u in context '%s'",
+	    next->regexp().c_str(),m_line,context.c_str());
+    }
+    return false;
+}
+
+PrefixNode::~PrefixNode()
+{
+    while (m_child) {
+	PrefixNode* n = m_child;
+	m_child = n->m_next;
+	delete n;
+    }
+    delete[] m_rules;
+}
+
+PrefixNode* PrefixNode::child(char c) const
+{
+    for (PrefixNode* n = m_child; n; n = n->m_next)
+	if (n->m_char == c)
+	    return n;
+    return 0;
+}
+
+PrefixNode* PrefixNode::addChild(char c)
+{
+    PrefixNode* n = child(c);
+    if (!n)
+	n = m_child = new PrefixNode(c,m_child);
+    return n;
+}
+
+// Rules are added in ascending order so the array stays sorted
+void PrefixNode::addRule(unsigned int index)
+{
+    // grow in powers of two
+    if (!(m_count & (m_count - 1))) {
+	unsigned int* rules = new unsigned int[m_count ? 2 * m_count : 1];
+	for (unsigned int i = 0; i < m_count; i++)
+	    rules[i] = m_rules[i];
+	delete[] m_rules;
+	m_rules = rules;
+    }
+    m_rules[m_count++] = index;
+}
+
+// Find the first rule with index not lower than the given one
+unsigned int PrefixNode::first(unsigned int from) const
+{
+    unsigned int lo = 0;
+    unsigned int hi = m_count;
+    while (lo < hi) {
+	unsigned int mid = (lo + hi) / 2;
+	if (m_rules[mid] < from)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return (lo < m_count) ? m_rules[lo] : (unsigned int)-1;
+}
+
+PrefixRun::PrefixRun(const RouteMatch* subject, unsigned int start)
+    : m_subject(subject), m_root(new PrefixNode(0,0)), m_end(start)
+{
+}
+
+void PrefixRun::append(const RouteRule* rule)
+{
+    PrefixNode* n = m_root;
+    for (const char* p = rule->prefix().c_str(); *p; p++)
+	n = n->addChild(*p);
+    n->addRule(m_end++);
+}
+
+// Get the index of the first rule at or after a given one that may match
+//  the current subject, end of the run if none
+unsigned int PrefixRun::next(const Message& msg, const String& str, unsigned int from) const
+{
+    String tmp(m_subject->subject(msg,str));
+    tmp.trimBlanks();
+    unsigned int found = m_end;
+    const PrefixNode* n = m_root;
+    for (const char* p = tmp.c_str(); p && *p; p++) {
+	n = n->child(*p);
+	if (!n)
+	    break;
+	unsigned int idx = n->first(from);
+	if (idx < found)
+	    found = idx;
+    }
+    return found;
+}
+
+RouteContext::RouteContext(const NamedList& sect)
+    : String(sect),
+      m_rules(0), m_prefixes(0), m_count(0)
+{
+    unsigned int len = sect.length();
+    if (!len)
+	return;
+    m_rules = new RouteRule*[len];
+    m_prefixes = new PrefixRun*[len];
+    for (unsigned int i = 0; i < len; i++) {
+	const NamedString* n = sect.getParam(i);
+	if (n) {
+	    m_prefixes[m_count] = 0;
+	    m_rules[m_count++] = new RouteRule(*n,i,sect);
+	}
+    }
+    buildPrefixes();
+}
+
+RouteContext::~RouteContext()
+{
+    for (unsigned int i = 0; i < m_count; i++)
+	delete m_rules[i];
+    delete[] m_rules;
+    delete[] m_prefixes;
+}
+
+// Index long enough runs of literal prefix rules on the same subject
+void RouteContext::buildPrefixes()
+{
+    unsigned int i = 0;
+    while (i < m_count) {
+	const RouteRule* r = m_rules[i];
+	unsigned int j = i + 1;
+	if (r->prefix()) {
+	    while ((j < m_count) && m_rules[j]->prefix() && r->sameSubject(m_rules[j]))
+		j++;
+	}
+	if (j - i >= PREFIX_RUN_MIN) {
+	    PrefixRun* run = new PrefixRun(r->primary(),i);
+	    m_runs.append(run);
+	    for (unsigned int k = i; k < j; k++) {
+		run->append(m_rules[k]);
+		m_prefixes[k] = run;
+	    }
+	    DDebug("RegexRoute",DebugAll,"Indexed %u prefix rules from #%u in context '%s'",
+		j - i,r->line(),c_str());
+	}
+	i = j;
+    }
+}
+
+RouteProgram::RouteProgram(const Configuration& cfg)
+    : m_contexts(cfg.sections() > 1024 ? 1024 : cfg.sections()),
+      m_rules(0)
+{
+    unsigned int n = cfg.sections();
+    for (unsigned int i = 0; i < n; i++) {
+	const NamedList* sect = cfg.getSection(i);
+	if (!sect || m_contexts[*sect])
+	    continue;
+	RouteContext* ctx = new RouteContext(*sect);
+	m_rules += ctx->count();
+	m_contexts.append(ctx);
     }
-    return (match.matches(reg) == doMatch);
 }
 
 enum BlockState {
@@ -510,8 +958,8 @@ enum BlockState {
 };
 
 // process one context, can call itself recursively
-static bool oneContext(Message &msg, String &str, const String &context, String &ret,
-    bool warn = false, int depth = 0)
+static bool oneContext(const RouteProgram* prog, Message &msg, String &str,
+    const String &context, String &ret, bool warn = false, int depth = 0)
 {
     if (context.null())
 	return false;
@@ -519,36 +967,30 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 	Debug("RegexRoute",DebugWarn,"Possible loop detected, current context '%s'",context.c_str());
 	return false;
     }
-    NamedList *l = s_cfg.getSection(context);
+    const RouteContext* l = prog ? prog->context(context) : 0;
     if (l) {
 	unsigned int blockDepth = 0;
 	BlockState blockStack[BLOCK_STACK];
-	unsigned int len = l->length();
+	unsigned int len = l->count();
 	for (unsigned int i = 0; i < len; i++) {
-	    const NamedString* n = l->getParam(i);
-	    if (!n)
-		continue;
+	    const RouteRule* n = l->rule(i);
 	    BlockState blockThis = (blockDepth > 0) ? blockStack[blockDepth-1] : BlockRun;
 	    BlockState blockLast = BlockSkip;
-	    Regexp reg(n->name(),s_extended,s_insensitive);
-	    if (reg.startSkip("}")) {
+	    if (n->blockEnd()) {
 		if (!blockDepth) {
 		    Debug("RegexRoute",DebugWarn,"Got '}' outside block in line #%u in context '%s'",
-			i+1,context.c_str());
+			n->line(),context.c_str());
 		    continue;
 		}
-		if (reg.trimBlanks().null())
-		    reg = ".*";
 		blockDepth--;
 		blockLast = blockThis;
 		blockThis = (blockDepth > 0) ? blockStack[blockDepth-1] : BlockRun;
 	    }
-	    static Regexp s_blockStart("\\(=[[:space:]]*\\)\\?{$");
-	    if (s_blockStart.matches(*n)) {
+	    if (n->blockStart()) {
 		// start of a new block
 		if (blockDepth >= BLOCK_STACK) {
 		    Debug("RegexRoute",DebugWarn,"Block stack overflow in line #%u in context '%s'",
-			i+1,context.c_str());
+			n->line(),context.c_str());
 		    return false;
 		}
 		// assume block is done
@@ -562,58 +1004,25 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 		}
 		blockStack[blockDepth++] = blockEnter;
 	    }
-	    XDebug("RegexRoute",DebugAll,"%s:%d(%u:%s) %s=%s",context.c_str(),i+1,
+	    XDebug("RegexRoute",DebugAll,"%s:%u(%u:%s) %s=%s",context.c_str(),n->line(),
 		blockDepth,String::boolText(BlockRun == blockThis),
-		n->name().c_str(),n->c_str());
+		n->name().c_str(),n->action().c_str());
 	    if (BlockRun != blockThis)
 		continue;
+	    const PrefixRun* run = l->prefixRun(i);
+	    if (run) {
+		// skip rules whose literal prefix cannot match
+		unsigned int next = run->next(msg,str,i);
+		if (next != i) {
+		    i = next - 1;
+		    continue;
+		}
+	    }
 
-	    String val(*n);
 	    String match;
-	    bool ok;
-	    do {
-		match = str;
-		ok = oneMatch(msg,reg,match,context,i+1);
-		if (ok) {
-		    if (val.startSkip("or")) {
-			do {
-			    int p = val.find('=');
-			    if (p < 0) {
-				Debug("RegexRoute",DebugWarn,"Malformed 'or' rule #%u in context '%s'",
-				    i+1,context.c_str());
-				ok = false;
-				break;
-			    }
-			    val = val.substr(p+1);
-			    val.trimBlanks();
-			} while (ok && (val.startSkip("or") || val.startSkip("if") || val.startSkip("and")));
-			break;
-		    }
-		    if (!(val.startSkip("if") || val.startSkip("and")))
-			break;
-		}
-		else if (val.startSkip("or"))
-		    ok = true;
-		if (ok) {
-		    int p = val.find('=');
-		    if (p >= 1) {
-			reg = val.substr(0,p);
-			val = val.substr(p+1);
-			reg.trimBlanks();
-			val.trimBlanks();
-			if (!reg.null()) {
-			    NDebug("RegexRoute",DebugAll,"Secondary match rule '%s' by rule #%u in context '%s'",
-				reg.c_str(),i+1,context.c_str());
-			    continue;
-			}
-		    }
-		    Debug("RegexRoute",DebugWarn,"Missing 'if' in rule #%u in context '%s'",
-			i+1,context.c_str());
-		    ok = false;
-		}
-	    } while (ok);
-	    if (!ok)
+	    if (!n->matches(msg,str,match,context))
 		continue;
+	    String val(n->action());
 
 	    if (val.startSkip("echo") || val.startSkip("output")) {
 		// special case: display the line but don't set params
@@ -629,7 +1038,7 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 		    blockStack[blockDepth-1] = BlockRun;
 		else
 		    Debug("RegexRoute",DebugWarn,"Got '{' outside block in line #%u in context '%s'",
-			i+1,context.c_str());
+			n->line(),context.c_str());
 		continue;
 	    }
 	    bool disp = val.startSkip("dispatch");
@@ -645,11 +1054,15 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 			m->userData(msg.userData());
 			NDebug("RegexRoute",DebugAll,"%s new message '%s' by rule #%u '%s' in context '%s'",
 			    (disp ? "Dispatching" : "Enqueueing"),
-			    val.c_str(),i+1,n->name().c_str(),context.c_str());
+			    val.c_str(),n->line(),n->name().c_str(),context.c_str());
 			if (disp) {
+			    s_varsMutex.lock();
 			    s_dispatching++;
+			    s_varsMutex.unlock();
 			    Engine::dispatch(m);
+			    s_varsMutex.lock();
 			    s_dispatching--;
+			    s_varsMutex.unlock();
 			}
 			else {
 			    Engine::enqueue(m);
@@ -676,14 +1089,14 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 	    else if (val.startSkip("goto") || val.startSkip("jump") ||
 		((val.startSkip("@goto") || val.startSkip("@jump")) && !(warn = false))) {
 		NDebug("RegexRoute",DebugAll,"Jumping to context '%s' by rule #%u '%s'",
-		    val.c_str(),i+1,n->name().c_str());
-		return oneContext(msg,str,val,ret,warn,depth+1);
+		    val.c_str(),n->line(),n->name().c_str());
+		return oneContext(prog,msg,str,val,ret,warn,depth+1);
 	    }
 	    else if (val.startSkip("include") || val.startSkip("call") ||
 		((val.startSkip("@include") || val.startSkip("@call")) && !(warn = false))) {
 		NDebug("RegexRoute",DebugAll,"Including context '%s' by rule #%u '%s'",
-		    val.c_str(),i+1,n->name().c_str());
-		if (oneContext(msg,str,val,ret,warn,depth+1)) {
+		    val.c_str(),n->line(),n->name().c_str());
+		if (oneContext(prog,msg,str,val,ret,warn,depth+1)) {
 		    DDebug("RegexRoute",DebugAll,"Returning true from context '%s'", context.c_str());
 		    return true;
 		}
@@ -691,20 +1104,20 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 	    else if (val.startSkip("match") || val.startSkip("newmatch")) {
 		if (!val.null()) {
 		    NDebug("RegexRoute",DebugAll,"Setting match string '%s' by rule #%u '%s' in context '%s'",
-			val.c_str(),i+1,n->name().c_str(),context.c_str());
+			val.c_str(),n->line(),n->name().c_str(),context.c_str());
 		    str = val;
 		}
 	    }
 	    else if (val.startSkip("rename")) {
 		if (!val.null()) {
 		    NDebug("RegexRoute",DebugAll,"Renaming message '%s' to '%s' by rule #%u '%s' in context '%s'",
-			msg.c_str(),val.c_str(),i+1,n->name().c_str(),context.c_str());
+			msg.c_str(),val.c_str(),n->line(),n->name().c_str(),context.c_str());
 		    msg = val;
 		}
 	    }
 	    else {
 		DDebug("RegexRoute",DebugAll,"Returning '%s' for '%s' in context '%s' by rule #%u '%s'",
-		    val.c_str(),str.c_str(),context.c_str(),i+1,n->name().c_str());
+		    val.c_str(),str.c_str(),context.c_str(),n->line(),n->name().c_str());
 		ret = val;
 		return true;
 	    }
@@ -727,8 +1140,7 @@ bool RouteHandler::received(Message &msg)
     if (called.null())
 	return false;
     const char *context = msg.getValue(YSTRING("context"),"default");
-    Lock lock(s_mutex);
-    if (oneContext(msg,called,context,msg.retValue())) {
+    if (oneContext(program(),msg,called,context,msg.retValue())) {
 	Debug(DebugInfo,"Routing call to '%s' in context '%s' via '%s' in " FMT64U " usec",
 	    called.c_str(),context,msg.retValue().c_str(),Time::now()-tmr);
 	return true;
@@ -760,8 +1172,7 @@ bool PrerouteHandler::received(Message &msg)
 	return false;
 
     String ret;
-    Lock lock(s_mutex);
-    if (oneContext(msg,caller,"contexts",ret)) {
+    if (oneContext(program(),msg,caller,"contexts",ret)) {
 	Debug(DebugInfo,"Classifying caller '%s' in context '%s' in " FMT64 " usec",
 	    caller.c_str(),ret.c_str(),Time::now()-tmr);
 	if (ret == YSTRING("-") || ret == YSTRING("error"))
@@ -805,8 +1216,7 @@ bool GenericHandler::received(Message &msg)
 	what = msg.getValue(what);
     else
 	what = *this;
-    Lock lock(s_mutex);
-    return oneContext(msg,what,m_context,msg.retValue());
+    return oneContext(program(),msg,what,m_context,msg.retValue());
 }
 
 
@@ -832,6 +1242,7 @@ void RegexRoutePlugin::initVars(NamedList* sect)
 {
     if (!sect)
 	return;
+    Lock lock(s_varsMutex);
     unsigned int len = sect->length();
     for (unsigned int i=0; i<len; i++) {
 	NamedString* n = sect->getParam(i);
@@ -876,6 +1287,12 @@ void RegexRoutePlugin::initialize()
 	depth = 100;
     s_maxDepth = depth;
     s_defRule = s_cfg.getValue("priorities","defaultrule",DEFAULT_RULE);
+    // parse and compile all rules once, routing in progress keeps the old ones
+    u_int64_t tmr = Time::now();
+    s_program = new RouteProgram(s_cfg);
+    s_program->deref();
+    Debug(DebugInfo,"Compiled %u rules in " FMT64U " usec",
+	s_program->rules(),Time::now() - tmr);
     NamedList* l = s_cfg.getSection("extra");
     if (l) {
 	unsigned int len = l->length();
@@ -533,7 +533,7 @@ struct MapCamelType {
     TcapXApplication::ParamType type;
     TcapXApplication::EncType encoding;
     bool (*decode)(const Parameter*, MapCamelType*, AsnTag& tag, DataBlock&, XmlElement*, bool, int& err);
-    bool (*encode)(const Parameter*, MapCamelType*, DataBlock&, XmlElement*, int& err);
+    bool (*encode)(const Parameter*, MapCamelType*, AsnWriter&, XmlElement*, int& err);
 };
 
 static const MapCamelType* findType(TcapXApplication::ParamType type);
@@ -567,28 +567,28 @@ static const Parameter* findParam(const Parameter* param, const String& tag)
     return 0;
 }
 
-static bool encodeParam(const Parameter* param, DataBlock& data, XmlElement* elem, int& err);
+static bool encodeParam(const Parameter* param, AsnWriter& data, XmlElement* elem, int& err);
 
-static bool encodeRaw(const Parameter* param, DataBlock& payload, XmlElement* elem, int& err)
+// Encoders put their parameter in front of the data already in the writer
+static bool encodeRaw(const Parameter* param, AsnWriter& payload, XmlElement* elem, int& err)
 {
     if (!elem)
 	return true;
 
     XDebug(&__plugin,DebugAll,"encodeRaw(param=[%p],elem=%s[%p])",param,elem->getTag().c_str(),elem);
-    bool hasChildren = false;
-    bool status = true;
-    while (XmlElement* child = elem->pop()) {
-	hasChildren = true;
-	DataBlock db;
-	Parameter* p = (Parameter*)findParam(param,elem->getTag());
-	if (p)
-	    status = encodeParam(p,db,child,err);
-	else
-	    status = encodeRaw(p,db,child,err);
-	payload.append(db);
-	TelEngine::destruct(child);
+    unsigned int mark = payload.length();
+    // children are put starting with the last one
+    ObjList children;
+    while (XmlElement* child = elem->pop())
+	children.insert(child);
+    bool hasChildren = (0 != children.skipNull());
+    Parameter* p = (Parameter*)findParam(param,elem->getTag());
+    for (ObjList* o = children.skipNull(); o; o = o->skipNext()) {
+	XmlElement* child = static_cast<XmlElement*>(o->get());
+	bool status = p ? encodeParam(p,payload,child,err) : encodeRaw(p,payload,child,err);
+	// encoding stops at a failed child, drop it and the children after it
 	if (!status)
-	    break;
+	    payload.rollback(mark);
     }
     AsnTag tag;
     const String* clas = elem->getAttribute(s_typeStr);
@@ -623,43 +623,38 @@ static bool encodeRaw(const Parameter* param, DataBlock& payload, XmlElement* el
 		Debug(DebugMild,"In <%s> missing %s=\"...\" attribute!",elem->getTag().c_str(),s_encAttr.c_str());
 		return false;
 	    }
-	    payload.clear();
 	    tag.type(param ? param->tag.type() : AsnTag::Primitive);
 	    clas = &String::empty();
 	}
 	else
 	    tag.type(AsnTag::Primitive);
 	if (*clas == "hex")
-	    payload.unHexify(text.c_str(),text.length(),' ');
+	    payload.putHex(text);
 	else if (*clas == "int")
-	    payload.insert(ASNLib::encodeInteger(text.toInteger(),false));
+	    payload.putInteger(text.toInteger());
 	else if (*clas == "str")
-	    payload.insert(ASNLib::encodeUtf8(text,false));
-	else if (*clas == "null")
-	    payload.clear();
+	    payload.put(ASNLib::encodeUtf8(text,false));
 	else if (*clas == "oid") {
 	    ASNObjId obj = text;
-	    payload.insert(ASNLib::encodeOID(obj,false));
+	    payload.put(ASNLib::encodeOID(obj,false));
 	}
 	else if (*clas == "bool")
-	    payload.insert(ASNLib::encodeBoolean(text.toBoolean(),false));
-	payload.insert(ASNLib::buildLength(payload));
-	AsnTag::encode(tag.classType(),tag.type(),tag.code(),payload);
+	    payload.putByte(text.toBoolean() ? 1 : 0);
     }
-    else {
+    else
 	tag.type(AsnTag::Constructor);
-	payload.insert(ASNLib::buildLength(payload));
-	AsnTag::encode(tag.classType(),tag.type(),tag.code(),payload);
-    }
+    tag.encode();
+    payload.close(mark,tag);
     return true;
 }
 
-static bool encodeParam(const Parameter* param, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeParam(const Parameter* param, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeParam(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
     MapCamelType* type = const_cast<MapCamelType*>(findType(param->type));
+    unsigned int mark = data.length();
     bool ok = true;
     if (!type)
 	ok = encodeRaw(param,data,elem,err);
@@ -683,9 +678,12 @@ static bool encodeParam(const Parameter* param, DataBlock& data, XmlElement* ele
 	}
 	elem->removeChild(child);
     }
+    // a failed parameter leaves nothing behind
+    if (!ok)
+	data.rollback(mark);
 #ifdef XDEBUG
     String str;
-    str.hexify(data.data(),data.length(),' ');
+    str.hexify(data.data().data(),data.length() - mark,' ');
     Debug(&__plugin,DebugAll,"encodeParam(param=%s[%p],elem=%s[%p] has %ssucceeded, encodedData=%s)",param->name.c_str(),param,
 		elem->getTag().c_str(),elem,(ok ? "" : "not "),str.c_str());
 #endif
@@ -889,15 +887,16 @@ static bool decodeTBCD(const Parameter* param, MapCamelType* type, AsnTag& tag,
     return true;
 }
 
-static bool encodeTBCD(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeTBCD(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeTBCD(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
-    const String& text = elem->getText();
-    encodeBCD(text,data);
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding()); 
+    unsigned int mark = data.length();
+    DataBlock digits;
+    encodeBCD(elem->getText(),digits);
+    data.put(digits);
+    data.close(mark,param->tag);
     return true;
 }
 
@@ -931,23 +930,25 @@ static bool decodeTel(const Parameter* param, MapCamelType* type, AsnTag& tag, D
     return true;
 }
 
-static bool encodeTel(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeTel(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeTel(param=%s[%p],elem=%s[%p],datalen=%d)",param->name.c_str(),param,elem->getTag().c_str(),
 	elem,data.length());
 
+    unsigned int mark = data.length();
+    DataBlock content;
     u_int8_t first = 0x80; // noExtension bit set
     first |= lookup(elem->attribute(s_natureAttr),s_dict_numNature,0);
     first |= lookup(elem->attribute(s_planAttr),s_dict_numPlan,0);
-    data.append(&first,sizeof(first));
+    content.append(&first,sizeof(first));
 
     const String& digits = elem->getText();
-    encodeBCD(digits,data);
+    encodeBCD(digits,content);
 
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding());
+    data.put(content);
+    data.close(mark,param->tag);
     return true;
 }
 
@@ -986,18 +987,18 @@ static bool decodeHex(const Parameter* param, MapCamelType* type, AsnTag& tag, D
     return true;
 }
 
-static bool encodeHex(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeHex(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeHexparam=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
+    unsigned int mark = data.length();
     const String& text = elem->getText();
-    if (!data.unHexify(text.c_str(),text.length(),' ')) {
+    if (!data.putHex(text)) {
 	Debug(&__plugin,DebugWarn,"Failed to parse hexified string '%s'",text.c_str());
 	return false;
     }
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding());;
+    data.close(mark,param->tag);
     return true;
 }
 
@@ -1023,15 +1024,15 @@ static bool decodeOID(const Parameter* param, MapCamelType* type, AsnTag& tag, D
     return true;
 }
 
-static bool encodeOID(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeOID(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeOID(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
+    unsigned int mark = data.length();
     ASNObjId oid = elem->getText();
-    data.append(ASNLib::encodeOID(oid,false));
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding());
+    data.put(ASNLib::encodeOID(oid,false));
+    data.close(mark,param->tag);
     return true;
 }
 
@@ -1055,15 +1056,12 @@ static bool decodeNull(const Parameter* param, MapCamelType* type, AsnTag& tag,
     return true;
 }
 
-static bool encodeNull(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeNull(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeNull(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
-    ASNObjId oid = elem->getText();
-    data.append(ASNLib::encodeNull(false));
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding());
+    data.close(data.length(),param->tag);
     return true;
 }
 
@@ -1088,15 +1086,15 @@ static bool decodeInt(const Parameter* param, MapCamelType* type, AsnTag& tag, D
     return true;
 }
 
-static bool encodeInt(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeInt(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeInt(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
+    unsigned int mark = data.length();
     u_int64_t val = elem->getText().toInteger();
-    data.append(ASNLib::encodeInteger(val,false));
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding());
+    data.putInteger(val);
+    data.close(mark,param->tag);
     return true;
 }
 
@@ -1145,41 +1143,40 @@ static bool decodeSeq(const Parameter* param, MapCamelType* type, AsnTag& tag, D
     return true;
 }
 
-static bool encodeSeq(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+// Encode the members of a sequence starting with params, the last member is put first
+static bool encodeSeqMembers(const Parameter* param, const Parameter* params, AsnWriter& data, XmlElement* elem, int& err)
+{
+    if (!(params && params->name))
+	return true;
+    const String& name = params->name;
+    XmlElement* child = elem->findFirstChild(&name);
+    if (!child) {
+	if (!params->isOptional) {
+	    printMissing(params->name.c_str(),param->name.c_str());
+	    err = TcapXApplication::DataMissing;
+	    return false;
+	}
+	return encodeSeqMembers(param,params + 1,data,elem,err);
+    }
+    // detach it so following members with the same name find the next child
+    elem->removeChild(child,false);
+    bool ok = encodeSeqMembers(param,params + 1,data,elem,err) && encodeParam(params,data,child,err);
+    TelEngine::destruct(child);
+    return ok;
+}
+
+static bool encodeSeq(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeSeq(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
 
-    if (param->content) {
-	const Parameter* params= static_cast<const Parameter*>(param->content);
-	while (params && params->name) {
-	    const String& name = params->name;
-	    XmlElement* child = elem->findFirstChild(&name);
-	    if (!child) {
-		if (!params->isOptional) {
-		    printMissing(params->name.c_str(),param->name.c_str());
-		    err = TcapXApplication::DataMissing;
-		    return false;
-		} 
-		else {
-		    params++;
-		    continue;
-		}
-	    }
-	    DataBlock db;
-	    if (!encodeParam(params,db,child,err))
-		return false;
-	    data.append(db);
-	    elem->removeChild(child);
-	    params++;
-	}
-    }
+    unsigned int mark = data.length();
+    if (param->content && !encodeSeqMembers(param,static_cast<const Parameter*>(param->content),data,elem,err))
+	return false;
 
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
-    }
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1226,49 +1223,45 @@ static bool decodeSeqOf(const Parameter* param, MapCamelType* type, AsnTag& tag,
     return true;
 }
 
-static bool encodeSeqOf(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeSeqOf(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeSeqOf(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
 
-    if (param->content) {
-	const Parameter* params = static_cast<const Parameter*>(param->content);
-	XmlElement* child = elem->pop();
+    unsigned int mark = data.length();
+    const Parameter* params = static_cast<const Parameter*>(param->content);
+    if (params && params->name) {
+	// items are put starting with the last one
+	ObjList items;
+	while (XmlElement* child = elem->pop())
+	    items.insert(child);
 	bool atLeastOne = false;
-	while (params && params->name && child) {
+	bool lastFailed = false;
+	bool last = true;
+	for (ObjList* o = items.skipNull(); o; o = o->skipNext(), last = false) {
+	    XmlElement* child = static_cast<XmlElement*>(o->get());
 	    if (!(child->getTag() == params->name)) {
 		Debug(&__plugin,DebugAll,"Skipping over unknown parameter '%s' for parent '%s', expecting '%s'",
 		    child->tag(),elem->tag(),params->name.c_str());
-		TelEngine::destruct(child);
-		child = elem->pop();
 		continue;
 	    }
-	    DataBlock db;
-	    if (!encodeParam(params,db,child,err)) {
-		TelEngine::destruct(child);
-		if (err != TcapXApplication::DataMissing) {
-		    printMissing(params->name.c_str(),param->name.c_str());
-		    err = TcapXApplication::DataMissing;
-		}
-		if (!param->isOptional && !(elem->findFirstChild()) && !atLeastOne)
-		    return false;
-		else {
-		    child = elem->pop();
-		    continue;
-		}
-	    }
-	    else
+	    if (encodeParam(params,data,child,err)) {
 		atLeastOne = true;
-	    data.append(db);
-	    TelEngine::destruct(child);
-	    child = elem->pop();
+		continue;
+	    }
+	    if (err != TcapXApplication::DataMissing) {
+		printMissing(params->name.c_str(),param->name.c_str());
+		err = TcapXApplication::DataMissing;
+	    }
+	    lastFailed = last;
 	}
+	// fail only if the last item failed and no item could be encoded
+	if (lastFailed && !atLeastOne && !param->isOptional)
+	    return false;
     }
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
-    }
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1316,7 +1309,7 @@ static bool decodeChoice(const Parameter* param, MapCamelType* type, AsnTag& tag
     return false;
 }
 
-static bool encodeChoice(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeChoice(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
@@ -1327,16 +1320,13 @@ static bool encodeChoice(const Parameter* param, MapCamelType* type, DataBlock&
 	XmlElement* child = elem->pop();
 	while (child && params && !TelEngine::null(params->name)) {
 	    if (child->getTag() == params->name) {
-		DataBlock db;
-		if (!encodeParam(params,db,child,err)) {
+		unsigned int mark = data.length();
+		if (!encodeParam(params,data,child,err)) {
 		    TelEngine::destruct(child);
 		    return false;
 		}
-		data.append(db);
-		if (param->tag != s_noTag) {
-		    data.insert(ASNLib::buildLength(data));
-		    data.insert(param->tag.coding());
-		}
+		if (param->tag != s_noTag)
+		    data.close(mark,param->tag);
 		TelEngine::destruct(child);
 		return true;
 	    }
@@ -1387,12 +1377,13 @@ static bool decodeEnumerated(const Parameter* param, MapCamelType* type, AsnTag&
     return true;
 }
 
-static bool encodeEnumerated(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeEnumerated(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeEnumerated(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
 
+    unsigned int mark = data.length();
     if (param->content) {
 	const TokenDict* dict = static_cast<const TokenDict*>(param->content);
 	if (!dict)
@@ -1403,13 +1394,10 @@ static bool encodeEnumerated(const Parameter* param, MapCamelType* type, DataBlo
 	    err = TcapXApplication::UnexpectedDataValue;
 	    return false;
 	}
-	u_int8_t enumVal = val & 0xff;
-	data.append(&enumVal,sizeof(enumVal));
-    }
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
+	data.putByte(val & 0xff);
     }
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1452,12 +1440,13 @@ static bool decodeBitString(const Parameter* param, MapCamelType* type, AsnTag&
     return true;
 }
 
-static bool encodeBitString(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeBitString(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeBitString(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
 
+    unsigned int mark = data.length();
     if (param->content) {
 	const TokenDict* dict = static_cast<const TokenDict*>(param->content);
 	String val;
@@ -1484,12 +1473,10 @@ static bool encodeBitString(const Parameter* param, MapCamelType* type, DataBloc
 		val = (b == 1? "1" : "0") + val;
 	}
 
-	data.append(ASNLib::encodeBitString(val,false));
-    }
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
+	data.put(ASNLib::encodeBitString(val,false));
     }
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1616,7 +1603,7 @@ static void encodeGSM7Bit(const String& str, DataBlock& db)
     }
 }
 
-static bool encodeGSMString(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeGSMString(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
@@ -1626,13 +1613,13 @@ static bool encodeGSMString(const Parameter* param, MapCamelType* type, DataBloc
     if (elem->getTag() != param->name)
 	return false;
 
-    const String& str = elem->getText();
-    encodeGSM7Bit(str,data);
+    unsigned int mark = data.length();
+    DataBlock content;
+    encodeGSM7Bit(elem->getText(),content);
+    data.put(content);
 
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
-    }
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1672,13 +1659,14 @@ static bool decodeFlags(const Parameter* param, MapCamelType* type, AsnTag& tag,
     return true;
 }
 
-static bool encodeFlags(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeFlags(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
 
     XDebug(&__plugin,DebugAll,"encodeFlags(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
 
+    unsigned int mark = data.length();
     u_int8_t byte = 0;
     if (param->content) {
  	const SignallingFlags* flags = static_cast<const SignallingFlags*>(param->content);
@@ -1699,11 +1687,9 @@ static bool encodeFlags(const Parameter* param, MapCamelType* type, DataBlock& d
 	}
 	TelEngine::destruct(list);
     }
-    data.append(&byte,sizeof(byte));
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
-    }
+    data.putByte(byte);
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1731,19 +1717,17 @@ static bool decodeString(const Parameter* param, MapCamelType* type, AsnTag& tag
     return true;
 }
 
-static bool encodeString(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeString(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
 
     XDebug(&__plugin,DebugAll,"encodeString(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
 
-    const String& text = elem->getText();
-    data.append(ASNLib::encodeString(text,ASNLib::PRINTABLE_STR,false));
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
-    }
+    unsigned int mark = data.length();
+    data.put(ASNLib::encodeString(elem->getText(),ASNLib::PRINTABLE_STR,false));
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1770,18 +1754,16 @@ static bool decodeBool(const Parameter* param, MapCamelType* type, AsnTag& tag,
     return true;
 }
 
-static bool encodeBool(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeBool(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeBool(param=%s[%p],elem=%s[%p])",param->name.c_str(),param,elem->getTag().c_str(),elem);
 
-    bool val = elem->getText().toBoolean();
-    data.append(ASNLib::encodeBoolean(val,false));
-    if (param->tag != s_noTag) {
-	data.insert(ASNLib::buildLength(data));
-	data.insert(param->tag.coding());
-    }
+    unsigned int mark = data.length();
+    data.putByte(elem->getText().toBoolean() ? 1 : 0);
+    if (param->tag != s_noTag)
+	data.close(mark,param->tag);
     return true;
 }
 
@@ -1990,7 +1972,7 @@ static bool decodeCallNumber(const Parameter* param, MapCamelType* type, AsnTag&
     return true;
 }
 
-static bool encodeCallNumber(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeCallNumber(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
@@ -2041,11 +2023,11 @@ static bool encodeCallNumber(const Parameter* param, MapCamelType* type, DataBlo
 	default:
 	    break;
     }
-    const String& digits = elem->getText();
-    setDigits(data,digits,nai,b2,b0);
-
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding());
+    unsigned int mark = data.length();
+    DataBlock content;
+    setDigits(content,elem->getText(),nai,b2,b0);
+    data.put(content);
+    data.close(mark,param->tag);
     return true;
 }
 
@@ -2118,23 +2100,23 @@ static bool decodeRedir(const Parameter* param, MapCamelType* type, AsnTag& tag,
     return true;
 }
 
-static bool encodeRedir(const Parameter* param, MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeRedir(const Parameter* param, MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
     XDebug(&__plugin,DebugAll,"encodeRedir(param=%s[%p],elem=%s[%p],datalen=%d)",param->name.c_str(),param,
 	elem->getTag().c_str(),elem,data.length());
 
-    unsigned char b0 = lookup(elem->getText(),s_dict_redir_main,0) & 0x07;
-    b0 |= (lookup(elem->attribute(s_reasonOrigAttr),s_dict_redir_reason,0) & 0x0f) << 4;
-    data.append(&b0,sizeof(b0));
+    unsigned char buf[2];
+    buf[0] = lookup(elem->getText(),s_dict_redir_main,0) & 0x07;
+    buf[0] |= (lookup(elem->attribute(s_reasonOrigAttr),s_dict_redir_reason,0) & 0x0f) << 4;
 
-    unsigned char b1 = String(elem->attribute(s_counterAttr)).toInteger() & 0x07;
-    b1 |= (lookup(elem->attribute(s_reasonAttr),s_dict_redir_reason,0) & 0x0f) << 4;
-    data.append(&b1,sizeof(b1));
+    buf[1] = String(elem->attribute(s_counterAttr)).toInteger() & 0x07;
+    buf[1] |= (lookup(elem->attribute(s_reasonAttr),s_dict_redir_reason,0) & 0x0f) << 4;
 
-    data.insert(ASNLib::buildLength(data));
-    data.insert(param->tag.coding());
+    unsigned int mark = data.length();
+    data.put(buf,sizeof(buf));
+    data.close(mark,param->tag);
     return true;
 }
 
@@ -2253,7 +2235,7 @@ static bool decodeUSI(const Parameter* param, MapCamelType* type, AsnTag& tag, D
     return true;
 }
 
-static bool encodeUSI(const Parameter* param,  MapCamelType* type, DataBlock& data, XmlElement* elem, int& err)
+static bool encodeUSI(const Parameter* param,  MapCamelType* type, AsnWriter& data, XmlElement* elem, int& err)
 {
     if (!(param && elem))
 	return false;
@@ -2280,8 +2262,8 @@ static bool encodeUSI(const Parameter* param,  MapCamelType* type, DataBlock& da
 	buff[buff[0] + 1] |= 0x20 | (((unsigned char)format) & 0x1f);
 	buff[0]++;
     }
-    data.assign(buff,buff[0] + 1);
-    data.insert(param->tag.coding());
+    data.put(buff,buff[0] + 1);
+    data.putTag(param->tag);
     return true;
 }
 
@@ -7740,7 +7722,8 @@ XmlToTcap::XmlToTcap(TcapXApplication* app)
     : Mutex(false,"XmlToTcap"),
       m_app(app), m_decl(0), m_elem(0)
 {
-    DDebug(&__plugin,DebugAll,"XmlToTcap created for application=%s[%p] [%p]",m_app->toString().c_str(),m_app,this);
+    DDebug(&__plugin,DebugAll,"XmlToTcap created for application=%s[%p] [%p]",
+	(m_app ? m_app->toString().c_str() : ""),m_app,this);
 }
 XmlToTcap::~XmlToTcap()
 {
@@ -7819,10 +7802,13 @@ void XmlToTcap::encodeOperation(Operation* op, XmlElement* elem, DataBlock& payl
 	return;
     const Parameter* param = (searchArgs ? op->args : op->res);
     AsnTag opTag = (searchArgs ? op->argTag : op->retTag);
+    // top level parameters are encoded each in its own buffer, they are
+    //  matched and consumed in order so they can't be put back to front
     while (param && !TelEngine::null(param->name)) {
 	DataBlock db;
+	AsnWriter writer(db);
 	err = TcapXApplication::NoError;
-	if (!encodeParam(param,db,elem,err)) {
+	if (!encodeParam(param,writer,elem,err)) {
 	    if (!param->isOptional && (err != TcapXApplication::DataMissing)) {
 		if (opTag == s_noTag) {
 		    const Parameter* tmp = param;
@@ -7843,7 +7829,8 @@ void XmlToTcap::encodeOperation(Operation* op, XmlElement* elem, DataBlock& payl
     XmlElement* child = elem->pop();
     while (child) {
 	DataBlock db;
-	encodeRaw(param,db,child,err);
+	AsnWriter writer(db);
+	encodeRaw(param,writer,child,err);
 	payload.append(db);
 	TelEngine::destruct(child);
 	child = elem->pop();
@@ -7857,17 +7844,16 @@ bool XmlToTcap::encodeComponent(DataBlock& payload, XmlElement* elem, bool searc
     if (!elem)
 	return false;
 
+    AsnWriter writer(payload);
     if (op)
 	encodeOperation(op,elem,payload,err,searchArgs);
     else if (elem->hasChildren())
-	encodeRaw(0,payload,elem,err);
+	encodeRaw(0,writer,elem,err);
 
     if (elem->getTag() == s_component) {
 	AsnTag tag = ( op ? (searchArgs ? op->argTag : op->retTag) : s_noTag);
-	if (tag != s_noTag) {
-	    payload.insert(ASNLib::buildLength(payload));
-	    payload.insert(tag.coding());
-	}
+	if (tag != s_noTag)
+	    writer.close(0,tag);
     }
     return true;
 }
@@ -7971,7 +7957,8 @@ bool XmlToTcap::handleMAPDialog(NamedList& tcapParams, XmlElement* elem, String
     int err = TcapXApplication::NoError;
     while (param && param->name) {
 	DataBlock db;
-	if (encodeParam(param,db,content,err)) {
+	AsnWriter writer(db);
+	if (encodeParam(param,writer,content,err)) {
 	    payload.append(db);
 	    break;
 	}
@@ -7980,7 +7967,8 @@ bool XmlToTcap::handleMAPDialog(NamedList& tcapParams, XmlElement* elem, String
     XmlElement* child = content->pop();
     while (child) {
 	DataBlock db;
-	encodeRaw(param,db,child,err);
+	AsnWriter writer(db);
+	encodeRaw(param,writer,child,err);
 	payload.append(db);
 	TelEngine::destruct(child);
 	child = content->pop();
@@ -205,8 +205,7 @@ bool QuerySipDriver::msgPreroute(Message& msg)
     m->addParam("copyparams","pbxassist,cdrwrite");
     m->addParam("querycnam",String::boolText(false));
     c->deref();
-    if (!Engine::enqueue(m))
-	delete m;
+    Engine::enqueue(m);
     int t = waitFor(c);
     Debug(this,(t > 500) ? DebugNote : DebugAll,"CNAM lookup took %d msec",t);
     return false;
@@ -257,8 +256,7 @@ bool QuerySipDriver::msgRoute(Message& msg)
     m->addParam("copyparams","pbxassist,cdrwrite");
     m->addParam("querylnp",String::boolText(false));
     c->deref();
-    if (!Engine::enqueue(m))
-	delete m;
+    Engine::enqueue(m);
     int t = waitFor(c);
     Debug(this,(t > 500) ? DebugNote : DebugAll,"LNP lookup took %d msec",t);
     return false;
@@ -0,0 +1,189 @@
+/*
+ * asnbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * ASN.1 BER decoding benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+#include <yateasn.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class AsnBench : public BenchPlugin
+{
+public:
+    AsnBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(const char* name, const DataBlock& msg, int loops, int expect);
+};
+
+INIT_PLUGIN(AsnBench);
+
+// TCAP Begin carrying a CAP v2 InitialDP as captured from a MSC
+static const char* s_initialDP =
+    "6281b248040a1b2c3d6b1e281c060700118605010101a011600f80020780a109"
+    "0607040000010032016c8189a18186020101020100307e800164820703132143"
+    "65870983070313214365870985010a8a088413214365870900bb0580038090a3"
+    "9c01029f320852000000000000f1bf34170201008107914477581007f0a30980"
+    "0752f01000010002bf35038301119f3605f30a1d00019f3707914477581007f0"
+    "9f3807031321436587f99f39080201101152000040";
+
+// Wrap some content in a tag and length
+static void wrap(DataBlock& data, unsigned char tag)
+{
+    data.insert(ASNLib::buildLength(data));
+    data.insert(DataBlock(&tag,1));
+}
+
+// Add a primitive element at the end of a block
+static void add(DataBlock& data, unsigned char tag, const void* value, unsigned int len)
+{
+    DataBlock elem((void*)value,len);
+    wrap(elem,tag);
+    data += elem;
+}
+
+// Build a TCAP Continue with a MAP like list of many small sequences
+static void buildList(DataBlock& msg, int items)
+{
+    DataBlock list;
+    for (int i = 0; i < items; i++) {
+	DataBlock item;
+	unsigned char code = i;
+	unsigned char msisdn[] = { 0x91, 0x44, 0x77, 0x58, 0x10, (unsigned char)(i >> 8), (unsigned char)i };
+	unsigned char flag = 0xff;
+	add(item,0x80,&code,1);
+	add(item,0x81,msisdn,sizeof(msisdn));
+	add(item,0x82,&flag,1);
+	wrap(item,0x30);
+	list += item;
+    }
+    wrap(list,0x30);
+    unsigned char id = 1;
+    unsigned char op = 7;
+    DataBlock comp;
+    add(comp,0x02,&id,1);
+    add(comp,0x02,&op,1);
+    comp += list;
+    wrap(comp,0xa1);
+    wrap(comp,0x6c);
+    unsigned char tid[] = { 0x0a, 0x1b, 0x2c, 0x3d };
+    msg.clear();
+    add(msg,0x48,tid,sizeof(tid));
+    add(msg,0x49,tid,sizeof(tid));
+    msg += comp;
+    wrap(msg,0x65);
+}
+
+// Decode all the elements in the next len bytes, descending in constructed ones
+//  as the TCAP and MAP decoders do, works on both DataBlock and AsnCursor
+template <class T> static int walk(T& data, unsigned int len, unsigned int& sum)
+{
+    int elems = 0;
+    unsigned int initLen = data.length();
+    while (data.length() && (initLen - data.length() < len)) {
+	AsnTag tag;
+	AsnTag::decode(tag,data);
+	data.cut(-(int)tag.coding().length());
+	if (tag.type() == AsnTag::Constructor) {
+	    int l = ASNLib::decodeLength(data);
+	    if ((l < 0) || (l > (int)data.length()))
+		return -1;
+	    int n = walk(data,l,sum);
+	    if (n < 0)
+		return -1;
+	    elems += n + 1;
+	}
+	else {
+	    OctetString val;
+	    if (ASNLib::decodeOctetString(data,&val,false) < 0)
+		return -1;
+	    sum = sum * 31 + val.length() + val.at(0,0);
+	    elems++;
+	}
+    }
+    return elems;
+}
+
+AsnBench::AsnBench()
+    : BenchPlugin("asnbench","AsnBench")
+{
+}
+
+void AsnBench::bench(const Configuration& cfg)
+{
+    int loops = cfg.getIntValue("asnbench","loops",100000);
+    DataBlock msg;
+    msg.unHexify(s_initialDP,::strlen(s_initialDP));
+    // the capture holds 35 elements, 13 of them constructed
+    run("InitialDP",msg,loops,35);
+    String sizes = cfg.getValue("asnbench","items","10,100,1000");
+    ObjList* l = sizes.split(',',false);
+    for (ObjList* o = l->skipNull(); o; o = o->skipNext()) {
+	int items = o->get()->toString().toInteger();
+	if (items <= 0)
+	    continue;
+	buildList(msg,items);
+	String name;
+	name << items << " item list";
+	// 4 elements in each item, 8 in the TCAP and component wrapping
+	run(name,msg,loops * 10 / (items + 10),4 * items + 8);
+    }
+    TelEngine::destruct(l);
+}
+
+// Decode a message with both DataBlock and cursor, both must find the expected elements
+void AsnBench::run(const char* name, const DataBlock& msg, int loops, int expect)
+{
+    if (loops <= 0)
+	loops = 1;
+    unsigned int sumBlock = 0;
+    int elems = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	DataBlock data(msg);
+	sumBlock = 0;
+	elems = walk(data,data.length(),sumBlock);
+    }
+    u_int64_t tBlock = Time::now() - t;
+    unsigned int sumCursor = 0;
+    int elemsCursor = 0;
+    t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	AsnCursor data(msg);
+	sumCursor = 0;
+	elemsCursor = walk(data,data.length(),sumCursor);
+    }
+    u_int64_t tCursor = Time::now() - t;
+    check(elems > 0,"%s: decoding failed",name);
+    check((elems == elemsCursor) && (sumBlock == sumCursor),"%s: cursor decoded %d elements,"
+	" checksum %08x, DataBlock %d elements, checksum %08x",name,elemsCursor,sumCursor,elems,sumBlock);
+    check(elems == expect,"%s: decoded %d elements, expected %d",name,elems,expect);
+    Output("%s of %u bytes with %d elements, %d times: DataBlock " FMT64U " usec, cursor " FMT64U " usec",
+	name,msg.length(),elems,loops,tBlock,tCursor);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
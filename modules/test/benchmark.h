@@ -0,0 +1,106 @@
+/**
+ * benchmark.h
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * Common code of the benchmark test modules
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+#include <yatengine.h>
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+// Base of the benchmark modules. The benchmark runs once, on the first
+//  initialization, then reports how many checks of its results failed
+class BenchPlugin : public Plugin
+{
+public:
+    inline BenchPlugin(const char* name, const char* title)
+	: Plugin(name,"misc"),
+	  m_title(title), m_done(false), m_checks(0), m_failed(0)
+	{ Output("Loaded module %s",m_title); }
+
+    virtual void initialize()
+	{
+	    if (m_done)
+		return;
+	    m_done = true;
+	    Output("Initializing module %s",m_title);
+	    bench(Engine::config());
+	    if (m_failed)
+		Output("%s: %u of %u result checks FAILED",m_title,m_failed,m_checks);
+	    else
+		Output("%s: all %u result checks passed",m_title,m_checks);
+	}
+
+protected:
+    // Run the benchmark and check its results
+    virtual void bench(const Configuration& cfg) = 0;
+
+    // Count a result check, output what failed
+    bool check(bool ok, const char* format, ...)
+	{
+	    m_checks++;
+	    if (ok)
+		return true;
+	    m_failed++;
+	    char buf[512];
+	    va_list va;
+	    va_start(va,format);
+	    ::vsnprintf(buf,sizeof(buf),format,va);
+	    va_end(va);
+	    Output("%s: check failed, %s",m_title,buf);
+	    return false;
+	}
+
+    // Check a string against the expected one
+    inline bool checkString(const String& str, const String& ref, const char* what)
+	{ return check(str == ref,"%s: got '%s' expected '%s'",what,str.c_str(),ref.c_str()); }
+
+    // Check some data against the expected bytes
+    inline bool checkData(const void* data, unsigned int len, const void* ref, unsigned int refLen,
+	const char* what)
+	{
+	    return check((len == refLen) && !(len && ::memcmp(data,ref,len)),
+		"%s: %u bytes differ from the expected %u",what,len,refLen);
+	}
+
+    inline unsigned int failed() const
+	{ return m_failed; }
+
+private:
+    const char* m_title;
+    bool m_done;
+    unsigned int m_checks;
+    unsigned int m_failed;
+};
+
+}; // anonymous namespace
+
+#endif /* __BENCHMARK_H */
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
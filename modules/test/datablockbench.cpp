@@ -0,0 +1,290 @@
+/*
+ * datablockbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * DataBlock append, cut and shared slice benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class DataBlockBench : public BenchPlugin
+{
+public:
+    DataBlockBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void runAppend(unsigned int size, unsigned int chunk);
+    void runCut(unsigned int size, unsigned int chunk);
+    void runStream(int loops, unsigned int frame, unsigned int lag);
+    void runInsert(int loops, unsigned int layers);
+    void runSlice(int loops, unsigned int pdu, unsigned int layers);
+};
+
+INIT_PLUGIN(DataBlockBench);
+
+// Sum of the bytes in a block, used to check that the patterns give the expected data
+static unsigned int checksum(const void* data, unsigned int len)
+{
+    const unsigned char* d = (const unsigned char*)data;
+    unsigned int sum = 0;
+    for (unsigned int i = 0; i < len; i++)
+	sum = sum * 31 + d[i];
+    return sum;
+}
+
+// Stand in for a protocol layer that looks at its header and hands the rest down
+static unsigned int layerBlock(DataBlock& data)
+{
+    unsigned int v = data.at(0) + data.at(1);
+    DataBlock payload(data);
+    payload.cut(-8);
+    data = payload;
+    return v;
+}
+
+static unsigned int layerSlice(DataSlice& data)
+{
+    unsigned int v = data.at(0) + data.at(1);
+    DataSlice payload(data,8);
+    data = payload;
+    return v;
+}
+
+DataBlockBench::DataBlockBench()
+    : BenchPlugin("datablockbench","DataBlockBench")
+{
+}
+
+void DataBlockBench::bench(const Configuration& cfg)
+{
+    String sizes = cfg.getValue("datablockbench","sizes","4096,65536,1048576");
+    ObjList* l = sizes.split(',',false);
+    for (ObjList* o = l->skipNull(); o; o = o->skipNext()) {
+	int size = o->get()->toString().toInteger();
+	if (size <= 0)
+	    continue;
+	runAppend(size,64);
+	runCut(size,20);
+    }
+    TelEngine::destruct(l);
+    int loops = cfg.getIntValue("datablockbench","loops",1000000);
+    runStream(loops,160,480);
+    runInsert(loops,4);
+    runSlice(loops,1400,4);
+}
+
+// Accumulate a large block from small pieces as stream readers do
+void DataBlockBench::runAppend(unsigned int size, unsigned int chunk)
+{
+    unsigned char buf[256];
+    for (unsigned int i = 0; i < chunk; i++)
+	buf[i] = i;
+    int loops = 16 * 1048576 / size;
+    if (loops < 1)
+	loops = 1;
+    unsigned int sum = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	DataBlock data;
+	for (unsigned int len = 0; len < size; len += chunk)
+	    data.append(buf,chunk);
+	sum = checksum(data.data(),data.length());
+    }
+    t = Time::now() - t;
+    // the same pieces copied one after another in plain memory
+    unsigned int len = ((size + chunk - 1) / chunk) * chunk;
+    unsigned char* ref = new unsigned char[len];
+    for (unsigned int i = 0; i < len; i++)
+	ref[i] = i % chunk;
+    check(sum == checksum(ref,len),"append %u byte chunks up to %u bytes: checksum %08x expected %08x",
+	chunk,size,sum,checksum(ref,len));
+    delete[] ref;
+    Output("append %u byte chunks up to %u bytes, %d times in " FMT64U " usec, checksum %08x",
+	chunk,size,loops,t,sum);
+}
+
+// Consume a large block from the front in small pieces as decoders do
+void DataBlockBench::runCut(unsigned int size, unsigned int chunk)
+{
+    DataBlock src(0,size);
+    unsigned char* d = (unsigned char*)src.data();
+    for (unsigned int i = 0; i < size; i++)
+	d[i] = i * 7;
+    int loops = 16 * 1048576 / size;
+    if (loops < 1)
+	loops = 1;
+    unsigned int sum = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	DataBlock data(src);
+	sum = 0;
+	while (data.length()) {
+	    sum = sum * 31 + data.at(0);
+	    data.cut(-(int)chunk);
+	}
+    }
+    t = Time::now() - t;
+    // each piece starts where the previous one ended
+    unsigned int ref = 0;
+    for (unsigned int i = 0; i < size; i += chunk)
+	ref = ref * 31 + d[i];
+    check(sum == ref,"cut %u byte chunks from %u bytes: checksum %08x expected %08x",
+	chunk,size,sum,ref);
+    Output("cut %u byte chunks from front of %u bytes, %d times in " FMT64U " usec, checksum %08x",
+	chunk,size,loops,t,sum);
+}
+
+// A jitter or conference buffer, frames come in at the end and go out at the front
+void DataBlockBench::runStream(int loops, unsigned int frame, unsigned int lag)
+{
+    if (loops <= 0)
+	return;
+    DataBlock in(0,frame);
+    unsigned char* d = (unsigned char*)in.data();
+    for (unsigned int i = 0; i < frame; i++)
+	d[i] = i;
+    DataBlock buf;
+    unsigned int sum = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	buf += in;
+	if (buf.length() > lag) {
+	    sum += buf.at(n % frame);
+	    buf.cut(-(int)frame);
+	}
+    }
+    t = Time::now() - t;
+    // the buffer always starts with a whole frame so the byte at offset k is k
+    unsigned int ref = 0;
+    unsigned int len = 0;
+    for (int n = 0; n < loops; n++) {
+	len += frame;
+	if (len > lag) {
+	    ref += n % frame;
+	    len -= frame;
+	}
+    }
+    check((sum == ref) && (buf.length() == len),"stream %d frames of %u bytes: checksum %08x"
+	" expected %08x, %u bytes left expected %u",loops,frame,sum,ref,buf.length(),len);
+    check(!::memcmp(buf.data(),in.data(),frame),"stream %d frames of %u bytes: buffer does not start"
+	" with a frame",loops,frame);
+    Output("stream %d frames of %u bytes with %u bytes buffered in " FMT64U " usec, checksum %08x",
+	loops,frame,lag,t,sum);
+}
+
+// Encoders wrap a payload in headers from the innermost layer outwards
+void DataBlockBench::runInsert(int loops, unsigned int layers)
+{
+    if (loops <= 0)
+	return;
+    unsigned char hdr[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    DataBlock payload(0,160);
+    unsigned int sum = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	DataBlock data(payload);
+	for (unsigned int i = 0; i < layers; i++)
+	    data.insert(hdr,sizeof(hdr));
+	sum += data.length();
+    }
+    u_int64_t tPlain = Time::now() - t;
+    t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	DataBlock data;
+	data.reserve(payload.length(),layers * sizeof(hdr));
+	data.append(payload);
+	for (unsigned int i = 0; i < layers; i++)
+	    data.insert(hdr,sizeof(hdr));
+	sum -= data.length();
+    }
+    u_int64_t tReserve = Time::now() - t;
+    check(!sum,"insert %u headers: reserved blocks differ in length",layers);
+    // the headers come first then the payload, as in plain memory
+    unsigned int len = layers * sizeof(hdr) + payload.length();
+    unsigned char* ref = new unsigned char[len];
+    for (unsigned int i = 0; i < layers; i++)
+	::memcpy(ref + i * sizeof(hdr),hdr,sizeof(hdr));
+    ::memcpy(ref + layers * sizeof(hdr),payload.data(),payload.length());
+    DataBlock plain(payload);
+    DataBlock reserved;
+    reserved.reserve(payload.length(),layers * sizeof(hdr));
+    reserved.append(payload);
+    for (unsigned int i = 0; i < layers; i++) {
+	plain.insert(hdr,sizeof(hdr));
+	reserved.insert(hdr,sizeof(hdr));
+    }
+    checkData(plain.data(),plain.length(),ref,len,"inserted headers");
+    checkData(reserved.data(),reserved.length(),ref,len,"inserted headers in reserved block");
+    delete[] ref;
+    Output("insert %u headers before %u bytes, %d times: " FMT64U " usec, reserved " FMT64U " usec",
+	layers,payload.length(),loops,tPlain,tReserve);
+}
+
+// Hand a received PDU down a stack of layers that strip their header
+void DataBlockBench::runSlice(int loops, unsigned int pdu, unsigned int layers)
+{
+    if (loops <= 0)
+	return;
+    DataBlock data(0,pdu);
+    unsigned char* d = (unsigned char*)data.data();
+    for (unsigned int i = 0; i < pdu; i++)
+	d[i] = i * 3;
+    unsigned int sum = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	DataBlock msg(data);
+	for (unsigned int i = 0; i < layers; i++)
+	    sum += layerBlock(msg);
+	sum += checksum(msg.data(),16);
+    }
+    u_int64_t tBlock = Time::now() - t;
+    t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	DataBlock rcv(data);
+	DataSlice msg(rcv,true);
+	for (unsigned int i = 0; i < layers; i++)
+	    sum -= layerSlice(msg);
+	sum -= checksum(msg.data(),16);
+    }
+    u_int64_t tSlice = Time::now() - t;
+    check(!sum,"pass %u byte PDU through %u layers: DataBlock and DataSlice see different data",
+	pdu,layers);
+    // what is left after the layers is the end of the PDU
+    unsigned int offs = layers * 8;
+    DataBlock msg(data);
+    DataBlock rcv(data);
+    DataSlice slice(rcv,true);
+    for (unsigned int i = 0; i < layers; i++) {
+	layerBlock(msg);
+	layerSlice(slice);
+    }
+    checkData(msg.data(),msg.length(),d + offs,pdu - offs,"DataBlock payload");
+    checkData(slice.data(),slice.length(),d + offs,pdu - offs,"DataSlice payload");
+    Output("pass %u byte PDU through %u layers, %d times: DataBlock " FMT64U " usec, DataSlice " FMT64U " usec",
+	pdu,layers,loops,tBlock,tSlice);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,213 @@
+/*
+ * dispatchbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * Message dispatcher throughput benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class BenchHandler : public MessageHandler
+{
+public:
+    BenchHandler(const char* name, unsigned prio)
+	: MessageHandler(name,prio,"dispatchbench"),
+	  m_calls(0)
+	{ }
+    virtual bool received(Message& msg);
+    unsigned int m_calls;
+};
+
+class BenchThread : public Thread
+{
+public:
+    BenchThread(MessageDispatcher* dispatcher, int messages)
+	: Thread("DispatchBench"),
+	  m_dispatcher(dispatcher), m_messages(messages)
+	{ }
+    virtual void run();
+private:
+    MessageDispatcher* m_dispatcher;
+    int m_messages;
+};
+
+class DispatchBench : public BenchPlugin
+{
+public:
+    DispatchBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(int handlers, int unnamed, int messages, int threads);
+    void checkHandlers(MessageDispatcher& dispatcher, const ObjList& list);
+    u_int64_t dispatch(MessageDispatcher& dispatcher, int messages, int threads);
+};
+
+INIT_PLUGIN(DispatchBench);
+
+// A mix of message names as seen on a busy server
+static const char* s_names[] = {
+    "call.route", "call.execute", "call.preroute", "call.answered",
+    "call.ringing", "call.progress", "call.update", "call.drop",
+    "call.cdr", "chan.startup", "chan.hangup", "chan.disconnected",
+    "chan.dtmf", "chan.notify", "chan.masquerade", "chan.locate",
+    "chan.attach", "chan.record", "chan.rtp", "chan.control",
+    "engine.timer", "engine.status", "engine.command", "engine.help",
+    "engine.debug", "engine.halt", "engine.init", "engine.start",
+    "user.auth", "user.register", "user.unregister", "user.notify",
+    "user.login", "resource.subscribe", "resource.notify", "database",
+    "monitor.query", "monitor.notify", "module.update", "msg.route",
+    "msg.execute", "xmpp.iq", "sip.options", "sip.info",
+    0
+};
+
+static Mutex s_mutex(false,"DispatchBench");
+static int s_running = 0;
+static int s_count = 0;
+static bool s_checking = false;
+static bool s_ordered = true;
+static unsigned int s_lastPriority = 0;
+
+// Handlers are counted only while checking, from a single thread
+bool BenchHandler::received(Message& msg)
+{
+    if (s_checking) {
+	m_calls++;
+	if (priority() < s_lastPriority)
+	    s_ordered = false;
+	s_lastPriority = priority();
+    }
+    return false;
+}
+
+void BenchThread::run()
+{
+    for (int i = 0; i < m_messages; i++) {
+	Message m(s_names[(i * 7) % s_count]);
+	m_dispatcher->dispatch(m);
+    }
+    Lock lock(s_mutex);
+    s_running--;
+}
+
+
+DispatchBench::DispatchBench()
+    : BenchPlugin("dispatchbench","DispatchBench")
+{
+}
+
+void DispatchBench::bench(const Configuration& cfg)
+{
+    run(cfg.getIntValue("dispatchbench","handlers",400),
+	cfg.getIntValue("dispatchbench","unnamed",4),
+	cfg.getIntValue("dispatchbench","messages",200000),
+	cfg.getIntValue("dispatchbench","threads",4));
+}
+
+// Dispatch messages from a number of threads, return elapsed time
+u_int64_t DispatchBench::dispatch(MessageDispatcher& dispatcher, int messages, int threads)
+{
+    s_running = threads;
+    u_int64_t t = Time::now();
+    for (int i = 0; i < threads; i++) {
+	BenchThread* th = new BenchThread(&dispatcher,messages / threads);
+	if (!th->startup()) {
+	    Debug(DebugWarn,"Failed to start benchmark thread");
+	    delete th;
+	    Lock lock(s_mutex);
+	    s_running--;
+	}
+    }
+    for (;;) {
+	Lock lock(s_mutex);
+	if (!s_running)
+	    break;
+	lock.drop();
+	Thread::idle();
+    }
+    return Time::now() - t;
+}
+
+// Each message must reach the handlers of its name and the unnamed ones
+//  exactly once, in priority order, as a walk of all handlers would
+void DispatchBench::checkHandlers(MessageDispatcher& dispatcher, const ObjList& list)
+{
+    s_checking = true;
+    for (int n = 0; n < s_count; n++) {
+	Message m(s_names[n]);
+	m.addParam("dispatchbench","unnamed");
+	s_ordered = true;
+	s_lastPriority = 0;
+	dispatcher.dispatch(m);
+	unsigned int expected = 0;
+	unsigned int wrong = 0;
+	for (ObjList* o = list.skipNull(); o; o = o->skipNext()) {
+	    BenchHandler* h = static_cast<BenchHandler*>(o->get());
+	    unsigned int calls = (h->null() || (*h == s_names[n])) ? 1 : 0;
+	    expected += calls;
+	    if (h->m_calls != calls)
+		wrong++;
+	    h->m_calls = 0;
+	}
+	check(s_ordered && !wrong,"'%s' has %u handlers, %u called wrong%s",
+	    s_names[n],expected,wrong,(s_ordered ? "" : ", not in priority order"));
+    }
+    s_checking = false;
+}
+
+void DispatchBench::run(int handlers, int unnamed, int messages, int threads)
+{
+    s_count = 0;
+    while (s_names[s_count])
+	s_count++;
+    // handlers must be destroyed before the dispatcher
+    MessageDispatcher dispatcher;
+    ObjList list;
+    for (int i = 0; i < handlers; i++) {
+	// some message names have a lot more handlers than others
+	int n = (i % 3) ? (i % 8) : (i % s_count);
+	BenchHandler* h = new BenchHandler(s_names[n],10 + Random::random() % 100);
+	list.append(h);
+	dispatcher.install(h);
+    }
+    for (int i = 0; i < unnamed; i++) {
+	BenchHandler* h = new BenchHandler(0,10 + Random::random() % 100);
+	h->setFilter("dispatchbench","unnamed");
+	list.append(h);
+	dispatcher.install(h);
+    }
+    check(dispatcher.handlerCount() == (unsigned int)(handlers + unnamed),
+	"%u handlers installed instead of %d",dispatcher.handlerCount(),handlers + unnamed);
+    checkHandlers(dispatcher,list);
+    for (int n = 1; n <= threads; n *= 2) {
+	u_int64_t t = dispatch(dispatcher,messages,n);
+	Output("Dispatched %d messages through %u handlers in %d threads in "
+	    FMT64U " usec, " FMT64U " msg/s",messages,dispatcher.handlerCount(),n,t,
+	    t ? (1000000 * (u_int64_t)messages / t) : (u_int64_t)0);
+    }
+    list.clear();
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,183 @@
+/*
+ * g711bench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * G.711 and signed linear conversion kernels benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class G711Bench : public BenchPlugin
+{
+public:
+    G711Bench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(int level, unsigned int samples, unsigned int blocks);
+};
+
+INIT_PLUGIN(G711Bench);
+
+static const struct {
+    DataBlock::Conversion conv;
+    const char* src;
+    const char* dst;
+} s_convs[] = {
+    { DataBlock::SlinToAlaw, "slin", "alaw" },
+    { DataBlock::SlinToMulaw, "slin", "mulaw" },
+    { DataBlock::AlawToSlin, "alaw", "slin" },
+    { DataBlock::MulawToSlin, "mulaw", "slin" },
+    { DataBlock::AlawToMulaw, "alaw", "mulaw" },
+    { DataBlock::MulawToAlaw, "mulaw", "alaw" },
+    { DataBlock::NoConversion, 0, 0 }
+};
+
+// Source data covering all possible sample values
+static void fillSource(DataBlock& data, bool slin)
+{
+    if (slin) {
+	data.assign(0,131072);
+	unsigned short* d = (unsigned short*)data.data();
+	for (unsigned int i = 0; i < 65536; i++)
+	    d[i] = i;
+    }
+    else {
+	data.assign(0,256);
+	unsigned char* d = (unsigned char*)data.data();
+	for (unsigned int i = 0; i < 256; i++)
+	    d[i] = i;
+    }
+}
+
+// Build a signal of varying loudness, encoded in the source format of a conversion
+static void buildSignal(DataBlock& data, DataBlock::Conversion conv, unsigned int samples)
+{
+    DataBlock lin(0,samples * 2);
+    short* d = (short*)lin.data();
+    unsigned int rnd = 12345;
+    for (unsigned int i = 0; i < samples; i++) {
+	// sum of uniform values is close to a normal distribution
+	int v = 0;
+	for (int k = 0; k < 4; k++) {
+	    rnd = rnd * 1103515245 + 12345;
+	    v += (int)((rnd >> 16) & 0x7fff) - 16384;
+	}
+	// loudness changes every 1000 samples
+	int amp = 1 + (i / 1000) % 8;
+	v = v * amp / 16;
+	if (v > 32767)
+	    v = 32767;
+	else if (v < -32768)
+	    v = -32768;
+	d[i] = v;
+    }
+    switch (conv) {
+	case DataBlock::AlawToSlin:
+	case DataBlock::AlawToMulaw:
+	    data.convert(lin,DataBlock::SlinToAlaw);
+	    break;
+	case DataBlock::MulawToSlin:
+	case DataBlock::MulawToAlaw:
+	    data.convert(lin,DataBlock::SlinToMulaw);
+	    break;
+	default:
+	    data = lin;
+    }
+}
+
+G711Bench::G711Bench()
+    : BenchPlugin("g711bench","G711Bench")
+{
+}
+
+void G711Bench::bench(const Configuration& cfg)
+{
+    unsigned int samples = cfg.getIntValue("g711bench","samples",160,1);
+    unsigned int blocks = cfg.getIntValue("g711bench","blocks",200000,1);
+    int best = DataBlock::convertLevel();
+    // every kernel must produce exactly the output of the portable code
+    DataBlock ref[6];
+    DataBlock src, dst;
+    for (int i = 0; s_convs[i].src; i++) {
+	DataBlock::convertLevel(0);
+	fillSource(src,s_convs[i].conv <= DataBlock::SlinToMulaw);
+	ref[i].convert(src,s_convs[i].conv);
+	for (int level = 1; level <= best; level++) {
+	    DataBlock::convertLevel(level);
+	    dst.convert(src,s_convs[i].conv);
+	    String what;
+	    what << "level " << level << " " << s_convs[i].src << " to " << s_convs[i].dst;
+	    checkData(dst.data(),dst.length(),ref[i].data(),ref[i].length(),what);
+	}
+    }
+    // the portable code itself must encode silence as the standards say
+    check(((const unsigned char*)ref[0].data())[0] == 0xd5,"silence is not encoded as A-law 0xd5");
+    check(((const unsigned char*)ref[1].data())[0] == 0xff,"silence is not encoded as mu-law 0xff");
+    for (int level = 0; level <= best; level++)
+	run(level,samples,blocks);
+    DataBlock::convertLevel(best);
+}
+
+void G711Bench::run(int level, unsigned int samples, unsigned int blocks)
+{
+    DataBlock::convertLevel(level);
+    String res;
+    for (int i = 0; s_convs[i].src; i++) {
+	DataBlock::Conversion conv = s_convs[i].conv;
+	bool slin = (conv <= DataBlock::SlinToMulaw);
+	// frames are taken in turn from a few seconds of a noisy signal
+	DataBlock sig;
+	buildSignal(sig,conv,samples * 256);
+	unsigned int frame = samples * (slin ? 2 : 1);
+	DataBlock* src = new DataBlock[256];
+	for (unsigned int n = 0; n < 256; n++)
+	    src[n].assign((char*)sig.data() + n * frame,frame);
+	DataBlock dst;
+	u_int64_t t = Time::now();
+	for (unsigned int n = 0; n < blocks; n++)
+	    dst.convert(src[n & 0xff],conv);
+	u_int64_t tConv = Time::now() - t;
+	DataBlock last(dst);
+	// the format names are resolved on each call
+	t = Time::now();
+	for (unsigned int n = 0; n < blocks; n++)
+	    dst.convert(src[n & 0xff],s_convs[i].src,s_convs[i].dst);
+	u_int64_t tNames = Time::now() - t;
+	delete[] src;
+	String what;
+	what << "level " << level << " " << s_convs[i].src << " to " << s_convs[i].dst << " by names";
+	checkData(dst.data(),dst.length(),last.data(),last.length(),what);
+	u_int64_t total = (u_int64_t)samples * blocks;
+	res << "\r\n  " << s_convs[i].src << " to " << s_convs[i].dst << ": "
+	    << (unsigned int)(tConv ? (total / tConv) : 0) << " Msamples/s, "
+	    << (unsigned int)(tNames ? (total / tNames) : 0) << " Msamples/s by format names";
+    }
+    static const char* levels[] = { "portable", "SSE2", "AVX2" };
+    Output("Level %d (%s), %u samples per block, %u blocks:%s",
+	level,levels[level],samples,blocks,res.c_str());
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,170 @@
+/*
+ * isupbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * SS7 ISUP message processing benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+#include <yatesig.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class IsupBench : public BenchPlugin
+{
+public:
+    IsupBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+};
+
+// Circuit without hardware, it only keeps the status
+class BenchCircuit : public SignallingCircuit
+{
+public:
+    inline BenchCircuit(unsigned int code, SignallingCircuitGroup* group)
+	: SignallingCircuit(TDM,code,Idle,group)
+	{ }
+};
+
+// ISUP controller fed directly with MSUs as if received from the network
+class BenchIsup : public SS7ISUP
+{
+public:
+    inline BenchIsup(const NamedList& params)
+	: SS7ISUP(params)
+	{ setPointCode(params); }
+    SS7MSU* build(SS7MsgISUP::Type type, const SS7Label& label, unsigned int cic,
+	const NamedList& params)
+	{ return buildMSU(type,sio(),label,cic,&params); }
+    bool receive(const SS7MSU& msu, const SS7Label& label)
+	{ return receivedMSU(msu,label,0,label.sls()) == HandledMSU::Accepted; }
+    unsigned int calls()
+	{
+	    Lock mylock(this);
+	    return m_calls.count();
+	}
+};
+
+INIT_PLUGIN(IsupBench);
+
+// Build the messages of a type for all circuits
+static void buildAll(BenchIsup* isup, ObjList& list, SS7MsgISUP::Type type,
+    const SS7Label& label, unsigned int circuits, const NamedList& params)
+{
+    for (unsigned int cic = 1; cic <= circuits; cic++) {
+	SS7MSU* msu = isup->build(type,label,cic,params);
+	if (msu)
+	    list.append(msu);
+    }
+}
+
+// Feed all messages in a list to the controller
+static int receiveAll(BenchIsup* isup, ObjList& list, const SS7Label& label)
+{
+    int ok = 0;
+    for (ObjList* o = list.skipNull(); o; o = o->skipNext())
+	if (isup->receive(*static_cast<SS7MSU*>(o->get()),label))
+	    ok++;
+    return ok;
+}
+
+// Count the circuits of a group that are not used by a call
+static unsigned int available(SignallingCircuitGroup* group, unsigned int circuits)
+{
+    unsigned int n = 0;
+    for (unsigned int cic = 1; cic <= circuits; cic++) {
+	SignallingCircuit* c = group->find(cic);
+	if (c && c->available())
+	    n++;
+    }
+    return n;
+}
+
+IsupBench::IsupBench()
+    : BenchPlugin("isupbench","IsupBench")
+{
+}
+
+void IsupBench::bench(const Configuration& cfg)
+{
+    unsigned int circuits = cfg.getIntValue("isupbench","circuits",4096,1,16383);
+    int loops = cfg.getIntValue("isupbench","loops",20);
+
+    NamedList params("isupbench");
+    params.addParam("pointcodetype","ITU");
+    params.addParam("pointcode","1-1-1");
+    params.addParam("remotepointcode","2-2-2");
+    params.addParam("drop_unknown",String::boolText(false));
+    BenchIsup* isup = new BenchIsup(params);
+    SignallingCircuitGroup* group = new SignallingCircuitGroup(0,SignallingCircuitGroup::Increment,"isupbench");
+    u_int64_t t = Time::now();
+    for (unsigned int cic = 1; cic <= circuits; cic++) {
+	BenchCircuit* c = new BenchCircuit(cic,group);
+	if (!group->insert(c))
+	    TelEngine::destruct(c);
+    }
+    Output("Inserted %u circuits in " FMT64U " usec",circuits,Time::now() - t);
+    check(group->count() == circuits,"%u of %u circuits inserted",group->count(),circuits);
+    isup->SignallingCallControl::attach(group);
+
+    SS7PointCode opc(2,2,2);
+    SS7PointCode dpc(1,1,1);
+    SS7Label label(SS7PointCode::ITU,dpc,opc,0);
+    NamedList iam("");
+    iam.addParam("CalledPartyNumber","1234567");
+    iam.addParam("CallingPartyNumber","7654321");
+    ObjList msgs;
+    buildAll(isup,msgs,SS7MsgISUP::IAM,label,circuits,iam);
+    t = Time::now();
+    int calls = receiveAll(isup,msgs,label);
+    t = Time::now() - t;
+    Output("Processed %u IAM, %d accepted, in " FMT64U " usec",msgs.count(),calls,t);
+    // each IAM starts a call on its own circuit
+    check(msgs.count() == circuits,"%u IAM built for %u circuits",msgs.count(),circuits);
+    check((unsigned int)calls == circuits,"%d IAM accepted of %u",calls,circuits);
+    check(isup->calls() == circuits,"%u calls for %u IAM",isup->calls(),circuits);
+    check(!available(group,circuits),"%u circuits still available after IAM",available(group,circuits));
+
+    // Facility is not a call message, it's looked up by circuit in the controller
+    msgs.clear();
+    buildAll(isup,msgs,SS7MsgISUP::FAC,label,circuits,NamedList(""));
+    int ok = 0;
+    t = Time::now();
+    for (int i = 0; i < loops; i++)
+	ok += receiveAll(isup,msgs,label);
+    t = Time::now() - t;
+    unsigned int total = loops * msgs.count();
+    Output("Processed %u FAC on %u circuits, %d accepted, in " FMT64U " usec, " FMT64U " nsec/message",
+	total,circuits,ok,t,total ? (t * 1000 / total) : 0);
+    check(msgs.count() == circuits,"%u FAC built for %u circuits",msgs.count(),circuits);
+    check((unsigned int)ok == total,"%d FAC accepted of %u",ok,total);
+    check(isup->calls() == circuits,"%u calls left after FAC, expected %u",isup->calls(),circuits);
+    msgs.clear();
+
+    isup->SignallingCallControl::attach(0);
+    TelEngine::destruct(isup);
+    TelEngine::destruct(group);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,205 @@
+/*
+ * paramsbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * NamedList parameter access benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class ParamsBench : public BenchPlugin
+{
+public:
+    ParamsBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(int params, int loops);
+    void checkLookups(const NamedList& list, const ObjList& keys, int params, const char* what);
+};
+
+INIT_PLUGIN(ParamsBench);
+
+// Parameters of a call.route as built by a SIP channel
+static const char* s_route[] = {
+    "id", "module", "status", "address", "billid", "answered", "direction",
+    "callid", "caller", "called", "callername", "antiloop", "ip_host",
+    "ip_port", "ip_transport", "sip_uri", "sip_from", "sip_to", "sip_callid",
+    "device", "sip_contact", "sip_supported", "sip_user-agent", "sip_allow",
+    "sip_content-type", "sip_max-forwards", "sip_p-asserted-identity",
+    "connection_id", "connection_reliable", "xsip_nat_address", "rtp_addr",
+    "media", "formats", "transport", "rtp_mapping", "rtp_port",
+    "rtp_forward", "sdp_raw", "sdp_o", "sdp_s", "sdp_c", "sdp_t",
+    "sdp_m", "sdp_a", "sdp_ptime", "media_video", "formats_video",
+    "transport_video", "rtp_port_video", "crypto_video", "sdp_video_a",
+    "username", "realm", "domain", "authorized", "newcall", "domain_local",
+    "trunk", "line", "account", "reason", "oconnection_id",
+    "cdrwrite", "copyparams", "pbxoper", "pbxguest", "pbxassist", "pbx_state",
+    "tonedetect_in", "tonedetect_out", "callto", "osip_X-Billing",
+    "osip_X-Route", "osip_X-Tag", "ocaller", "ocalled", "ocallername",
+    "maxcall", "timeout", "rtp_rfc2833", "earlymedia", "handlers",
+    "droute", "dtmfpass", "forward_sdp", "autoring", "autoanswer",
+    "isup_called", "isup_calling", "isup_nai", "isup_plan", "isup_presentation",
+    "isup_screening", "isup_complete", "isup_category", "isup_format",
+    "isup_redirecting", "isup_redirection", "isup_location", "isup_cause",
+    "q931_bearer", "q931_transfer", "q931_format", "q931_channel",
+    "q931_callerplan", "q931_callertype", "q931_calledplan", "q931_calledtype",
+    "privacy", "diversion", "diversion_reason", "diversion_privacy",
+    "reg_id", "reg_expires", "reg_contact", "reg_instance", "reg_flow",
+    "billing_account", "billing_plan", "billing_rate", "billing_units",
+    0
+};
+
+// Parameters usually looked up by routing modules, some are not present
+static const char* s_lookup[] = {
+    "caller", "called", "callto", "billid", "id", "module", "username",
+    "domain", "sip_from", "ip_host", "formats", "rtp_forward", "line",
+    "account", "reason", "cdrwrite", "copyparams", "timeout", "maxcall",
+    "handlers", "autoanswer", "privacy", "diversion",
+    "error", "redirect", "pbxparams", "rtp_remoteip", "sip_referred-by",
+    0
+};
+
+// Find a parameter by walking the list in order, as done before the hash index
+static const NamedString* findLinear(const NamedList& list, const String& name)
+{
+    NamedIterator iter(list);
+    while (const NamedString* s = iter.get()) {
+	if (s->name() == name)
+	    return s;
+    }
+    return 0;
+}
+
+ParamsBench::ParamsBench()
+    : BenchPlugin("paramsbench","ParamsBench")
+{
+}
+
+void ParamsBench::bench(const Configuration& cfg)
+{
+    int loops = cfg.getIntValue("paramsbench","loops",20000);
+    String sizes = cfg.getValue("paramsbench","params","10,30,60,90,120");
+    ObjList* l = sizes.split(',',false);
+    for (ObjList* o = l->skipNull(); o; o = o->skipNext())
+	run(o->get()->toString().toInteger(),loops);
+    TelEngine::destruct(l);
+}
+
+// The looked up names and the names of all parameters must find the
+//  same parameter as a walk of the list
+void ParamsBench::checkLookups(const NamedList& list, const ObjList& keys, int params, const char* what)
+{
+    unsigned int wrong = 0;
+    unsigned int names = 0;
+    for (ObjList* k = keys.skipNull(); k; k = k->skipNext(), names++) {
+	const String& name = k->get()->toString();
+	if (list.getParam(name) != findLinear(list,name))
+	    wrong++;
+    }
+    NamedIterator iter(list);
+    while (const NamedString* s = iter.get()) {
+	names++;
+	if (list.getParam(s->name()) != findLinear(list,s->name()))
+	    wrong++;
+    }
+    check(!wrong,"%d params %s: %u of %u lookups differ from a list walk",params,what,wrong,names);
+}
+
+void ParamsBench::run(int params, int loops)
+{
+    int names = 0;
+    while (s_route[names])
+	names++;
+    if (params > names)
+	params = names;
+    if (params <= 0 || loops <= 0)
+	return;
+    Message msg("call.route");
+    for (int i = 0; i < params; i++)
+	msg.addParam(s_route[i],"0123456789abcdef");
+    // keep the names as String so their hashes are computed only once
+    ObjList keys;
+    for (int i = 0; s_lookup[i]; i++)
+	keys.append(new String(s_lookup[i]));
+
+    unsigned int found = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++)
+	for (ObjList* k = keys.skipNull(); k; k = k->skipNext())
+	    if (msg.getParam(k->get()->toString()))
+		found++;
+    u_int64_t tGet = Time::now() - t;
+    checkLookups(msg,keys,params,"built");
+
+    t = Time::now();
+    for (int n = 0; n < loops; n++)
+	for (ObjList* k = keys.skipNull(); k; k = k->skipNext())
+	    msg.setParam(k->get()->toString(),"x");
+    u_int64_t tSet = Time::now() - t;
+    checkLookups(msg,keys,params,"set");
+    unsigned int wrong = 0;
+    for (ObjList* k = keys.skipNull(); k; k = k->skipNext()) {
+	const NamedString* p = findLinear(msg,k->get()->toString());
+	if (!(p && (*p == "x")))
+	    wrong++;
+    }
+    check(!wrong,"%d params: %u of %u set parameters have the wrong value",params,wrong,keys.count());
+
+    int copies = loops / 20;
+    if (!copies)
+	copies = 1;
+    t = Time::now();
+    for (int n = 0; n < copies; n++) {
+	Message m(msg);
+	m.clearParam(YSTRING("error"));
+	m.setParam("called","123");
+	m.copyParams(msg);
+    }
+    u_int64_t tCopy = Time::now() - t;
+    // the copy must end up with the same parameters and values
+    Message m(msg);
+    m.clearParam(YSTRING("error"));
+    m.setParam("called","123");
+    m.copyParams(msg);
+    checkLookups(m,keys,params,"copied");
+    wrong = 0;
+    NamedIterator iter(msg);
+    while (const NamedString* s = iter.get()) {
+	const NamedString* p = findLinear(m,s->name());
+	if (!(p && (*p == *s)))
+	    wrong++;
+    }
+    check(!wrong && (m.length() == msg.length()),
+	"%d params: the copy has %u parameters, %u differ from the %u of the original",
+	params,m.length(),wrong,msg.length());
+
+    Output("%d params: %u lookups (%u found) in " FMT64U " usec, "
+	"%u sets in " FMT64U " usec, %d copies in " FMT64U " usec",
+	params,loops * keys.count(),found / loops,tGet,
+	loops * keys.count(),tSet,copies,tCopy);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,245 @@
+/*
+ * resampbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * Audio resampling translator throughput and quality benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+#include <yatephone.h>
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace TelEngine;
+namespace { // anonymous
+
+// Keeps the samples that come out of a translator
+class Collector : public DataConsumer
+{
+public:
+    inline Collector(const DataFormat& format, unsigned int maxSamples)
+	: DataConsumer(format), m_samples(new short[maxSamples]), m_max(maxSamples), m_count(0)
+	{ }
+    virtual ~Collector()
+	{ delete[] m_samples; }
+    virtual unsigned long Consume(const DataBlock& data, unsigned long tStamp, unsigned long flags)
+	{
+	    unsigned int n = data.length() / 2;
+	    if (n > m_max - m_count)
+		n = m_max - m_count;
+	    ::memcpy(m_samples + m_count,data.data(),n * 2);
+	    m_count += n;
+	    return invalidStamp();
+	}
+    short* m_samples;
+    unsigned int m_max;
+    unsigned int m_count;
+};
+
+class ResampBench : public BenchPlugin
+{
+public:
+    ResampBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(const String& sFormat, const String& dFormat, int level, unsigned int seconds,
+	DataBlock& ref);
+};
+
+INIT_PLUGIN(ResampBench);
+
+// Build a sine of the given frequency and amplitude
+static void buildTone(short* d, unsigned int samples, int rate, double freq, double amp)
+{
+    double w = 2 * M_PI * freq / rate;
+    for (unsigned int i = 0; i < samples; i++)
+	d[i] = (short)::floor(amp * ::sin(w * i) + 0.5);
+}
+
+// Fit a sine of known frequency by least squares, return the signal to residual ratio in dB
+static double toneSnr(const short* d, unsigned int samples, int rate, double freq)
+{
+    double w = 2 * M_PI * freq / rate;
+    double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+    for (unsigned int i = 0; i < samples; i++) {
+	double s = ::sin(w * i);
+	double c = ::cos(w * i);
+	ss += s * s;
+	cc += c * c;
+	sc += s * c;
+	ys += d[i] * s;
+	yc += d[i] * c;
+    }
+    double det = ss * cc - sc * sc;
+    if (!det)
+	return 0;
+    double a = (ys * cc - yc * sc) / det;
+    double b = (yc * ss - ys * sc) / det;
+    double sig = 0, err = 0;
+    for (unsigned int i = 0; i < samples; i++) {
+	double f = a * ::sin(w * i) + b * ::cos(w * i);
+	sig += f * f;
+	err += (d[i] - f) * (d[i] - f);
+    }
+    if (!err)
+	return 200;
+    return 10 * ::log10(sig / err);
+}
+
+// Power of a signal relative to a full amplitude sine in dB
+static double powerDb(const short* d, unsigned int samples, double amp)
+{
+    double p = 0;
+    for (unsigned int i = 0; i < samples; i++)
+	p += (double)d[i] * d[i];
+    p /= samples;
+    if (!p)
+	return -200;
+    return 10 * ::log10(p / (amp * amp / 2));
+}
+
+// Push a signal through a translator in 10ms frames, return the processing time
+static u_int64_t translate(DataSource* src, const short* sig, unsigned int samples, int rate)
+{
+    unsigned int frame = rate / 100;
+    DataBlock block;
+    u_int64_t t = Time::now();
+    unsigned long tStamp = 0;
+    for (unsigned int pos = 0; pos + frame <= samples; pos += frame) {
+	block.assign((void*)(sig + pos),frame * 2,false);
+	src->Forward(block,tStamp);
+	block.clear(false);
+	tStamp += frame;
+    }
+    return Time::now() - t;
+}
+
+ResampBench::ResampBench()
+    : BenchPlugin("resampbench","ResampBench")
+{
+}
+
+void ResampBench::bench(const Configuration& cfg)
+{
+    unsigned int seconds = cfg.getIntValue("resampbench","seconds",20,1);
+    String pairs = cfg.getValue("resampbench","pairs",
+	"slin>slin/16000,slin/16000>slin,slin/16000>slin/32000,slin/32000>slin,"
+	"slin>slin/44100,slin/44100>slin,slin/16000>slin/48000,slin/48000>slin/16000,"
+	"slin>slin/48000,slin/48000>slin,slin/44100>slin/48000,slin/48000>slin/44100");
+    int best = DataBlock::convertLevel();
+    ObjList* l = pairs.split(',',false);
+    for (ObjList* o = l->skipNull(); o; o = o->skipNext()) {
+	const String& pair = o->get()->toString();
+	int pos = pair.find('>');
+	if (pos <= 0)
+	    continue;
+	// the output of the portable code is the reference for the other levels
+	DataBlock ref;
+	for (int level = 0; level <= best; level++)
+	    run(pair.substr(0,pos),pair.substr(pos + 1),level,seconds,ref);
+    }
+    TelEngine::destruct(l);
+    DataBlock::convertLevel(best);
+}
+
+void ResampBench::run(const String& sFormat, const String& dFormat, int level, unsigned int seconds,
+    DataBlock& ref)
+{
+    DataFormat sFmt(sFormat);
+    DataFormat dFmt(dFormat);
+    int sRate = sFmt.sampleRate();
+    int dRate = dFmt.sampleRate();
+    if (!check(sRate && dRate,"unknown format in '%s' to '%s'",sFormat.c_str(),dFormat.c_str()))
+	return;
+    DataBlock::convertLevel(level);
+    DataTranslator* trans = DataTranslator::create(sFmt,dFmt);
+    if (!check(trans != 0,"cannot translate '%s' to '%s'",sFormat.c_str(),dFormat.c_str()))
+	return;
+    DataSource* src = new DataSource(sFormat);
+    Collector* out = new Collector(dFormat,dRate * (seconds + 1));
+    src->attach(trans);
+    trans->getTransSource()->attach(out);
+    unsigned int samples = sRate * seconds;
+    short* sig = new short[samples];
+    double amp = 16000;
+    buildTone(sig,samples,sRate,997,amp);
+    u_int64_t t = translate(src,sig,samples,sRate);
+    // skip the start where the filter history is still empty
+    unsigned int skip = dRate / 10;
+    double snr = 0;
+    if (out->m_count > skip + (unsigned int)dRate)
+	snr = toneSnr(out->m_samples + skip,out->m_count - skip,dRate,997);
+    unsigned int got = out->m_count;
+    String what;
+    what << sFormat << " to " << dFormat << " level " << level;
+    // all but the last partial output frame must come out
+    unsigned int expect = (unsigned int)((u_int64_t)samples * dRate / sRate);
+    check(got <= expect && got + dRate / 100 > expect,"%s: got %u samples, expected %u",
+	what.c_str(),got,expect);
+    check(snr >= 70,"%s: 997 Hz SNR %.1f dB is below 70 dB",what.c_str(),snr);
+    if (level)
+	checkData(out->m_samples,got * 2,ref.data(),ref.length(),what);
+    else
+	ref.assign(out->m_samples,got * 2);
+    char alias[64];
+    alias[0] = '\0';
+    // a tone above the output Nyquist frequency must not alias back
+    if (dRate < sRate) {
+	src->detach(trans);
+	trans->getTransSource()->detach(out);
+	TelEngine::destruct(trans);
+	trans = DataTranslator::create(sFmt,dFmt);
+	out->m_count = 0;
+	if (trans) {
+	    src->attach(trans);
+	    trans->getTransSource()->attach(out);
+	    double freq = (sRate + dRate) / 4 + 7;
+	    buildTone(sig,samples,sRate,freq,amp);
+	    translate(src,sig,samples,sRate);
+	    if (out->m_count > skip) {
+		double db = powerDb(out->m_samples + skip,out->m_count - skip,amp);
+		::snprintf(alias,sizeof(alias),", %u Hz alias %.1f dB",(unsigned int)freq,db);
+		// the tone is close to Nyquist, inside the transition band of 48000 to 44100
+		check(db <= -40,"%s: %u Hz alias %.1f dB is above -40 dB",
+		    what.c_str(),(unsigned int)freq,db);
+	    }
+	}
+    }
+    Output("%s to %s level %d: %u to %u samples in " FMT64U " usec (%u Ksamples/s), 997 Hz SNR %.1f dB%s",
+	sFormat.c_str(),dFormat.c_str(),level,samples,got,t,
+	(unsigned int)(t ? ((u_int64_t)samples * 1000 / t) : 0),snr,alias);
+    delete[] sig;
+    if (trans) {
+	src->detach(trans);
+	trans->getTransSource()->detach(out);
+    }
+    TelEngine::destruct(trans);
+    TelEngine::destruct(src);
+    TelEngine::destruct(out);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,215 @@
+/*
+ * sipbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * SIP engine transaction matching and event scheduling benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+#include <yatesip.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+// A party that only counts the messages it should send
+class BenchParty : public SIPParty
+{
+public:
+    inline BenchParty()
+	: m_sent(0), m_requests(0)
+	{ setAddr("127.0.0.1",5060,true); setAddr("127.0.0.1",5061,false); }
+    virtual void transmit(SIPEvent* event)
+	{
+	    m_sent++;
+	    if (event->getMessage() && !event->getMessage()->isAnswer())
+		m_requests++;
+	}
+    virtual const char* getProtoName() const
+	{ return "UDP"; }
+    virtual bool setParty(const URI& uri)
+	{ return true; }
+    virtual void* getTransport()
+	{ return 0; }
+    unsigned int m_sent;
+    unsigned int m_requests;
+};
+
+class BenchEngine : public SIPEngine
+{
+public:
+    inline BenchEngine(BenchParty* party)
+	: SIPEngine("YATE/bench"), m_party(party)
+	{ addAllowed("INVITE"); addAllowed("OPTIONS"); }
+    virtual bool buildParty(SIPMessage* message)
+	{ message->setParty(m_party); return true; }
+private:
+    BenchParty* m_party;
+};
+
+class SipBench : public BenchPlugin
+{
+public:
+    SipBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(int count);
+};
+
+INIT_PLUGIN(SipBench);
+
+// Build the text of an incoming request
+static void buildRequest(String& buf, const char* method, int n)
+{
+    buf.clear();
+    buf << method << " sip:bench" << n << "@127.0.0.1 SIP/2.0\r\n"
+	<< "Via: SIP/2.0/UDP 127.0.0.1:5061;branch=z9hG4bKbench" << n << "\r\n"
+	<< "From: <sip:peer@127.0.0.1>;tag=f" << n << "\r\n"
+	<< "To: <sip:bench" << n << "@127.0.0.1>\r\n"
+	<< "Call-ID: " << n << "-bench@127.0.0.1\r\n"
+	<< "CSeq: 1 " << method << "\r\n"
+	<< "Max-Forwards: 70\r\n"
+	<< "Content-Length: 0\r\n\r\n";
+}
+
+// Get all available events, answer the new incoming requests, send the rest
+static unsigned int drain(SIPEngine* engine)
+{
+    unsigned int events = 0;
+    while (SIPEvent* e = engine->getEvent()) {
+	events++;
+	SIPTransaction* t = e->getTransaction();
+	if (t && e->isIncoming() && (e->getState() == SIPTransaction::Trying)) {
+	    // leave every 4th INVITE ringing, answer all others
+	    if (t->isInvite() && !(events & 3))
+		t->setResponse(180);
+	    else
+		t->setResponse(200);
+	    delete e;
+	}
+	else
+	    engine->processEvent(e);
+    }
+    return events;
+}
+
+SipBench::SipBench()
+    : BenchPlugin("sipbench","SipBench")
+{
+}
+
+void SipBench::bench(const Configuration& cfg)
+{
+    String sizes = cfg.getValue("sipbench","transactions","1000,10000,50000");
+    ObjList* l = sizes.split(',',false);
+    for (ObjList* o = l->skipNull(); o; o = o->skipNext())
+	run(o->get()->toString().toInteger());
+    TelEngine::destruct(l);
+}
+
+void SipBench::run(int count)
+{
+    if (count <= 0)
+	return;
+    BenchParty* party = new BenchParty;
+    BenchEngine* engine = new BenchEngine(party);
+    String buf;
+
+    // a mix of incoming INVITE, incoming OPTIONS and outgoing OPTIONS
+    int outgoing = 0;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < count; n++) {
+	SIPMessage* msg = 0;
+	switch (n % 3) {
+	    case 0:
+	    case 1:
+		buildRequest(buf,(n % 3) ? "OPTIONS" : "INVITE",n);
+		msg = SIPMessage::fromParsing(party,buf.c_str(),buf.length());
+		break;
+	    default:
+		msg = new SIPMessage("OPTIONS","sip:peer@127.0.0.1:5061");
+		msg->setParty(party);
+		outgoing++;
+		break;
+	}
+	if (msg) {
+	    engine->addMessage(msg);
+	    msg->deref();
+	}
+    }
+    u_int64_t tAdd = Time::now() - t;
+
+    t = Time::now();
+    unsigned int events = drain(engine);
+    u_int64_t tDrain = Time::now() - t;
+    check(events >= (unsigned int)count,"%d transactions: only %u events",count,events);
+
+    // retransmissions of incoming requests must find their transaction
+    int retrans = count / 10;
+    if (!retrans)
+	retrans = 1;
+    ObjList msgs;
+    for (int n = 0; n < retrans; n++) {
+	int i = (n * 3) % count;
+	buildRequest(buf,(i % 3) ? "OPTIONS" : "INVITE",i);
+	SIPMessage* msg = SIPMessage::fromParsing(party,buf.c_str(),buf.length());
+	if (msg)
+	    msgs.append(msg);
+    }
+    unsigned int matched = 0;
+    t = Time::now();
+    for (ObjList* o = msgs.skipNull(); o; o = o->skipNext()) {
+	if (engine->addMessage(static_cast<SIPMessage*>(o->get())))
+	    matched++;
+    }
+    u_int64_t tMatch = Time::now() - t;
+    drain(engine);
+    check(matched == (unsigned int)retrans,"%d transactions: %u of %d retransmissions matched",
+	count,matched,retrans);
+
+    // most transactions now only wait for their timers
+    int idle = 1000;
+    t = Time::now();
+    for (int n = 0; n < idle; n++)
+	drain(engine);
+    u_int64_t tIdle = Time::now() - t;
+
+    // let some retransmission timers expire
+    Thread::msleep(1100);
+    t = Time::now();
+    unsigned int fired = drain(engine);
+    u_int64_t tFire = Time::now() - t;
+    // the first retransmission timer of every outgoing request has expired
+    check(party->m_requests >= 2 * (unsigned int)outgoing,
+	"%d transactions: %u transmissions of %d outgoing requests",count,party->m_requests,outgoing);
+
+    Output("%d transactions: added in " FMT64U " usec, %u events in " FMT64U " usec, "
+	"%u/%d matched in " FMT64U " usec, %d idle polls in " FMT64U " usec, "
+	"%u timer events in " FMT64U " usec, %u sent",
+	count,tAdd,events,tDrain,matched,retrans,tMatch,idle,tIdle,
+	fired,tFire,party->m_sent);
+    msgs.clear();
+    delete engine;
+    party->deref();
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
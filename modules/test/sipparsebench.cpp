@@ -0,0 +1,348 @@
+/*
+ * sipparsebench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * SIP message parser benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+#include <yatesip.h>
+
+// the compact header forms are not public
+#include "../../libs/ysip/util.h"
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class SipParseBench : public BenchPlugin
+{
+public:
+    SipParseBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(const char* name, const char* text, int count);
+    void checkParse(const char* name, const char* text, int len);
+};
+
+INIT_PLUGIN(SipParseBench);
+
+// Messages as captured from a live system, addresses changed
+static const char* s_invite =
+    "INVITE sip:5551234@10.0.0.1:5060 SIP/2.0\r\n"
+    "Via: SIP/2.0/UDP 10.0.0.2:5060;branch=z9hG4bK-524287-1---a5f1c9c6d30e6b8e;rport\r\n"
+    "Max-Forwards: 70\r\n"
+    "Contact: <sip:alice@10.0.0.2:5060;transport=udp>\r\n"
+    "To: <sip:5551234@10.0.0.1>\r\n"
+    "From: \"Alice\" <sip:alice@10.0.0.1>;tag=9fc2b5d1\r\n"
+    "Call-ID: ZjQ2NTM0ZjA4ZTI1YzE3ZmQwN2E3ZjZkOGQ1YzJlNmE.\r\n"
+    "CSeq: 2 INVITE\r\n"
+    "Allow: INVITE, ACK, CANCEL, BYE, NOTIFY, REFER, MESSAGE, OPTIONS, INFO, SUBSCRIBE\r\n"
+    "Content-Type: application/sdp\r\n"
+    "Supported: replaces, norefersub, extended-refer, timer, X-cisco-serviceuri\r\n"
+    "User-Agent: Softphone 4.1 (Linux)\r\n"
+    "Proxy-Authorization: Digest username=\"alice\",realm=\"Yate\","
+	"nonce=\"5bb2a0c1e4e8a4c0d6.1407748330\",uri=\"sip:5551234@10.0.0.1:5060\","
+	"response=\"0d3c5aa5f2a8c2e5c0e4d52c8c14a3b1\",algorithm=MD5\r\n"
+    "Allow-Events: presence, kpml, talk\r\n"
+    "Content-Length: 362\r\n"
+    "\r\n"
+    "v=0\r\n"
+    "o=- 13049824 13049824 IN IP4 10.0.0.2\r\n"
+    "s=softphone\r\n"
+    "c=IN IP4 10.0.0.2\r\n"
+    "t=0 0\r\n"
+    "m=audio 58532 RTP/AVP 9 8 0 101\r\n"
+    "a=rtpmap:9 G722/8000\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n"
+    "a=rtpmap:101 telephone-event/8000\r\n"
+    "a=fmtp:101 0-15\r\n"
+    "a=sendrecv\r\n"
+    "m=video 0 RTP/AVP 96\r\n"
+    "a=rtpmap:96 H264/90000\r\n"
+    "a=fmtp:96 profile-level-id=42801F\r\n"
+    "a=inactive\r\n"
+    "a=x-unknown-attribute\r\n";
+
+static const char* s_register =
+    "REGISTER sip:10.0.0.1 SIP/2.0\r\n"
+    "Via: SIP/2.0/UDP 10.0.0.3:5062;branch=z9hG4bK1792301485;rport\r\n"
+    "From: <sip:bob@10.0.0.1>;tag=1137497382\r\n"
+    "To: <sip:bob@10.0.0.1>\r\n"
+    "Call-ID: 1416702493@10.0.0.3\r\n"
+    "CSeq: 21 REGISTER\r\n"
+    "Contact: <sip:bob@10.0.0.3:5062;line=c3f0a17e7e2bb5a>;reg-id=1;"
+	"+sip.instance=\"<urn:uuid:00000000-0000-1000-8000-000b82a1b2c3>\"\r\n"
+    "Authorization: Digest username=\"bob\", realm=\"Yate\", "
+	"nonce=\"0a4f113b8e4b1bb2f5.1407748411\", uri=\"sip:10.0.0.1\", "
+	"response=\"6629fae49393a05397450978507c4ef1\", algorithm=MD5\r\n"
+    "Max-Forwards: 70\r\n"
+    "User-Agent: Deskphone 2.0\r\n"
+    "Expires: 3600\r\n"
+    "Allow: INVITE, ACK, OPTIONS, CANCEL, BYE, SUBSCRIBE, NOTIFY, INFO, REFER, UPDATE, MESSAGE\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n";
+
+static const char* s_answer =
+    "SIP/2.0 200 OK\r\n"
+    "v: SIP/2.0/UDP 10.0.0.1:5060;rport=5060;branch=z9hG4bK1514698091;received=10.0.0.1\r\n"
+    "Via: SIP/2.0/UDP 10.0.0.9:5060;branch=z9hG4bK8a3c.6d1a3f91000000000000000000000000.0\r\n"
+    "Record-Route: <sip:10.0.0.9;lr;ftag=592279320>\r\n"
+    "Record-Route: <sip:10.0.0.10;lr>\r\n"
+    "f: <sip:10.0.0.1>;tag=592279320\r\n"
+    "t: <sip:x@10.0.0.4:5060>;tag=as5c1d2e3f\r\n"
+    "i: 447460217@10.0.0.1\r\n"
+    "CSeq: 1 INVITE\r\n"
+    "Server: PBX 11.2\r\n"
+    "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, SUBSCRIBE, NOTIFY, INFO, PUBLISH\r\n"
+    "Supported: replaces, timer\r\n"
+    "m: <sip:x@10.0.0.4:5060>\r\n"
+    "Session-Expires: 1800;refresher=uac\r\n"
+    "c: application/sdp\r\n"
+    "l: 199\r\n"
+    "\r\n"
+    "v=0\r\n"
+    "o=root 1793 1793 IN IP4 10.0.0.4\r\n"
+    "s=PBX\r\n"
+    "c=IN IP4 10.0.0.4\r\n"
+    "t=0 0\r\n"
+    "m=audio 16844 RTP/AVP 0 101\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n"
+    "a=rtpmap:101 telephone-event/8000\r\n"
+    "a=fmtp:101 0-16\r\n"
+    "a=ptime:20\r\n"
+    "a=sendrecv\r\n";
+
+// Headers most message handlers look at
+static const char* s_lookup[] = {
+    "Via", "From", "To", "Call-ID", "CSeq", "Contact", "Max-Forwards", "Content-Length", 0
+};
+
+// Header lines that are moved to the body when one is built
+static bool bodyHeader(const String& name)
+{
+    return name.startsWith("Content-",false,true) && !(name &= "Content-Length");
+}
+
+// Add the body and its type to the text of a message
+static void dumpBody(String& out, const MimeBody* body)
+{
+    out << "\r\n";
+    if (!body)
+	return;
+    body->getType().buildLine(out);
+    out << "\r\n";
+    const DataBlock& data = body->getBody();
+    out.append((const char*)data.data(),data.length());
+}
+
+// Write a parsed message as text: the first line fields, the header lines
+//  with their parameters, then the body
+static void dumpMessage(String& out, const SIPMessage* msg)
+{
+    if (msg->isAnswer())
+	out << msg->version << "|" << msg->code << "|" << msg->reason << "\r\n";
+    else
+	out << msg->method << "|" << msg->uri << "|" << msg->version << "\r\n";
+    for (const ObjList* o = msg->header.skipNull(); o; o = o->skipNext()) {
+	const MimeHeaderLine* hl = static_cast<const MimeHeaderLine*>(o->get());
+	if (msg->body && bodyHeader(hl->name()))
+	    continue;
+	hl->buildLine(out);
+	out << "\r\n";
+    }
+    dumpBody(out,msg->body);
+}
+
+// Parse a message as done before the single pass parser, unfolding each line
+//  and matching the first one with regular expressions, write it as text
+static bool parseReference(String& out, const char* buf, int len)
+{
+    String* line = 0;
+    while (len > 0) {
+	line = MimeBody::getUnfoldedLine(buf,len);
+	if (!line->null())
+	    break;
+	TelEngine::destruct(line);
+    }
+    if (!line)
+	return false;
+    static const Regexp r("^\\([Ss][Ii][Pp]/[0-9]\\.[0-9]\\+\\)[[:space:]]\\+\\([0-9][0-9][0-9]\\)[[:space:]]\\+\\(.*\\)$");
+    static const Regexp r2("^\\([[:alpha:]]\\+\\)[[:space:]]\\+\\([^[:space:]]\\+\\)[[:space:]]\\+\\([Ss][Ii][Pp]/[0-9]\\.[0-9]\\+\\)$");
+    if (line->matches(r))
+	out << line->matchString(1).toUpper() << "|" << line->matchString(2).toInteger()
+	    << "|" << line->matchString(3) << "\r\n";
+    else if (line->matches(r2))
+	out << line->matchString(1).toUpper() << "|" << line->matchString(2)
+	    << "|" << line->matchString(3).toUpper() << "\r\n";
+    else {
+	line->destruct();
+	return false;
+    }
+    line->destruct();
+    int clen = -1;
+    ObjList headers;
+    const MimeHeaderLine* cType = 0;
+    while (len > 0) {
+	line = MimeBody::getUnfoldedLine(buf,len);
+	if (line->null()) {
+	    line->destruct();
+	    break;
+	}
+	int col = line->find(':');
+	String name = line->substr(0,col);
+	name.trimBlanks();
+	if ((col <= 0) || name.null()) {
+	    line->destruct();
+	    return false;
+	}
+	name = uncompactForm(name);
+	*line >> ":";
+	line->trimBlanks();
+	MimeHeaderLine* hl = 0;
+	if ((name &= "WWW-Authenticate") || (name &= "Proxy-Authenticate") ||
+	    (name &= "Authorization") || (name &= "Proxy-Authorization"))
+	    hl = new MimeAuthLine(name,*line);
+	else
+	    hl = new MimeHeaderLine(name,*line);
+	headers.append(hl);
+	if ((clen < 0) && (name &= "Content-Length"))
+	    clen = line->toInteger(-1,10);
+	else if (!cType && (name &= "Content-Type"))
+	    cType = hl;
+	line->destruct();
+    }
+    if ((clen >= 0) && (clen < len))
+	len = clen;
+    MimeBody* body = cType ? MimeBody::build(buf,len,*cType) : 0;
+    for (ObjList* o = headers.skipNull(); o; o = o->skipNext()) {
+	const MimeHeaderLine* hl = static_cast<const MimeHeaderLine*>(o->get());
+	if (body && bodyHeader(hl->name()))
+	    continue;
+	hl->buildLine(out);
+	out << "\r\n";
+    }
+    dumpBody(out,body);
+    TelEngine::destruct(body);
+    return true;
+}
+
+// Fold the header lines after each parameter separator, keep the body
+static void foldHeaders(String& out, const char* text, int len)
+{
+    const char* end = ::strstr(text,"\r\n\r\n");
+    int hdrs = end ? (end - text) : len;
+    int pos = 0;
+    for (int i = 0; i < hdrs; i++) {
+	if (text[i] != ';')
+	    continue;
+	out.append(text + pos,i + 1 - pos);
+	out << "\r\n ";
+	pos = i + 1;
+    }
+    out.append(text + pos,len - pos);
+}
+
+SipParseBench::SipParseBench()
+    : BenchPlugin("sipparsebench","SipParseBench")
+{
+}
+
+void SipParseBench::bench(const Configuration& cfg)
+{
+    int count = cfg.getIntValue("sipparsebench","iterations",100000);
+    run("INVITE",s_invite,count);
+    run("REGISTER",s_register,count);
+    run("200 OK",s_answer,count);
+}
+
+// The parser must give the same result as the old line by line parsing
+void SipParseBench::checkParse(const char* name, const char* text, int len)
+{
+    String got;
+    SIPMessage* msg = SIPMessage::fromParsing(0,text,len);
+    if (msg)
+	dumpMessage(got,msg);
+    TelEngine::destruct(msg);
+    String ref;
+    if (check(parseReference(ref,text,len),"%s: the reference parser failed",name))
+	checkString(got,ref,name);
+}
+
+void SipParseBench::run(const char* name, const char* text, int count)
+{
+    if (count <= 0)
+	return;
+    int len = ::strlen(text);
+    SIPMessage* first = SIPMessage::fromParsing(0,text,len);
+    if (!first) {
+	Output("%s: failed to parse",name);
+	return;
+    }
+    Output("%s: %d bytes, %u header lines, body %s",name,len,
+	first->header.count(),first->body ? "yes" : "no");
+    TelEngine::destruct(first);
+    checkParse(name,text,len);
+    // folded lines take the unfolding path of the parser
+    String folded;
+    foldHeaders(folded,text,len);
+    checkParse(name,folded.c_str(),folded.length());
+
+    u_int64_t t = Time::now();
+    for (int n = 0; n < count; n++) {
+	SIPMessage* msg = SIPMessage::fromParsing(0,text,len);
+	TelEngine::destruct(msg);
+    }
+    u_int64_t tParse = Time::now() - t;
+
+    SIPMessage* msg = SIPMessage::fromParsing(0,text,len);
+    unsigned int found = 0;
+    t = Time::now();
+    for (int n = 0; n < count; n++) {
+	for (const char** h = s_lookup; *h; h++)
+	    if (msg->getHeader(*h))
+		found++;
+    }
+    u_int64_t tLookup = Time::now() - t;
+
+    // lookups that need to see all header lines, including missing ones
+    unsigned int counted = 0;
+    t = Time::now();
+    for (int n = 0; n < count; n++) {
+	if (msg->getLastHeader("Via"))
+	    counted++;
+	counted += msg->countHeaders("Via");
+	counted += msg->countHeaders("Route");
+	if (msg->getHeader("Require"))
+	    counted++;
+    }
+    u_int64_t tScan = Time::now() - t;
+    TelEngine::destruct(msg);
+
+    Output("%s: %d parsed in " FMT64U " usec (%u/sec), %u header lookups in " FMT64U " usec, "
+	"%d full scans (%u) in " FMT64U " usec",
+	name,count,tParse,(unsigned int)(tParse ? (count * 1000000ULL / tParse) : 0),
+	found,tLookup,count * 4,counted,tScan);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,280 @@
+/*
+ * stringbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * String building benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class StringBench : public BenchPlugin
+{
+public:
+    StringBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void runSip(int loops);
+    void runStatus(int chans, int loops);
+    void runCdr(int loops);
+};
+
+INIT_PLUGIN(StringBench);
+
+// Counts the appends done to a string and how many times its buffer grew,
+//  without room to spare each append would allocate a new buffer
+class Counter
+{
+public:
+    inline Counter()
+	: m_appends(0), m_buffers(0), m_last(0)
+	{ }
+    inline void check(const String& str)
+	{
+	    m_appends++;
+	    if (str.capacity() != m_last) {
+		m_last = str.capacity();
+		m_buffers++;
+	    }
+	}
+    unsigned int m_appends;
+    unsigned int m_buffers;
+private:
+    unsigned int m_last;
+};
+
+// Header lines of a typical INVITE as name, value pairs
+static const char* s_headers[] = {
+    "Via", "SIP/2.0/UDP 192.168.1.10:5060;rport;branch=z9hG4bK1234567890",
+    "From", "\"Alice\" <sip:alice@example.org>;tag=1928301774",
+    "To", "<sip:bob@example.org>",
+    "Call-ID", "a84b4c76e66710@pc33.example.org",
+    "CSeq", "314159 INVITE",
+    "Max-Forwards", "70",
+    "Contact", "<sip:alice@192.168.1.10:5060>",
+    "User-Agent", "YATE/5.4.0",
+    "Allow", "ACK, INVITE, BYE, CANCEL, OPTIONS, INFO, REFER, NOTIFY, SUBSCRIBE",
+    "Supported", "replaces, timer",
+    "P-Asserted-Identity", "<sip:+40211234567@example.org>",
+    "Content-Type", "application/sdp",
+    0
+};
+
+static const char* s_statuses[] = { "incoming", "outgoing", "answered", "ringing" };
+
+// Parameters of a call.cdr message as used by a CDR file format
+static const char* s_cdr[] = {
+    "time", "1412345678.123", "billid", "1412345600-42", "chan", "sip/1234",
+    "address", "192.168.1.10:5060", "caller", "+40211234567", "called", "+40731234567",
+    "billtime", "62.345", "ringtime", "3.210", "duration", "65.555",
+    "direction", "incoming", "status", "answered", "reason", "",
+    0
+};
+
+static void buildSip(String& buf, int n, Counter* cnt)
+{
+    buf << "INVITE sip:bob@example.org SIP/2.0\r\n";
+    if (cnt)
+	cnt->check(buf);
+    for (int i = 0; s_headers[i]; i += 2) {
+	buf << s_headers[i] << ": " << s_headers[i + 1] << "\r\n";
+	if (cnt) {
+	    for (int k = 0; k < 4; k++)
+		cnt->check(buf);
+	}
+    }
+    buf << "Content-Length: " << (100 + (n & 0xff)) << "\r\n\r\n";
+    if (cnt) {
+	for (int k = 0; k < 3; k++)
+	    cnt->check(buf);
+    }
+}
+
+static void buildSipBuilder(String& buf, int n)
+{
+    StringBuilder out(buf);
+    out << "INVITE sip:bob@example.org SIP/2.0\r\n";
+    for (int i = 0; s_headers[i]; i += 2)
+	out << s_headers[i] << ": " << s_headers[i + 1] << "\r\n";
+    out << "Content-Length: " << (100 + (n & 0xff)) << "\r\n\r\n";
+}
+
+// Build a status report the way Driver::statusDetail() does
+static void buildStatus(String& s, const String* ids, const String* addrs, int chans)
+{
+    for (int i = 0; i < chans; i++)
+	s.append(ids[i],",") << "=" << s_statuses[i & 3] << "|" << addrs[i] << "|" << "sip/" << (chans + i);
+}
+
+static void buildStatusBuilder(String& s, const String* ids, const String* addrs, int chans)
+{
+    StringBuilder out(s);
+    for (int i = 0; i < chans; i++) {
+	if (out.length())
+	    out << ",";
+	out << ids[i] << "=" << s_statuses[i & 3] << "|" << addrs[i] << "|" << "sip/" << (chans + i);
+    }
+}
+
+StringBench::StringBench()
+    : BenchPlugin("stringbench","StringBench")
+{
+}
+
+void StringBench::bench(const Configuration& cfg)
+{
+    runSip(cfg.getIntValue("stringbench","messages",200000));
+    String sizes = cfg.getValue("stringbench","channels","100,1000,10000");
+    ObjList* l = sizes.split(',',false);
+    for (ObjList* o = l->skipNull(); o; o = o->skipNext()) {
+	int chans = o->get()->toString().toInteger();
+	if (chans > 0)
+	    runStatus(chans,cfg.getIntValue("stringbench","reports",1000000) / chans);
+    }
+    TelEngine::destruct(l);
+    runCdr(cfg.getIntValue("stringbench","cdrs",200000));
+}
+
+void StringBench::runSip(int loops)
+{
+    if (loops <= 0)
+	return;
+    unsigned int len = 0;
+    Counter cnt;
+    String buf;
+    buildSip(buf,0,&cnt);
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	String s;
+	buildSip(s,n,0);
+	len += s.length();
+    }
+    u_int64_t tPlain = Time::now() - t;
+    t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	String s;
+	s.reserve(512);
+	buildSip(s,n,0);
+	len += s.length();
+    }
+    u_int64_t tReserve = Time::now() - t;
+    t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	String s;
+	buildSipBuilder(s,n);
+	len += s.length();
+    }
+    u_int64_t tBuilder = Time::now() - t;
+    // all ways of building must give the same message
+    String reserved;
+    reserved.reserve(512);
+    buildSip(reserved,0,0);
+    String built;
+    buildSipBuilder(built,0);
+    checkString(reserved,buf,"reserved SIP message");
+    checkString(built,buf,"built SIP message");
+    check(buf.endsWith("Content-Length: 100\r\n\r\n"),"SIP message does not end with its body length");
+    Output("%d SIP messages of %u bytes: %u appends in %u buffers, "
+	"operator<< " FMT64U " usec, reserved " FMT64U " usec, builder " FMT64U " usec",
+	loops,buf.length(),cnt.m_appends,cnt.m_buffers,tPlain,tReserve,tBuilder);
+}
+
+void StringBench::runStatus(int chans, int loops)
+{
+    if (loops <= 0)
+	loops = 1;
+    // the channel details as Driver::statusDetail() formats them
+    String* ids = new String[chans];
+    String* addrs = new String[chans];
+    for (int i = 0; i < chans; i++) {
+	ids[i] << "sip/" << (i + 1);
+	addrs[i] << "192.168." << (i >> 8) << "." << (i & 0xff) << ":5060";
+    }
+    Counter cnt;
+    String str;
+    for (int i = 0; i < chans; i++) {
+	str.append(ids[i],",") << "=" << s_statuses[i & 3] << "|" << addrs[i] << "|" << "sip/" << (chans + i);
+	for (int k = 0; k < 7; k++)
+	    cnt.check(str);
+    }
+    unsigned int len = str.length();
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	String s;
+	buildStatus(s,ids,addrs,chans);
+    }
+    u_int64_t tPlain = Time::now() - t;
+    t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	String s;
+	buildStatusBuilder(s,ids,addrs,chans);
+    }
+    u_int64_t tBuilder = Time::now() - t;
+    String plain;
+    buildStatus(plain,ids,addrs,chans);
+    String built;
+    buildStatusBuilder(built,ids,addrs,chans);
+    check(plain == str,"report of %d channels: %u bytes differ from the expected %u",
+	chans,plain.length(),len);
+    check(built == str,"built report of %d channels: %u bytes differ from the expected %u",
+	chans,built.length(),len);
+    check(str.startsWith("sip/1=incoming|192.168.0.0:5060|sip/"),"report of %d channels starts with '%.40s'",
+	chans,str.c_str());
+    delete[] ids;
+    delete[] addrs;
+    Output("%d reports of %d channels in %u bytes: %u appends in %u buffers, "
+	"operator<< " FMT64U " usec, builder " FMT64U " usec",
+	loops,chans,len,cnt.m_appends,cnt.m_buffers,tPlain,tBuilder);
+}
+
+void StringBench::runCdr(int loops)
+{
+    if (loops <= 0)
+	return;
+    NamedList params("call.cdr");
+    String format;
+    String expect;
+    for (int i = 0; s_cdr[i]; i += 2) {
+	params.addParam(s_cdr[i],s_cdr[i + 1]);
+	format.append("${" + String(s_cdr[i]) + "}",",");
+	if (i)
+	    expect << ",";
+	expect << s_cdr[i + 1];
+    }
+    format << "\n";
+    String line;
+    u_int64_t t = Time::now();
+    for (int n = 0; n < loops; n++) {
+	line = format;
+	params.replaceParams(line);
+    }
+    u_int64_t tCdr = Time::now() - t;
+    line.trimSpaces();
+    checkString(line,expect,"CDR line");
+    Output("%d CDR lines with %u parameters in " FMT64U " usec: %s",
+	loops,params.length(),tCdr,line.c_str());
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,367 @@
+/*
+ * tcapencode.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * Known answer checks for the TCAP and MAP/CAMEL BER encoders
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// The MAP/CAMEL encoders are private to camel_map so they are built in here.
+// This module also holds a camel_map instance, don't load both of them.
+#include "../sig/camel_map.cpp"
+#include "benchmark.h"
+
+namespace { // anonymous
+
+struct TcapCase;
+struct MapCase;
+
+class TcapEncode : public BenchPlugin
+{
+public:
+    TcapEncode();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    template <class T> void checkTcap(T* tcap, const TcapCase* cases, const char* what);
+    void checkMap(const MapCase* cases);
+    bool checkEncoding(const char* what, const char* name, const String& result, const char* expected);
+};
+
+// TCAP that keeps the message it would have sent to SCCP
+template <class T> class CheckTcap : public T
+{
+public:
+    inline CheckTcap(const NamedList& params)
+	: SignallingComponent(params,&params), SS7TCAP(params), T(params)
+	{ }
+    virtual bool sendData(DataBlock& data, NamedList& params)
+	{
+	    m_sent.hexify(data.data(),data.length(),' ');
+	    return true;
+	}
+    String m_sent;
+};
+
+// TCAP user request and the message it must produce
+struct TcapCase {
+    // requests without a name only move the transaction along
+    const char* name;
+    // parameters as name=value pairs separated by ';'
+    const char* params;
+    const char* result;
+};
+
+// MAP/CAMEL component parameters and their encoding
+struct MapCase {
+    const char* name;
+    TcapXUser::UserType type;
+    const char* xml;
+    const char* result;
+};
+
+static TcapEncode s_check;
+
+// The results were produced by the DataBlock based encoders that
+//  built each element in its own buffer and inserted its length in front
+static const TcapCase s_ituCases[] = {
+    { "Begin",
+	"tcap.request.type=Begin;tcap.transaction.localTID=0a 1b 2c 3d;"
+	"tcap.dialogPDU.application-context-name=0.4.0.0.1.0.50.1;"
+	"tcap.component.count=1;"
+	"tcap.component.1.componentType=Invoke;tcap.component.1.localCID=1;"
+	"tcap.component.1.operationCodeType=local;tcap.component.1.operationCode=0;"
+	"tcap.component.1=30 06 80 01 64 9c 01 0a",
+	"62 38 48 04 0a 1b 2c 3d 6b 1e 28 1c 06 07 00 11 86 05 01 01 01 a0 11 60 "
+	"0f 80 02 07 80 a1 09 06 07 04 00 00 01 00 32 01 6c 10 a1 0e 02 01 01 02 "
+	"01 00 30 06 80 01 64 9c 01 0a" },
+    { "Continue",
+	"tcap.request.type=Continue;tcap.transaction.localTID=0a 1b 2c 3d;"
+	"tcap.transaction.remoteTID=01 02 03 04;"
+	"tcap.component.count=3;"
+	"tcap.component.1.componentType=ResultLast;tcap.component.1.remoteCID=1;"
+	"tcap.component.1.operationCodeType=local;tcap.component.1.operationCode=2;"
+	"tcap.component.1=30 03 04 01 01;"
+	"tcap.component.2.componentType=U_Error;tcap.component.2.remoteCID=2;"
+	"tcap.component.2.errorCodeType=local;tcap.component.2.errorCode=27;"
+	"tcap.component.3.componentType=Invoke;tcap.component.3.localCID=3;"
+	"tcap.component.3.remoteCID=1;"
+	"tcap.component.3.operationCodeType=global;tcap.component.3.operationCode=1.2.826.0.1249.58.1.0",
+	"65 38 48 04 0a 1b 2c 3d 49 04 01 02 03 04 6c 2a a2 0d 02 01 01 30 08 02 "
+	"01 02 30 03 04 01 01 a3 06 02 01 02 02 01 1b a1 11 02 01 03 80 01 01 06 "
+	"09 2a 86 3a 00 89 61 3a 01 00" },
+    { "End",
+	"tcap.request.type=End;tcap.transaction.localTID=0a 1b 2c 3d;"
+	"tcap.transaction.terminationBasic=true;"
+	"tcap.component.count=1;"
+	"tcap.component.1.componentType=U_Reject;tcap.component.1.remoteCID=4;"
+	"tcap.component.1.problemCode=16",
+	"64 10 49 04 01 02 03 04 6c 08 a4 06 02 01 04 81 01 01" },
+    { "Unidirectional",
+	"tcap.request.type=Unidirectional;tcap.transaction.localTID=00 00 00 07;"
+	"tcap.dialogPDU.application-context-name=0.4.0.0.1.0.25.2;"
+	"tcap.dialogPDU.userInformation.direct-reference=0.4.0.0.1.1.1.1;"
+	"tcap.dialogPDU.userInformation.encoding-type=single-ASN1-type-contructor;"
+	"tcap.dialogPDU.userInformation.encoding-contents=a0 09 80 07 91 44 77 58 10 07 f0;"
+	"tcap.component.count=1;"
+	"tcap.component.1.componentType=Invoke;tcap.component.1.localCID=5;"
+	"tcap.component.1.operationCodeType=local;tcap.component.1.operationCode=46",
+	"61 44 6b 38 28 36 06 07 00 11 86 05 01 02 01 a0 2b 60 29 80 02 07 80 a1 "
+	"09 06 07 04 00 00 01 00 19 02 be 18 28 16 06 07 04 00 00 01 01 01 01 a0 "
+	"0b a0 09 80 07 91 44 77 58 10 07 f0 6c 08 a1 06 02 01 05 02 01 2e" },
+    { "",
+	"tcap.request.type=Begin;tcap.transaction.localTID=00 00 00 08;"
+	"tcap.dialogPDU.application-context-name=0.4.0.0.1.0.50.1;"
+	"tcap.component.count=1;"
+	"tcap.component.1.componentType=Invoke;tcap.component.1.localCID=6;"
+	"tcap.component.1.operationCodeType=local;tcap.component.1.operationCode=59;"
+	"tcap.component.1=30 04 04 02 aa bb",
+	"" },
+    { "",
+	"tcap.request.type=Continue;tcap.transaction.localTID=00 00 00 08;"
+	"tcap.transaction.remoteTID=05 06 07 08",
+	"" },
+    { "U_Abort",
+	"tcap.request.type=U_Abort;tcap.transaction.localTID=00 00 00 08;"
+	"tcap.transaction.abort.cause=uAbort",
+	"67 1a 49 04 05 06 07 08 6b 12 28 10 06 07 00 11 86 05 01 01 01 a0 05 64 "
+	"03 80 01 00" },
+    { 0, 0, 0 },
+};
+
+static const TcapCase s_ansiCases[] = {
+    { "QueryWithPerm",
+	"tcap.request.type=QueryWithPerm;tcap.transaction.localTID=0a 1b 2c 3d;"
+	"tcap.dialogPDU.protocol-version=1;tcap.dialogPDU.integerApplicationId=27;"
+	"tcap.dialogPDU.integerSecurityId=4;"
+	"tcap.component.count=2;"
+	"tcap.component.1.componentType=Invoke;tcap.component.1.localCID=1;"
+	"tcap.component.1.operationCodeType=national;tcap.component.1.operationCode=2305;"
+	"tcap.component.1=f2 03 84 01 05;"
+	"tcap.component.2.componentType=InvokeNotLast;tcap.component.2.localCID=2;"
+	"tcap.component.2.remoteCID=1;"
+	"tcap.component.2.operationCodeType=private;tcap.component.2.operationCode=3",
+	"e2 2a c7 04 0a 1b 2c 3d f9 09 da 01 04 db 01 1b 80 01 04 e8 17 e9 0c cf "
+	"01 01 d0 02 09 01 f2 03 84 01 05 ed 07 cf 02 02 01 d1 01 03" },
+    { "ConversationWithPerm",
+	"tcap.request.type=ConversationWithPerm;tcap.transaction.localTID=0a 1b 2c 3d;"
+	"tcap.transaction.remoteTID=01 02 03 04;"
+	"tcap.component.count=2;"
+	"tcap.component.1.componentType=ResultLast;tcap.component.1.remoteCID=1;"
+	"tcap.component.1=f2 03 84 01 06;"
+	"tcap.component.2.componentType=U_Error;tcap.component.2.remoteCID=2;"
+	"tcap.component.2.errorCodeType=private;tcap.component.2.errorCode=129",
+	"e5 1f c7 08 0a 1b 2c 3d 01 02 03 04 e8 13 ea 08 cf 01 01 f2 03 84 01 06 "
+	"eb 07 cf 01 02 d4 02 00 81" },
+    { "Response",
+	"tcap.request.type=Response;tcap.transaction.localTID=0a 1b 2c 3d;"
+	"tcap.transaction.terminationBasic=true;"
+	"tcap.component.count=1;"
+	"tcap.component.1.componentType=U_Reject;tcap.component.1.remoteCID=3;"
+	"tcap.component.1.problemCode=16",
+	"e4 11 c7 04 01 02 03 04 e8 09 ec 07 cf 01 03 d5 02 02 02" },
+    { "",
+	"tcap.request.type=QueryWithPerm;tcap.transaction.localTID=00 00 00 08;"
+	"tcap.component.count=1;"
+	"tcap.component.1.componentType=Invoke;tcap.component.1.localCID=4;"
+	"tcap.component.1.operationCodeType=private;tcap.component.1.operationCode=7",
+	"" },
+    { "",
+	"tcap.request.type=ConversationWithPerm;tcap.transaction.localTID=00 00 00 08;"
+	"tcap.transaction.remoteTID=05 06 07 08",
+	"" },
+    { "U_Abort",
+	"tcap.request.type=U_Abort;tcap.transaction.localTID=00 00 00 08;"
+	"tcap.transaction.abort.cause=userAbortP;"
+	"tcap.transaction.abort.information=01 02",
+	"f6 0a c7 04 05 06 07 08 d8 02 01 02" },
+    { 0, 0, 0 },
+};
+
+static const MapCase s_mapCases[] = {
+    { "initialDP", TcapXUser::CAMEL,
+	"<component type=\"Invoke\" operationCode=\"initialDP\"><serviceKey>100</serviceKey>"
+	"<calledPartyNumber nature=\"national\" plan=\"isdn\" inn=\"true\">1234567890</calledPartyNumber>"
+	"<callingPartyNumber nature=\"national\" plan=\"isdn\" complete=\"true\" restrict=\"allowed\""
+	" screened=\"network-provided\">1234567890</callingPartyNumber>"
+	"<callingPartysCategory>ordinary</callingPartysCategory>"
+	"<locationNumber nature=\"international\" plan=\"isdn\" inn=\"true\" restrict=\"allowed\""
+	" screened=\"network-provided\">12345678900</locationNumber>"
+	"<bearerCapability><bearerCap coding=\"CCITT\" transfercap=\"speech\" transfermode=\"circuit\""
+	" transferrate=\"64kbit\">alaw</bearerCap></bearerCapability>"
+	"<eventTypeBCSM>collectedInfo</eventTypeBCSM><imsi>250000000000001</imsi>"
+	"<locationInformation><ageOfLocationInformation>0</ageOfLocationInformation>"
+	"<vlr-Number nature=\"international\" plan=\"isdn\">44778501700</vlr-Number>"
+	"<cellIdOrLAI><cellIdFixedLength>2500100100020</cellIdFixedLength></cellIdOrLAI></locationInformation>"
+	"<ext-basicServiceCode><teleservice>telephony</teleservice></ext-basicServiceCode>"
+	"<callReferenceNumber>f3 0a 1d 00 01</callReferenceNumber>"
+	"<mscAddress nature=\"international\" plan=\"isdn\">44778501700</mscAddress>"
+	"<calledPartyBCDNumber nature=\"unknown\" plan=\"data\">31123456789</calledPartyBCDNumber>"
+	"<timeAndTimezone>2010011125000004</timeAndTimezone></component>",
+	"30 7e 80 01 64 82 07 03 10 21 43 65 87 09 83 07 03 13 21 43 65 87 09 85 "
+	"01 0a 8a 08 84 13 21 43 65 87 09 00 bb 05 80 03 00 90 a3 9c 01 02 9f 32 "
+	"08 52 00 00 00 00 00 00 f1 bf 34 17 02 01 00 81 07 91 44 77 58 10 07 f0 "
+	"a3 09 80 07 52 00 01 10 00 20 f0 bf 35 03 83 01 11 9f 36 05 f3 0a 1d 00 "
+	"01 9f 37 07 91 44 77 58 10 07 f0 9f 38 07 83 13 21 43 65 87 f9 9f 39 08 "
+	"02 01 10 11 52 00 00 40" },
+    { "updateLocation", TcapXUser::MAP,
+	"<component type=\"Invoke\" operationCode=\"updateLocation\"><imsi>2341080000000000</imsi>"
+	"<msc-Number nature=\"international\" plan=\"isdn\">44778501700</msc-Number>"
+	"<vlr-Number nature=\"international\" plan=\"isdn\">44778501701</vlr-Number>"
+	"<vlr-Capability><supportedCamelPhases>phase1</supportedCamelPhases></vlr-Capability>"
+	"<informPreviousNetworkEntity/><add-info><imeisv>3510325476981002</imeisv></add-info></component>",
+	"30 30 04 08 32 14 80 00 00 00 00 00 81 07 91 44 77 58 10 07 f0 04 07 91 "
+	"44 77 58 10 07 f1 a6 04 80 02 07 80 8b 00 ad 0a 80 08 53 01 23 45 67 89 "
+	"01 20" },
+    { "insertSubscriberData", TcapXUser::MAP,
+	"<component type=\"Invoke\" operationCode=\"insertSubscriberData\">"
+	"<msisdn nature=\"international\" plan=\"isdn\">44778501702</msisdn>"
+	"<category>ordinary</category><subscriberStatus>serviceGranted</subscriberStatus>"
+	"<bearerServiceList><bearerService>general-dataCDS</bearerService>"
+	"<bearerService>padAccessCA-9600bps</bearerService></bearerServiceList>"
+	"<teleserviceList><teleservice>telephony</teleservice><teleservice>shortMessageMT-PP</teleservice>"
+	"<teleservice>shortMessageMO-PP</teleservice></teleserviceList>"
+	"<roamingRestrictionDueToUnsupportedFeature/></component>",
+	"30 24 81 07 91 44 77 58 10 07 f2 82 01 0a 83 01 00 a4 06 04 01 1f 04 01 "
+	"26 a6 09 04 01 11 04 01 21 04 01 22 89 00" },
+    { "connect", TcapXUser::CAMEL,
+	"<component type=\"Invoke\" operationCode=\"connect\"><destinationRoutingAddress>"
+	"<calledPartyNumber nature=\"national\" plan=\"isdn\" inn=\"true\">12345678.0</calledPartyNumber>"
+	"<calledPartyNumber nature=\"international\" plan=\"isdn\" inn=\"true\">1234567</calledPartyNumber>"
+	"</destinationRoutingAddress><callingPartysCategory>ordinary</callingPartysCategory></component>",
+	"30 16 a0 11 04 07 03 10 21 43 65 87 0f 04 06 84 10 21 43 65 07 9c 01 0a" },
+    { "requestReportBCSMEvent", TcapXUser::CAMEL,
+	"<component type=\"Invoke\" operationCode=\"requestReportBCSMEvent\"><bcsmEvents>"
+	"<bcsmEvent><eventTypeBCSM>routeSelectFailure</eventTypeBCSM><monitorMode>notifyAndContinue</monitorMode></bcsmEvent>"
+	"<bcsmEvent><eventTypeBCSM>oAnswer</eventTypeBCSM><monitorMode>interrupted</monitorMode></bcsmEvent>"
+	"<bcsmEvent><eventTypeBCSM>oDisconnect</eventTypeBCSM><monitorMode>interrupted</monitorMode>"
+	"<legID><receivingSideID>leg2</receivingSideID></legID></bcsmEvent></bcsmEvents></component>",
+	"30 1f a0 1d 30 06 80 01 04 81 01 01 30 06 80 01 07 81 01 00 30 0b 80 01 "
+	"09 81 01 00 a2 03 81 01 02" },
+    { "raw elements", TcapXUser::CAMEL,
+	"<component type=\"Invoke\" operationCode=\"initialDP\"><serviceKey>100</serviceKey>"
+	"<u type=\"context\" tag=\"5\"><u type=\"context\" tag=\"0\" enc=\"hex\">05</u>"
+	"<u type=\"context\" tag=\"1\" enc=\"int\">258</u></u>"
+	"<u type=\"universal\" tag=\"4\" enc=\"str\">yate</u></component>",
+	"30 12 80 01 64 a5 07 80 01 05 81 02 01 02 04 04 79 61 74 65" },
+    // the old encoders put multi-byte tags of raw elements after the contents
+    { "raw multi-byte tags", TcapXUser::CAMEL,
+	"<component type=\"Invoke\" operationCode=\"initialDP\"><serviceKey>100</serviceKey>"
+	"<u type=\"context\" tag=\"60\"><u type=\"context\" tag=\"0\" enc=\"hex\">05</u>"
+	"<u type=\"context\" tag=\"1\" enc=\"hex\">01 02</u></u>"
+	"<u type=\"context\" tag=\"61\" enc=\"hex\">06 07</u></component>",
+	"30 12 80 01 64 bf 3c 07 80 01 05 81 02 01 02 9f 3d 02 06 07" },
+    { 0, TcapXUser::MAP, 0, 0 },
+};
+
+// MAP dialog carried in the TCAP user information
+static const char* s_mapDialog =
+    "<userInformation><direct-reference>map-DialogueAS</direct-reference>"
+    "<encoding-contents><map-open>"
+    "<destinationReference nature=\"international\" plan=\"isdn\">44778501700</destinationReference>"
+    "<originationReference nature=\"international\" plan=\"isdn\">44778501703</originationReference>"
+    "</map-open></encoding-contents></userInformation>";
+static const char* s_mapDialogResult = "a0 12 80 07 91 44 77 58 10 07 f0 81 07 91 44 77 58 10 07 f3";
+
+// Parse a XML fragment and return its first element
+static XmlElement* parseXml(const char* xml)
+{
+    XmlDomParser parser("tcapencode",true);
+    if (!parser.parse(xml))
+	return 0;
+    return parser.fragment()->popElement();
+}
+
+TcapEncode::TcapEncode()
+    : BenchPlugin("tcapencode","TcapEncode")
+{
+}
+
+// Compare an encoding with the expected one
+bool TcapEncode::checkEncoding(const char* what, const char* name, const String& result,
+    const char* expected)
+{
+    return check(result == expected,"%s %s encoded as '%s', expected '%s'",
+	what,name,result.c_str(),expected);
+}
+
+// Run user requests through a TCAP and check what it sends
+template <class T> void TcapEncode::checkTcap(T* tcap, const TcapCase* cases, const char* what)
+{
+    for (; cases->params; cases++) {
+	NamedList params("");
+	ObjList* list = String(cases->params).split(';',false);
+	for (ObjList* o = list->skipNull(); o; o = o->skipNext()) {
+	    const String& s = o->get()->toString();
+	    int pos = s.find('=');
+	    if (pos > 0)
+		params.addParam(s.substr(0,pos),s.substr(pos + 1));
+	}
+	TelEngine::destruct(list);
+	tcap->m_sent.clear();
+	tcap->userRequest(params);
+	if (*cases->name)
+	    checkEncoding(what,cases->name,tcap->m_sent,cases->result);
+    }
+}
+
+// Encode component parameters as the XML to TCAP converter does
+void TcapEncode::checkMap(const MapCase* cases)
+{
+    XmlToTcap conv(0);
+    for (; cases->xml; cases++) {
+	XmlElement* comp = parseXml(cases->xml);
+	if (!check(comp != 0,"MAP/CAMEL %s failed to parse",cases->name))
+	    continue;
+	const String* opName = comp->getAttribute(s_tcapOpCode);
+	Operation* op = opName ? (Operation*)findOperation(cases->type,*opName) : 0;
+	DataBlock payload;
+	int err = TcapXApplication::NoError;
+	conv.encodeComponent(payload,comp,true,err,op);
+	String result;
+	result.hexify(payload.data(),payload.length(),' ');
+	checkEncoding("MAP/CAMEL",cases->name,result,cases->result);
+	TelEngine::destruct(comp);
+    }
+    XmlElement* dialog = parseXml(s_mapDialog);
+    if (!check(dialog != 0,"MAP dialog failed to parse"))
+	return;
+    NamedList params("");
+    conv.handleMAPDialog(params,dialog,s_userInformation);
+    checkEncoding("MAP","dialog",params[s_tcapEncodingContent],s_mapDialogResult);
+    TelEngine::destruct(dialog);
+}
+
+void TcapEncode::bench(const Configuration& cfg)
+{
+    NamedList params("tcapencode");
+    params.addParam("localpointcode","1-1-1");
+    params.addParam("remotepointcode","2-2-2");
+    CheckTcap<SS7TCAPITU>* itu = new CheckTcap<SS7TCAPITU>(params);
+    CheckTcap<SS7TCAPANSI>* ansi = new CheckTcap<SS7TCAPANSI>(params);
+    checkTcap(itu,s_ituCases,"ITU");
+    checkTcap(ansi,s_ansiCases,"ANSI");
+    checkMap(s_mapCases);
+    TelEngine::destruct(itu);
+    TelEngine::destruct(ansi);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,290 @@
+/*
+ * xmlparsebench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * XML stream parser and DOM arena benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2014 Null Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "benchmark.h"
+#include <yatexml.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class XmlParseBench : public BenchPlugin
+{
+public:
+    XmlParseBench();
+protected:
+    virtual void bench(const Configuration& cfg);
+private:
+    void run(const String& stream, unsigned int chunk, unsigned int stanzas);
+    void runStanzas(const char* kind, int count, unsigned int arena);
+    void checkChunks(const String& stream, const String& ref, unsigned int chunk,
+	unsigned int arena, const char* what);
+};
+
+INIT_PLUGIN(XmlParseBench);
+
+// Build a client stream with a large roster followed by chat messages
+static unsigned int buildStream(String& buf, int items, int messages)
+{
+    // collect the pieces and join them once, appending to a large String is slow
+    ObjList parts;
+    ObjList* tail = &parts;
+    String* s = new String;
+    *s << "<?xml version='1.0'?>"
+	<< "<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams'"
+	<< " from='example.org' id='bench' version='1.0'>"
+	<< "<iq type='result' id='roster_1' to='user@example.org/yate'>"
+	<< "<query xmlns='jabber:iq:roster' ver='ver14'>";
+    tail = tail->append(s);
+    for (int i = 0; i < items; i++) {
+	s = new String;
+	*s << "<item jid='contact" << i << "@example.org' name='Contact \xc8\x98tefan " << i
+	    << "' subscription='both'><group>Friends &amp; Family</group></item>";
+	tail = tail->append(s);
+    }
+    tail = tail->append(new String("</query></iq>"));
+    for (int i = 0; i < messages; i++) {
+	s = new String;
+	*s << "<message from='contact" << (i % (items ? items : 1)) << "@example.org/phone'"
+	    << " to='user@example.org/yate' type='chat' id='m" << i << "'>"
+	    << "<body>Message " << i << ": h\xc3\xa9llo w\xc3\xb6rld \xe2\x98\x8e &lt;ok&gt;</body>"
+	    << "<active xmlns='http://jabber.org/protocol/chatstates'/></message>";
+	tail = tail->append(s);
+    }
+    buf.append(&parts);
+    return messages + 1;
+}
+
+// Build a client stream with a number of typical presence, message or iq stanzas
+static void buildStanzas(String& buf, const char* kind, int count)
+{
+    ObjList parts;
+    ObjList* tail = &parts;
+    tail = tail->append(new String("<stream:stream xmlns='jabber:client'"
+	" xmlns:stream='http://etherx.jabber.org/streams' from='example.org' id='bench' version='1.0'>"));
+    for (int i = 0; i < count; i++) {
+	String* s = new String;
+	if (!::strcmp(kind,"presence"))
+	    *s << "<presence from='contact" << i << "@example.org/phone' to='user@example.org'>"
+		<< "<show>away</show><status>Out for lunch</status><priority>5</priority>"
+		<< "<c xmlns='http://jabber.org/protocol/caps' hash='sha-1'"
+		<< " node='http://yate.null.ro/yate/client' ver='QgayPKawpkPSDYmwT/WM94uAlu0='/>"
+		<< "</presence>";
+	else if (!::strcmp(kind,"message"))
+	    *s << "<message from='contact" << i << "@example.org/phone'"
+		<< " to='user@example.org/yate' type='chat' id='m" << i << "'>"
+		<< "<body>Message " << i << ": h\xc3\xa9llo w\xc3\xb6rld</body>"
+		<< "<active xmlns='http://jabber.org/protocol/chatstates'/></message>";
+	else
+	    *s << "<iq type='result' id='disco_" << i << "' from='example.org' to='user@example.org/yate'>"
+		<< "<query xmlns='http://jabber.org/protocol/disco#info'>"
+		<< "<identity category='server' type='im' name='Yate'/>"
+		<< "<feature var='http://jabber.org/protocol/disco#info'/>"
+		<< "<feature var='urn:xmpp:ping'/><feature var='jabber:iq:version'/>"
+		<< "</query></iq>";
+	tail = tail->append(s);
+    }
+    buf.append(&parts);
+}
+
+// Count the objects of an element: itself, its attributes and its children
+static unsigned int countObjects(const XmlElement* xml, unsigned int& attrs)
+{
+    unsigned int n = 1;
+    attrs += xml->attributes().count();
+    for (ObjList* o = xml->getChildren().skipNull(); o; o = o->skipNext()) {
+	XmlChild* ch = static_cast<XmlChild*>(o->get());
+	if (ch->xmlElement())
+	    n += countObjects(ch->xmlElement(),attrs);
+	else
+	    n++;
+    }
+    return n;
+}
+
+// Parse a stream in chunks as a stream does, add the text of each stanza
+static unsigned int parseStanzas(String& out, const String& stream, unsigned int chunk,
+    unsigned int arena)
+{
+    XmlDomParser parser("xmlparsebench");
+    parser.setArena(arena);
+    unsigned int got = 0;
+    for (unsigned int pos = 0; pos < stream.length(); pos += chunk) {
+	unsigned int len = stream.length() - pos;
+	if (len > chunk)
+	    len = chunk;
+	if (!parser.parse(String(stream.c_str() + pos,len)) &&
+	    (parser.error() != XmlSaxParser::Incomplete))
+	    break;
+	XmlDocument* doc = parser.document();
+	XmlElement* root = doc ? doc->root(false) : 0;
+	if (!root)
+	    continue;
+	while (XmlElement* x = root->pop()) {
+	    got++;
+	    String text;
+	    x->toString(text);
+	    out << text << "\n";
+	    TelEngine::destruct(x);
+	}
+    }
+    return got;
+}
+
+XmlParseBench::XmlParseBench()
+    : BenchPlugin("xmlparsebench","XmlParseBench")
+{
+}
+
+void XmlParseBench::bench(const Configuration& cfg)
+{
+    String stream;
+    unsigned int stanzas = buildStream(stream,
+	cfg.getIntValue("xmlparsebench","items",20000),
+	cfg.getIntValue("xmlparsebench","messages",20000));
+    // the stanzas of the whole stream parsed at once are the expected result
+    String ref;
+    check(parseStanzas(ref,stream,stream.length(),0) == stanzas,
+	"the stream parsed at once does not hold %u stanzas",stanzas);
+    String sizes = cfg.getValue("xmlparsebench","chunks","64,536,1400,16384");
+    ObjList* l = sizes.split(',',false);
+    for (ObjList* o = l->skipNull(); o; o = o->skipNext()) {
+	unsigned int chunk = o->get()->toString().toInteger();
+	run(stream,chunk,stanzas);
+	checkChunks(stream,ref,chunk,0,"stream");
+    }
+    TelEngine::destruct(l);
+    int count = cfg.getIntValue("xmlparsebench","stanzas",20000);
+    unsigned int arena = cfg.getIntValue("xmlparsebench","arena",4096,0);
+    static const char* kinds[] = { "presence", "message", "iq", 0 };
+    for (const char** k = kinds; *k; k++) {
+	runStanzas(*k,count,0);
+	if (arena)
+	    runStanzas(*k,count,arena);
+    }
+}
+
+// Stanzas parsed in chunks must be the same as those of the whole stream
+void XmlParseBench::checkChunks(const String& stream, const String& ref, unsigned int chunk,
+    unsigned int arena, const char* what)
+{
+    if (!chunk)
+	return;
+    String out;
+    parseStanzas(out,stream,chunk,arena);
+    check(out == ref,"%s in %u byte chunks, arena=%u: %u bytes of stanzas differ from the %u"
+	" of the whole stream",what,chunk,arena,out.length(),ref.length());
+}
+
+void XmlParseBench::run(const String& stream, unsigned int chunk, unsigned int stanzas)
+{
+    if (!chunk)
+	return;
+    XmlDomParser parser("xmlparsebench");
+    char* buf = new char[chunk + 1];
+    unsigned int got = 0;
+    unsigned int maxBuf = 0;
+    bool ok = true;
+    u_int64_t t = Time::now();
+    for (unsigned int pos = 0; ok && (pos < stream.length()); pos += chunk) {
+	unsigned int len = stream.length() - pos;
+	if (len > chunk)
+	    len = chunk;
+	::memcpy(buf,stream.c_str() + pos,len);
+	buf[len] = 0;
+	if (!parser.parse(buf) && (parser.error() != XmlSaxParser::Incomplete))
+	    ok = false;
+	if (parser.buffer().length() > maxBuf)
+	    maxBuf = parser.buffer().length();
+	// take completed stanzas out as a stream would do
+	XmlDocument* doc = parser.document();
+	XmlElement* root = doc ? doc->root(false) : 0;
+	if (!root)
+	    continue;
+	while (XmlElement* x = root->pop()) {
+	    got++;
+	    TelEngine::destruct(x);
+	}
+    }
+    u_int64_t tParse = Time::now() - t;
+    delete[] buf;
+    check(ok && (got == stanzas),"%u byte chunks: %u/%u stanzas, parser error '%s'",
+	chunk,got,stanzas,parser.getError());
+    Output("%u bytes in %u byte chunks: %u/%u stanzas in " FMT64U " usec (%u KB/s), max buffered %u",
+	stream.length(),chunk,got,stanzas,tParse,
+	(unsigned int)(tParse ? ((u_int64_t)stream.length() * 1000000 / 1024 / tParse) : 0),
+	maxBuf);
+}
+
+void XmlParseBench::runStanzas(const char* kind, int count, unsigned int arena)
+{
+    if (count <= 0)
+	return;
+    String stream;
+    buildStanzas(stream,kind,count);
+    XmlDomParser parser("xmlparsebench");
+    parser.setArena(arena);
+    unsigned int chunk = 1400;
+    char buf[1401];
+    unsigned int got = 0;
+    unsigned int nodes = 0;
+    unsigned int attrs = 0;
+    bool ok = true;
+    u_int64_t t = Time::now();
+    for (unsigned int pos = 0; ok && (pos < stream.length()); pos += chunk) {
+	unsigned int len = stream.length() - pos;
+	if (len > chunk)
+	    len = chunk;
+	::memcpy(buf,stream.c_str() + pos,len);
+	buf[len] = 0;
+	if (!parser.parse(buf) && (parser.error() != XmlSaxParser::Incomplete))
+	    ok = false;
+	XmlDocument* doc = parser.document();
+	XmlElement* root = doc ? doc->root(false) : 0;
+	if (!root)
+	    continue;
+	while (XmlElement* x = root->pop()) {
+	    got++;
+	    nodes += countObjects(x,attrs);
+	    TelEngine::destruct(x);
+	}
+    }
+    u_int64_t tParse = Time::now() - t;
+    check(ok && (got == (unsigned int)count),"%d %s stanzas arena=%u: got %u, parser error '%s'",
+	count,kind,arena,got,parser.getError());
+    String ref;
+    parseStanzas(ref,stream,stream.length(),0);
+    checkChunks(stream,ref,chunk,arena,kind);
+    // without an arena each attribute is allocated by the parser then copied in the element
+    unsigned int allocs = nodes + 2 * attrs;
+    if (parser.arena())
+	allocs = parser.arena()->blocks() + parser.arena()->large();
+    Output("%u/%d %s stanzas arena=%u in " FMT64U " usec: %u objects (%u attributes),"
+	" %u heap allocations, %u.%02u per stanza",
+	got,count,kind,arena,tParse,nodes + attrs,attrs,allocs,
+	got ? allocs / got : 0,got ? (allocs * 100 / got) % 100 : 0);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
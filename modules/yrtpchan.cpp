@@ -104,6 +104,8 @@ static Thread::Priority s_priority = Thread::Normal;
 static int s_tos     = 0;
 static int s_udpbuf  = 0;
 static int s_sleep   = 5;
+static int s_reactors = 0;
+static bool s_useReactors = false;
 static int s_interval= 0;
 static int s_timeout = 0;
 static int s_udptlTimeout = 0;
@@ -701,7 +703,9 @@ bool YRTPWrapper::startRTP(const char* raddr, unsigned int rport, Message& msg)
 	    m_consumer->deref();
 	}
     }
-    if (!(m_rtp->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority)) &&
+    RTPReactor* reactor = s_useReactors ? RTPReactor::pick() : 0;
+    if (!((reactor ? m_rtp->initGroup(reactor) :
+	    m_rtp->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority))) &&
 	 m_rtp->direction(m_dir)))
 	return false;
 
@@ -761,7 +765,9 @@ bool YRTPWrapper::startUDPTL(const char* raddr, unsigned int rport, Message& msg
     int msec = msg.getIntValue(YSTRING("msleep"),s_sleep);
     if (!setRemote(raddr,rport,msg))
 	return false;
-    if (!m_udptl->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority)))
+    RTPReactor* reactor = s_useReactors ? RTPReactor::pick() : 0;
+    if (!(reactor ? m_udptl->initGroup(reactor) :
+	    m_udptl->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority))))
 	return false;
 
     m_udptl->setTOS(tos);
@@ -1864,6 +1870,16 @@ void YRTPPlugin::initialize()
     s_sleep = cfg.getIntValue("general","defsleep",5);
     RTPGroup::setMinSleep(cfg.getIntValue("general","minsleep"));
     s_priority = Thread::priority(cfg.getValue("general","thread"));
+    // reactors are never stopped, their number can only grow
+    // setting zero stops assigning new sessions to the running ones
+    int reactors = cfg.getIntValue("general","reactors",0,0,64);
+    if (reactors > s_reactors) {
+	if (RTPReactor::start(reactors,s_sleep,s_priority))
+	    s_reactors = RTPReactor::pool();
+	else
+	    Debug(this,DebugWarn,"Could not start %d RTP reactors, using per call threads",reactors);
+    }
+    s_useReactors = (reactors > 0) && (s_reactors > 0);
     s_timeout = cfg.getIntValue("timeouts","timeout",3000);
     s_udptlTimeout = cfg.getIntValue("timeouts","udptl_timeout",25000);
     s_notifyMsg = cfg.getValue("timeouts","notifymsg");
@@ -28,6 +28,12 @@
 
 #include <string.h>
 
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#include <errno.h>
+#include <fcntl.h>
+#endif
+
 
 using namespace TelEngine;
 namespace { // anonymous
@@ -38,12 +44,15 @@ class YateSIPTransport;                  // SIP transport: keeps a socket, read/
 class YateSIPUDPTransport;               // UDP transport
 class YateSIPTCPTransport;               // TCP/TLS transport
 class YateSIPTransportWorker;            // A transport worker
+class YateSIPTCPReactor;                 // Serves many TCP/TLS transports
+class YateSIPReactorEntry;               // A transport served by a reactor
 class YateSIPTCPListener;                // A TCP listener
 class YateUDPParty;                      // A SIP UDP party
 class YateTCPParty;                      // A SIP TCP/TLS party
 class YateSIPEngine;                     // The SIP engine
 class YateSIPLine;                       // A line
 class YateSIPEndPoint;                   // Endpoint processor
+class YateSIPEventWorker;                // A SIP event worker
 class SIPDriver;
 
 #define EXPIRES_MIN 60
@@ -57,6 +66,13 @@ class SIPDriver;
 #define TCP_IDLE_DEF 120
 #define TCP_IDLE_MAX 600
 
+// Maximum number of socket events handled by a TCP reactor in one run
+#define REACTOR_EVENTS 64
+// Interval in microseconds at which a TCP reactor checks all its transports timers
+#define REACTOR_SWEEP 1000000
+// How many times a reactor processes a transport in a row while it has data
+#define REACTOR_BURST 8
+
 // Maximum allowed value for bind retry interval in milliseconds
 // 1 minute
 #define BIND_RETRY_MAX 60000
@@ -299,6 +315,7 @@ class YateSIPTransport : public Mutex, public RefObject, public ProtocolHolder
     friend class SIPDriver;
     friend class YateSIPEndPoint;
     friend class YateSIPTransportWorker;
+    friend class YateSIPTCPReactor;
 public:
     enum Status {
 	Idle = 0,
@@ -390,6 +407,7 @@ protected:
     String m_rtpLocalAddr;               // RTP local address
     String m_rtpNatAddr;                 // NAT IP to override RTP local address
     YateSIPTransportWorker* m_worker;    // Transport worker
+    YateSIPReactorEntry* m_reactor;      // Reactor entry if served by a reactor
     bool m_initialized;                  // Flag reset when initializing by the module and set in init()
     String m_protoAddr;                  // Proto + addr: used for debug (send/recv msg)
 private:
@@ -425,6 +443,7 @@ class YateSIPTCPTransport : public YateSIPTransport
 {
     YCLASS(YateSIPTCPTransport,YateSIPTransport);
     friend class YateTCPParty;
+    friend class YateSIPTCPReactor;
 public:
     // Build an outgoing transport
     YateSIPTCPTransport(bool tls, const String& laddr, const String& raddr, int rport);
@@ -449,6 +468,11 @@ public:
     void setFlowTimer(bool on, unsigned int interval);
     // Send an event
     void send(SIPEvent* event);
+    // Check if there are messages waiting to be sent
+    inline bool writePending() {
+	    Lock lock(this);
+	    return 0 != m_queue.skipNull();
+	}
     // Process data (read/send)
     virtual int process();
 protected:
@@ -510,6 +534,62 @@ private:
     YateSIPTransport* m_transport;
 };
 
+// A transport served by a TCP reactor, deleted only by the reactor thread
+class YateSIPReactorEntry : public GenObject
+{
+public:
+    inline YateSIPReactorEntry(YateSIPTCPReactor* reactor, YateSIPTCPTransport* trans)
+	: m_reactor(reactor), m_transport(trans), m_handle(Socket::invalidHandle()),
+	  m_write(false), m_queued(false), m_dead(false), m_terminate(false)
+	{ }
+    YateSIPTCPReactor* m_reactor;
+    YateSIPTCPTransport* m_transport;    // Referenced while in the reactor
+    SOCKET m_handle;                     // Socket handle watched by epoll
+    bool m_write;                        // Watching for socket writable
+    bool m_queued;                       // Already in the reactor's pending list
+    bool m_dead;                         // Removed, waiting to be released
+    bool m_terminate;                    // Terminate transport when released
+};
+
+// Serves incoming TCP/TLS transports from an epoll loop instead of one thread each
+class YateSIPTCPReactor : public GenObject, public Thread
+{
+public:
+    YateSIPTCPReactor(unsigned int index, Thread::Priority prio);
+    ~YateSIPTCPReactor();
+    virtual void run();
+    virtual void cleanup();
+    inline unsigned int connections() const
+	{ return m_count; }
+    // Start serving a transport, takes over the reference held by its worker
+    bool attach(YateSIPTCPTransport* trans);
+    // Stop serving a transport, it is released by the reactor thread
+    void detach(YateSIPReactorEntry* entry);
+    // Process a transport as soon as possible, used when it has data to send
+    void wakeup(YateSIPReactorEntry* entry);
+    // Start the reactors pool, return true if any is running
+    static bool start(unsigned int count, Thread::Priority prio);
+    // Pick the least loaded reactor, return 0 if there is none
+    static YateSIPTCPReactor* pick();
+    // Append status of all reactors, return their number
+    static unsigned int status(String& buf, bool details);
+    static bool supported();
+private:
+    void serve(YateSIPReactorEntry* entry);
+    void release(YateSIPReactorEntry* entry);
+    void watch(YateSIPReactorEntry* entry, bool write);
+    void unwatch(YateSIPReactorEntry* entry);
+    unsigned int m_index;
+    Mutex m_mutex;
+    int m_epoll;
+    Socket m_wakeRead;                   // Socket pair used to interrupt epoll wait
+    Socket m_wakeWrite;
+    bool m_signaled;                     // Wakeup was written and not read
+    ObjList m_entries;                   // Served transports
+    ObjList m_pending;                   // Entries to process on next run (not owned)
+    unsigned int m_count;
+};
+
 class YateSIPTCPListener : public Thread, public String, public ProtocolHolder, public YateSIPListener
 {
     friend class SIPDriver;
@@ -602,11 +682,6 @@ public:
     bool hasActiveTransaction(YateSIPTransport* trans);
     // Check if the engine has pending transactions
     bool hasInitialTransaction();
-    // Clear transactions
-    inline void clearTransactions() {
-	    Lock lck(this);
-	    m_transList.clear();
-	}
     inline bool prack() const
 	{ return m_prack; }
     inline bool info() const
@@ -694,16 +769,65 @@ private:
     bool m_keepTcpOffline;               // Don't reset party when offline
 };
 
+// A SIP event waiting in a worker queue
+class YateSIPQueuedEvent : public GenObject
+{
+public:
+    inline YateSIPQueuedEvent(SIPEvent* event)
+	: m_event(event), m_time(Time::now())
+	{ }
+    virtual ~YateSIPQueuedEvent()
+	{ delete m_event; }
+    SIPEvent* m_event;
+    u_int64_t m_time;
+};
+
+// Processes the SIP events of the dialogs whose Call-ID hashes to it
+class YateSIPEventWorker : public Thread
+{
+    friend class YateSIPEndPoint;
+public:
+    YateSIPEventWorker(YateSIPEndPoint* ep, unsigned int index, Thread::Priority prio);
+    ~YateSIPEventWorker();
+    virtual void run();
+    virtual void cleanup();
+    // Queue an event to be processed, take ownership of it on success
+    // Refuse it if the queue is full unless forced
+    bool enqueue(SIPEvent* event, bool force);
+    // Append status: Queued|MaxQueued|Events|AvgLatency|MaxLatency|Rejected
+    void status(String& buf);
+private:
+    YateSIPEndPoint* m_endpoint;
+    unsigned int m_index;
+    Mutex m_mutex;                       // Protect queue and counters
+    Semaphore m_wake;                    // Signaled when an event is queued
+    ObjList m_queue;                     // Queued events
+    ObjList* m_tail;                     // Last node of the queue
+    unsigned int m_queued;
+    unsigned int m_maxQueued;
+    unsigned int m_events;               // Events processed
+    u_int64_t m_latency;                 // Total time spent by events in queue
+    u_int64_t m_maxLatency;
+    unsigned int m_rejected;             // Requests rejected while queue was full
+};
+
 class YateSIPEndPoint : public Thread
 {
     friend class SIPDriver;
     friend class YateSIPTCPListener;
+    friend class YateSIPEventWorker;
 public:
     YateSIPEndPoint(Thread::Priority prio = Thread::Normal,
 	unsigned int partyMutexCount = 5);
     ~YateSIPEndPoint();
     bool Init(void);
     void run(void);
+    // Process an event retrieved from engine
+    void dispatch(SIPEvent* e);
+    // Start the event workers, events are processed by endpoint if none
+    void startWorkers(unsigned int count, Thread::Priority prio);
+    // Stop the event workers, drop events they did not process
+    void stopWorkers();
     bool incoming(SIPEvent* e, SIPTransaction* t);
     void invite(SIPEvent* e, SIPTransaction* t);
     void regReq(SIPEvent* e, SIPTransaction* t);
@@ -753,14 +877,10 @@ public:
     void initializing(bool start);
     inline YateSIPEngine* engine() const
 	{ return m_engine; }
-    inline void incFailedAuths() 
-	{ m_failedAuths++; }
-    inline unsigned int failedAuths()
-    {
-	unsigned int tmp = m_failedAuths;
-	m_failedAuths = 0;
-	return tmp;
-    }
+    // Count a failed authentication, it may be called from any worker
+    void incFailedAuths();
+    // Retrieve and reset the failed authentications count
+    unsigned int failedAuths();
     inline unsigned int timedOutTrs()
     {
 	unsigned int tmp = m_timedOutTrs;
@@ -776,13 +896,20 @@ public:
     MutexPool m_partyMutexPool;          // SIPParty mutex pool
     // Check if data is allowed to be read from socket(s) and processed
     static bool canRead();
+    // Events pending processing, used for flood detection
+    static inline int floodLevel()
+	{ return s_evCount + s_evQueued; }
     static int s_evCount;
+    static int s_evQueued;               // Events waiting in worker queues
 private:
     YateSIPEngine *m_engine;
     Mutex m_mutex;                       // Protect transports and listeners
     ObjList m_transports;                // All transports (non UDP are not owned)
     YateSIPUDPTransport* m_defTransport; // Default transport (pointer to object in m_transports)
     ObjList m_listeners;                 // Listeners list
+    Mutex m_workerMutex;                 // Protect the event workers
+    YateSIPEventWorker** m_workers;      // Event workers, by Call-ID hash
+    unsigned int m_workerCount;
 
     unsigned int m_failedAuths;
     unsigned int m_timedOutTrs;
@@ -1061,6 +1188,8 @@ private:
     void msgStatusAccounts(Message& msg);
     void msgStatusTransports(Message& msg, bool showUdp, bool showTcp, bool showTls);
     void msgStatusListener(Message& msg);
+    void msgStatusWorkers(Message& msg);
+    void msgStatusReactors(Message& msg);
     void msgStatusTransport(Message& msg, const String& id);
 
     SDPParser m_parser;
@@ -1100,8 +1229,11 @@ static Mutex s_globalMutex(true,"SIPGlobal"); // Protect globals (don't use the
 static unsigned int s_engineStop = 0;    // engine.stop message counter
 static bool s_engineHalt = false;        // engine.halt received
 static unsigned int s_bindRetryMs = 500; // Listeners bind retry interval
+static ObjList s_reactors;               // TCP reactors (not owned)
+static Mutex s_reactorsMutex(false,"SIPReactors"); // Protect the TCP reactors list
 static String s_realm = "Yate";
 static int s_floodEvents = 100;
+static unsigned int s_workerQueue = 1000;  // Maximum events queued to a worker
 static bool s_floodProtection = true;
 static int s_maxForwards = 20;
 static int s_nat_refresh = 25;
@@ -1142,6 +1274,7 @@ static String s_statusCmd = "status";
 static u_int64_t s_printFloodTime = 0;
 
 int YateSIPEndPoint::s_evCount = 0;
+int YateSIPEndPoint::s_evQueued = 0;
 
 // DTMF methods
 static bool s_checkAllowInfo = true;         // Check Allow in INVITE and OK for INFO support
@@ -2389,7 +2522,7 @@ YateSIPTransport::YateSIPTransport(int proto, const String& id, Socket* sock, in
     m_sock(sock), m_maxpkt(1500),
     m_local(proto == Udp ? AF_INET : PF_INET),
     m_remote(proto == Udp ? AF_INET : PF_INET),
-    m_worker(0), m_initialized(false)
+    m_worker(0), m_reactor(0), m_initialized(false)
 {
     Debug(&plugin,DebugAll,"Transport(%s) created [%p]",m_id.c_str(),this);
 }
@@ -2428,6 +2561,13 @@ bool YateSIPTransport::init(const NamedList& params, const NamedList& defs,
 	m_sock->getSockName(m_local);
 	m_sock->getPeerName(m_remote);
     }
+    // Incoming connections may share a reactor, outgoing need to (re)connect
+    YateSIPTCPTransport* tcp = tcpTransport();
+    if (tcp && !tcp->outgoing()) {
+	YateSIPTCPReactor* reactor = YateSIPTCPReactor::pick();
+	if (reactor && reactor->attach(tcp))
+	    return true;
+    }
     m_worker = new YateSIPTransportWorker(this,prio);
     if (m_worker->startup())
 	return true;
@@ -2501,6 +2641,26 @@ void YateSIPTransport::terminate(const char* reason)
 {
     XDebug(&plugin,DebugInfo,"YateSIPTransport::terminate(%s) [%p]",reason,this);
     changeStatus(Terminating);
+    if (m_reactor) {
+	bool wait = false;
+	lock();
+	if (m_reactor) {
+	    if (Thread::current() != m_reactor->m_reactor)
+		wait = true;
+	    m_reactor->m_reactor->detach(m_reactor);
+	    if (!wait)
+		m_reactor = 0;
+	}
+	unlock();
+	if (wait) {
+	    unsigned int n = 500;
+	    while (m_reactor && n--)
+		Thread::idle();
+	    if (m_reactor)
+		Debug(&plugin,DebugFail,"Transport(%s) terminating while served by reactor [%p]",
+		    m_id.c_str(),this);
+	}
+    }
     if (m_worker) {
 	bool wait = false;
 	lock();
@@ -2736,7 +2896,7 @@ int YateSIPUDPTransport::process()
 	if (!m_sock)
 	    return Thread::idleUsec();
     }
-    int& evc = YateSIPEndPoint::s_evCount;
+    int evc = YateSIPEndPoint::floodLevel();
     // Do nothing if the endpoint is flooded with events or terminating
     if (!(YateSIPEndPoint::canRead() || ((evc & 3) == 0)))
 	return Thread::idleUsec();
@@ -2779,7 +2939,7 @@ int YateSIPUDPTransport::process()
     b[res] = 0;
     if (s_printMsg)
 	printRecvMsg(b,res);
-    if (s_floodProtection && s_floodEvents && plugin.ep() && plugin.ep()->s_evCount >= s_floodEvents && !msgIsAllowed(b,res)) {
+    if (s_floodProtection && s_floodEvents && plugin.ep() && YateSIPEndPoint::floodLevel() >= s_floodEvents && !msgIsAllowed(b,res)) {
 	if (Time::now() >= s_printFloodTime) {
 	    Debug(&plugin,DebugWarn,"Flood detected, dropping INVITE/REGISTER/SUBSCRIBE/OPTIONS messages, allowing reINVITES");
 	    s_printFloodTime = Time::now() + 10000000;
@@ -2879,6 +3039,8 @@ void YateSIPTCPTransport::send(SIPEvent* event)
     if (m_queue.find(msg) || !msg->ref())
 	return;
     m_queue.append(msg);
+    if (m_reactor)
+	m_reactor->m_reactor->wakeup(m_reactor);
 #ifdef XDEBUG
     String tmp;
     getMsgLine(tmp,msg);
@@ -3440,6 +3602,316 @@ void YateSIPTransportWorker::cleanupTransport(bool final, bool terminate)
     trans = 0;
 }
 
+YateSIPTCPReactor::YateSIPTCPReactor(unsigned int index, Thread::Priority prio)
+    : Thread("YSIP Reactor",prio),
+    m_index(index), m_mutex(false,"YateSIPTCPReactor"), m_epoll(-1),
+    m_signaled(false), m_count(0)
+{
+    DDebug(&plugin,DebugAll,"YateSIPTCPReactor(%u) [%p]",index,this);
+#ifdef HAVE_EPOLL
+    m_epoll = ::epoll_create(256);
+    if (m_epoll < 0) {
+	Debug(&plugin,DebugWarn,"TCP reactor failed to create epoll: %d [%p]",errno,this);
+	return;
+    }
+    ::fcntl(m_epoll,F_SETFD,FD_CLOEXEC);
+    if (Socket::createPair(m_wakeRead,m_wakeWrite) && m_wakeRead.setBlocking(false)) {
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = 0;
+	if (!::epoll_ctl(m_epoll,EPOLL_CTL_ADD,m_wakeRead.handle(),&ev))
+	    return;
+    }
+    Debug(&plugin,DebugWarn,"TCP reactor failed to create wakeup sockets [%p]",this);
+    ::close(m_epoll);
+    m_epoll = -1;
+#endif
+}
+
+YateSIPTCPReactor::~YateSIPTCPReactor()
+{
+    DDebug(&plugin,DebugAll,"~YateSIPTCPReactor(%u) [%p]",m_index,this);
+#ifdef HAVE_EPOLL
+    if (m_epoll >= 0)
+	::close(m_epoll);
+#endif
+}
+
+void YateSIPTCPReactor::run()
+{
+#ifdef HAVE_EPOLL
+    DDebug(&plugin,DebugAll,"YateSIPTCPReactor(%u) started [%p]",m_index,this);
+    struct epoll_event events[REACTOR_EVENTS];
+    u_int64_t sweep = Time::now() + REACTOR_SWEEP;
+    while (!Thread::check(false)) {
+	m_mutex.lock();
+	int timeout = m_pending.skipNull() ? 0 : Thread::idleMsec();
+	m_mutex.unlock();
+	int n = ::epoll_wait(m_epoll,events,REACTOR_EVENTS,timeout);
+	if (n < 0) {
+	    if (errno != EINTR) {
+		Debug(&plugin,DebugWarn,"TCP reactor epoll wait failed: %d [%p]",errno,this);
+		Thread::msleep(1);
+	    }
+	    n = 0;
+	}
+	u_int64_t now = Time::now();
+	// while halting transports wait to be the last ones referencing themselves
+	bool all = s_engineHalt || (now >= sweep);
+	if (all)
+	    sweep = now + REACTOR_SWEEP;
+	ObjList run;
+	ObjList* tail = &run;
+	ObjList dead;
+	m_mutex.lock();
+	for (int i = 0; i < n; i++) {
+	    YateSIPReactorEntry* entry = static_cast<YateSIPReactorEntry*>(events[i].data.ptr);
+	    if (!entry) {
+		char buf[64];
+		while (m_wakeRead.readData(buf,sizeof(buf)) > 0)
+		    ;
+		m_signaled = false;
+		continue;
+	    }
+	    if (entry->m_queued || entry->m_dead || all)
+		continue;
+	    entry->m_queued = true;
+	    tail = tail->append(entry);
+	    tail->setDelete(false);
+	}
+	while (YateSIPReactorEntry* entry = static_cast<YateSIPReactorEntry*>(m_pending.remove(false))) {
+	    if (all || entry->m_dead)
+		continue;
+	    tail = tail->append(entry);
+	    tail->setDelete(false);
+	}
+	for (ObjList* o = m_entries.skipNull(); o; ) {
+	    YateSIPReactorEntry* entry = static_cast<YateSIPReactorEntry*>(o->get());
+	    if (entry->m_dead) {
+		o->remove(false);
+		dead.append(entry);
+		o = o->skipNull();
+		continue;
+	    }
+	    if (all) {
+		entry->m_queued = true;
+		tail = tail->append(entry);
+		tail->setDelete(false);
+	    }
+	    o = o->skipNext();
+	}
+	m_mutex.unlock();
+	while (YateSIPReactorEntry* entry = static_cast<YateSIPReactorEntry*>(dead.remove(false)))
+	    release(entry);
+	for (ObjList* o = run.skipNull(); o; o = o->skipNext())
+	    serve(static_cast<YateSIPReactorEntry*>(o->get()));
+    }
+    DDebug(&plugin,DebugAll,"YateSIPTCPReactor(%u) terminated [%p]",m_index,this);
+#endif
+}
+
+void YateSIPTCPReactor::cleanup()
+{
+    s_reactorsMutex.lock();
+    s_reactors.remove(this,false);
+    s_reactorsMutex.unlock();
+    // transports still served are left to terminate by themselves
+    m_mutex.lock();
+    ObjList entries;
+    while (GenObject* entry = m_entries.remove(false))
+	entries.append(entry);
+    m_pending.clear();
+    m_mutex.unlock();
+    while (YateSIPReactorEntry* entry = static_cast<YateSIPReactorEntry*>(entries.remove(false)))
+	release(entry);
+}
+
+bool YateSIPTCPReactor::attach(YateSIPTCPTransport* trans)
+{
+    YateSIPReactorEntry* entry = new YateSIPReactorEntry(this,trans);
+    Lock lck(trans);
+    watch(entry,false);
+    if (entry->m_handle == Socket::invalidHandle()) {
+	delete entry;
+	return false;
+    }
+    trans->m_reactor = entry;
+    lck.drop();
+    Lock lock(m_mutex);
+    m_entries.append(entry);
+    m_count++;
+    // process it once, there may be data received while it was set up
+    entry->m_queued = true;
+    m_pending.insert(entry)->setDelete(false);
+    DDebug(&plugin,DebugAll,"TCP reactor %u serving '%s' connections=%u [%p]",
+	m_index,trans->toString().c_str(),m_count,this);
+    return true;
+}
+
+void YateSIPTCPReactor::detach(YateSIPReactorEntry* entry)
+{
+    Lock lock(m_mutex);
+    if (entry->m_dead)
+	return;
+    entry->m_dead = true;
+    m_count--;
+    if (!m_signaled) {
+	m_signaled = true;
+	m_wakeWrite.writeData("",1);
+    }
+}
+
+void YateSIPTCPReactor::wakeup(YateSIPReactorEntry* entry)
+{
+    if (Thread::current() == this)
+	return;
+    Lock lock(m_mutex);
+    if (entry->m_queued || entry->m_dead)
+	return;
+    entry->m_queued = true;
+    m_pending.insert(entry)->setDelete(false);
+    if (!m_signaled) {
+	m_signaled = true;
+	m_wakeWrite.writeData("",1);
+    }
+}
+
+// Process a transport until it has nothing more to read
+void YateSIPTCPReactor::serve(YateSIPReactorEntry* entry)
+{
+    // keep the transport alive while calling its method, like a worker does
+    RefPointer<YateSIPTCPTransport> trans = entry->m_transport;
+    int n = 0;
+    for (int i = 0; !n && (i < REACTOR_BURST); i++)
+	n = trans->process();
+    Lock lock(m_mutex);
+    entry->m_queued = false;
+    if (entry->m_dead)
+	return;
+    if (n < 0) {
+	entry->m_dead = true;
+	entry->m_terminate = true;
+	m_count--;
+	return;
+    }
+    // still reading, let others get served and come back on next run
+    if (!n) {
+	entry->m_queued = true;
+	m_pending.insert(entry)->setDelete(false);
+    }
+    lock.drop();
+    bool write = trans->writePending();
+    if (write != entry->m_write)
+	watch(entry,write);
+}
+
+// Stop watching a dead entry, release the transport and delete the entry
+void YateSIPTCPReactor::release(YateSIPReactorEntry* entry)
+{
+    YateSIPTCPTransport* trans = entry->m_transport;
+    trans->lock();
+    unwatch(entry);
+    if (trans->m_reactor == entry)
+	trans->m_reactor = 0;
+    trans->unlock();
+    DDebug(&plugin,DebugAll,"TCP reactor %u released '%s' [%p]",
+	m_index,trans->toString().c_str(),this);
+    if (entry->m_terminate)
+	trans->terminate();
+    trans->deref();
+    delete entry;
+}
+
+// Watch the transport socket for reading and optionally writing
+void YateSIPTCPReactor::watch(YateSIPReactorEntry* entry, bool write)
+{
+#ifdef HAVE_EPOLL
+    Socket* sock = entry->m_transport->m_sock;
+    SOCKET handle = sock ? sock->handle() : Socket::invalidHandle();
+    if (handle == Socket::invalidHandle())
+	return;
+    struct epoll_event ev;
+    ev.events = write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.ptr = entry;
+    int op = (handle == entry->m_handle) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (::epoll_ctl(m_epoll,op,handle,&ev)) {
+	Debug(&plugin,DebugMild,"TCP reactor failed to watch '%s': %d [%p]",
+	    entry->m_transport->toString().c_str(),errno,this);
+	return;
+    }
+    entry->m_handle = handle;
+    entry->m_write = write;
+#endif
+}
+
+// Remove the transport socket from epoll if the transport still owns it
+void YateSIPTCPReactor::unwatch(YateSIPReactorEntry* entry)
+{
+#ifdef HAVE_EPOLL
+    Socket* sock = entry->m_transport->m_sock;
+    struct epoll_event ev;
+    if (sock && (entry->m_handle != Socket::invalidHandle()) && (sock->handle() == entry->m_handle))
+	::epoll_ctl(m_epoll,EPOLL_CTL_DEL,entry->m_handle,&ev);
+#endif
+    entry->m_handle = Socket::invalidHandle();
+}
+
+bool YateSIPTCPReactor::supported()
+{
+#ifdef HAVE_EPOLL
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool YateSIPTCPReactor::start(unsigned int count, Thread::Priority prio)
+{
+    if (!count)
+	return false;
+    if (!supported()) {
+	Debug(&plugin,DebugNote,"TCP reactors are not supported on this platform");
+	return false;
+    }
+    Lock lock(s_reactorsMutex);
+    for (unsigned int i = s_reactors.count(); i < count; i++) {
+	YateSIPTCPReactor* r = new YateSIPTCPReactor(i,prio);
+	if (r->m_epoll < 0 || !r->startup()) {
+	    Debug(&plugin,DebugWarn,"Failed to start TCP reactor %u",i);
+	    delete r;
+	    break;
+	}
+	s_reactors.append(r)->setDelete(false);
+    }
+    return s_reactors.skipNull() != 0;
+}
+
+YateSIPTCPReactor* YateSIPTCPReactor::pick()
+{
+    Lock lock(s_reactorsMutex);
+    YateSIPTCPReactor* best = 0;
+    for (ObjList* o = s_reactors.skipNull(); o; o = o->skipNext()) {
+	YateSIPTCPReactor* r = static_cast<YateSIPTCPReactor*>(o->get());
+	if (!best || (r->connections() < best->connections()))
+	    best = r;
+    }
+    return best;
+}
+
+unsigned int YateSIPTCPReactor::status(String& buf, bool details)
+{
+    Lock lock(s_reactorsMutex);
+    unsigned int n = 0;
+    for (ObjList* o = s_reactors.skipNull(); o; o = o->skipNext(), n++) {
+	if (!details)
+	    continue;
+	YateSIPTCPReactor* r = static_cast<YateSIPTCPReactor*>(o->get());
+	buf.append(String(r->m_index),",") << "=" << r->connections();
+    }
+    return n;
+}
+
+
 
 YateSIPTCPListener::YateSIPTCPListener(int proto, const String& name, const NamedList& params)
     : Thread("YSIP Listener",Thread::priority(params.getValue("thread"))),
@@ -3891,7 +4363,9 @@ void YateSIPEngine::transportChangedStatus(YateSIPTransport* trans, int stat, co
 	return;
     // Clear transactions
     Lock lock(this);
-    for (ObjList* l = m_transList.skipNull(); l; l = l->skipNext()) {
+    ObjList list;
+    getTransactions(list);
+    for (ObjList* l = list.skipNull(); l; l = l->skipNext()) {
 	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
 	if (t->initialMessage() && t->initialMessage()->getParty() &&
 	    trans == t->initialMessage()->getParty()->getTransport()) {
@@ -3910,7 +4384,9 @@ bool YateSIPEngine::hasActiveTransaction(YateSIPTransport* trans)
     if (!trans)
 	return false;
     Lock lock(this);
-    for (ObjList* l = m_transList.skipNull(); l; l = l->skipNext()) {
+    ObjList list;
+    getTransactions(list);
+    for (ObjList* l = list.skipNull(); l; l = l->skipNext()) {
 	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
 	if (t->isActive() && t->initialMessage() && t->initialMessage()->getParty() &&
 	    trans == t->initialMessage()->getParty()->getTransport()	    )
@@ -3923,7 +4399,9 @@ bool YateSIPEngine::hasActiveTransaction(YateSIPTransport* trans)
 bool YateSIPEngine::hasInitialTransaction()
 {
     Lock lock(this);
-    for (ObjList* l = m_transList.skipNull(); l; l = l->skipNext()) {
+    ObjList list;
+    getTransactions(list);
+    for (ObjList* l = list.skipNull(); l; l = l->skipNext()) {
 	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
 	if (t->getState() == SIPTransaction::Initial)
 	    return true;
@@ -4081,6 +4559,7 @@ YateSIPEndPoint::YateSIPEndPoint(Thread::Priority prio, unsigned int partyMutexC
     : Thread("YSIP EndPoint",prio),
       m_partyMutexPool(partyMutexCount,true,"SIPParty"),
       m_engine(0), m_mutex(true,"YateSIPEndPoint"), m_defTransport(0),
+      m_workerMutex(false,"YateSIPEndPoint::workers"), m_workers(0), m_workerCount(0),
       m_failedAuths(0),m_timedOutTrs(0), m_timedOutByes(0)
 {
     Debug(&plugin,DebugAll,"YateSIPEndPoint::YateSIPEndPoint(%s) [%p]",
@@ -4090,6 +4569,9 @@ YateSIPEndPoint::YateSIPEndPoint(Thread::Priority prio, unsigned int partyMutexC
 YateSIPEndPoint::~YateSIPEndPoint()
 {
     Debug(&plugin,DebugAll,"YateSIPEndPoint::~YateSIPEndPoint() [%p]",this);
+    stopWorkers();
+    delete[] m_workers;
+    m_workers = 0;
     plugin.channels().clear();
     s_lines.clear();
     if (m_engine) {
@@ -4482,7 +4964,21 @@ bool YateSIPEndPoint::Init()
 // Check if data is allowed to be read from socket(s) and processed
 bool YateSIPEndPoint::canRead()
 {
-    return s_floodEvents <= 1 || (s_evCount < s_floodEvents) || Engine::exiting();
+    return s_floodEvents <= 1 || (floodLevel() < s_floodEvents) || Engine::exiting();
+}
+
+void YateSIPEndPoint::incFailedAuths()
+{
+    Lock lck(plugin);
+    m_failedAuths++;
+}
+
+unsigned int YateSIPEndPoint::failedAuths()
+{
+    Lock lck(plugin);
+    unsigned int tmp = m_failedAuths;
+    m_failedAuths = 0;
+    return tmp;
 }
 
 void YateSIPEndPoint::run()
@@ -4490,78 +4986,231 @@ void YateSIPEndPoint::run()
     for (;;)
     {
 	if (!canRead()) {
-	    if (s_evCount == s_floodEvents)
-	        Debug(&plugin,DebugMild,"Flood detected: %d handled events",s_evCount);
-	    else if ((s_evCount % s_floodEvents) == 0)
-	        Debug(&plugin,DebugWarn,"Severe flood detected: %d events",s_evCount);
+	    int level = floodLevel();
+	    if (level == s_floodEvents)
+	        Debug(&plugin,DebugMild,"Flood detected: %d handled events",level);
+	    else if ((level % s_floodEvents) == 0)
+	        Debug(&plugin,DebugWarn,"Severe flood detected: %d events",level);
 	}
 	SIPEvent* e = m_engine->getEvent();
-	if (e)
+	if (e) {
 	    s_evCount++;
+	    dispatch(e);
+	}
 	else 
 	    s_evCount = 0;
-	// hack: use a loop so we can use break and continue
-	for (; e; m_engine->processEvent(e),e = 0) {
-	    SIPTransaction* t = e->getTransaction();
-	    if (!t)
-		continue;
-	    plugin.lock();
+	if (s_evCount || s_engineHalt)
+	    Thread::check();
+	else
+	    Thread::usleep(Thread::idleUsec());
+    }
+}
 
-	    if (t->isOutgoing() && t->getResponseCode() == 408) {
-	    	if (t->getMethod() == YSTRING("BYE")) {
-		    DDebug(&plugin,DebugInfo,"BYE for transaction %p has timed out",t);
-		    m_timedOutByes++;
-		    plugin.changed();
-		}
-		if (e->getState() == SIPTransaction::Cleared && e->getUserData()) {
-		    DDebug(&plugin,DebugInfo,"Transaction %p has timed out",t);
-		    m_timedOutTrs++;
-		    plugin.changed();
-		}
+// Process an event, queue it to the worker of its dialog if we have workers
+void YateSIPEndPoint::dispatch(SIPEvent* e)
+{
+    if (m_workerCount && Thread::current() == this) {
+	SIPTransaction* t = e->getTransaction();
+	unsigned int idx = t ? (t->getCallID().hash() % m_workerCount) : 0;
+	// Only new requests outside dialogs may be refused, other events
+	//  must be processed or their transactions and dialogs get stuck
+	bool force = !(t && (e->getState() == SIPTransaction::Trying) &&
+	    !e->isOutgoing() && !t->getUserData() && !t->getDialogTag());
+	Lock lck(m_workerMutex);
+	if (m_workers[idx]) {
+	    if (m_workers[idx]->enqueue(e,force)) {
+		s_evQueued++;
+		return;
 	    }
+	    lck.drop();
+	    DDebug(&plugin,DebugNote,"Worker %u queue full, rejecting %s transaction %p",
+		idx,t->getMethod().c_str(),t);
+	    t->setResponse(503);
+	    delete e;
+	    return;
+	}
+    }
+    // hack: use a loop so we can use break and continue
+    for (; e; m_engine->processEvent(e),e = 0) {
+	SIPTransaction* t = e->getTransaction();
+	if (!t)
+	    continue;
+	plugin.lock();
 
-	    GenObject* obj = static_cast<GenObject*>(t->getUserData());
-	    RefPointer<YateSIPConnection> conn = YOBJECT(YateSIPConnection,obj);
-	    YateSIPLine* line = YOBJECT(YateSIPLine,obj);
-	    YateSIPGenerate* gen = YOBJECT(YateSIPGenerate,obj);
-	    plugin.unlock();
-	    if (conn) {
-		if (conn->process(e)) {
-		    delete e;
-		    break;
-		}
-		else
-		    continue;
+	if (t->isOutgoing() && t->getResponseCode() == 408) {
+	    if (t->getMethod() == YSTRING("BYE")) {
+		DDebug(&plugin,DebugInfo,"BYE for transaction %p has timed out",t);
+		m_timedOutByes++;
+		plugin.changed();
 	    }
-	    if (line) {
-		if (line->process(e)) {
-		    delete e;
-		    break;
-		}
-		else
-		    continue;
+	    if (e->getState() == SIPTransaction::Cleared && e->getUserData()) {
+		DDebug(&plugin,DebugInfo,"Transaction %p has timed out",t);
+		m_timedOutTrs++;
+		plugin.changed();
 	    }
-	    if (gen) {
-		if (gen->process(e)) {
-		    delete e;
-		    break;
-		}
-		else
-		    continue;
+	}
+
+	GenObject* obj = static_cast<GenObject*>(t->getUserData());
+	RefPointer<YateSIPConnection> conn = YOBJECT(YateSIPConnection,obj);
+	YateSIPLine* line = YOBJECT(YateSIPLine,obj);
+	YateSIPGenerate* gen = YOBJECT(YateSIPGenerate,obj);
+	plugin.unlock();
+	if (conn) {
+	    if (conn->process(e)) {
+		delete e;
+		break;
 	    }
-	    if ((e->getState() == SIPTransaction::Trying) &&
-		!e->isOutgoing() && incoming(e,e->getTransaction())) {
+	    else
+		continue;
+	}
+	if (line) {
+	    if (line->process(e)) {
 		delete e;
 		break;
 	    }
+	    else
+		continue;
+	}
+	if (gen) {
+	    if (gen->process(e)) {
+		delete e;
+		break;
+	    }
+	    else
+		continue;
+	}
+	if ((e->getState() == SIPTransaction::Trying) &&
+	    !e->isOutgoing() && incoming(e,e->getTransaction())) {
+	    delete e;
+	    break;
 	}
-	if (s_evCount || s_engineHalt)
-	    Thread::check();
-	else
-	    Thread::usleep(Thread::idleUsec());
     }
 }
 
+void YateSIPEndPoint::startWorkers(unsigned int count, Thread::Priority prio)
+{
+    if (m_workers || !count)
+	return;
+    m_workers = new YateSIPEventWorker*[count];
+    for (unsigned int i = 0; i < count; i++)
+	m_workers[i] = 0;
+    for (unsigned int i = 0; i < count; i++) {
+	YateSIPEventWorker* w = new YateSIPEventWorker(this,i,prio);
+	m_workers[i] = w;
+	if (!w->startup()) {
+	    Debug(&plugin,DebugWarn,"Failed to start SIP event worker %u",i);
+	    m_workers[i] = 0;
+	    delete w;
+	}
+    }
+    m_workerCount = count;
+    Debug(&plugin,DebugInfo,"Started %u SIP event workers",count);
+}
+
+void YateSIPEndPoint::stopWorkers()
+{
+    bool wait = false;
+    m_workerMutex.lock();
+    for (unsigned int i = 0; i < m_workerCount; i++) {
+	if (!m_workers[i])
+	    continue;
+	wait = true;
+	m_workers[i]->cancel();
+	m_workers[i]->m_wake.unlock();
+    }
+    m_workerMutex.unlock();
+    while (wait) {
+	Thread::idle();
+	wait = false;
+	Lock lck(m_workerMutex);
+	for (unsigned int i = 0; i < m_workerCount; i++)
+	    wait = wait || (m_workers[i] != 0);
+    }
+}
+
+YateSIPEventWorker::YateSIPEventWorker(YateSIPEndPoint* ep, unsigned int index, Thread::Priority prio)
+    : Thread("YSIP Worker",prio),
+      m_endpoint(ep), m_index(index),
+      m_mutex(false,"YateSIPEventWorker"), m_wake(1,"YateSIPEventWorker"),
+      m_tail(&m_queue), m_queued(0), m_maxQueued(0),
+      m_events(0), m_latency(0), m_maxLatency(0), m_rejected(0)
+{
+    DDebug(&plugin,DebugAll,"YateSIPEventWorker(%u) [%p]",index,this);
+}
+
+YateSIPEventWorker::~YateSIPEventWorker()
+{
+    DDebug(&plugin,DebugAll,"~YateSIPEventWorker(%u) [%p]",m_index,this);
+}
+
+void YateSIPEventWorker::run()
+{
+    while (!Thread::check(false)) {
+	m_mutex.lock();
+	if (m_queue.next() == m_tail)
+	    m_tail = &m_queue;
+	YateSIPQueuedEvent* q = static_cast<YateSIPQueuedEvent*>(m_queue.remove(false));
+	if (q) {
+	    u_int64_t latency = Time::now() - q->m_time;
+	    m_queued--;
+	    m_events++;
+	    m_latency += latency;
+	    if (m_maxLatency < latency)
+		m_maxLatency = latency;
+	}
+	m_mutex.unlock();
+	if (!q) {
+	    m_wake.lock(Thread::idleUsec());
+	    continue;
+	}
+	m_endpoint->m_workerMutex.lock();
+	YateSIPEndPoint::s_evQueued--;
+	m_endpoint->m_workerMutex.unlock();
+	SIPEvent* e = q->m_event;
+	q->m_event = 0;
+	TelEngine::destruct(q);
+	m_endpoint->dispatch(e);
+    }
+}
+
+void YateSIPEventWorker::cleanup()
+{
+    // unprocessed events hold transactions, drop them while engine exists
+    m_mutex.lock();
+    m_queue.clear();
+    m_tail = &m_queue;
+    unsigned int dropped = m_queued;
+    m_queued = 0;
+    m_mutex.unlock();
+    Lock lck(m_endpoint->m_workerMutex);
+    YateSIPEndPoint::s_evQueued -= dropped;
+    if (m_endpoint->m_workers && (m_endpoint->m_workers[m_index] == this))
+	m_endpoint->m_workers[m_index] = 0;
+}
+
+bool YateSIPEventWorker::enqueue(SIPEvent* event, bool force)
+{
+    Lock lck(m_mutex);
+    if (!force && s_workerQueue && (m_queued >= s_workerQueue)) {
+	m_rejected++;
+	return false;
+    }
+    m_tail = m_tail->append(new YateSIPQueuedEvent(event));
+    if (++m_queued > m_maxQueued)
+	m_maxQueued = m_queued;
+    lck.drop();
+    m_wake.unlock();
+    return true;
+}
+
+void YateSIPEventWorker::status(String& buf)
+{
+    Lock lck(m_mutex);
+    buf << m_queued << "|" << m_maxQueued << "|" << m_events << "|";
+    buf << (unsigned int)(m_events ? (m_latency / m_events) : 0) << "|";
+    buf << (unsigned int)m_maxLatency << "|" << m_rejected;
+}
+
 bool YateSIPEndPoint::incoming(SIPEvent* e, SIPTransaction* t)
 {
     if (t->isInvite())
@@ -7979,6 +8628,7 @@ bool SIPDriver::received(Message& msg, int id)
 	dropAll(msg);
 	channels().clear();
 	s_lines.clear();
+	m_endpoint->stopWorkers();
 	// Clear transactions: they keep references to parties and transports
 	m_endpoint->engine()->clearTransactions();
 	m_endpoint->clearUdpTransports("Exiting");
@@ -8082,6 +8732,7 @@ void SIPDriver::initialize()
     s_honorDtmfDetect = s_cfg.getBoolValue("general","honor_dtmf_detect",true);
     s_maxForwards = s_cfg.getIntValue("general","maxforwards",20);
     s_floodEvents = s_cfg.getIntValue("general","floodevents",100);
+    s_workerQueue = s_cfg.getIntValue("general","workerqueue",1000,0);
     s_floodProtection = s_cfg.getBoolValue("general","floodprotection",true);
     s_privacy = s_cfg.getBoolValue("general","privacy");
     s_auto_nat = s_cfg.getBoolValue("general","nat",true);
@@ -8116,6 +8767,8 @@ void SIPDriver::initialize()
 	    m_endpoint = 0;
 	    return;
 	}
+	m_endpoint->startWorkers(s_cfg.getIntValue("general","workers",0,0,64),prio);
+	YateSIPTCPReactor::start(s_cfg.getIntValue("general","tcp_reactors",0,0,64),prio);
 	m_endpoint->startup();
 	setup();
 	installRelay(Halt);
@@ -8222,6 +8875,8 @@ bool SIPDriver::commandComplete(Message& msg, const String& partLine, const Stri
 	itemComplete(msg.retValue(),YSTRING("accounts"),partWord);
 	itemComplete(msg.retValue(),YSTRING("listeners"),partWord);
 	itemComplete(msg.retValue(),YSTRING("transports"),partWord);
+	itemComplete(msg.retValue(),YSTRING("workers"),partWord);
+	itemComplete(msg.retValue(),YSTRING("reactors"),partWord);
     }
     String cmdTrans = cmd + " transports";
     String cmdOverViewTrans = overviewCmd + " transports";
@@ -8268,6 +8923,10 @@ void SIPDriver::msgStatus(Message& msg)
 	}
 	else if (str.startSkip("listeners"))
 	    msgStatusListener(msg);
+	else if (str.startSkip("workers"))
+	    msgStatusWorkers(msg);
+	else if (str.startSkip("reactors"))
+	    msgStatusReactors(msg);
     }
 }
 
@@ -8411,6 +9070,48 @@ void SIPDriver::msgStatusListener(Message& msg)
     msg.retValue() << "\r\n";
 }
 
+// Add event workers status
+void SIPDriver::msgStatusWorkers(Message& msg)
+{
+    msg.retValue().clear();
+    msg.retValue() << "module=" << name();
+    msg.retValue() << ",protocol=SIP";
+    msg.retValue() << ",format=Queued|MaxQueued|Events|AvgLatency|MaxLatency|Rejected;";
+    String buf;
+    unsigned int n = 0;
+    if (m_endpoint) {
+	bool details = msg.getBoolValue("details",true);
+	Lock lock(m_endpoint->m_workerMutex);
+	for (unsigned int i = 0; i < m_endpoint->m_workerCount; i++) {
+	    YateSIPEventWorker* w = m_endpoint->m_workers[i];
+	    if (!w)
+		continue;
+	    n++;
+	    if (!details)
+		continue;
+	    buf.append(String(i),",") << "=";
+	    w->status(buf);
+	}
+    }
+    msg.retValue() << "workers=" << n;
+    msg.retValue().append(buf,";"); 
+    msg.retValue() << "\r\n";
+}
+
+// Add TCP reactors status
+void SIPDriver::msgStatusReactors(Message& msg)
+{
+    msg.retValue().clear();
+    msg.retValue() << "module=" << name();
+    msg.retValue() << ",protocol=SIP";
+    msg.retValue() << ",format=Connections;";
+    String buf;
+    unsigned int n = YateSIPTCPReactor::status(buf,msg.getBoolValue("details",true));
+    msg.retValue() << "reactors=" << n;
+    msg.retValue().append(buf,";"); 
+    msg.retValue() << "\r\n";
+}
+
 // Add transport status
 void SIPDriver::msgStatusTransport(Message& msg, const String& id)
 {
@@ -1650,6 +1650,20 @@ public:
     inline unsigned int length() const
 	{ return m_length; }
 
+    /**
+     * Get the number of characters the string can hold without reallocating.
+     * @return Capacity of the allocated buffer, zero for NULL.
+     */
+    inline unsigned int capacity() const
+	{ return m_string ? ((m_capacity > m_length) ? m_capacity : m_length) : 0; }
+
+    /**
+     * Make room for a string of the given length so appending up to it will not
+     *  reallocate. A NULL string stays NULL and allocates the room on first use.
+     * @param len Number of characters to make room for
+     */
+    void reserve(unsigned int len);
+
     /**
      * Checks if the string holds a NULL pointer.
      * @return True if the string holds NULL, false otherwise.
@@ -2334,9 +2348,15 @@ protected:
      virtual void changed();
 
 private:
+    friend class StringBuilder;
     void clearMatches();
+    bool grow(unsigned int len);
+    bool appendRaw(const char* value, unsigned int len);
+    void lengthChanged(unsigned int len);
     char* m_string;
     unsigned int m_length;
+    unsigned int m_capacity;
+    bool m_lengthSet;
     // I hope every C++ compiler now knows about mutable...
     mutable unsigned int m_hash;
     StringMatchPrivate* m_matches;
@@ -2429,6 +2449,113 @@ YATE_API int lookup(const char* str, const TokenDict* tokens, int defvalue = 0,
  */
 YATE_API const char* lookup(int value, const TokenDict* tokens, const char* defvalue = 0);
 
+/**
+ * A helper that appends many pieces to a String without notifying each change.
+ * The string grows geometrically and its hash and matches are updated only
+ *  once, when the builder is flushed or destroyed.
+ * @short Fast appending to a String
+ */
+class YATE_API StringBuilder
+{
+    YNOCOPY(StringBuilder); // no automatic copies please
+public:
+    /**
+     * Constructor
+     * @param str String to append to
+     * @param reserve Number of characters expected to be appended
+     */
+    explicit StringBuilder(String& str, unsigned int reserve = 0);
+
+    /**
+     * Destructor, flushes the appended data
+     */
+    inline ~StringBuilder()
+	{ flush(); }
+
+    /**
+     * Get the length of the string built so far
+     * @return Length of the string
+     */
+    inline unsigned int length() const
+	{ return m_str.length(); }
+
+    /**
+     * Notify the string about the data appended so far
+     * @return Reference to the string
+     */
+    String& flush();
+
+    /**
+     * Append characters to the string
+     * @param value Pointer to the characters to append
+     * @param len Number of characters to append, must not include any NUL
+     * @return Reference to this builder
+     */
+    StringBuilder& append(const char* value, unsigned int len);
+
+    /**
+     * Append a C string
+     * @param value String to append, may be NULL
+     * @return Reference to this builder
+     */
+    StringBuilder& operator<<(const char* value);
+
+    /**
+     * Append a String
+     * @param value String to append
+     * @return Reference to this builder
+     */
+    inline StringBuilder& operator<<(const String& value)
+	{ return append(value.c_str(),value.length()); }
+
+    /**
+     * Append a single character
+     * @param value Character to append
+     * @return Reference to this builder
+     */
+    StringBuilder& operator<<(char value);
+
+    /**
+     * Append the decimal representation of an integer
+     * @param value Number to append
+     * @return Reference to this builder
+     */
+    StringBuilder& operator<<(int value);
+
+    /**
+     * Append the decimal representation of an unsigned integer
+     * @param value Number to append
+     * @return Reference to this builder
+     */
+    StringBuilder& operator<<(unsigned int value);
+
+    /**
+     * Append the decimal representation of a 64 bit integer
+     * @param value Number to append
+     * @return Reference to this builder
+     */
+    StringBuilder& operator<<(int64_t value);
+
+    /**
+     * Append the decimal representation of an unsigned 64 bit integer
+     * @param value Number to append
+     * @return Reference to this builder
+     */
+    StringBuilder& operator<<(u_int64_t value);
+
+    /**
+     * Append a boolean as text
+     * @param value Boolean to append
+     * @return Reference to this builder
+     */
+    inline StringBuilder& operator<<(bool value)
+	{ return operator<<(String::boolText(value)); }
+
+private:
+    String& m_str;
+    bool m_changed;
+};
+
 class NamedList;
 
 /**
@@ -3195,6 +3322,19 @@ private:
 class YATE_API DataBlock : public GenObject
 {
 public:
+    /**
+     * Conversions between the basic audio formats supported by convert()
+     */
+    enum Conversion {
+	NoConversion = 0,
+	CopyData,
+	SlinToAlaw,
+	SlinToMulaw,
+	AlawToSlin,
+	AlawToMulaw,
+	MulawToSlin,
+	MulawToAlaw,
+    };
 
     /**
      * Constructs an empty data block
@@ -3289,11 +3429,7 @@ public:
      * @param value Data to append
      * @param len Length of data
      */
-    inline void append(void* value, unsigned int len) {
-	    DataBlock tmp(value,len,false);
-	    append(tmp);
-	    tmp.clear(false);
-	}
+    void append(void* value, unsigned int len);
 
     /**
      * Append data to the current block
@@ -3313,6 +3449,34 @@ public:
      */
     void insert(const DataBlock& value);
 
+    /**
+     * Insert data before the current block
+     * @param value Data to insert
+     * @param len Length of data
+     */
+    void insert(void* value, unsigned int len);
+
+    /**
+     * Make room in the buffer so data can be added without reallocating it
+     * @param tail Number of bytes that can be appended afterwards
+     * @param head Number of bytes that can be inserted afterwards
+     */
+    void reserve(unsigned int tail, unsigned int head = 0);
+
+    /**
+     * Get the number of bytes that can be inserted without reallocating
+     * @return Unused space in front of the data
+     */
+    inline unsigned int headroom() const
+	{ return m_offset; }
+
+    /**
+     * Get the number of bytes that can be appended without reallocating
+     * @return Unused space after the data
+     */
+    inline unsigned int tailroom() const
+	{ return m_size - m_offset - m_length; }
+
     /**
      * Resize (re-alloc or free) this block if required size is not the same as the current one
      * @param len Required block size
@@ -3323,13 +3487,14 @@ public:
 	}
 
     /**
-     * Truncate the data block
+     * Truncate the data block, the memory is kept for appending later
      * @param len The maximum length to keep
      */
     void truncate(unsigned int len);
 
     /**
-     * Cut off a number of bytes from the data block
+     * Cut off a number of bytes from the data block.
+     * No data is moved, the memory is kept as head or tail room
      * @param len Amount to cut, positive to cut from end, negative to cut from start of block
      */
     void cut(int len);
@@ -3378,6 +3543,33 @@ public:
     bool convert(const DataBlock& src, const String& sFormat,
 	const String& dFormat, unsigned maxlen = 0);
 
+    /**
+     * Convert data using a conversion resolved in advance
+     * @param src Source data block
+     * @param conv Conversion to apply as returned by conversion()
+     * @param maxlen Maximum amount to convert, 0 to use source
+     * @return True if converted successfully, false on failure
+     */
+    bool convert(const DataBlock& src, Conversion conv, unsigned maxlen = 0);
+
+    /**
+     * Find the conversion between two formats, callers that convert
+     *  many blocks should resolve it only once
+     * @param sFormat Name of the source format
+     * @param dFormat Name of the destination format
+     * @return Conversion between the formats, NoConversion if not supported
+     */
+    static Conversion conversion(const String& sFormat, const String& dFormat);
+
+    /**
+     * Set or retrieve the instruction set used by the audio conversion kernels.
+     * The best one supported by the processor is used by default
+     * @param level Highest level to use: 0 portable code, 1 SSE2, 2 AVX2,
+     *  negative to just retrieve the current level
+     * @return Level in use, may be lower than requested if not supported
+     */
+    static int convertLevel(int level = -1);
+
     /**
      * Build this data block from a hexadecimal string representation.
      * Each octet must be represented in the input string with 2 hexadecimal characters.
@@ -3398,8 +3590,139 @@ public:
     String sqlEscape(char extraEsc) const;
 
 private:
+    friend class DataSlice;
+    bool relocate(unsigned int head, unsigned int size);
+    bool growTail(unsigned int len);
+    bool growHead(unsigned int len);
     void* m_data;
     unsigned int m_length;
+    unsigned int m_offset;
+    void* m_buffer;
+    unsigned int m_size;
+};
+
+/**
+ * A read only view of a range of bytes held in a reference counted buffer.
+ * Copies and sub-slices share the buffer instead of copying the bytes so a
+ *  slice is cheap to pass down a protocol stack or to keep in a queue
+ * @short A shared slice of binary data
+ */
+class YATE_API DataSlice : public GenObject
+{
+public:
+    /**
+     * Constructs an empty slice
+     */
+    DataSlice();
+
+    /**
+     * Copy constructor, shares the buffer of the other slice
+     * @param value Original slice
+     */
+    DataSlice(const DataSlice& value);
+
+    /**
+     * Constructs a slice of part of another slice, shares its buffer
+     * @param value Original slice
+     * @param offs Offset of the first byte inside the original slice
+     * @param len Maximum number of bytes to include
+     */
+    DataSlice(const DataSlice& value, unsigned int offs, unsigned int len = (unsigned int)-1);
+
+    /**
+     * Constructs a slice holding a copy of the data in a block
+     * @param value Data block to copy
+     */
+    explicit DataSlice(const DataBlock& value);
+
+    /**
+     * Constructs a slice from a data block, optionally taking its buffer
+     * @param value Data block to use
+     * @param take True to take the buffer from the block and leave it empty,
+     *  false to copy the data
+     */
+    DataSlice(DataBlock& value, bool take);
+
+    /**
+     * Destructor, releases the buffer if no other slice uses it
+     */
+    virtual ~DataSlice();
+
+    /**
+     * Get a pointer to the data of the slice
+     * @return A pointer to the data or NULL if the slice is empty
+     */
+    inline const unsigned char* data() const
+	{ return m_data; }
+
+    /**
+     * Get a pointer to a byte range inside the slice
+     * @param offs Byte offset inside the slice
+     * @param len Number of bytes that must be valid starting at offset
+     * @return A pointer to the data or NULL if the range is not available
+     */
+    inline const unsigned char* data(unsigned int offs, unsigned int len = 1) const
+	{ return (offs + len <= m_length) ? (m_data + offs) : 0; }
+
+    /**
+     * Get the value of a single byte inside the slice
+     * @param offs Byte offset inside the slice
+     * @param defvalue Default value to return if offset is outside data
+     * @return Byte value at offset (0-255) or defvalue if offset outside data
+     */
+    inline int at(unsigned int offs, int defvalue = -1) const
+	{ return (offs < m_length) ? m_data[offs] : defvalue; }
+
+    /**
+     * Byte indexing operator
+     * @param index Index of the byte to retrieve
+     * @return Byte value at offset (0-255) or -1 if index outside data
+     */
+    inline int operator[](unsigned int index) const
+	{ return at(index); }
+
+    /**
+     * Get the length of the slice
+     * @return The number of bytes in the slice
+     */
+    inline unsigned int length() const
+	{ return m_length; }
+
+    /**
+     * Check if the slice is empty
+     * @return True if the slice holds no data
+     */
+    inline bool null() const
+	{ return !m_data; }
+
+    /**
+     * Release the buffer and make the slice empty
+     */
+    void clear();
+
+    /**
+     * Cut off a number of bytes from the slice, the buffer is not changed
+     * @param len Amount to cut, positive to cut from end, negative to cut from start
+     */
+    void cut(int len);
+
+    /**
+     * Copy the data of the slice at the end of a data block
+     * @param dest Data block to append to
+     */
+    inline void appendTo(DataBlock& dest) const
+	{ dest.append((void*)m_data,m_length); }
+
+    /**
+     * Assignment operator, shares the buffer of the other slice
+     */
+    DataSlice& operator=(const DataSlice& value);
+
+private:
+    void set(RefObject* buffer, const unsigned char* data, unsigned int len);
+    RefObject* m_buffer;
+    const unsigned char* m_data;
+    unsigned int m_length;
 };
 
 /**
@@ -3726,7 +4049,10 @@ public:
 class NamedIterator;
 
 /**
- * This class holds a named list of named strings
+ * This class holds a named list of named strings.
+ * Parameters are kept in insertion order, duplicate names are allowed.
+ * Lookups by name in large lists are helped by an internal hash index
+ *  that is built once the number of parameters crosses a small threshold.
  * @short A named string container class
  */
 class YATE_API NamedList : public String
@@ -3781,11 +4107,15 @@ public:
     inline unsigned int count() const
 	{ return m_params.count(); }
 
+    /**
+     * Destructor
+     */
+    virtual ~NamedList();
+
     /**
      * Clear all parameters
      */
-    inline void clearParams()
-	{ m_params.clear(); }
+    void clearParams();
 
     /**
      * Add a named string to the parameter list.
@@ -3992,7 +4322,11 @@ public:
 
 private:
     NamedList(); // no default constructor please
+    void indexParam(NamedString* param);
+    void unindexParam(NamedString* param);
     ObjList m_params;
+    HashList* m_index;
+    unsigned int m_unindexed;
 };
 
 /**
@@ -5619,6 +5953,101 @@ protected:
     HANDLE m_handle;
 };
 
+/**
+ * A set of preallocated datagram buffers used to send or receive many
+ *  packets with a single system call where the platform supports it
+ * @short Buffers for batched datagram socket operations
+ */
+class YATE_API SocketBatch
+{
+    friend class Socket;
+    YNOCOPY(SocketBatch); // no automatic copies please
+public:
+    /**
+     * Constructor, allocates all the packet buffers
+     * @param capacity Maximum number of packets held in the batch
+     * @param size Size of each packet buffer in octets
+     */
+    SocketBatch(unsigned int capacity = 16, unsigned int size = 1500);
+
+    /**
+     * Destructor, releases the packet buffers
+     */
+    ~SocketBatch();
+
+    /**
+     * Get the number of packets currently held
+     * @return Number of received packets or packets queued for sending
+     */
+    inline unsigned int count() const
+	{ return m_count; }
+
+    /**
+     * Get the maximum number of packets the batch can hold
+     * @return Number of preallocated packet buffers
+     */
+    inline unsigned int capacity() const
+	{ return m_capacity; }
+
+    /**
+     * Get the size of each packet buffer
+     * @return Size of a packet buffer in octets
+     */
+    inline unsigned int size() const
+	{ return m_size; }
+
+    /**
+     * Check if the batch cannot accept more packets
+     * @return True if all packet buffers are in use
+     */
+    inline bool full() const
+	{ return m_count >= m_capacity; }
+
+    /**
+     * Discard all the packets held in the batch
+     */
+    inline void clear()
+	{ m_count = 0; }
+
+    /**
+     * Get the data of a packet
+     * @param index Index of the packet, must be less than count()
+     * @return Pointer to the packet data
+     */
+    unsigned char* data(unsigned int index) const;
+
+    /**
+     * Get the length of a packet
+     * @param index Index of the packet, must be less than count()
+     * @return Length of the packet data in octets
+     */
+    int length(unsigned int index) const;
+
+    /**
+     * Get the source or destination address of a packet
+     * @param index Index of the packet, must be less than count()
+     * @param adrlen Optional pointer to fill with the length of the address
+     * @return Pointer to the address structure
+     */
+    const struct sockaddr* address(unsigned int index, socklen_t* adrlen = 0) const;
+
+    /**
+     * Queue a copy of a packet for sending
+     * @param data Pointer to the packet data
+     * @param length Length of the packet data, must not exceed size()
+     * @param addr Address to send the packet to
+     * @return True if the packet was queued, false if full or invalid
+     */
+    bool add(const void* data, int length, const SocketAddr& addr);
+
+private:
+    unsigned int m_capacity;
+    unsigned int m_size;
+    unsigned int m_count;
+    unsigned char* m_buffer;
+    void* m_packets;
+};
+
 /**
  * This class encapsulates a system dependent socket in a system independent abstraction
  * @short A generic socket class
@@ -5980,6 +6409,24 @@ public:
      */
     int recvFrom(void* buffer, int length, SocketAddr& addr, int flags = 0);
 
+    /**
+     * Receive as many messages as fit in a batch, with a single system call
+     *  if the platform supports it. Messages claimed by filters are dropped.
+     * @param batch Batch to fill with the received messages, any old content is lost
+     * @param flags Operating system specific bit flags that change the behaviour
+     * @return Number of messages in the batch, @ref socketError() if an error occurred
+     */
+    int recvBatch(SocketBatch& batch, int flags = 0);
+
+    /**
+     * Send all the messages queued in a batch, with a single system call
+     *  if the platform supports it. The batch is cleared even on failure.
+     * @param batch Batch holding the messages to send
+     * @param flags Operating system specific bit flags that change the behaviour
+     * @return Number of messages sent, @ref socketError() if an error occurred
+     */
+    int sendBatch(SocketBatch& batch, int flags = 0);
+
     /**
      * Receive a message from a connected socket
      * @param buffer Buffer for data transfer
@@ -463,6 +463,7 @@ private:
     RefObject* m_data;
     bool m_notify;
     bool m_broadcast;
+    bool m_queued;
     void commonEncode(String& str) const;
     int commonDecode(const char* str, int offs);
 };
@@ -718,28 +719,68 @@ public:
      *  called and the return value is true if any handler returned true.
      * Note that in some cases when a handler is removed from the list
      *  other handlers with equal priority may be called twice.
+     * The dispatcher is not locked while walking the handlers, it works on a
+     *  snapshot of them that is replaced when handlers are (un)installed.
      * @param msg The message to dispatch
      * @return True if one handler accepted it, false if all ignored
      */
     bool dispatch(Message& msg);
 
     /**
-     * Put a message in the waiting queue for asynchronous dispatching
+     * Put a message in the waiting queue for asynchronous dispatching.
+     * The message goes in the queue of the first message class matching its
+     *  name or in the default queue if no class matches.
      * @param msg The message to enqueue, will be destroyed after dispatching
-     * @return True if successfully queued, false otherwise
+     *  or immediately if the queue of its class is full and refuses it
+     * @return True if successfully queued, false if the message was already
+     *  queued (it is left untouched) or it was refused and destroyed
      */
     bool enqueue(Message* msg);
 
     /**
-     * Dispatch all messages from the waiting queue
+     * Dispatch all messages from the waiting queues of all message classes
      */
     void dequeue();
 
     /**
-     * Dispatch one message from the waiting queue
+     * Dispatch one message from the waiting queue of a message class
+     * @param cls Index of the message class, zero for the default queue
      * @return True if success, false if the queue is empty
      */
-    bool dequeueOne();
+    bool dequeueOne(unsigned int cls = 0);
+
+    /**
+     * Wait until a message is put in the waiting queue of a message class
+     * @param maxwait Maximum time to wait in microseconds, -1 to wait forever
+     * @param cls Index of the message class, zero for the default queue
+     * @return True if a message was enqueued, false if timed out
+     */
+    bool waitMessage(long maxwait = -1, unsigned int cls = 0);
+
+    /**
+     * Add a class of enqueued messages that has its own waiting queue
+     * @param name Name of the message class
+     * @param match Regular expression matching the names of the messages in the class
+     * @param maxDepth Maximum number of messages in the queue, zero for no limit
+     * @param dropOld True to drop the oldest message if the queue is full,
+     *  false to refuse enqueueing new messages
+     * @return Index of the new message class, zero on failure
+     */
+    unsigned int addClass(const char* name, const char* match,
+	unsigned int maxDepth = 0, bool dropOld = false);
+
+    /**
+     * Get the number of message classes, including the default one
+     * @return Count of message classes
+     */
+    unsigned int classCount();
+
+    /**
+     * Append the status of the message classes to a string, for each class
+     *  name=queued|highest|maxdepth|enqueued|dropped
+     * @param str String to append the comma separated status to
+     */
+    void classStatus(String& str);
 
     /**
      * Set a limit to generate warning when a message took too long to dispatch
@@ -751,12 +792,11 @@ public:
     /**
      * Clear all the message handlers and post-dispatch hooks
      */
-    inline void clear()
-	{ m_handlers.clear(); m_hooks.clear(); }
+    void clear();
 
     /**
-     * Get the number of messages waiting in the queue
-     * @return Count of messages in the queue
+     * Get the number of messages waiting in all the queues
+     * @return Count of messages in the queues
      */
     unsigned int messageCount();
 
@@ -782,11 +822,20 @@ protected:
 	{ m_trackParam = paramName; }
 
 private:
+    RefObject* grab();
+    void publish(RefObject* snapshot);
+    void purge();
+    void update(MessageHandler* handler, bool install);
     ObjList m_handlers;
-    ObjList m_messages;
+    ObjList m_classes;
+    HashList m_classMap;
+    unsigned int m_msgCount;
     ObjList m_hooks;
+    ObjList m_retired;
+    volatile unsigned int m_retiredCount;
+    RefObject* volatile m_snapshot;
+    int m_grabbing;
     String m_trackParam;
-    unsigned int m_changes;
     u_int64_t m_warnTime;
 };
 
@@ -1198,7 +1247,9 @@ public:
     /**
      * Enqueue a message in the message queue for asynchronous dispatching
      * @param msg The message to enqueue, will be destroyed after dispatching
-     * @return True if enqueued, false on error (already queued)
+     *  or immediately if it cannot be queued
+     * @return True if enqueued, false if the message was already queued (it is
+     *  left untouched) or it was refused and destroyed
      */
     static bool enqueue(Message* msg);
 
@@ -1207,7 +1258,7 @@ public:
      * Enqueue a new parameterless message in the message queue
      * @param name Name of the parameterless message to put in queue
      * @param broadcast Broadcast flag, true if handling the mesage must not stop it
-     * @return True if enqueued, false on error (already queued)
+     * @return True if enqueued, false on error (queue full)
      */
     inline static bool enqueue(const char* name, bool broadcast = false)
 	{ return name && *name && enqueue(new Message(name,0,broadcast)); }
@@ -1257,8 +1308,8 @@ public:
     int usedPlugins();
 
     /**
-     * Get the number of messages waiting in the queue
-     * @return Count of messages in the queue
+     * Get the number of messages waiting in all the queues
+     * @return Count of messages in the queues
      */
     inline unsigned int messageCount()
 	{ return m_dispatcher.messageCount(); }